@@ -18,6 +18,10 @@ DEFINES += FAST_NEFF_SHUFFLE
 # UNCOMMENT THE FOLLOWING TO ENABLE BLOG DROP BLAME FOR CSBULK
 # DEFINES += CS_BLOG_DROP
 
+# UNCOMMENT THE FOLLOWING TO USE THE ORIGINAL X9.17 PADS IN CSBULK RATHER THAN
+# AES-CTR, ALL NODES MUST AGREE, BLAME IS SLOWER WITH THEM
+# DEFINES += CSBR_COMPATIBLE_PADS
+
 QMAKE_CXXFLAGS += -Werror -std=c++11
 QMAKE_CFLAGS += -Werror
 
@@ -67,6 +71,7 @@ HEADERS += src/Dissent.hpp \
            src/Anonymity/Round.hpp \
            src/Anonymity/RoundFactory.hpp \
            src/Anonymity/RoundStateMachine.hpp \
+           src/Anonymity/SlotSender.hpp \
            src/Applications/CommandLine.hpp \
            src/Applications/ConsoleSink.hpp \
            src/Applications/FileSink.hpp \
@@ -93,11 +98,15 @@ HEADERS += src/Dissent.hpp \
            src/Crypto/DiffieHellman.hpp \
            src/Crypto/Hash.hpp \
            src/Crypto/Integer.hpp \
+           src/Crypto/KeyPool.hpp \
            src/Crypto/KeyShare.hpp \
            src/Crypto/LRSPrivateKey.hpp \
            src/Crypto/LRSPublicKey.hpp \
            src/Crypto/LRSSignature.hpp \
+           src/Crypto/MultiExponentiation.hpp \
            src/Crypto/OnionEncryptor.hpp \
+           src/Crypto/PadEngine.hpp \
+           src/Crypto/PadGenerator.hpp \
            src/Crypto/ThreadedOnionEncryptor.hpp \
            src/Crypto/Serialization.hpp \
            src/Crypto/Utils.hpp \
@@ -109,6 +118,7 @@ HEADERS += src/Dissent.hpp \
            src/Crypto/AbstractGroup/AbstractGroup.hpp \
            src/Crypto/AbstractGroup/ECParams.hpp \
            src/Crypto/AbstractGroup/IntegerElementData.hpp \
+           src/Crypto/AbstractGroup/PrecomputedBase.hpp \
            src/Crypto/BlogDrop/PublicKey.hpp \
            src/Crypto/BlogDrop/Parameters.hpp \
            src/Crypto/BlogDrop/BlogDropUtils.hpp \
@@ -155,6 +165,8 @@ HEADERS += src/Dissent.hpp \
            src/Session/ClientRegister.hpp \
            src/Session/ClientSession.hpp \
            src/Session/ClientStates.hpp \
+           src/Session/DataAssembler.hpp \
+           src/Session/DataQueue.hpp \
            src/Session/SerializeList.hpp \
            src/Session/ServerAgree.hpp \
            src/Session/ServerEnlist.hpp \
@@ -181,9 +193,20 @@ HEADERS += src/Dissent.hpp \
            src/Transports/EdgeFactory.hpp \
            src/Transports/EdgeListener.hpp \
            src/Transports/EdgeListenerFactory.hpp \
+           src/Transports/EpollAddress.hpp \
+           src/Transports/EpollEdge.hpp \
+           src/Transports/EpollEdgeListener.hpp \
+           src/Transports/EpollReactor.hpp \
+           src/Transports/FrameReader.hpp \
+           src/Transports/FrameWriter.hpp \
            src/Transports/TcpAddress.hpp \
            src/Transports/TcpEdge.hpp \
            src/Transports/TcpEdgeListener.hpp \
+           src/Transports/UdpAddress.hpp \
+           src/Transports/UdpEdge.hpp \
+           src/Transports/UdpEdgeListener.hpp \
+           src/Transports/UdpSession.hpp \
+           src/Utils/DnsCache.hpp \
            src/Utils/Logging.hpp \
            src/Utils/Random.hpp \
            src/Utils/QRunTimeError.hpp \
@@ -196,8 +219,10 @@ HEADERS += src/Dissent.hpp \
            src/Utils/Timer.hpp \
            src/Utils/TimerCallback.hpp \
            src/Utils/TimerEvent.hpp \
+           src/Utils/TraceRing.hpp \
            src/Utils/Triggerable.hpp \
            src/Utils/Triple.hpp \
+           src/Utils/TunnelScheduler.hpp \
            src/Utils/Utils.hpp \
            src/Web/EchoService.hpp \
            src/Web/GetDirectoryService.hpp \
@@ -232,16 +257,19 @@ SOURCES += src/Anonymity/BaseDCNetRound.cpp \
            src/Crypto/DsaPublicKey.cpp \
            src/Crypto/NeffShuffle.cpp \
            src/Crypto/DiffieHellman.cpp \
+           src/Crypto/KeyPool.cpp \
            src/Crypto/KeyShare.cpp \
            src/Crypto/LRSPrivateKey.cpp \
            src/Crypto/LRSPublicKey.cpp \
            src/Crypto/OnionEncryptor.cpp \
+           src/Crypto/PadEngine.cpp \
            src/Crypto/RsaPrivateKey.cpp \
            src/Crypto/ThreadedOnionEncryptor.cpp \
            src/Crypto/AbstractGroup/IntegerGroup.cpp \
            src/Crypto/AbstractGroup/AbstractGroup.cpp \
            src/Crypto/AbstractGroup/CppECGroup.cpp \
            src/Crypto/AbstractGroup/ECParams.cpp \
+           src/Crypto/AbstractGroup/PrecomputedBase.cpp \
            src/Crypto/BlogDrop/CiphertextFactory.cpp \
            src/Crypto/BlogDrop/BlogDropServer.cpp \
            src/Crypto/BlogDrop/PublicKeySet.cpp \
@@ -264,6 +292,8 @@ SOURCES += src/Anonymity/BaseDCNetRound.cpp \
            src/Messaging/RpcHandler.cpp \
            src/Messaging/SignalSink.cpp \
            src/Session/ClientSession.cpp \
+           src/Session/DataAssembler.cpp \
+           src/Session/DataQueue.cpp \
            src/Session/ServerSession.cpp \
            src/Session/Session.cpp \
            src/Session/SessionSharedState.cpp \
@@ -276,9 +306,20 @@ SOURCES += src/Anonymity/BaseDCNetRound.cpp \
            src/Transports/EdgeFactory.cpp \
            src/Transports/EdgeListener.cpp \
            src/Transports/EdgeListenerFactory.cpp \
+           src/Transports/EpollAddress.cpp \
+           src/Transports/EpollEdge.cpp \
+           src/Transports/EpollEdgeListener.cpp \
+           src/Transports/EpollReactor.cpp \
+           src/Transports/FrameReader.cpp \
+           src/Transports/FrameWriter.cpp \
            src/Transports/TcpAddress.cpp \
            src/Transports/TcpEdge.cpp \
            src/Transports/TcpEdgeListener.cpp \
+           src/Transports/UdpAddress.cpp \
+           src/Transports/UdpEdge.cpp \
+           src/Transports/UdpEdgeListener.cpp \
+           src/Transports/UdpSession.cpp \
+           src/Utils/DnsCache.cpp \
            src/Utils/Logging.cpp \
            src/Utils/Random.cpp \
            src/Utils/Sleeper.cpp \
@@ -286,6 +327,8 @@ SOURCES += src/Anonymity/BaseDCNetRound.cpp \
            src/Utils/Time.cpp \
            src/Utils/Timer.cpp \
            src/Utils/TimerEvent.cpp \
+           src/Utils/TraceRing.cpp \
+           src/Utils/TunnelScheduler.cpp \
            src/Utils/Utils.cpp \
            src/Web/GetDirectoryService.cpp \
            src/Web/GetFileService.cpp \
@@ -305,5 +348,6 @@ SOURCES += src/Crypto/CryptoPP/CryptoRandomImpl.cpp \
            src/Crypto/CryptoPP/DsaPublicKeyImpl.cpp \
            src/Crypto/CryptoPP/HashImpl.cpp \
            src/Crypto/CryptoPP/IntegerImpl.cpp \
+           src/Crypto/CryptoPP/PadGeneratorImpl.cpp \
            src/Crypto/CryptoPP/RsaPrivateKeyImpl.cpp \
            src/Crypto/CryptoPP/RsaPublicKeyImpl.cpp
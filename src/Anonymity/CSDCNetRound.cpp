@@ -6,16 +6,21 @@
  * Consider how to have server exchange ciphertext bits ... already know both colluding parties one needs to submit the shared secret
  */
 
+#include <QDir>
+#include <QThreadPool>
+
 #include "Crypto/DsaPrivateKey.hpp"
 #include "Crypto/DsaPublicKey.hpp"
 #include "Crypto/Hash.hpp"
 #include "Identity/PublicIdentity.hpp"
+#include "Utils/Logging.hpp"
 #include "Utils/Random.hpp"
 #include "Utils/QRunTimeError.hpp"
 #include "Utils/Serialization.hpp"
 #include "Utils/Time.hpp"
 #include "Utils/Timer.hpp"
 #include "Utils/TimerCallback.hpp"
+#include "Utils/TraceRing.hpp"
 #include "Utils/Utils.hpp"
 
 #include "NeffKeyShuffleRound.hpp"
@@ -34,7 +39,41 @@ namespace Dissent {
   using Utils::QRunTimeError;
   using Utils::Serialization;
 
+  namespace {
+    template <typename T> bool ContainsIdentity(const T &identities,
+        const Connections::Id &id)
+    {
+      foreach(const PublicIdentity &identity, identities) {
+        if(identity.GetId() == id) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    /**
+     * Serializes the first count anonymous keys, a missing key is empty
+     */
+    QByteArray SerializeKeys(
+        const QVector<QSharedPointer<Crypto::AsymmetricKey> > &keys, int count)
+    {
+      QVector<QByteArray> encoded(count);
+      for(int idx = 0; idx < count && idx < keys.count(); idx++) {
+        if(keys[idx]) {
+          encoded[idx] = keys[idx]->GetByteArray();
+        }
+      }
+
+      QByteArray data;
+      QDataStream stream(&data, QIODevice::WriteOnly);
+      stream << encoded;
+      return data;
+    }
+  }
+
 namespace Anonymity {
+  int CSDCNetRound::_default_pipeline_depth = CSDCNetRound::PIPELINE_DEPTH;
+
   CSDCNetRound::CSDCNetRound(const Identity::Roster &clients,
       const Identity::Roster &servers,
       const Identity::PrivateIdentity &ident,
@@ -45,7 +84,11 @@ namespace Anonymity {
     BaseDCNetRound(clients, servers, ident, nonce, overlay, get_data, create_shuffle),
     _state_machine(this),
     _stop_next(false),
-    _get_blame_data(this, &CSDCNetRound::GetBlameData)
+    _pipeline_depth(_default_pipeline_depth),
+    _phase_log_retention(PHASE_LOG_RETENTION),
+    _phase_log_memory_window(PHASE_LOG_MEMORY_WINDOW),
+    _get_blame_data(this, &CSDCNetRound::GetBlameData),
+    _get_join_data(this, &CSDCNetRound::GetJoinData)
   {
     _state_machine.AddState(OFFLINE);
     _state_machine.AddState(SHUFFLING, -1, 0, &CSDCNetRound::StartShuffle);
@@ -70,7 +113,6 @@ namespace Anonymity {
     }
 #endif
 
-    _state_machine.AddTransition(OFFLINE, SHUFFLING);
     _state_machine.AddTransition(SHUFFLING, PROCESS_BOOTSTRAP);
     _state_machine.AddTransition(PROCESS_BOOTSTRAP, PREPARE_FOR_BULK);
     _state_machine.AddTransition(STARTING_BLAME_SHUFFLE,
@@ -83,7 +125,12 @@ namespace Anonymity {
       InitClient();
     }
 
-    _state->slot_open = false;
+    // Clients missing from the roster are joining a round in progress
+    if(_state->joining) {
+      _state_machine.AddTransition(OFFLINE, JOIN_WAIT_FOR_BATCH);
+    } else {
+      _state_machine.AddTransition(OFFLINE, SHUFFLING);
+    }
 
     Hash hashalgo;
     QByteArray hashval = hashalgo.ComputeHash(GetNonce());
@@ -133,11 +180,7 @@ namespace Anonymity {
     Q_ASSERT(_state);
     _server_state->handled_servers_bits = QBitArray(GetClients().Count(), false);
 
-    _server_state->current_phase_log =
-      QSharedPointer<PhaseLog>(
-          new PhaseLog(_state_machine.GetPhase(), GetClients().Count()));
-    _server_state->phase_logs[_state_machine.GetPhase()] =
-      _server_state->current_phase_log;
+    _server_state->current_phase_log = GetPhaseLog(_state_machine.GetPhase());
 
 #ifndef CSBR_RECONNECTS
     foreach(const QSharedPointer<Connections::Connection> &con,
@@ -158,6 +201,8 @@ namespace Anonymity {
     _state_machine.AddState(SERVER_WAIT_FOR_CLIENT_LISTS,
         SERVER_CLIENT_LIST, &CSDCNetRound::HandleServerClientList,
         &CSDCNetRound::SubmitClientList);
+    _state_machine.AddState(SERVER_GENERATE_CIPHERTEXT, -1, 0,
+        &CSDCNetRound::StartServerCiphertext);
     _state_machine.AddState(SERVER_WAIT_FOR_SERVER_COMMITS,
         SERVER_COMMIT, &CSDCNetRound::HandleServerCommit,
         &CSDCNetRound::SubmitCommit);
@@ -189,6 +234,8 @@ namespace Anonymity {
     _state_machine.AddTransition(SERVER_WAIT_FOR_CLIENT_CIPHERTEXT,
         SERVER_WAIT_FOR_CLIENT_LISTS);
     _state_machine.AddTransition(SERVER_WAIT_FOR_CLIENT_LISTS,
+        SERVER_GENERATE_CIPHERTEXT);
+    _state_machine.AddTransition(SERVER_GENERATE_CIPHERTEXT,
         SERVER_WAIT_FOR_SERVER_COMMITS);
     _state_machine.AddTransition(SERVER_WAIT_FOR_SERVER_COMMITS,
         SERVER_WAIT_FOR_SERVER_CIPHERTEXT);
@@ -244,6 +291,171 @@ namespace Anonymity {
 
     _state_machine.AddTransition(WAITING_FOR_BLAME_SHUFFLE,
         WAITING_FOR_DATA_REQUEST_OR_VERDICT);
+
+    _state->joining = !GetClients().Contains(GetLocalId());
+    if(_state->joining) {
+      _state_machine.AddState(JOIN_WAIT_FOR_BATCH, SERVER_JOIN_BATCH,
+          &CSDCNetRound::HandleJoinBatch);
+      _state_machine.AddTransition(JOIN_WAIT_FOR_BATCH,
+          CLIENT_WAIT_FOR_CLEARTEXT);
+    }
+  }
+
+  CSDCNetRound::PhaseLog::PhaseLog(int phase, int max,
+      Crypto::PadGenerator::Mode pad_mode) :
+    phase(phase),
+    _max(max),
+    _pad_mode(pad_mode),
+    _file(QDir::tempPath() + "/dissent_phase_log"),
+    _file_size(0),
+    _map(0),
+    _map_size(0)
+  {
+    if(!_file.open()) {
+      qWarning() << "Unable to open phase log file, storing in memory";
+    }
+  }
+
+  CSDCNetRound::PhaseLog::~PhaseLog()
+  {
+    if(_map) {
+      _file.unmap(_map);
+    }
+  }
+
+  void CSDCNetRound::PhaseLog::AddMessage(int idx, const QByteArray &msg)
+  {
+    _messages[idx] = Append(msg);
+  }
+
+  QByteArray CSDCNetRound::PhaseLog::GetMessage(int idx)
+  {
+    if(!_messages.contains(idx)) {
+      return QByteArray();
+    }
+    return Read(_messages[idx]);
+  }
+
+  void CSDCNetRound::PhaseLog::AddServerMessage(const Connections::Id &id,
+      const QByteArray &msg)
+  {
+    Record record;
+    record.length = msg.size();
+    record.data = msg;
+    _server_messages[id] = record;
+  }
+
+  void CSDCNetRound::PhaseLog::Archive()
+  {
+    QHash<Connections::Id, Record>::iterator it;
+    for(it = _server_messages.begin(); it != _server_messages.end(); ++it) {
+      if(it.value().offset < 0) {
+        it.value() = Append(it.value().data);
+      }
+    }
+  }
+
+  QPair<QBitArray, QBitArray> CSDCNetRound::PhaseLog::GetBitsAtIndex(int msg_idx)
+  {
+    int byte_idx = msg_idx / 8;
+    int bit_idx = msg_idx % 8;
+
+    QBitArray clients(_max, false);
+    foreach(int idx, _messages.keys()) {
+      char byte = ReadByte(_messages[idx], byte_idx);
+      clients[idx] = (byte & bit_masks[bit_idx]) > 0;
+    }
+
+    QBitArray mine(_max, false);
+    foreach(int idx, _pad_seeds.keys()) {
+      mine[idx] = (GetPadByte(idx, byte_idx) & bit_masks[bit_idx]) > 0;
+    }
+
+    return QPair<QBitArray, QBitArray>(clients, mine);
+  }
+
+  CSDCNetRound::PhaseLog::Record CSDCNetRound::PhaseLog::Append(
+      const QByteArray &msg)
+  {
+    Record record;
+    record.length = msg.size();
+
+    if(_file.isOpen()) {
+      // Only a read from the file moves its position away from the end
+      if((_file.pos() == _file_size || _file.seek(_file_size)) &&
+          _file.write(msg) == msg.size())
+      {
+        record.offset = _file_size;
+        _file_size += msg.size();
+        return record;
+      }
+      qWarning() << "Unable to write to phase log file, storing in memory";
+    }
+
+    record.data = msg;
+    return record;
+  }
+
+  const uchar *CSDCNetRound::PhaseLog::Map(const Record &record)
+  {
+    qint64 end = record.offset + record.length;
+    if(_map_size < end) {
+      // The log only grows, so a stale mapping is replaced by a larger one
+      if(_map) {
+        _file.unmap(_map);
+      }
+      _file.flush();
+      _map_size = _file_size;
+      _map = _file.map(0, _map_size);
+      if(!_map) {
+        _map_size = 0;
+        return 0;
+      }
+    }
+    return _map + record.offset;
+  }
+
+  QByteArray CSDCNetRound::PhaseLog::Read(const Record &record)
+  {
+    if(record.offset < 0) {
+      return record.data;
+    }
+
+    const uchar *data = Map(record);
+    if(data) {
+      return QByteArray(reinterpret_cast<const char *>(data), record.length);
+    }
+
+    if(!_file.seek(record.offset)) {
+      qWarning() << "Unable to read from phase log file";
+      return QByteArray();
+    }
+    return _file.read(record.length);
+  }
+
+  char CSDCNetRound::PhaseLog::ReadByte(const Record &record, int byte_idx)
+  {
+    if(byte_idx >= record.length) {
+      return 0;
+    } else if(record.offset < 0) {
+      return record.data[byte_idx];
+    }
+
+    const uchar *data = Map(record);
+    if(data) {
+      return data[byte_idx];
+    }
+
+    char byte = 0;
+    if(!_file.seek(record.offset + byte_idx) || !_file.getChar(&byte)) {
+      qWarning() << "Unable to read from phase log file";
+    }
+    return byte;
+  }
+
+  char CSDCNetRound::PhaseLog::GetPadByte(int idx, int byte_idx)
+  {
+    return Crypto::PadGenerator(_pad_seeds[idx], _pad_mode).GetByte(byte_idx);
   }
 
   CSDCNetRound::~CSDCNetRound()
@@ -255,6 +467,17 @@ namespace Anonymity {
 
   void CSDCNetRound::OnStart()
   {
+    if(IsServer() && _pipeline_depth > 1) {
+      _state_machine.AddFutureMessageHandler(CLIENT_CIPHERTEXT,
+          &CSDCNetRound::HandleFutureClientCiphertext, _pipeline_depth - 1);
+    }
+
+    // The batch may have been formed many phases after the round began
+    if(_state->joining) {
+      _state_machine.AddFutureMessageHandler(SERVER_JOIN_BATCH,
+          &CSDCNetRound::HandleFutureJoinBatch, -1);
+    }
+
     Round::OnStart();
     _state_machine.StateComplete();
   }
@@ -265,6 +488,10 @@ namespace Anonymity {
       _server_state->client_ciphertext_period.Stop();
     }
 
+    if(_state->join_shuffle && !_state->join_shuffle->Stopped()) {
+      _state->join_shuffle->Stop("Round finished");
+    }
+
     _state_machine.SetState(FINISHED);
     Utils::PrintResourceUsage(ToString() + " " + "finished bulk");
     Round::OnStop();
@@ -272,6 +499,21 @@ namespace Anonymity {
 
   void CSDCNetRound::HandleDisconnect(const Connections::Id &id)
   {
+    if(IsServer()) {
+      // Not yet offered to the other servers, so it can simply be dropped
+      for(int idx = 0; idx < _server_state->pending_joins.count(); idx++) {
+        if(_server_state->pending_joins[idx].GetId() == id) {
+          _server_state->pending_joins.removeAt(idx);
+          break;
+        }
+      }
+    }
+
+    // A batch member going offline fails the batch's shuffle
+    if(_state->join_shuffle && !_state->join_shuffle->Stopped()) {
+      _state->join_shuffle->HandleDisconnect(id);
+    }
+
     if(!GetServers().Contains(id) && !GetClients().Contains(id)) {
       return;
     }
@@ -295,6 +537,30 @@ namespace Anonymity {
     }
   }
 
+  bool CSDCNetRound::AdmitsClients() const
+  {
+#if defined(CSBR_SIGN_SLOTS) || defined(CS_BLOG_DROP)
+    // Every member verifies every slot with its anonymous key
+    return false;
+#else
+    return IsServer() && !Stopped();
+#endif
+  }
+
+  void CSDCNetRound::AdmitClient(const PublicIdentity &client)
+  {
+    if(!AdmitsClients() || GetClients().Contains(client.GetId()) ||
+        ContainsIdentity(_server_state->pending_joins, client.GetId()) ||
+        ContainsIdentity(_server_state->join_candidates, client.GetId()) ||
+        ContainsIdentity(_server_state->join_batch, client.GetId()))
+    {
+      return;
+    }
+
+    _server_state->pending_joins.append(client);
+    qDebug() << ToString() << "queued" << client.GetId() << "for admission";
+  }
+
   void CSDCNetRound::BeforeStateTransition()
   {
     if(_server_state) {
@@ -305,19 +571,28 @@ namespace Anonymity {
 
   bool CSDCNetRound::CycleComplete()
   {
+    int nphase = _state_machine.GetPhase() + 1;
+    if(_state->activation_phase == nphase) {
+      ActivateJoinedClients();
+    }
+
     if(_server_state) {
-      _server_state->handled_clients.fill(false, GetClients().Count());
-      _server_state->client_ciphertexts.clear();
-      _server_state->server_ciphertexts.clear();
+      _server_state->admission.clear();
 
-      int nphase = _state_machine.GetPhase() + 1;
-      if(nphase >= 5) {
-        Q_ASSERT(_server_state->phase_logs.remove(nphase - 5));
+      // Start from any ciphertexts that arrived early for the next phase
+      ServerState::PipelinedPhase pending =
+        _server_state->pipelined_phases.take(nphase);
+      if(pending.handled_clients.isEmpty()) {
+        pending.handled_clients.fill(false, GetClients().Count());
       }
-      _server_state->current_phase_log =
-        QSharedPointer<PhaseLog>(
-            new PhaseLog(nphase, GetClients().Count()));
-      _server_state->phase_logs[nphase] = _server_state->current_phase_log;
+      _server_state->handled_clients = pending.handled_clients;
+      _server_state->client_aggregate = pending.client_aggregate;
+      _server_state->client_ciphertext_count = pending.client_ciphertext_count;
+      _server_state->server_ciphertexts.clear();
+
+      RetirePhaseLogs(_server_state->phase_logs, nphase,
+          _phase_log_retention, _phase_log_memory_window);
+      _server_state->current_phase_log = GetPhaseLog(nphase);
     }
 
     if(_stop_next) {
@@ -336,10 +611,29 @@ namespace Anonymity {
       return;
     }
 
+    // Servers receive a flood of client ciphertexts at the deadline, verify
+    // those together, everything else is processed as it arrives unless it
+    // would overtake a queued ciphertext
+    if(IsServer() && (data[0] == 0) && GetClients().Contains(from)) {
+      QueueVerify(from, data, 1);
+    } else if(VerifyPending()) {
+      QueuePacket(from, data);
+    } else {
+      ProcessQueued(from, data, 0);
+    }
+  }
+
+  void CSDCNetRound::ProcessQueued(const Connections::Id &from,
+      const QByteArray &data, const QByteArray *verified)
+  {
     qint8 type = data[0];
     switch(type) {
       case 0:
-        _state_machine.ProcessData(from, data.mid(1));
+        if(verified) {
+          _state_machine.ProcessVerifiedData(from, data.mid(1), *verified);
+        } else {
+          _state_machine.ProcessData(from, data.mid(1));
+        }
         break;
       case 1:
         GetShuffleRound()->ProcessPacket(from, data.mid(1));
@@ -347,6 +641,12 @@ namespace Anonymity {
       case 2:
         _state->blame_shuffle->ProcessPacket(from, data.mid(1));
         break;
+      case 3:
+        // Members already in the round overhear the join shuffles
+        if(IsServer() || _state->joining) {
+          ProcessJoinPacket(from, data.mid(1));
+        }
+        break;
       default:
         qWarning() << "Unknown packet type:" << type;
     }
@@ -363,9 +663,11 @@ namespace Anonymity {
     QHash<int, QByteArray> signatures;
     QByteArray cleartext;
     QBitArray online;
-    stream >> signatures >> cleartext >> online;
+    QByteArray admission;
+    stream >> signatures >> cleartext >> online >> admission;
 
-    if(cleartext.size() != _state->msg_length) {
+    // A joining client does not know the layout until it is admitted
+    if(!_state->joining && cleartext.size() != _state->msg_length) {
       throw QRunTimeError("Cleartext size mismatch: " +
           QString::number(cleartext.size()) + " :: " +
           QString::number(_state->msg_length));
@@ -378,8 +680,12 @@ namespace Anonymity {
     QDataStream tstream(&data, QIODevice::WriteOnly);
     tstream << online;
     hash.Update(data);
+    if(!admission.isEmpty()) {
+      hash.Update(admission);
+    }
 
     QByteArray signed_hash = hash.ComputeHash();
+    DISSENT_TRACE_EVENT(CLEARTEXT, _state_machine.GetPhase(), cleartext.size());
 
     int server_length = GetServers().Count();
     for(int idx = 0; idx < server_length; idx++) {
@@ -390,13 +696,24 @@ namespace Anonymity {
     }
 
     _state->cleartext = cleartext;
-    ProcessCleartext();
+    if(_state->joining) {
+      if(!AdmitsBatch(admission)) {
+        _state_machine.StateComplete();
+        return;
+      }
 
-    if(_state->start_accuse) {
-      _state_machine.SetState(STARTING_BLAME_SHUFFLE);
-    } else {
-      _state_machine.StateComplete();
+      // The cleartext waits for the batch's shuffle to be parsed
+      _state->admission = admission;
+      if(_state->join_shuffle->Stopped()) {
+        CompleteJoin();
+      }
+      return;
+    }
+
+    if(!admission.isEmpty()) {
+      ApplyAdmission(admission);
     }
+    ConcludeCleartext();
   }
 
   void CSDCNetRound::HandleClientCiphertext(const Connections::Id &from, QDataStream &stream)
@@ -424,19 +741,24 @@ namespace Anonymity {
     }
 
     _server_state->handled_clients[idx] = true;
-    _server_state->client_ciphertexts.append(QPair<int, QByteArray>(idx, payload));
-    _server_state->current_phase_log->messages[idx] = payload;
-
-    qDebug() << GetServers().GetIndex(GetLocalId()) << GetLocalId().ToString() <<
-      ": received client ciphertext from" << GetClients().GetIndex(from) <<
-      from.ToString() << "Have" << _server_state->client_ciphertexts.count()
+    if(_server_state->client_aggregate.size() != payload.size()) {
+      _server_state->client_aggregate = QByteArray(payload.size(), 0);
+    }
+    Utils::Xor(_server_state->client_aggregate.data(), payload.constData(),
+        payload.size());
+    _server_state->client_ciphertext_count++;
+    _server_state->current_phase_log->AddMessage(idx, payload);
+
+    DISSENT_TRACE_EVENT(CLIENT_CIPHERTEXT, _state_machine.GetPhase(),
+        payload.size());
+    DISSENT_LOG(LOG_TRACE) << GetServers().GetIndex(GetLocalId()) <<
+      GetLocalId().ToString() << ": received client ciphertext from" << GetClients().GetIndex(from) <<
+      from.ToString() << "Have" << _server_state->client_ciphertext_count
       << "expecting" << _server_state->allowed_clients.count();
 
-    if(_server_state->allowed_clients.count() ==
-        _server_state->client_ciphertexts.count())
-    {
+    if(AllowedClientsSubmitted()) {
       _state_machine.StateComplete();
-    } else if(_server_state->client_ciphertexts.count() ==
+    } else if(_server_state->client_ciphertext_count ==
         _server_state->expected_clients)
     {
       // Start the flexible deadline
@@ -453,6 +775,55 @@ namespace Anonymity {
     }
   }
 
+  void CSDCNetRound::HandleFutureClientCiphertext(const Connections::Id &from,
+      QDataStream &stream, int phase)
+  {
+    if(!IsServer()) {
+      throw QRunTimeError("Not a server");
+    }
+
+    Q_ASSERT(_server_state);
+    int idx = GetClients().GetIndex(from);
+
+    // Admitted clients submit ahead for the phase their slots open
+    bool admitted = _server_state->admitted_clients.contains(from) &&
+      (_state->activation_phase <= phase);
+    if(!_server_state->allowed_clients.contains(from) && !admitted) {
+      throw QRunTimeError("Not allowed to submit a ciphertext");
+    }
+
+    ServerState::PipelinedPhase &pending =
+      _server_state->pipelined_phases[phase];
+    if(pending.handled_clients.isEmpty()) {
+      pending.handled_clients.fill(false, GetClients().Count());
+    } else if(pending.handled_clients.at(idx)) {
+      throw QRunTimeError("Already have ciphertext");
+    }
+
+    QByteArray payload;
+    stream >> payload;
+
+    int length = GetLayout(phase).length;
+    if(payload.size() != length) {
+      throw QRunTimeError("Incorrect message length, got " +
+          QString::number(payload.size()) + " expected " +
+          QString::number(length));
+    }
+
+    pending.handled_clients[idx] = true;
+    if(pending.client_aggregate.size() != length) {
+      pending.client_aggregate = QByteArray(length, 0);
+    }
+    Utils::Xor(pending.client_aggregate.data(), payload.constData(), length);
+    pending.client_ciphertext_count++;
+    GetPhaseLog(phase)->AddMessage(idx, payload);
+
+    DISSENT_TRACE_EVENT(CLIENT_CIPHERTEXT, phase, payload.size());
+    DISSENT_LOG(LOG_TRACE) << GetServers().GetIndex(GetLocalId()) <<
+      GetLocalId().ToString() << ": received client ciphertext for phase" << phase << "from" << idx <<
+      from.ToString() << "Have" << pending.client_ciphertext_count;
+  }
+
   void CSDCNetRound::HandleServerClientList(const Connections::Id &from, QDataStream &stream)
   {
     if(!GetOverlay()->IsServer(from)) {
@@ -466,7 +837,9 @@ namespace Anonymity {
     }
 
     QBitArray clients;
-    stream >> clients;
+    QList<PublicIdentity> joins;
+    int join_status;
+    stream >> clients >> joins >> join_status;
 
     /// XXX Handle overlaps in list
 
@@ -480,6 +853,9 @@ namespace Anonymity {
       }
     }
 
+    _server_state->join_offers[sidx] = joins;
+    _server_state->join_status[sidx] = join_status;
+
     qDebug() << GetServers().GetIndex(GetLocalId()) << GetLocalId().ToString() <<
       ": received client list from" << GetServers().GetIndex(from) <<
       from.ToString() << "Have" << _server_state->handled_servers.count()
@@ -553,10 +929,12 @@ namespace Anonymity {
 
     _server_state->handled_servers.insert(from);
     _server_state->server_ciphertexts[GetServers().GetIndex(from)] = ciphertext;
-    _server_state->current_phase_log->server_messages[from] = ciphertext;
+    _server_state->current_phase_log->AddServerMessage(from, ciphertext);
 
-    qDebug() << GetServers().GetIndex(GetLocalId()) << GetLocalId().ToString() <<
-      ": received ciphertext from" << GetServers().GetIndex(from) <<
+    DISSENT_TRACE_EVENT(SERVER_CIPHERTEXT, _state_machine.GetPhase(),
+        ciphertext.size());
+    DISSENT_LOG(LOG_TRACE) << GetServers().GetIndex(GetLocalId()) <<
+      GetLocalId().ToString() << ": received ciphertext from" << GetServers().GetIndex(from) <<
       from.ToString() << "Have" << _server_state->handled_servers.count()
       << "expecting" << GetServers().Count();
 
@@ -682,10 +1060,9 @@ namespace Anonymity {
         int accuse_idx = _server_state->current_blame.second;
         int byte_idx = accuse_idx / 8;
         int bit_idx = accuse_idx % 8;
-        QByteArray tmp(byte_idx + 1, 0);
-        CryptoRandom(seed).GenerateBlock(tmp);
+        char byte = Crypto::PadGenerator(seed, PAD_MODE).GetByte(byte_idx);
 
-        if(((tmp[byte_idx] & bit_masks[bit_idx % 8]) != 0) == _server_state->server_bits[rebuttal.first]) {
+        if(((byte & bit_masks[bit_idx]) != 0) == _server_state->server_bits[rebuttal.first]) {
           _server_state->bad_dude = from;
           qDebug() << "Client misbehaves:" << from;
         } else {
@@ -777,6 +1154,21 @@ namespace Anonymity {
     Stop("Bad member found and reported");
   }
 
+  void CSDCNetRound::HandleJoinBatch(const Connections::Id &from,
+      QDataStream &stream)
+  {
+    StartJoin(from, stream, _state_machine.GetPhase());
+  }
+
+  void CSDCNetRound::HandleFutureJoinBatch(const Connections::Id &from,
+      QDataStream &stream, int phase)
+  {
+    if(_state_machine.GetState() != JOIN_WAIT_FOR_BATCH) {
+      throw QRunTimeError("Not waiting for a batch");
+    }
+    StartJoin(from, stream, phase);
+  }
+
   void CSDCNetRound::StartShuffle()
   {
 #ifdef CS_BLOG_DROP
@@ -829,6 +1221,28 @@ namespace Anonymity {
     _state_machine.StateComplete();
   }
 
+  void CSDCNetRound::JoinShuffleFinished()
+  {
+    if(Stopped()) {
+      return;
+    }
+
+    _state->join_packets.clear();
+    if(IsServer()) {
+      // Servers report the outcome in their next client list
+      return;
+    }
+
+    if(!_state->join_shuffle->Successful()) {
+      qDebug() << ToString() << "join shuffle failed:" <<
+        _state->join_shuffle->GetStoppedReason();
+    }
+
+    if(!_state->admission.isEmpty()) {
+      CompleteJoin();
+    }
+  }
+
   void CSDCNetRound::ProcessDataShuffle()
   {
     if(GetShuffleSink().Count() != GetClients().Count()) {
@@ -908,12 +1322,16 @@ namespace Anonymity {
 
   void CSDCNetRound::PrepareForBulk()
   {
-    _state->msg_length = (GetClients().Count() / 8);
-    if(GetClients().Count() % 8) {
-      ++_state->msg_length;
-    }
+    _state->slot_count = GetClients().Count();
+    _state->msg_length = BitmapLength(_state->slot_count);
     _state->base_msg_length = _state->msg_length;
 
+    // Until the first cleartexts arrive, in-flight phases have no slots
+    for(int idx = 1; idx < _pipeline_depth; idx++) {
+      _state->pipelined_layouts.append(SlotLayout(QMap<int, int>(),
+            _state->base_msg_length));
+    }
+
     SetupRngSeeds();
     _state_machine.StateComplete();
     Utils::PrintResourceUsage(ToString() + " " + "beginning bulk");
@@ -921,13 +1339,15 @@ namespace Anonymity {
 
   void CSDCNetRound::SetupRngSeeds()
   {
-    Identity::Roster roster;
     if(IsServer()) {
-      roster = GetClients();
+      AddRngSeeds(GetClients());
     } else {
-      roster = GetServers();
+      AddRngSeeds(GetServers());
     }
+  }
 
+  void CSDCNetRound::AddRngSeeds(const Identity::Roster &roster)
+  {
     foreach(const PublicIdentity &gc, roster) {
       if(gc.GetId() == GetLocalId()) {
         _state->base_seeds.append(QByteArray());
@@ -944,9 +1364,9 @@ namespace Anonymity {
     Hash hashalgo;
 
     QByteArray phase(4, 0);
-    Serialization::WriteInt(_state_machine.GetPhase(), phase, 0);
+    Serialization::WriteInt(_state->ciphertext_phase, phase, 0);
 
-    _state->anonymous_rngs.clear();
+    _state->anonymous_pads.Clear();
 
     QList<QByteArray> seeds = _state->base_seeds;
     if(IsServer()) {
@@ -961,51 +1381,69 @@ namespace Anonymity {
       }
     }
 
-    foreach(const QByteArray &base_seed, seeds) {
-      if(base_seed.isEmpty()) {
+    for(int idx = 0; idx < seeds.size(); idx++) {
+      if(seeds[idx].isEmpty()) {
         continue;
       }
-      hashalgo.Update(base_seed);
+      hashalgo.Update(seeds[idx]);
       hashalgo.Update(phase);
       hashalgo.Update(GetNonce());
-      _state->anonymous_rngs.append(CryptoRandom(hashalgo.ComputeHash()));
+      QByteArray seed = hashalgo.ComputeHash();
+      _state->anonymous_pads.AddSeed(seed);
+
+      if(IsServer()) {
+        // Kept so the pad can be regenerated for blame, rather than stored
+        _server_state->current_phase_log->SetPadSeed(
+            _server_state->rng_to_gidx[idx], seed);
+      }
     }
   }
 
   void CSDCNetRound::SubmitClientCiphertext()
   {
-    SetupRngs();
+    if(_state->joining) {
+      return;
+    }
 
-    QByteArray payload;
-    QDataStream stream(&payload, QIODevice::WriteOnly);
-    stream << CLIENT_CIPHERTEXT << GetNonce() << _state_machine.GetPhase()
-      << GenerateCiphertext();
+    // Keep _pipeline_depth phases in flight, at the start this submits the
+    // whole pipeline and afterwards one phase per cleartext
+    int last = _state_machine.GetPhase() + _pipeline_depth - 1;
+    int first = qMax(_state->submitted_phase + 1, _state_machine.GetPhase());
 
-    VerifiableSend(_state->my_server, payload);
+    for(int phase = first; phase <= last; phase++) {
+      _state->ciphertext_phase = phase;
+      SetupRngs();
+
+      QByteArray payload;
+      QDataStream stream(&payload, QIODevice::WriteOnly);
+      stream << CLIENT_CIPHERTEXT << GetNonce() << phase
+        << GenerateCiphertext();
+
+      VerifiableSend(_state->my_server, payload);
+      _state->submitted_phase = phase;
+    }
   }
 
   QByteArray CSDCNetRound::GenerateCiphertext()
   {
-    QByteArray xor_msg(_state->msg_length, 0);
-    QByteArray tmsg(_state->msg_length, 0);
-    
-    int idx = 0;
-    for(int jdx = 0; jdx < _state->anonymous_rngs.size(); jdx++) {
-      _state->anonymous_rngs[jdx].GenerateBlock(tmsg);
-      if(IsServer()) {
-        int gidx = _server_state->rng_to_gidx[idx++];
-        _server_state->current_phase_log->my_sub_ciphertexts[gidx] = tmsg;
-      }
-      Xor(xor_msg, xor_msg, tmsg);
+    if(IsServer()) {
+      QByteArray xor_msg(_state->msg_length, 0);
+      _state->anonymous_pads.ParallelAccumulate(xor_msg);
+      // Servers do not own slots, this may also be off the event thread
+      return xor_msg;
     }
 
-    if(_state->slot_open) {
-      int offset = _state->base_msg_length;
-      foreach(int owner, _state->next_messages.keys()) {
+    SlotLayout layout = GetLayout(_state->ciphertext_phase);
+    QByteArray xor_msg(layout.length, 0);
+    _state->anonymous_pads.Accumulate(xor_msg);
+
+    if(layout.messages.contains(_state->my_idx)) {
+      int offset = BaseLength(_state->ciphertext_phase);
+      foreach(int owner, layout.messages.keys()) {
         if(owner == _state->my_idx) {
           break;
         }
-        offset += _state->next_messages[owner];
+        offset += layout.messages[owner];
       }
 
       QByteArray my_msg = GenerateSlotMessage();
@@ -1014,15 +1452,16 @@ namespace Anonymity {
       Xor(my_msg, my_msg, my_xor_base);
       xor_msg.replace(offset, my_msg.size(), my_msg);
 
-      qDebug() << "Writing ciphertext into my slot" << _state->my_idx <<
+      DISSENT_LOG(LOG_TRACE) << "Writing ciphertext into my slot" << _state->my_idx <<
         "starting at" << offset << "for" << my_msg.size() << "bytes.";
 
     } else if(CheckData()) {
-      qDebug() << "Opening my slot" << _state->my_idx;
+      DISSENT_LOG(LOG_TRACE) << "Opening my slot" << _state->my_idx;
       xor_msg[_state->my_idx / 8] = xor_msg[_state->my_idx / 8] ^
         bit_masks[_state->my_idx % 8];
-      _state->read = false;
-      _state->slot_open = true;
+      // The first slot only announces the length of the pending message
+      _state->slot_messages[_state->ciphertext_phase + _pipeline_depth] =
+        QByteArray();
     }
 
 #ifdef BAD_CS_BULK
@@ -1039,29 +1478,34 @@ namespace Anonymity {
 
   bool CSDCNetRound::CheckData()
   {
-    if(!_state->next_msg.isEmpty()) {
+    if(!_state->pending_msgs.isEmpty()) {
       return true;
     }
 
     QPair<QByteArray, bool> pair = GetData(MAX_GET);
-    if(pair.first.size() > 0) {
-      qDebug() << "Found a message of" << pair.first.size();
+    if(pair.first.size() == 0) {
+      return false;
     }
-    _state->next_msg = pair.first;
-    _state->last_msg = QByteArray();
-    return !_state->next_msg.isEmpty();
+
+    qDebug() << "Found a message of" << pair.first.size();
+    _state->pending_msgs.append(pair.first);
+    return true;
   }
 
   QByteArray CSDCNetRound::GenerateSlotMessage()
   {
-    QByteArray msg = _state->next_msg;
-    if(_state->read) {
-      QPair<QByteArray, bool> pair = GetData(MAX_GET);
-      _state->last_msg = _state->next_msg;
-      _state->next_msg = pair.first;
-    } else {
-      msg = _state->last_msg;
-      _state->read = !_state->accuse;
+    int phase = _state->ciphertext_phase;
+    QByteArray msg = _state->slot_messages.take(phase);
+    _state->sent_messages[phase] = msg;
+
+    // The message announced now is sent _pipeline_depth phases later
+    QByteArray next;
+    if(!_state->accuse) {
+      if(_state->pending_msgs.isEmpty()) {
+        next = GetData(MAX_GET).first;
+      } else {
+        next = _state->pending_msgs.takeFirst();
+      }
     }
 
     QByteArray msg_p(9, 0);
@@ -1070,11 +1514,10 @@ namespace Anonymity {
       msg_p[0] = 0xFF;
     }
 
-    Serialization::WriteInt(_state_machine.GetPhase(), msg_p, 1);
-    int length = _state->next_msg.size() + SlotHeaderLength(_state->my_idx);
+    Serialization::WriteInt(phase, msg_p, 1);
+    int length = next.size() + SlotHeaderLength(_state->my_idx);
 #ifdef CSBR_CLOSE_SLOT
-    if(_state->next_msg.size() == 0) {
-      _state->slot_open = false;
+    if(next.size() == 0) {
       length = 0;
     }
 #endif
@@ -1085,6 +1528,10 @@ namespace Anonymity {
       Serialization::WriteInt(length, msg_p, 5);
       msg_p.append(msg);
     }
+
+    if(_state->accuse || length > 0) {
+      _state->slot_messages[phase + _pipeline_depth] = next;
+    }
 #ifdef CSBR_SIGN_SLOTS
     QByteArray sig = _state->anonymous_key->Sign(msg_p);
 #else
@@ -1092,8 +1539,9 @@ namespace Anonymity {
 #endif
 
     QByteArray msg_pp = msg_p + sig;
-    _state->last_ciphertext  = Randomize(msg_pp);
-    return _state->last_ciphertext;
+    QByteArray ciphertext = Randomize(msg_pp);
+    _state->sent_ciphertexts[phase] = ciphertext;
+    return ciphertext;
   }
 
   void CSDCNetRound::SetOnlineClients()
@@ -1104,15 +1552,19 @@ namespace Anonymity {
     foreach(const QSharedPointer<Connections::Connection> &con,
         GetOverlay()->GetConnectionTable().GetConnections())
     {
-      if(GetOverlay()->IsServer(con->GetRemoteId())) {
+      Connections::Id id = con->GetRemoteId();
+      if(GetOverlay()->IsServer(id) || !GetClients().Contains(id) ||
+          _server_state->admitted_clients.contains(id))
+      {
         continue;
       }
 
-      _server_state->allowed_clients.insert(con->GetRemoteId());
+      _server_state->allowed_clients.insert(id);
     }
 #endif
 
-    if(_server_state->allowed_clients.count() == 0) {
+    // When pipelining, every ciphertext may have arrived early
+    if(AllowedClientsSubmitted()) {
       _state_machine.StateComplete();
       return;
     }
@@ -1130,6 +1582,21 @@ namespace Anonymity {
       int(_server_state->allowed_clients.count() * CLIENT_PERCENTAGE);
   }
 
+  bool CSDCNetRound::AllowedClientsSubmitted() const
+  {
+    // A client that submitted and then went offline still counts towards
+    // client_ciphertext_count, so compare the sets
+    foreach(const Connections::Id &id, _server_state->allowed_clients) {
+      int idx = GetClients().GetIndex(id);
+      if(idx < 0 || idx >= _server_state->handled_clients.size() ||
+          !_server_state->handled_clients.at(idx))
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
   void CSDCNetRound::ConcludeClientCiphertextSubmission(const int &)
   {
     qDebug() << "Client window has closed, unfortunately some client may not"
@@ -1142,20 +1609,32 @@ namespace Anonymity {
     QByteArray payload;
     QDataStream stream(&payload, QIODevice::WriteOnly);
     stream << SERVER_CLIENT_LIST << GetNonce() <<
-      _state_machine.GetPhase() << _server_state->handled_clients;
+      _state_machine.GetPhase() << _server_state->handled_clients <<
+      _server_state->pending_joins << GetJoinStatus();
+    _server_state->pending_joins.clear();
 
     VerifiableBroadcastToServers(payload);
   }
 
-  void CSDCNetRound::SubmitCommit()
+  void CSDCNetRound::StartServerCiphertext()
   {
+    ProcessJoins();
+
+    _state->ciphertext_phase = _state_machine.GetPhase();
     SetupRngs();
 
     qDebug() << ToString() << "generating ciphertext for" <<
-      _state->anonymous_rngs.count() << "out of" << GetClients().Count();
+      _state->anonymous_pads.Count() << "out of" << GetClients().Count();
 
-    GenerateServerCiphertext();
+    CSDCNetRoundPrivate::GenerateServerCiphertext *generator =
+      new CSDCNetRoundPrivate::GenerateServerCiphertext(this);
+    QObject::connect(generator, SIGNAL(Finished()),
+        this, SLOT(ServerCiphertextFinished()));
+    QThreadPool::globalInstance()->start(generator);
+  }
 
+  void CSDCNetRound::SubmitCommit()
+  {
     QByteArray payload;
     QDataStream stream(&payload, QIODevice::WriteOnly);
     stream << SERVER_COMMIT << GetNonce() <<
@@ -1166,21 +1645,14 @@ namespace Anonymity {
 
   void CSDCNetRound::GenerateServerCiphertext()
   {
+    // Runs on the thread pool, so this reads only the pads, msg_length, and
+    // client_aggregate, which the event thread leaves alone until it ends
     QByteArray ciphertext = GenerateCiphertext();
-    for(int lidx = 0; lidx < _server_state->client_ciphertexts.size(); lidx++) {
-      const QPair<int, QByteArray> &entry = _server_state->client_ciphertexts[lidx];
-      int idx = entry.first;
-      const QByteArray &text = entry.second;
-
-      if(!_server_state->handled_clients.at(idx)) {
-        continue;
-      }
-      Xor(ciphertext, ciphertext, text);
-    }
 
-    QBitArray open(GetClients().Count(), false);
-    for(int idx = 0; idx < _state->next_messages.size(); idx++) {
-      open[idx] = _state->next_messages[idx] != 0;
+    // Client ciphertexts were already folded together as they arrived
+    if(_server_state->client_aggregate.size() == ciphertext.size()) {
+      Utils::Xor(ciphertext.data(), _server_state->client_aggregate.constData(),
+          ciphertext.size());
     }
 
     _server_state->my_ciphertext = ciphertext;
@@ -1216,6 +1688,9 @@ namespace Anonymity {
      */
     tstream << _server_state->handled_clients;
     hash.Update(data);
+    if(!_state->admission.isEmpty()) {
+      hash.Update(_state->admission);
+    }
 
     _server_state->signed_hash = hash.ComputeHash();
     QByteArray signature = GetKey()->Sign(_server_state->signed_hash);
@@ -1234,15 +1709,335 @@ namespace Anonymity {
     QDataStream stream(&payload, QIODevice::WriteOnly);
     stream << SERVER_CLEARTEXT << GetNonce() << _state_machine.GetPhase()
       << _server_state->signatures << _server_state->cleartext <<
-      _server_state->handled_clients;
+      _server_state->handled_clients << _state->admission;
 
     VerifiableBroadcastToClients(payload);
+    ConcludeCleartext();
+  }
+
+  void CSDCNetRound::ConcludeCleartext()
+  {
     ProcessCleartext();
-    if(_state->start_accuse) {
+    if(!_state->start_accuse) {
+      _state_machine.StateComplete();
+    } else if(IsServer() ||
+        _state->blame_shuffle->GetClients().Contains(GetLocalId()))
+    {
       _state_machine.SetState(STARTING_BLAME_SHUFFLE);
     } else {
+      // Admitted clients have no part in the blame shuffle
+      _state_machine.SetState(WAITING_FOR_DATA_REQUEST_OR_VERDICT);
+    }
+  }
+
+  int CSDCNetRound::GetJoinStatus() const
+  {
+    if(_server_state->join_batch.isEmpty() || !_state->join_shuffle) {
+      return JOIN_IDLE;
+    } else if(!_state->join_shuffle->Stopped()) {
+      return JOIN_RUNNING;
+    } else if(_state->join_shuffle->Successful()) {
+      return JOIN_DONE;
+    }
+    return JOIN_FAILED;
+  }
+
+  void CSDCNetRound::ProcessJoins()
+  {
+    int phase = _state_machine.GetPhase();
+
+    // Offers are merged in server order so that all servers agree
+    for(int sidx = 0; sidx < GetServers().Count(); sidx++) {
+      foreach(const PublicIdentity &client,
+          _server_state->join_offers.value(sidx))
+      {
+        if(GetClients().Contains(client.GetId()) ||
+            ContainsIdentity(_server_state->join_candidates, client.GetId()) ||
+            ContainsIdentity(_server_state->join_batch, client.GetId()))
+        {
+          continue;
+        }
+        _server_state->join_candidates.append(client);
+      }
+    }
+    _server_state->join_offers.clear();
+
+    QList<int> statuses = _server_state->join_status.values();
+    _server_state->join_status.clear();
+
+    if(!_server_state->join_batch.isEmpty()) {
+      if(_state->activation_phase >= 0) {
+        return;
+      }
+
+      QSharedPointer<NeffKeyShuffleRound> nks =
+        _state->join_shuffle.dynamicCast<NeffKeyShuffleRound>();
+      bool done = statuses.count(JOIN_DONE) == GetServers().Count();
+      if(statuses.contains(JOIN_FAILED) || (done && nks->GetKeys().isEmpty())) {
+        qDebug() << ToString() << "abandoning the admission of" <<
+          _server_state->join_batch.count() << "clients";
+        _server_state->join_batch.clear();
+      } else if(done) {
+        AdmitBatch(nks->GetKeys());
+      }
+      return;
+    }
+
+    // A batch is the anonymity set of its slots, so small ones wait
+    if(_server_state->join_candidates.count() < int(MIN_JOIN_BATCH)) {
+      return;
+    }
+
+    while(!_server_state->join_candidates.isEmpty() &&
+        _server_state->join_batch.count() < int(MAX_JOIN_BATCH))
+    {
+      _server_state->join_batch.append(
+          _server_state->join_candidates.takeFirst());
+    }
+
+    StartJoinShuffle(Identity::Roster(_server_state->join_batch), phase);
+
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream << SERVER_JOIN_BATCH << GetNonce() << phase <<
+      _server_state->join_batch <<
+      SerializeKeys(_state->anonymous_keys, _state->slot_count);
+
+    foreach(const PublicIdentity &client, _server_state->join_batch) {
+      if(GetOverlay()->GetConnectionTable().GetConnection(client.GetId())) {
+        VerifiableSend(client.GetId(), payload);
+      }
+    }
+
+    qDebug() << ToString() << "admitting" << _server_state->join_batch.count()
+      << "clients, with" << _server_state->join_candidates.count() <<
+      "waiting";
+  }
+
+  void CSDCNetRound::AdmitBatch(
+      const QVector<QSharedPointer<Crypto::AsymmetricKey> > &keys)
+  {
+    int offset = _state->slot_count;
+    int activation = _state_machine.GetPhase() + _pipeline_depth;
+
+    // A joining client learns the layouts of the phases in flight, which
+    // this phase's cleartext then advances as it does for everyone else, and
+    // checks the earlier slots' keys its server sent against their hash
+    QByteArray admission;
+    QDataStream stream(&admission, QIODevice::WriteOnly);
+    stream << activation << offset << keys.count() << _state->join_nonce <<
+      Hash().ComputeHash(SerializeKeys(_state->anonymous_keys, offset)) <<
+      _state->next_messages << _state->msg_length <<
+      _state->pipelined_layouts.count();
+    foreach(const SlotLayout &layout, _state->pipelined_layouts) {
+      stream << layout.messages << layout.length;
+    }
+
+    _state->anonymous_keys.resize(offset);
+    _state->anonymous_keys += keys;
+
+    AddClients(_server_state->join_batch);
+    AddRngSeeds(Identity::Roster(_server_state->join_batch));
+
+    int count = GetClients().Count();
+    _server_state->handled_clients.resize(count);
+    QMap<int, ServerState::PipelinedPhase>::iterator it;
+    for(it = _server_state->pipelined_phases.begin();
+        it != _server_state->pipelined_phases.end(); ++it)
+    {
+      if(!it.value().handled_clients.isEmpty()) {
+        it.value().handled_clients.resize(count);
+      }
+    }
+
+    foreach(const PublicIdentity &client, _server_state->join_batch) {
+      _server_state->admitted_clients.insert(client.GetId());
+    }
+
+    _state->admission = admission;
+    ApplyAdmission(admission);
+
+    qDebug() << ToString() << "admitted" << keys.count() <<
+      "slots starting in phase" << activation;
+  }
+
+  void CSDCNetRound::StartJoinShuffle(const Identity::Roster &batch, int phase)
+  {
+    QByteArray bphase(4, 0);
+    Serialization::WriteInt(phase, bphase, 0);
+    _state->join_nonce = Hash().ComputeHash(GetNonce() + bphase);
+
+    QSharedPointer<Round> join_shuffle(new NeffKeyShuffleRound(batch,
+          GetServers(), GetPrivateIdentity(), _state->join_nonce,
+          GetOverlay(), _get_join_data));
+    join_shuffle->SetSharedPointer(join_shuffle);
+
+    QByteArray header = GetHeaderBytes();
+    header[1] = 3;
+    join_shuffle->SetHeaderBytes(header);
+    join_shuffle->SetSink(&_join_sink);
+    QObject::connect(join_shuffle.data(), SIGNAL(Finished()),
+        this, SLOT(JoinShuffleFinished()));
+
+    _state->join_shuffle = join_shuffle;
+    join_shuffle->Start();
+
+    QList<QPair<Connections::Id, QByteArray> > packets = _state->join_packets;
+    _state->join_packets.clear();
+    for(int idx = 0; idx < packets.count(); idx++) {
+      ProcessJoinPacket(packets[idx].first, packets[idx].second);
+    }
+  }
+
+  void CSDCNetRound::StartJoin(const Connections::Id &from,
+      QDataStream &stream, int phase)
+  {
+    if(from != _state->my_server) {
+      throw QRunTimeError("Not my server");
+    } else if(_state->join_shuffle) {
+      throw QRunTimeError("Already have a batch");
+    }
+
+    QVector<PublicIdentity> batch;
+    stream >> batch >> _state->join_keys;
+
+    Identity::Roster roster(batch);
+    if(!roster.Contains(GetLocalId())) {
+      throw QRunTimeError("Not in the batch");
+    }
+
+    qDebug() << ToString() << "joining with" << roster.Count() <<
+      "clients in phase" << phase;
+
+    _state_machine.SetPhase(phase);
+    StartJoinShuffle(roster, phase);
+    _state_machine.StateComplete();
+  }
+
+  void CSDCNetRound::ProcessJoinPacket(const Connections::Id &from,
+      const QByteArray &data)
+  {
+    if(_state->join_shuffle && !_state->join_shuffle->Stopped()) {
+      _state->join_shuffle->ProcessPacket(from, data);
+    } else if(_state->join_packets.count() < int(MAX_JOIN_BATCH) * 4) {
+      // Others may start the next batch's shuffle before this member
+      _state->join_packets.append(
+          QPair<Connections::Id, QByteArray>(from, data));
+    }
+  }
+
+  void CSDCNetRound::ApplyAdmission(const QByteArray &admission)
+  {
+    QDataStream stream(admission);
+    int activation, offset, count;
+    stream >> activation >> offset >> count;
+
+    _state->activation_phase = activation;
+    _state->next_slot_count = offset + count;
+    _state->next_base_msg_length = BitmapLength(_state->next_slot_count);
+  }
+
+  bool CSDCNetRound::AdmitsBatch(const QByteArray &admission) const
+  {
+    if(admission.isEmpty() || _state->join_nonce.isEmpty()) {
+      return false;
+    }
+
+    QDataStream stream(admission);
+    int activation, offset, count;
+    QByteArray nonce;
+    stream >> activation >> offset >> count >> nonce;
+    return nonce == _state->join_nonce;
+  }
+
+  void CSDCNetRound::CompleteJoin()
+  {
+    QSharedPointer<NeffKeyShuffleRound> nks =
+      _state->join_shuffle.dynamicCast<NeffKeyShuffleRound>();
+    if(!nks->Successful() || nks->GetKeyIndex() < 0) {
+      qDebug() << ToString() << "not admitted, waiting for the next round";
+      _state->admission.clear();
       _state_machine.StateComplete();
+      return;
+    }
+
+    QDataStream stream(_state->admission);
+    int activation, offset, count, msg_length, layouts;
+    QByteArray nonce, keys_hash;
+    QMap<int, int> next_messages;
+    stream >> activation >> offset >> count >> nonce >> keys_hash >>
+      next_messages >> msg_length >> layouts;
+
+    QList<SlotLayout> pipelined_layouts;
+    for(int idx = 0; idx < layouts; idx++) {
+      QMap<int, int> messages;
+      int length;
+      stream >> messages >> length;
+      pipelined_layouts.append(SlotLayout(messages, length));
+    }
+
+    QVector<QByteArray> encoded;
+    QDataStream kstream(_state->join_keys);
+    kstream >> encoded;
+
+    QVector<QSharedPointer<Crypto::AsymmetricKey> > keys = nks->GetKeys();
+    if(keys.count() != count || _state->cleartext.size() != msg_length ||
+        encoded.count() != offset ||
+        Hash().ComputeHash(_state->join_keys) != keys_hash)
+    {
+      Stop("Invalid admission");
+      return;
     }
+
+    // The earlier slots' keys, as agreed upon by every server
+    QVector<QSharedPointer<Crypto::AsymmetricKey> > anonymous_keys;
+    foreach(const QByteArray &key, encoded) {
+      anonymous_keys.append(key.isEmpty() ?
+          QSharedPointer<Crypto::AsymmetricKey>() :
+          QSharedPointer<Crypto::AsymmetricKey>(new Crypto::DsaPublicKey(key)));
+    }
+
+    _state->anonymous_keys = anonymous_keys + keys;
+    _state->anonymous_key = nks->GetKey();
+    _state->my_idx = offset + nks->GetKeyIndex();
+
+    _state->slot_count = offset;
+    _state->base_msg_length = BitmapLength(offset);
+    _state->next_messages = next_messages;
+    _state->msg_length = msg_length;
+    _state->pipelined_layouts = pipelined_layouts;
+    ApplyAdmission(_state->admission);
+
+    // The phases in flight were laid out without this client's slot
+    _state->submitted_phase = activation - 1;
+    _state->joining = false;
+    _state->admission.clear();
+    _state->join_keys.clear();
+
+    SetupRngSeeds();
+    qDebug() << ToString() << "admitted into slot" << _state->my_idx <<
+      "starting in phase" << activation;
+
+    ConcludeCleartext();
+  }
+
+  void CSDCNetRound::ActivateJoinedClients()
+  {
+    _state->slot_count = _state->next_slot_count;
+    _state->base_msg_length = _state->next_base_msg_length;
+    _state->activation_phase = -1;
+
+    if(!IsServer()) {
+      return;
+    }
+
+    foreach(const Connections::Id &id, _server_state->admitted_clients) {
+      if(GetOverlay()->GetConnectionTable().GetConnection(id)) {
+        _server_state->allowed_clients.insert(id);
+      }
+    }
+    _server_state->admitted_clients.clear();
+    _server_state->join_batch.clear();
   }
 
   void CSDCNetRound::StartBlameShuffle()
@@ -1317,9 +2112,8 @@ namespace Anonymity {
 
   void CSDCNetRound::TransmitBlameBits()
   {
-    QPair<QBitArray, QBitArray> bits =
-      _server_state->phase_logs[_server_state->current_blame.third]->
-      GetBitsAtIndex(_server_state->current_blame.second);
+    QPair<QBitArray, QBitArray> bits = GetBlameBits(
+        _server_state->current_blame.third, _server_state->current_blame.second);
 
     QByteArray payload;
     QDataStream stream(&payload, QIODevice::WriteOnly);
@@ -1329,6 +2123,11 @@ namespace Anonymity {
     _state_machine.StateComplete();
   }
 
+  QPair<QBitArray, QBitArray> CSDCNetRound::GetBlameBits(int phase, int msg_idx)
+  {
+    return _server_state->phase_logs[phase]->GetBitsAtIndex(msg_idx);
+  }
+
   void CSDCNetRound::RequestRebuttal()
   {
     QPair<int, QBitArray> pair = FindMismatch();
@@ -1399,9 +2198,9 @@ namespace Anonymity {
 
   void CSDCNetRound::ProcessCleartext()
   {
-    int next_msg_length = _state->base_msg_length;
+    int next_msg_length = BaseLength(_state_machine.GetPhase() + _pipeline_depth);
     QMap<int, int> next_msgs;
-    for(int idx = 0; idx < GetClients().Count(); idx++) {
+    for(int idx = 0; idx < _state->slot_count; idx++) {
       if(_state->cleartext[idx / 8] & bit_masks[idx % 8]) {
         int length = SlotHeaderLength(idx);
         next_msgs[idx] = length;
@@ -1410,10 +2209,7 @@ namespace Anonymity {
       }
     }
 
-    int offset = GetClients().Count() / 8;
-    if(GetClients().Count() % 8) {
-      ++offset;
-    }
+    int offset = _state->base_msg_length;
 
 #ifndef CSBR_SIGN_SLOTS
     Hash hashalgo;
@@ -1422,7 +2218,7 @@ namespace Anonymity {
 
     if(IsServer()) {
       int calc = offset;
-      for(int idx = 0; idx < GetClients().Count(); idx++) {
+      for(int idx = 0; idx < _state->slot_count; idx++) {
         _server_state->current_phase_log->message_offsets.append(calc);
         int msg_length = _state->next_messages.contains(idx) ?
           _state->next_messages[idx] : 0;
@@ -1447,8 +2243,7 @@ namespace Anonymity {
         next_msgs[owner] = msg_length;
 
         if(_state->my_idx == owner) {
-          _state->read = false;
-          _state->slot_open = true;
+          RetransmitSlotMessage();
           qDebug() << "My message didn't make it in time.";
         }
         continue;
@@ -1475,10 +2270,11 @@ namespace Anonymity {
         next_msgs[owner] = msg_length;
 
         if(owner == _state->my_idx && !_state->accuse) {
-          _state->read = false;
-          _state->slot_open = true;
+          RetransmitSlotMessage();
+          const QByteArray last_ciphertext =
+            _state->sent_ciphertexts.value(_state_machine.GetPhase());
           for(int pidx = 0; pidx < msg_ppp.size(); pidx++) {
-            const char expected = _state->last_ciphertext[pidx];
+            const char expected = last_ciphertext[pidx];
             const char actual = msg_ppp[pidx];
             if(expected == actual) {
               continue;
@@ -1509,7 +2305,7 @@ namespace Anonymity {
               _state->accuse_idx << _state->blame_phase;
           } else {
             qDebug() << msg_ppp.toBase64() << msg_ppp.size() << msg_length;
-            qDebug() << _state->last_ciphertext.toBase64() << _state->last_ciphertext.size();
+            qDebug() << last_ciphertext.toBase64() << last_ciphertext.size();
             qDebug() << "My message got corrupted cannot blame";
           }
         }
@@ -1561,10 +2357,72 @@ namespace Anonymity {
 
     if(IsServer()) {
       _server_state->current_phase_log->message_length = offset;
+    } else {
+      int phase = _state_machine.GetPhase();
+      _state->slot_messages.remove(phase);
+      _state->sent_messages.remove(phase);
+      _state->sent_ciphertexts.remove(phase);
     }
 
-    _state->next_messages = next_msgs;
-    _state->msg_length = next_msg_length;
+    // This cleartext lays out the phase _pipeline_depth phases from now
+    _state->pipelined_layouts.append(SlotLayout(next_msgs, next_msg_length));
+    SlotLayout layout = _state->pipelined_layouts.takeFirst();
+    _state->next_messages = layout.messages;
+    _state->msg_length = layout.length;
+  }
+
+  CSDCNetRound::SlotLayout CSDCNetRound::GetLayout(int phase) const
+  {
+    int ahead = phase - _state_machine.GetPhase();
+    if(ahead <= 0) {
+      return SlotLayout(_state->next_messages, _state->msg_length);
+    }
+    return _state->pipelined_layouts.value(ahead - 1,
+        SlotLayout(QMap<int, int>(), BaseLength(phase)));
+  }
+
+  int CSDCNetRound::BaseLength(int phase) const
+  {
+    if(_state->activation_phase >= 0 && _state->activation_phase <= phase) {
+      return _state->next_base_msg_length;
+    }
+    return _state->base_msg_length;
+  }
+
+  QSharedPointer<CSDCNetRound::PhaseLog> CSDCNetRound::GetPhaseLog(int phase)
+  {
+    QSharedPointer<PhaseLog> &phase_log = _server_state->phase_logs[phase];
+    if(!phase_log) {
+      phase_log = QSharedPointer<PhaseLog>(
+          new PhaseLog(phase, GetClients().Count(), PAD_MODE));
+    }
+    return phase_log;
+  }
+
+  void CSDCNetRound::RetirePhaseLogs(
+      QHash<int, QSharedPointer<PhaseLog> > &phase_logs, int phase,
+      int retention, int memory_window)
+  {
+    foreach(int log_phase, phase_logs.keys()) {
+      if(log_phase <= phase - retention) {
+        phase_logs.remove(log_phase);
+      } else if(log_phase <= phase - memory_window) {
+        phase_logs[log_phase]->Archive();
+      }
+    }
+  }
+
+  void CSDCNetRound::RetransmitSlotMessage()
+  {
+    int phase = _state_machine.GetPhase();
+    int retry = phase + _pipeline_depth;
+
+    // The announcement made in this slot was lost, so announce it again
+    QByteArray lost = _state->slot_messages.value(retry);
+    if(!lost.isEmpty()) {
+      _state->pending_msgs.prepend(lost);
+    }
+    _state->slot_messages[retry] = _state->sent_messages.value(phase);
   }
 
   QByteArray CSDCNetRound::NullSeed()
@@ -1659,18 +2517,17 @@ namespace Anonymity {
 
     int byte_idx = accuse_idx / 8;
     int bit_idx = accuse_idx % 8;
-    int msg_size = byte_idx + 1;
 
     int bidx = -1;
-    QByteArray tmp(msg_size, 0);
 
     for(int idx = 0; idx < _state->base_seeds.size(); idx++) {
       const QByteArray &base_seed = _state->base_seeds[idx];
       hashalgo.Update(base_seed);
       hashalgo.Update(bphase);
       hashalgo.Update(GetNonce());
-      CryptoRandom(hashalgo.ComputeHash()).GenerateBlock(tmp);
-      if(((tmp[byte_idx] & bit_masks[bit_idx]) != 0) != server_bits[idx]) {
+      char byte = Crypto::PadGenerator(hashalgo.ComputeHash(), PAD_MODE).
+        GetByte(byte_idx);
+      if(((byte & bit_masks[bit_idx]) != 0) != server_bits[idx]) {
         bidx = idx;
         break;
       }
@@ -1688,5 +2545,13 @@ namespace Anonymity {
     QByteArray proof = GetPrivateIdentity().GetDhKey().ProveSharedSecret(server_dh);
     return QPair<int, QByteArray>(bidx, proof);
   }
+
+namespace CSDCNetRoundPrivate {
+  void GenerateServerCiphertext::run()
+  {
+    _round->GenerateServerCiphertext();
+    emit Finished();
+  }
+}
 }
 }
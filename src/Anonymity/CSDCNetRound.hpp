@@ -2,9 +2,12 @@
 #define DISSENT_ANONYMITY_CS_BULK_ROUND_H_GUARD
 
 #include <QMetaEnum>
+#include <QRunnable>
+#include <QTemporaryFile>
 
 #include "Crypto/CryptoRandom.hpp"
 #include "Crypto/Hash.hpp"
+#include "Crypto/PadEngine.hpp"
 #include "Utils/TimerEvent.hpp"
 #include "Utils/Triple.hpp"
 #include "RoundStateMachine.hpp"
@@ -14,6 +17,10 @@ namespace Dissent {
 namespace Anonymity {
   const unsigned char bit_masks[8] = {1, 2, 4, 8, 16, 32, 64, 128};
 
+namespace CSDCNetRoundPrivate {
+  class GenerateServerCiphertext;
+}
+
   /**
    * Represents a single instance of a cryptographically secure anonymous
    * exchange.
@@ -35,6 +42,22 @@ namespace Anonymity {
    * and then distribute the final cleartext to all clients. RNGs are reset
    * each round to map to the shared secret between the client and server,
    * the RoundID (or nonce), and then the current phase.
+   *
+   * Clients that register after the round began are admitted in batches
+   * rather than by restarting the round.  Servers exchange the clients
+   * registered with them alongside their client lists, agree on a batch,
+   * and run a key shuffle amongst only the batch to hand out anonymous keys.
+   * Once every server has finished that shuffle, the next cleartext carries
+   * the admission, which appends the batch's slots and DiffieHellman seeds
+   * at a phase boundary, pipeline depth phases later, so that members'
+   * existing slots, seeds, and keys are untouched.  Admitted clients are not
+   * part of the blame shuffle and so cannot accuse.
+   *
+   * A batch's anonymous keys are shuffled amongst only the batch, so an
+   * admitted slot is anonymous only within its batch rather than amongst
+   * every client in the round.  Servers therefore hold admissions until at
+   * least MIN_JOIN_BATCH clients are waiting, clients that arrive while
+   * fewer are waiting are admitted with later arrivals or at the next round.
    */
   class CSDCNetRound : public BaseDCNetRound
   {
@@ -56,6 +79,7 @@ namespace Anonymity {
         SERVER_REBUTTAL_OR_VERDICT,
         CLIENT_REBUTTAL,
         SERVER_VERDICT_SIGNATURE,
+        SERVER_JOIN_BATCH,
       };
 
       enum States {
@@ -66,6 +90,7 @@ namespace Anonymity {
         CLIENT_WAIT_FOR_CLEARTEXT,
         SERVER_WAIT_FOR_CLIENT_CIPHERTEXT,
         SERVER_WAIT_FOR_CLIENT_LISTS,
+        SERVER_GENERATE_CIPHERTEXT,
         SERVER_WAIT_FOR_SERVER_COMMITS,
         SERVER_WAIT_FOR_SERVER_CIPHERTEXT,
         SERVER_WAIT_FOR_SERVER_VALIDATION,
@@ -82,6 +107,7 @@ namespace Anonymity {
         SERVER_EXCHANGE_VERDICT_SIGNATURE,
         SERVER_WAIT_FOR_VERDICT_SIGNATURE,
         SERVER_SHARE_VERDICT,
+        JOIN_WAIT_FOR_BATCH,
         FINISHED,
       };
 
@@ -170,6 +196,65 @@ namespace Anonymity {
        */
       virtual void PeerJoined() { _stop_next = true; }
 
+      /**
+       * Returns true if clients can be admitted while the round is running,
+       * which is not possible when members need the anonymous keys of every
+       * slot
+       */
+      virtual bool AdmitsClients() const;
+
+      /**
+       * Queues a client to be admitted at a later phase, the client should
+       * then start a round from the original roster, which does not include
+       * it
+       * @param client the client's identity for this round
+       */
+      virtual void AdmitClient(const Identity::PublicIdentity &client);
+
+      /**
+       * Slots follow the anonymous keys shuffled at the start of each round
+       */
+      virtual bool ReassignsSlots() const { return true; }
+
+      /**
+       * Sets the number of phases a client keeps in flight.  The cleartext of
+       * a phase determines the slots of the phase depth phases later, so
+       * servers can collect the next phases' client ciphertexts while they
+       * finish the current one.  All members must agree and this must be set
+       * before the round starts.
+       * @param depth the number of phases in flight
+       */
+      void SetPipelineDepth(int depth) { _pipeline_depth = qMax(1, depth); }
+
+      /**
+       * Sets the pipeline depth of rounds constructed afterwards, such as
+       * from the pipeline_depth setting.  All members must use the same
+       * depth.
+       * @param depth the number of phases in flight, less than 1 restores
+       * PIPELINE_DEPTH
+       */
+      static void SetDefaultPipelineDepth(int depth)
+      {
+        _default_pipeline_depth = depth < 1 ? int(PIPELINE_DEPTH) : depth;
+      }
+
+      /**
+       * Returns the pipeline depth of rounds constructed afterwards
+       */
+      static int GetDefaultPipelineDepth() { return _default_pipeline_depth; }
+
+      /**
+       * Sets how much accusation history servers keep
+       * @param retention the number of phases that can still be blamed
+       * @param memory_window the number of most recent phases whose server
+       * ciphertexts are held in memory, older phases are read from disk
+       */
+      void SetPhaseLogRetention(int retention, int memory_window)
+      {
+        _phase_log_retention = qMax(1, retention);
+        _phase_log_memory_window = qMax(1, memory_window);
+      }
+
       virtual void HandleDisconnect(const Connections::Id &id);
 
       /**
@@ -186,12 +271,53 @@ namespace Anonymity {
 
       static constexpr float CLIENT_WINDOW_MULTIPLIER = 2.0;
 
+      /**
+       * Keystream used for the DC-net pads.  Pads are not stored, so blame
+       * reads single pad bytes, AES_CTR does so in constant time while the
+       * original X9.17 pads must be replayed up to the byte.  AES_CTR does
+       * not interoperate with nodes using the X9.17 pads.
+       */
+#ifdef CSBR_COMPATIBLE_PADS
+      static const Crypto::PadGenerator::Mode PAD_MODE =
+        Crypto::PadGenerator::COMPATIBLE;
+#else
+      static const Crypto::PadGenerator::Mode PAD_MODE =
+        Crypto::PadGenerator::AES_CTR;
+#endif
+
+      /**
+       * Default number of phases in flight, 1 disables pipelining
+       */
+      static const int PIPELINE_DEPTH = 1;
+
+      /**
+       * Default number of phases that can be blamed
+       */
+      static const int PHASE_LOG_RETENTION = 5;
+
+      /**
+       * Default number of phases whose server ciphertexts are held in memory
+       */
+      static const int PHASE_LOG_MEMORY_WINDOW = 1;
+
+      /**
+       * The fewest clients admitted into a running round at once, which is
+       * the anonymity set of an admitted slot
+       */
+      static const int MIN_JOIN_BATCH = 4;
+
+      /**
+       * The most clients admitted into a running round at once
+       */
+      static const int MAX_JOIN_BATCH = 32;
+
 #ifdef DEMO_SESSION
       static constexpr int MAX_GET = 1048576;
 #else
       static constexpr int MAX_GET = 4096;
 #endif
 
+
     protected:
       typedef Utils::Random Random;
 
@@ -203,6 +329,15 @@ namespace Anonymity {
       virtual void ProcessPacket(const Connections::Id &from,
           const QByteArray &data);
 
+      /**
+       * Routes a packet to the RoundStateMachine or the shuffles
+       * @param from the remote peer sending the data
+       * @param data Incoming data
+       * @param verified the verified data block, if checked by QueueVerify
+       */
+      virtual void ProcessQueued(const Connections::Id &from,
+          const QByteArray &data, const QByteArray *verified);
+
       /**
        * Called when the BulkRound is started
        */
@@ -216,31 +351,80 @@ namespace Anonymity {
       //Needed in protected for testing
       virtual QByteArray GenerateCiphertext();
       virtual void GenerateServerCiphertext();
+      virtual QPair<QBitArray, QBitArray> GetBlameBits(int phase, int msg_idx);
+
+      /**
+       * The slot lengths and total length of a phase's ciphertext
+       */
+      class SlotLayout {
+        public:
+          SlotLayout(const QMap<int, int> &messages = QMap<int, int>(),
+              int length = 0) :
+            messages(messages),
+            length(length)
+          {
+          }
+
+          QMap<int, int> messages;
+          int length;
+      };
 
       /**
        * Holds the internal state for this round
        */
       class State {
         public:
-          State() : accuse(false), start_accuse(false), my_accuse(false) {}
+          State() :
+            anonymous_pads(PAD_MODE),
+            accuse(false),
+            ciphertext_phase(0),
+            submitted_phase(-1),
+            start_accuse(false),
+            my_accuse(false),
+            slot_count(0),
+            activation_phase(-1),
+            next_slot_count(0),
+            next_base_msg_length(0),
+            joining(false)
+          {
+          }
           virtual ~State() {}
 
           QVector<QSharedPointer<Crypto::AsymmetricKey> > anonymous_keys;
           QList<QByteArray> base_seeds;
-          QVector<Crypto::CryptoRandom> anonymous_rngs;
+          Crypto::PadEngine anonymous_pads;
           QMap<int, int> next_messages;
           QHash<int, QByteArray> signatures;
           QByteArray cleartext;
           QBitArray online_clients;
 
+          /**
+           * Layouts of the phases after the current one, when pipelining
+           */
+          QList<SlotLayout> pipelined_layouts;
+
           QSharedPointer<Crypto::AsymmetricKey> anonymous_key;
           QByteArray shuffle_data;
-          bool read;
-          bool slot_open;
           bool accuse;
-          QByteArray next_msg;
-          QByteArray last_msg;
-          QByteArray last_ciphertext;
+
+          /**
+           * Data retrieved for a slot but not yet announced
+           */
+          QList<QByteArray> pending_msgs;
+
+          /**
+           * By phase, the message announced for this client's slot, the
+           * message sent, and the resulting slot ciphertext
+           */
+          QHash<int, QByteArray> slot_messages;
+          QHash<int, QByteArray> sent_messages;
+          QHash<int, QByteArray> sent_ciphertexts;
+
+          /**
+           * The phase GenerateCiphertext is producing a ciphertext for
+           */
+          int ciphertext_phase;
+          int submitted_phase;
           int msg_length;
           int base_msg_length;
           int my_idx;
@@ -251,52 +435,146 @@ namespace Anonymity {
           int accuse_idx;
           int blame_phase;
           QSharedPointer<Round> blame_shuffle;
+
+          /**
+           * The slots in the current phase and, once clients are admitted,
+           * the phase their slots open and the slots and bitmap length from
+           * then on
+           */
+          int slot_count;
+          int activation_phase;
+          int next_slot_count;
+          int next_base_msg_length;
+
+          /**
+           * Set for a client that joined the round in progress until its
+           * admission arrives
+           */
+          bool joining;
+
+          /**
+           * The key shuffle of the batch being admitted, its nonce, and the
+           * packets that arrived when no shuffle was running
+           */
+          QSharedPointer<Round> join_shuffle;
+          QByteArray join_nonce;
+
+          /**
+           * For a joining client, the anonymous keys of the slots preceding
+           * its batch as sent by its server, checked against the admission
+           */
+          QByteArray join_keys;
+          QList<QPair<Connections::Id, QByteArray> > join_packets;
+
+          /**
+           * For servers, the admission carried by this phase's cleartext,
+           * for a joining client, its admission held until its shuffle ends
+           */
+          QByteArray admission;
       };
 
       /**
-       * Holds the internal state for phases for the purpose of accusation
+       * Holds the internal state for phases for the purpose of accusation.
+       * Ciphertexts are kept in an append-only file that is memory-mapped
+       * when read, and this server's pads are not stored at all but
+       * regenerated from the per-phase seeds, so a log costs little more
+       * than its file on disk.
        */
       class PhaseLog {
         public:
-          PhaseLog(int phase, int max) : phase(phase), _max(max) { }
-
-          QPair<QBitArray, QBitArray> GetBitsAtIndex(int msg_idx)
-          {
-            int byte_idx = msg_idx / 8;
-            int bit_idx = msg_idx % 8;
-
-            QBitArray clients(_max, false);
-            foreach(int idx, messages.keys()) {
-              clients[idx] = (messages[idx][byte_idx] & bit_masks[bit_idx]) > 0;
-            }
-
-            QBitArray mine(_max, false);
-            foreach(int idx, my_sub_ciphertexts.keys()) {
-              mine[idx] = (my_sub_ciphertexts[idx][byte_idx] & bit_masks[bit_idx]) > 0;
-            }
-
-            return QPair<QBitArray, QBitArray>(clients, mine);
-          }
+          PhaseLog(int phase, int max, Crypto::PadGenerator::Mode pad_mode);
+          ~PhaseLog();
+
+          /**
+           * Stores a client ciphertext for blame
+           * @param idx the client's index
+           * @param msg the client's ciphertext
+           */
+          void AddMessage(int idx, const QByteArray &msg);
+
+          /**
+           * Returns the stored ciphertext for a client
+           * @param idx the client's index
+           */
+          QByteArray GetMessage(int idx);
+
+          /**
+           * Returns the number of stored client ciphertexts
+           */
+          int MessageCount() const { return _messages.count(); }
+
+          /**
+           * Stores a server ciphertext for blame, these remain in memory
+           * until Archive is called
+           * @param id the server
+           * @param msg the server's ciphertext
+           */
+          void AddServerMessage(const Connections::Id &id, const QByteArray &msg);
+
+          /**
+           * Stores the seed for the pad this server shared with a client
+           * during this phase
+           * @param idx the client's index
+           * @param seed the seed for the pad
+           */
+          void SetPadSeed(int idx, const QByteArray &seed) { _pad_seeds[idx] = seed; }
+
+          /**
+           * Moves the server ciphertexts into the log file, called once
+           * the phase leaves the in-memory window
+           */
+          void Archive();
+
+          /**
+           * Returns the number of bytes written to the log file
+           */
+          qint64 FileSize() const { return _file_size; }
+
+          QPair<QBitArray, QBitArray> GetBitsAtIndex(int msg_idx);
 
           char GetBitAtIndex(const Connections::Id &id, int msg_idx)
           {
             int byte_idx = msg_idx / 8;
             int bit_idx = msg_idx % 8;
-            return (server_messages[id][byte_idx] & bit_masks[bit_idx]) >> bit_idx;
+            char byte = ReadByte(_server_messages.value(id), byte_idx);
+            return (byte & bit_masks[bit_idx]) >> bit_idx;
           }
 
           QBitArray clients;
           QVector<int> message_offsets;
           int message_length;
           QHash<int, int> client_to_server;
-          QHash<int, QByteArray> messages;
-          QHash<int, QByteArray> my_sub_ciphertexts;
-          QHash<Connections::Id, QByteArray> server_messages;
           int phase;
 
         private:
-          int _max;
+          /**
+           * The location of a ciphertext, either an offset into the log file
+           * or, if offset is negative, data
+           */
+          class Record {
+            public:
+              Record() : offset(-1), length(0) {}
+
+              qint64 offset;
+              int length;
+              QByteArray data;
+          };
+
+          Record Append(const QByteArray &msg);
+          QByteArray Read(const Record &record);
+          char ReadByte(const Record &record, int byte_idx);
+          const uchar *Map(const Record &record);
+          char GetPadByte(int idx, int byte_idx);
 
+          int _max;
+          Crypto::PadGenerator::Mode _pad_mode;
+          QHash<int, QByteArray> _pad_seeds;
+          QHash<int, Record> _messages;
+          QHash<Connections::Id, Record> _server_messages;
+          QTemporaryFile _file;
+          qint64 _file_size;
+          uchar *_map;
+          qint64 _map_size;
       };
 
       /**
@@ -304,9 +582,21 @@ namespace Anonymity {
        */
       class ServerState : public State {
         public:
-          ServerState() : accuse_found(false) { }
+          ServerState() : client_ciphertext_count(0), accuse_found(false) { }
           virtual ~ServerState() {}
 
+          /**
+           * Client ciphertexts received early for a later phase
+           */
+          class PipelinedPhase {
+            public:
+              PipelinedPhase() : client_ciphertext_count(0) {}
+
+              QBitArray handled_clients;
+              QByteArray client_aggregate;
+              int client_ciphertext_count;
+          };
+
           Utils::TimerEvent client_ciphertext_period;
           qint64 start_of_phase;
           int expected_clients;
@@ -320,14 +610,36 @@ namespace Anonymity {
           QBitArray handled_clients;
           QByteArray signed_hash;
           QBitArray handled_servers_bits;
-          QList<QPair<int, QByteArray> > client_ciphertexts;
+
+          /**
+           * XOR of the client ciphertexts received this phase, folded in
+           * as each arrives
+           */
+          QByteArray client_aggregate;
+          int client_ciphertext_count;
 
           QSet<Connections::Id> handled_servers;
           QHash<int, int> rng_to_gidx;
           QHash<int, QByteArray> server_commits;
           QHash<int, QByteArray> server_ciphertexts;
+          QMap<int, PipelinedPhase> pipelined_phases;
           QHash<int, QSharedPointer<PhaseLog> > phase_logs;
           QSharedPointer<PhaseLog> current_phase_log;
+
+          /**
+           * Clients registered with this server not yet offered to the
+           * others, the offers and join shuffle status in this phase's
+           * client lists by server index, the clients offered but not yet
+           * batched, the batch being admitted, and those of the batch whose
+           * slots are not yet open
+           */
+          QList<Identity::PublicIdentity> pending_joins;
+          QHash<int, QList<Identity::PublicIdentity> > join_offers;
+          QHash<int, int> join_status;
+          QList<Identity::PublicIdentity> join_candidates;
+          QVector<Identity::PublicIdentity> join_batch;
+          QSet<Connections::Id> admitted_clients;
+
           bool accuse_found;
           // owner, accuse, phase
           Utils::Triple<int, int, int> current_blame;
@@ -342,6 +654,8 @@ namespace Anonymity {
       QSharedPointer<State> GetState() { return _state; }
 
     private:
+      friend class CSDCNetRoundPrivate::GenerateServerCiphertext;
+
       /**
        * Called by the constructor to initialize the server state machine
        */
@@ -398,6 +712,15 @@ namespace Anonymity {
        */
       void HandleClientCiphertext(const Connections::Id &from, QDataStream &stream);
 
+      /**
+       * Server handles client ciphertext messages for a later phase
+       * @param from sender of the message
+       * @param stream message
+       * @param phase the phase of the ciphertext
+       */
+      void HandleFutureClientCiphertext(const Connections::Id &from,
+          QDataStream &stream, int phase);
+
       /**
        * Server handles other server client list messages
        * @param from sender of the message
@@ -441,11 +764,34 @@ namespace Anonymity {
 
       void HandleRebuttalOrVerdict(const Connections::Id &from, QDataStream &stream);
 
+      /**
+       * Joining client handles the batch it is to be admitted with
+       * @param from sender of the message
+       * @param stream message
+       */
+      void HandleJoinBatch(const Connections::Id &from, QDataStream &stream);
+
+      /**
+       * Joining client handles the batch it is to be admitted with, when
+       * the batch was formed after the phase the client is in
+       * @param from sender of the message
+       * @param stream message
+       * @param phase the phase the batch was formed in
+       */
+      void HandleFutureJoinBatch(const Connections::Id &from,
+          QDataStream &stream, int phase);
+
       /**
        * Decoupled as to not waste resources if the shuffle doesn't succeed
        */
       void SetupRngSeeds();
 
+      /**
+       * Appends the base seeds shared with members of a roster
+       * @param roster the members
+       */
+      void AddRngSeeds(const Identity::Roster &roster);
+
       /**
        * For clients, this is a trivial setup, one for each server, servers
        * need to set this after determining the online client set.
@@ -462,7 +808,15 @@ namespace Anonymity {
 #endif
       void SubmitClientCiphertext();
       void SetOnlineClients();
+
+      /**
+       * Returns true if every allowed client has submitted a ciphertext
+       * for the current phase
+       */
+      bool AllowedClientsSubmitted() const;
+
       void SubmitClientList();
+      void StartServerCiphertext();
       void SubmitCommit();
       void SubmitServerCiphertext();
       void SubmitValidation();
@@ -482,6 +836,36 @@ namespace Anonymity {
       void ProcessCleartext();
       void ConcludeClientCiphertextSubmission(const int &);
 
+      /**
+       * Returns the layout of the current or a pipelined phase
+       * @param phase the phase
+       */
+      SlotLayout GetLayout(int phase) const;
+
+      /**
+       * Returns the log for a phase, creating it if necessary
+       * @param phase the phase
+       */
+      QSharedPointer<PhaseLog> GetPhaseLog(int phase);
+
+      /**
+       * Drops the logs of phases that can no longer be blamed and archives
+       * those that have left the in-memory window
+       * @param phase_logs the logs by phase
+       * @param phase the phase about to begin
+       * @param retention the number of phases that can still be blamed
+       * @param memory_window the number of phases held in memory
+       */
+      static void RetirePhaseLogs(
+          QHash<int, QSharedPointer<PhaseLog> > &phase_logs, int phase,
+          int retention, int memory_window);
+
+      /**
+       * Called when this client's slot in the current phase was lost, the
+       * slot sized by the lost announcement repeats the message
+       */
+      void RetransmitSlotMessage();
+
 #ifdef CSBR_SIGN_SLOTS
       inline int SlotHeaderLength(int slot_idx) const
 #else
@@ -496,6 +880,117 @@ namespace Anonymity {
         return 9 + Crypto::CryptoRandom::OptimalSeedSize() + sig_length;
       }
 
+      /**
+       * Returns the length of the slot bitmap for a number of slots
+       * @param slots the number of slots
+       */
+      static int BitmapLength(int slots)
+      {
+        return (slots / 8) + ((slots % 8) ? 1 : 0);
+      }
+
+      /**
+       * Returns the length of the slot bitmap in a phase
+       * @param phase the phase
+       */
+      int BaseLength(int phase) const;
+
+      /**
+       * Processes the current cleartext and moves on to the next phase or
+       * to blame
+       */
+      void ConcludeCleartext();
+
+      /* Below are the helpers for admitting clients into the round */
+
+      /**
+       * The key shuffle of a batch generates its own keys
+       */
+      QPair<QByteArray, bool> GetJoinData(int)
+      {
+        return QPair<QByteArray, bool>(QByteArray(), false);
+      }
+
+      /**
+       * The status of a server's join shuffle, as reported in its client list
+       */
+      enum JoinStatus {
+        JOIN_IDLE = 0,
+        JOIN_RUNNING,
+        JOIN_DONE,
+        JOIN_FAILED,
+      };
+
+      /**
+       * Returns the status of this server's join shuffle
+       */
+      int GetJoinStatus() const;
+
+      /**
+       * Called by servers once the client lists are in, merges the offered
+       * clients, forms a batch when none is being admitted and enough
+       * clients are waiting, and admits or abandons the batch once its
+       * shuffle has finished
+       */
+      void ProcessJoins();
+
+      /**
+       * Admits the batch once every server has finished its shuffle,
+       * appending its slots, clients, and seeds and recording the admission
+       * for this phase's cleartext
+       * @param keys the batch's anonymous keys
+       */
+      void AdmitBatch(
+          const QVector<QSharedPointer<Crypto::AsymmetricKey> > &keys);
+
+      /**
+       * Creates and starts the key shuffle for a batch
+       * @param batch the clients in the batch
+       * @param phase the phase the batch was formed in
+       */
+      void StartJoinShuffle(const Identity::Roster &batch, int phase);
+
+      /**
+       * Joining client starts its batch's shuffle
+       * @param from sender of the batch
+       * @param stream the batch message
+       * @param phase the phase the batch was formed in
+       */
+      void StartJoin(const Connections::Id &from, QDataStream &stream,
+          int phase);
+
+      /**
+       * Hands a join shuffle packet to the running join shuffle, or holds
+       * it until the next one starts
+       * @param from the sender
+       * @param data the packet
+       */
+      void ProcessJoinPacket(const Connections::Id &from,
+          const QByteArray &data);
+
+      /**
+       * Schedules the opening of admitted slots announced in a cleartext
+       * @param admission the admission
+       */
+      void ApplyAdmission(const QByteArray &admission);
+
+      /**
+       * Returns true if the admission admits this joining client's batch
+       * @param admission the admission
+       */
+      bool AdmitsBatch(const QByteArray &admission) const;
+
+      /**
+       * Joining client takes its slot and the slot layouts from its
+       * admission, then processes the cleartext that carried it
+       */
+      void CompleteJoin();
+
+      /**
+       * Opens the admitted slots at the start of their first phase
+       */
+      void ActivateJoinedClients();
+
       QPair<int, QBitArray> FindMismatch();
       QPair<int, QByteArray> GetRebuttal(int phase, int accuse_idx,
           const QBitArray &server_bits);
@@ -504,12 +999,57 @@ namespace Anonymity {
       QSharedPointer<State> _state;
       RoundStateMachine<CSDCNetRound> _state_machine;
       bool _stop_next;
+      static int _default_pipeline_depth;
+      int _pipeline_depth;
+      int _phase_log_retention;
+      int _phase_log_memory_window;
       Messaging::GetDataMethod<CSDCNetRound> _get_blame_data;
       BufferSink _blame_sink;
+      Messaging::GetDataMethod<CSDCNetRound> _get_join_data;
+      BufferSink _join_sink;
 
     private slots:
       void OperationFinished() { _state_machine.StateComplete(); }
+
+      /**
+       * Called when a join shuffle finishes
+       */
+      void JoinShuffleFinished();
+
+      /**
+       * Called when the server ciphertext has been generated off the event
+       * thread, the round may have been stopped in the meantime
+       */
+      void ServerCiphertextFinished()
+      {
+        if(Stopped()) {
+          return;
+        }
+        _state_machine.StateComplete();
+      }
   };
+
+namespace CSDCNetRoundPrivate {
+  /**
+   * Runs GenerateServerCiphertext on the thread pool, so that pad expansion
+   * and ciphertext folding for many clients does not block the event loop
+   */
+  class GenerateServerCiphertext : public QObject, public QRunnable {
+    Q_OBJECT
+
+    public:
+      GenerateServerCiphertext(CSDCNetRound *round) : _round(round) { }
+
+      virtual ~GenerateServerCiphertext() { }
+      virtual void run();
+
+    signals:
+      void Finished();
+
+    private:
+      CSDCNetRound *_round;
+  };
+}
 }
 }
 
@@ -1,19 +1,40 @@
 #include <QDataStream>
+#include <QDebug>
+#include "Crypto/Hash.hpp"
 #include "Log.hpp"
-#include "Connections/Id.hpp"
-
-using Dissent::Connections::Id;
 
 namespace Dissent {
 namespace Anonymity {
-  Log::Log() : _enabled(true)
+  Log::Log() :
+    _enabled(true),
+    _budget(0),
+    _digest_threshold(0),
+    _bytes(0),
+    _dropped(0),
+    _last_write(-1),
+    _spill_size(0)
   {
   }
 
-  Log::Log(const QByteArray &logdata) : _enabled(true)
+  Log::Log(const QByteArray &logdata) :
+    _enabled(true),
+    _budget(0),
+    _digest_threshold(0),
+    _bytes(0),
+    _dropped(0),
+    _last_write(-1),
+    _spill_size(0)
   {
     QDataStream stream(logdata);
-    stream >> _entries;
+    int count = 0;
+    stream >> count >> _dropped;
+    for(int idx = 0; idx < count && stream.status() == QDataStream::Ok; idx++) {
+      Entry entry;
+      stream >> entry.remote >> entry.data >> entry.digest >> entry.size >>
+        entry.offset;
+      _bytes += entry.data.size();
+      _entries.append(entry);
+    }
   }
 
   bool Log::ToggleEnabled()
@@ -21,40 +42,176 @@ namespace Anonymity {
     return (_enabled = !_enabled);
   }
 
+  void Log::SetLimits(int budget, int digest_threshold)
+  {
+    _budget = qMax(0, budget);
+    _digest_threshold = qMax(0, digest_threshold);
+  }
+
+  bool Log::SetSpillFile(const QString &filename)
+  {
+    _last_write = -1;
+    _spill_size = 0;
+    _spill = QSharedPointer<QFile>(new QFile(filename));
+    if(!_spill->open(QIODevice::ReadWrite | QIODevice::Truncate)) {
+      qWarning() << "Unable to open log spill file" << filename;
+      _spill.clear();
+      return false;
+    }
+    return true;
+  }
+
+  qint64 Log::WriteSpill(SpillRecord type, const QByteArray &data)
+  {
+    // Both size and seek flush QFile's buffer, so the end is tracked here
+    qint64 offset = _spill_size;
+    if(_spill->pos() != offset) {
+      _spill->seek(offset);
+    }
+    QDataStream stream(_spill.data());
+    stream << int(type) << data;
+    _spill_size = _spill->pos();
+    _last_write = offset;
+    return offset;
+  }
+
   void Log::Pop()
   {
-    if(_enabled) {
-      _entries.pop_back();
+    if(!_enabled || _entries.isEmpty()) {
+      return;
+    }
+
+    Entry entry = _entries.takeLast();
+    _bytes -= entry.data.size();
+    // Only reclaim the packet if nothing was written after it
+    if(_spill && entry.offset >= 0 && entry.offset == _last_write) {
+      _spill->resize(entry.offset);
+      _spill_size = entry.offset;
+      _last_write = -1;
     }
   }
 
-  void Log::Append(const QByteArray &entry, const Id &remote)
+  void Log::Append(const QByteArray &data, const Id &remote)
   {
-    if(_enabled) {
-      _entries.append(QPair<QByteArray, Id>(entry, remote));
+    if(!_enabled) {
+      return;
+    }
+
+    Entry entry;
+    entry.remote = remote;
+    entry.size = data.size();
+    entry.offset = -1;
+    entry.digest = (_digest_threshold > 0) && (data.size() > _digest_threshold);
+
+    if(entry.digest) {
+      entry.data = Crypto::Hash().ComputeHash(data);
+      if(_spill) {
+        entry.offset = WriteSpill(SPILL_PACKET, data);
+      }
+    } else {
+      entry.data = data;
+    }
+
+    _bytes += entry.data.size();
+    _entries.append(entry);
+
+    // Keeps at least the newest entry, so that it can be popped
+    while(_budget > 0 && _bytes > _budget && _entries.count() > 1) {
+      _bytes -= _entries.takeFirst().data.size();
+      _dropped++;
     }
   }
 
-  const QPair<QByteArray, Id> &Log::At(int idx) const
+  QPair<QByteArray, Log::Id> Log::At(int idx) const
   {
-    if(_entries.count() < idx || idx < 0) {
-      static const QPair<QByteArray, Id> empty;
-      return empty;
+    if(_entries.count() <= idx || idx < 0) {
+      return QPair<QByteArray, Id>();
+    }
+
+    const Entry &entry = _entries[idx];
+    if(!entry.digest) {
+      return QPair<QByteArray, Id>(entry.data, entry.remote);
+    }
+
+    QByteArray data;
+    if(_spill && entry.offset >= 0 && _spill->seek(entry.offset)) {
+      QDataStream stream(_spill.data());
+      int type;
+      stream >> type >> data;
+      if(type != SPILL_PACKET || data.size() != entry.size) {
+        data.clear();
+      }
     }
-    return _entries[idx];
+    return QPair<QByteArray, Id>(data, entry.remote);
+  }
+
+  bool Log::IsDigest(int idx) const
+  {
+    return (0 <= idx) && (idx < _entries.count()) && _entries[idx].digest;
+  }
+
+  QByteArray Log::GetDigest(int idx) const
+  {
+    return IsDigest(idx) ? _entries[idx].data : QByteArray();
   }
 
   QByteArray Log::Serialize() const
   {
     QByteArray logdata;
     QDataStream stream(&logdata, QIODevice::WriteOnly);
-    stream << _entries;
+    stream << _entries.count() << _dropped;
+    foreach(const Entry &entry, _entries) {
+      stream << entry.remote << entry.data << entry.digest << entry.size <<
+        entry.offset;
+    }
     return logdata;
   }
 
   void Log::Clear()
   {
     _entries.clear();
+    _bytes = 0;
+    _dropped = 0;
+  }
+
+  void Log::Spill()
+  {
+    if(_spill && _enabled && (!_entries.isEmpty() || _dropped)) {
+      WriteSpill(SPILL_LOG, Serialize());
+      // Hashed packets are buffered until now, seeking in At flushes them
+      _spill->flush();
+    }
+    Clear();
+  }
+
+  bool Log::ReadSpillFile(const QString &filename, QList<Log> &logs)
+  {
+    QSharedPointer<QFile> file(new QFile(filename));
+    if(!file->open(QIODevice::ReadOnly)) {
+      return false;
+    }
+
+    // A separate handle lets the logs read back their hashed packets
+    QSharedPointer<QFile> packets(new QFile(filename));
+    packets->open(QIODevice::ReadOnly);
+
+    QDataStream stream(file.data());
+    while(!stream.atEnd()) {
+      int type;
+      QByteArray data;
+      stream >> type >> data;
+      if(stream.status() != QDataStream::Ok) {
+        return false;
+      }
+
+      if(type == SPILL_LOG) {
+        Log log(data);
+        log._spill = packets;
+        log._enabled = false;
+        logs.append(log);
+      }
+    }
+    return true;
   }
 }
 }
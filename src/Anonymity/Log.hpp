@@ -2,24 +2,29 @@
 #define DISSENT_ANONYMITY_LOG_H_GUARD
 
 #include <QByteArray>
+#include <QFile>
+#include <QList>
 #include <QPair>
-#include <QVector>
+#include <QSharedPointer>
 
-namespace Dissent {
-namespace Connections {
-  class Id;
-}
+#include "Connections/Id.hpp"
 
+namespace Dissent {
 namespace Anonymity {
   /**
-   * Maintains a historical mapping of a packet to an Id
+   * Maintains a historical mapping of a packet to an Id.  By default the log
+   * keeps every packet, a round's history log can instead be bounded: packets
+   * larger than a threshold are kept only as their hash and size, the oldest
+   * packets are dropped once a byte budget is exceeded, and the log can be
+   * spilled to a file rather than discarded.  A spilled log records the file
+   * offset of each hashed packet so that it can be recovered.
    */
   class Log {
     public:
       typedef Connections::Id Id;
 
       /**
-       * Default constructor
+       * Default constructor, an unbounded log
        */
       explicit Log();
 
@@ -29,6 +34,22 @@ namespace Anonymity {
        */
       explicit Log(const QByteArray &logdata);
 
+      /**
+       * Bounds the memory held by the log
+       * @param budget the bytes of packets kept, the oldest are dropped
+       * when exceeded, 0 for unbounded
+       * @param digest_threshold packets larger than this are kept as a hash,
+       * 0 to keep all packets
+       */
+      void SetLimits(int budget, int digest_threshold);
+
+      /**
+       * Sets a file to hold the packets kept as a hash and the logs passed
+       * to Spill, the file is truncated
+       * @param filename the file
+       */
+      bool SetSpillFile(const QString &filename);
+
       /**
        * Adds a new message to the end of the log
        * @param entry the data to append
@@ -42,11 +63,23 @@ namespace Anonymity {
       void Pop();
 
       /**
-       * Returns the log entry at the specified index, true if it returns
-       * valid data, false otherwise
+       * Returns the log entry at the specified index, a hashed entry is read
+       * back from the spill file or is empty if there is none
        * @param idx index
        */
-      const QPair<QByteArray, Id> &At(int idx) const;
+      QPair<QByteArray, Id> At(int idx) const;
+
+      /**
+       * Returns true if the entry at the index is kept only as a hash
+       * @param idx index
+       */
+      bool IsDigest(int idx) const;
+
+      /**
+       * Returns the hash of a hashed entry
+       * @param idx index
+       */
+      QByteArray GetDigest(int idx) const;
 
       /**
        * Returns a serialized Log
@@ -56,13 +89,38 @@ namespace Anonymity {
       /**
        * Returns the amount of entries in the log
        */
-      inline int Count() { return _entries.count(); }
+      inline int Count() const { return _entries.count(); }
+
+      /**
+       * Returns the bytes of packets held by the log
+       */
+      inline int Bytes() const { return _bytes; }
+
+      /**
+       * Returns the entries dropped to stay within the budget since the last
+       * Clear
+       */
+      inline int Dropped() const { return _dropped; }
 
       /**
        * Clears the log
        */
       void Clear();
 
+      /**
+       * Appends the serialized log to the spill file, if there is one, flushes
+       * the file so that ReadSpillFile sees it, and clears the log
+       */
+      void Spill();
+
+      /**
+       * Reads the logs spilled into a file, oldest first, the logs are
+       * disabled so they will not write to the file
+       * @param filename the spill file
+       * @param logs returns the logs
+       */
+      static bool ReadSpillFile(const QString &filename, QList<Log> &logs);
+
       /**
        * Disables logging
        */
@@ -71,11 +129,40 @@ namespace Anonymity {
       /**
        * Returns if logging is enabled
        */
-      inline bool Enabled() { return _enabled; }
+      inline bool Enabled() const { return _enabled; }
+
+      static const int DEFAULT_BUDGET = 1 << 20;
+      static const int DEFAULT_DIGEST_THRESHOLD = 1024;
+
     private:
-      QVector<QPair<QByteArray, Id> > _entries;
+      /**
+       * A packet or its hash, offset is the packet's position in the spill
+       * file or -1
+       */
+      struct Entry {
+        QByteArray data;
+        Id remote;
+        bool digest;
+        int size;
+        qint64 offset;
+      };
+
+      enum SpillRecord {
+        SPILL_PACKET = 0,
+        SPILL_LOG = 1
+      };
+
+      qint64 WriteSpill(SpillRecord type, const QByteArray &data);
+
+      QList<Entry> _entries;
       bool _enabled;
-      static const QPair<QByteArray, Id> _empty;
+      int _budget;
+      int _digest_threshold;
+      int _bytes;
+      int _dropped;
+      qint64 _last_write;
+      qint64 _spill_size;
+      QSharedPointer<QFile> _spill;
   };
 }
 }
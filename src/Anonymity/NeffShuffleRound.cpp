@@ -1,4 +1,5 @@
 #include <QThreadPool>
+#include <QtConcurrentMap>
 #include "Crypto/NeffShuffle.hpp"
 #include "Crypto/Hash.hpp"
 #include "Identity/PublicIdentity.hpp"
@@ -424,6 +425,14 @@ namespace Anonymity {
   void NeffShuffleRound::PushServerKeys()
   {
     _server_state->next_verify_keys = _server_state->server_keys;
+
+    // Every server key shares the group, so the shuffles and verifications
+    // share its fixed-base tables
+    const DsaPublicKey &pkey = _server_state->server_keys[0];
+    _server_state->group = QSharedPointer<Crypto::AbstractGroup::IntegerGroup>(
+        new Crypto::AbstractGroup::IntegerGroup(pkey.GetModulus(),
+          pkey.GetGenerator(), pkey.GetSubgroupOrder()));
+
     QByteArray out;
     QDataStream stream(&out, QIODevice::WriteOnly);
     stream << MSG_KEY_DIST << GetNonce() << _server_state->server_keys
@@ -617,7 +626,7 @@ namespace NeffShufflePrivate {
     QVector<QByteArray> output;
     QByteArray transcript;
 
-    NeffShuffle shuffle;
+    NeffShuffle shuffle(_shuffle->_server_state->group);
     shuffle.Shuffle(input, *_shuffle->_server_state->private_key,
         remaining_keys, output, transcript);
 
@@ -629,22 +638,73 @@ namespace NeffShufflePrivate {
     emit Finished();
   }
 
+namespace {
+  /**
+   * The verification of a single server's shuffle transcript
+   */
+  struct TranscriptCheck {
+    QVector<QByteArray> input;
+    QVector<DsaPublicKey> keys;
+    QByteArray transcript;
+    QVector<QByteArray> output;
+    bool valid;
+    QSharedPointer<Crypto::AbstractGroup::IntegerGroup> group;
+  };
+
+  void VerifyTranscript(TranscriptCheck &check)
+  {
+    NeffShuffle shuffle(check.group);
+    check.valid = shuffle.Verify(check.input, check.keys,
+        check.transcript, check.output);
+  }
+}
+
   void VerifyShuffles::run()
   {
     QVector<DsaPublicKey> remaining_keys = _shuffle->_server_state->next_verify_keys;
     QVector<QByteArray> input = _shuffle->_server_state->next_verify_input;
     QVector<QByteArray> output;
-    NeffShuffle shuffle;
 
-    for(int idx = _shuffle->_server_state->next_verify_idx; 
-        idx < _shuffle->_server_state->end_verify_idx; idx++)
-    {
+    // Each transcript claims its output, which is the next transcript's
+    // input, so the transcripts can be verified concurrently
+    int start = _shuffle->_server_state->next_verify_idx;
+    int end = _shuffle->_server_state->end_verify_idx;
+    QVector<TranscriptCheck> checks;
+    QVector<bool> parsed;
+    for(int idx = start; idx < end; idx++) {
       Connections::Id id = _shuffle->GetServers().GetId(idx);
-      QByteArray transcript = _shuffle->_server_state->shuffle_proof[id];
-      if(!shuffle.Verify(input, remaining_keys, transcript, output)) {
-        qCritical() << "Invalid transcript from" << id << "at idx" << idx;
+      TranscriptCheck check = { input, remaining_keys,
+        _shuffle->_server_state->shuffle_proof[id], QVector<QByteArray>(), false,
+        _shuffle->_server_state->group };
+      checks.append(check);
+      parsed.append(NeffShuffle::ParseOutput(check.transcript, input));
+      remaining_keys.pop_front();
+    }
+
+    if(Utils::MultiThreading && checks.size() > 1) {
+      QtConcurrent::blockingMap(checks, VerifyTranscript);
+    } else {
+      for(int idx = 0; idx < checks.size(); idx++) {
+        VerifyTranscript(checks[idx]);
+      }
+    }
+
+    // As when verifying one after another, the chain continues from the
+    // last transcript verified before the first failure
+    remaining_keys = _shuffle->_server_state->next_verify_keys;
+    input = _shuffle->_server_state->next_verify_input;
+    bool chained = true;
+    for(int idx = 0; idx < checks.size(); idx++) {
+      if(!checks[idx].valid || !parsed[idx]) {
+        qCritical() << "Invalid transcript from" <<
+          _shuffle->GetServers().GetId(start + idx) << "at idx" << (start + idx);
+        chained = false;
+      }
+
+      if(chained) {
+        output = checks[idx].output;
+        input = output;
       }
-      input = output;
       remaining_keys.pop_front();
     }
 
@@ -1,6 +1,7 @@
 #ifndef DISSENT_ANONYMITY_NEFF_SHUFFLE_ROUND_H_GUARD
 #define DISSENT_ANONYMITY_NEFF_SHUFFLE_ROUND_H_GUARD
 
+#include "Crypto/AbstractGroup/IntegerGroup.hpp"
 #include "Crypto/DsaPrivateKey.hpp"
 #include "Crypto/DsaPublicKey.hpp"
 #include "Crypto/Integer.hpp"
@@ -238,6 +239,7 @@ namespace NeffShufflePrivate {
           int end_verify_idx;
           int new_end_verify_idx;
           QVector<Crypto::DsaPublicKey> next_verify_keys;
+          QSharedPointer<Crypto::AbstractGroup::IntegerGroup> group;
           QByteArray cleartext_hash;
           QHash<Connections::Id, QByteArray > signatures;
       };
@@ -1,11 +1,33 @@
+#include <QFutureWatcher>
+#include <QtConcurrentMap>
+
 #include "Connections/Connection.hpp"
+#include "Crypto/AsymmetricKey.hpp"
 #include "Crypto/CryptoRandom.hpp"
 #include "Messaging/Request.hpp"
+#include "Utils/Utils.hpp"
 
 #include "Round.hpp"
+#include "SlotSender.hpp"
 
 namespace Dissent {
 namespace Anonymity {
+  namespace {
+    /**
+     * A message and the signature to check it against
+     */
+    struct SignedMessage {
+      QSharedPointer<Crypto::AsymmetricKey> key;
+      QByteArray msg;
+      QByteArray sig;
+    };
+
+    bool VerifyMessage(const SignedMessage &message)
+    {
+      return message.key->Verify(message.msg, message.sig);
+    }
+  }
+
   Round::Round(const Identity::Roster &clients,
       const Identity::Roster &servers,
       const Identity::PrivateIdentity &ident,
@@ -21,7 +43,12 @@ namespace Anonymity {
     m_get_data_cb(get_data),
     m_successful(false),
     m_interrupted(false),
-    m_header(QByteArray(1, 127))
+    m_header(QByteArray(1, 127)),
+    m_verifying(false)
+  {
+  }
+
+  Round::~Round()
   {
   }
 
@@ -32,6 +59,8 @@ namespace Anonymity {
 
   void Round::OnStop()
   {
+    m_verify_queue.clear();
+    m_verify_batch.clear();
     emit Finished();
   }
 
@@ -75,7 +104,136 @@ namespace Anonymity {
   bool Round::Verify(const Connections::Id &from,
       const QByteArray &data, QByteArray &msg)
   {
-    QSharedPointer<Crypto::AsymmetricKey> key = GetServers().GetKey(from);
+    QSharedPointer<Crypto::AsymmetricKey> key;
+    QByteArray sig;
+    if(!ParseSigned(from, data, key, msg, sig)) {
+      return false;
+    }
+    return key->Verify(msg, sig);
+  }
+
+  void Round::QueueVerify(const Connections::Id &from,
+      const QByteArray &packet, int offset)
+  {
+    QueuedPacket queued;
+    queued.from = from;
+    queued.packet = packet;
+    queued.offset = offset;
+    queued.valid = true;
+    m_verify_queue.append(queued);
+
+    // Packets queued during a verification are picked up once it finishes
+    FlushVerifyQueue();
+  }
+
+  void Round::QueuePacket(const Connections::Id &from, const QByteArray &packet)
+  {
+    if(!VerifyPending()) {
+      ProcessQueued(from, packet, 0);
+      return;
+    }
+
+    QueuedPacket queued;
+    queued.from = from;
+    queued.packet = packet;
+    queued.offset = -1;
+    queued.valid = true;
+    m_verify_queue.append(queued);
+  }
+
+  void Round::ProcessQueued(const Connections::Id &from,
+      const QByteArray &packet, const QByteArray *)
+  {
+    ProcessPacket(from, packet);
+  }
+
+  void Round::FlushVerifyQueue()
+  {
+    if(Stopped() || m_verifying || !m_verify_batch.isEmpty() ||
+        m_verify_queue.isEmpty())
+    {
+      return;
+    }
+
+    m_verify_batch = m_verify_queue;
+    m_verify_queue.clear();
+    m_verify_index.clear();
+
+    QList<SignedMessage> messages;
+    for(int idx = 0; idx < m_verify_batch.size(); idx++) {
+      QueuedPacket &queued = m_verify_batch[idx];
+      if(queued.offset < 0) {
+        continue;
+      }
+
+      SignedMessage message;
+      if(!ParseSigned(queued.from, queued.packet.mid(queued.offset),
+            message.key, queued.msg, message.sig))
+      {
+        queued.valid = false;
+        continue;
+      }
+
+      message.msg = queued.msg;
+      m_verify_index.append(idx);
+      messages.append(message);
+    }
+
+    if(!Utils::MultiThreading || messages.isEmpty()) {
+      for(int idx = 0; idx < messages.size(); idx++) {
+        m_verify_batch[m_verify_index[idx]].valid = VerifyMessage(messages[idx]);
+      }
+      DeliverVerified();
+      return;
+    }
+
+    // Each signature is checked on its own, spread across the thread pool
+    m_verifying = true;
+    QFutureWatcher<bool> *watcher = new QFutureWatcher<bool>(this);
+    QObject::connect(watcher, SIGNAL(finished()), this, SLOT(VerifyFinished()));
+    watcher->setFuture(QtConcurrent::mapped(messages, VerifyMessage));
+  }
+
+  void Round::VerifyFinished()
+  {
+    QFutureWatcher<bool> *watcher = static_cast<QFutureWatcher<bool> *>(sender());
+    QList<bool> valid = watcher->future().results();
+    watcher->deleteLater();
+    m_verifying = false;
+
+    if(Stopped()) {
+      return;
+    }
+
+    for(int idx = 0; idx < valid.size(); idx++) {
+      m_verify_batch[m_verify_index[idx]].valid = valid[idx];
+    }
+    DeliverVerified();
+  }
+
+  void Round::DeliverVerified()
+  {
+    // Stop clears the batch
+    while(!m_verify_batch.isEmpty()) {
+      QueuedPacket queued = m_verify_batch.takeFirst();
+      if(!queued.valid) {
+        qDebug() << "Received malsigned data block from" << queued.from;
+      } else if(queued.offset < 0) {
+        ProcessQueued(queued.from, queued.packet, 0);
+      } else {
+        ProcessQueued(queued.from, queued.packet, &queued.msg);
+      }
+    }
+
+    // The packets that arrived during the verification form the next batch
+    FlushVerifyQueue();
+  }
+
+  bool Round::ParseSigned(const Connections::Id &from, const QByteArray &data,
+      QSharedPointer<Crypto::AsymmetricKey> &key, QByteArray &msg,
+      QByteArray &sig) const
+  {
+    key = GetServers().GetKey(from);
     if(key.isNull()) {
       key = GetClients().GetKey(from);
       if(key.isNull()) {
@@ -92,8 +250,18 @@ namespace Anonymity {
     }
 
     msg = data.left(data.size() - sig_size);
-    QByteArray sig = QByteArray::fromRawData(data.data() + msg.size(), sig_size);
-    return key->Verify(msg, sig);
+    sig = data.mid(msg.size());
+    return true;
+  }
+
+  void Round::AddClients(const QVector<Identity::PublicIdentity> &clients)
+  {
+    QVector<Identity::PublicIdentity> roster;
+    foreach(const Identity::PublicIdentity &client, m_clients) {
+      roster.append(client);
+    }
+    roster += clients;
+    m_clients = Identity::Roster(roster);
   }
 
   void Round::HandleDisconnect(const Connections::Id &id)
@@ -122,9 +290,11 @@ namespace Anonymity {
     return data;
   }
 
-  void Round::PushData(int, const QByteArray &data)
+  void Round::PushData(int uid, const QByteArray &data)
   {
-    PushData(GetSharedPointer(), data);
+    QSharedPointer<Messaging::ISender> round = GetSharedPointer();
+    PushData(QSharedPointer<Messaging::ISender>(new SlotSender(round, uid)),
+        data);
   }
 }
 }
@@ -2,8 +2,11 @@
 #define DISSENT_ANONYMITY_ROUND_H_GUARD
 
 #include <QDateTime>
+#include <QList>
 #include <QObject>
+#include <QPair>
 #include <QSharedPointer>
+#include <QVector>
 
 #include "ClientServer/Overlay.hpp"
 #include "Connections/Id.hpp"
@@ -58,7 +61,7 @@ namespace Anonymity {
       /**
        * Destructor
        */
-      virtual ~Round() {}
+      virtual ~Round();
 
       /**
        * Handle a data message from a remote peer
@@ -120,6 +123,26 @@ namespace Anonymity {
        */
       virtual void PeerJoined() {}
 
+      /**
+       * Returns true if clients that registered after the round began can be
+       * admitted into it, see AdmitClient
+       */
+      virtual bool AdmitsClients() const { return false; }
+
+      /**
+       * Asks the round to admit a client that registered after the round
+       * began.  Default behavior is to do nothing and wait for the next round.
+       * @param client the client's identity for this round
+       */
+      virtual void AdmitClient(const Identity::PublicIdentity &) {}
+
+      /**
+       * Returns true if the slots passed to PushData are assigned anew each
+       * round, so that a message cannot be continued in the next round's
+       * slots
+       */
+      virtual bool ReassignsSlots() const { return false; }
+
       /**
        * Was the round interrupted?  Should the leader interrupt others.
        */
@@ -186,6 +209,52 @@ namespace Anonymity {
        */
       bool Verify(const Connections::Id &from, const QByteArray &data, QByteArray &msg);
 
+      /**
+       * Queues a packet carrying a signed message to be verified.  The
+       * signatures are checked in parallel off the event thread, those
+       * arriving while a check runs are checked together once it finishes.
+       * The packet is then handed to ProcessQueued in order of arrival or
+       * dropped if malsigned.  Meant for the flood of client messages, see
+       * QueuePacket.
+       * @param from the signing peers id
+       * @param packet the packet
+       * @param offset where the data + signature blocks start in packet
+       */
+      void QueueVerify(const Connections::Id &from, const QByteArray &packet,
+          int offset);
+
+      /**
+       * Queues a packet behind those waiting on QueueVerify so that packets
+       * are processed in order of arrival, the packet is handed unverified to
+       * ProcessQueued
+       * @param from the sending peers id
+       * @param packet the packet
+       */
+      void QueuePacket(const Connections::Id &from, const QByteArray &packet);
+
+      /**
+       * Returns true while packets queued by QueueVerify or QueuePacket have
+       * yet to be processed, a packet arriving now should be queued with
+       * QueuePacket to keep the order of arrival
+       */
+      bool VerifyPending() const
+      {
+        return m_verifying || !m_verify_queue.isEmpty() ||
+          !m_verify_batch.isEmpty();
+      }
+
+      /**
+       * Called, in order of arrival, for each packet queued by QueueVerify
+       * with a valid signature and each packet queued by QueuePacket.  By
+       * default, forwards the packet to ProcessPacket, a round that queues
+       * packets from ProcessPacket must override this.
+       * @param from the sending peers id
+       * @param packet the packet
+       * @param verified the verified data block, 0 if queued by QueuePacket
+       */
+      virtual void ProcessQueued(const Connections::Id &from,
+          const QByteArray &packet, const QByteArray *verified);
+
       /**
        * Signs and encrypts a message before sending it to all participants
        * @param data the message to send
@@ -246,6 +315,13 @@ namespace Anonymity {
 
       void SetSuccessful(bool successful) { m_successful = successful; }
 
+      /**
+       * Appends clients admitted while the round is running to the client
+       * roster
+       * @param clients the admitted clients
+       */
+      void AddClients(const QVector<Identity::PublicIdentity> &clients);
+
       /**
        * Returns the underlyign network
        */
@@ -266,8 +342,9 @@ namespace Anonymity {
       QByteArray GenerateData(int size = DEFAULT_GENERATE_DATA_SIZE);
 
       /**
-       * Wrapper around Source::PushData to assist with buddies
-       * @param uid anonymous id
+       * Pushes data delivered in an anonymous slot, the sender is a
+       * SlotSender identifying the slot
+       * @param uid the slot index
        * @param data data to push
        */
       void PushData(int uid, const QByteArray &data);
@@ -282,9 +359,43 @@ namespace Anonymity {
       }
 
     private:
+      /**
+       * Splits data into its message and signature blocks and finds the
+       * signing key
+       * @param from the signing peers id
+       * @param data the data + signature blocks
+       * @param key returns the signing key
+       * @param msg returns the data block
+       * @param sig returns the signature block
+       */
+      bool ParseSigned(const Connections::Id &from, const QByteArray &data,
+          QSharedPointer<Crypto::AsymmetricKey> &key, QByteArray &msg,
+          QByteArray &sig) const;
+
+      /**
+       * A packet waiting in the verify queue
+       */
+      struct QueuedPacket {
+        Connections::Id from;
+        QByteArray packet;
+        int offset;
+        QByteArray msg;
+        bool valid;
+      };
+
+      /**
+       * Starts verifying the packets queued by QueueVerify and QueuePacket
+       */
+      void FlushVerifyQueue();
+
+      /**
+       * Processes the verified batch, and starts on the packets queued since
+       */
+      void DeliverVerified();
+
       QDateTime m_create_time;
       QDateTime m_start_time;
-      const Identity::Roster m_clients;
+      Identity::Roster m_clients;
       const Identity::Roster m_servers;
       const Identity::PrivateIdentity m_ident;
       const QByteArray m_nonce;
@@ -295,6 +406,16 @@ namespace Anonymity {
       bool m_interrupted;
       QWeakPointer<Round> m_shared;
       QByteArray m_header;
+      QList<QueuedPacket> m_verify_queue;
+      QList<QueuedPacket> m_verify_batch;
+      QVector<int> m_verify_index;
+      bool m_verifying;
+
+    private slots:
+      /**
+       * Called when the signatures of the batch have been checked
+       */
+      void VerifyFinished();
   };
 
   inline QDebug operator<<(QDebug dbg, const QSharedPointer<Round> &round)
@@ -2,7 +2,9 @@
 #define DISSENT_ANONYMITY_ROUND_STATE_MACHINE_H_GUARD
 
 #include "Connections/Id.hpp"
+#include "Utils/Logging.hpp"
 #include "Utils/QRunTimeError.hpp"
+#include "Utils/TraceRing.hpp"
 
 #include "Round.hpp"
 #include "Log.hpp"
@@ -26,6 +28,8 @@ namespace Anonymity {
 
       typedef void(T::*MessageHandler)(const Id &from, QDataStream &stream);
       typedef void(T::*TransitionCallback)();
+      typedef void(T::*FutureMessageHandler)(const Id &from,
+          QDataStream &stream, int phase);
       typedef Utils::QRunTimeError QRunTimeError;
 
       /**
@@ -38,6 +42,7 @@ namespace Anonymity {
         _phase(0),
         _cycle_state(-1)
       {
+        _log.SetLimits(Log::DEFAULT_BUDGET, Log::DEFAULT_DIGEST_THRESHOLD);
       }
 
       /**
@@ -91,6 +96,22 @@ namespace Anonymity {
         _state_transitions[from] = to;
       }
 
+      /**
+       * Messages of message_type belonging to one of the next lookahead
+       * phases are passed to handler as they arrive, rather than being held
+       * until their phase begins
+       * @param message_type the binary representation of the message type
+       * @param handler where to dump messages for future phases
+       * @param lookahead how many phases past the current phase to accept,
+       * negative for any later phase
+       */
+      void AddFutureMessageHandler(int message_type,
+          FutureMessageHandler handler, int lookahead)
+      {
+        _future_handlers[message_type] =
+          QPair<FutureMessageHandler, int>(handler, lookahead);
+      }
+
       /**
        * If the Round wants to have phases, set the cycle
        * @param state the state prior to the round cycling
@@ -114,26 +135,29 @@ namespace Anonymity {
         _next_state_log = Log();
 
         if((_cycle_state == GetCurrentState()->GetState()) && (state == -1)) {
-          qDebug() << "In" << _round->ToString() << "ending phase";
+          DISSENT_LOG(LOG_TRACE) << "In" << _round->ToString() <<
+            "ending phase";
           if(!_round->CycleComplete()) {
             return;
           }
-          _log = Log();
+          _log.Spill();
           IncrementPhase();
         }
 
         if(state == -1) {
-          qDebug() << "In" << _round->ToString() << "ending:" <<
+          DISSENT_LOG(LOG_TRACE) << "In" << _round->ToString() << "ending:" <<
             StateToString(GetCurrentState()->GetState()) <<
             "starting:" << StateToString(GetNextState()->GetState());
           _current_sm_state = GetNextState();
         } else {
-          qDebug() << "In" << _round->ToString() << "ending:" <<
+          DISSENT_LOG(LOG_TRACE) << "In" << _round->ToString() << "ending:" <<
             StateToString(GetCurrentState()->GetState()) <<
             "starting:" << StateToString(_states[state]->GetState());
           _current_sm_state = _states[state];
         }
 
+        DISSENT_TRACE_EVENT(STATE_COMPLETE,
+            GetCurrentState()->GetState(), _phase);
         (_round->*GetCurrentState()->GetTransitionCallback())();
 
         for(int idx = 0; idx < tmp.Count(); idx++) {
@@ -150,17 +174,20 @@ namespace Anonymity {
        */
       void ProcessData(const Id &from, const QByteArray &data)
       {
-        _log.Append(data, from);
-        try {
-          ProcessDataBase(from, data);
-        } catch (QRunTimeError &err) {
-          qWarning() << _round->GetLocalId() << "received a message from" <<
-            from << "in" << _round->GetNonce().toBase64() << "in state" <<
-            StateToString(GetCurrentState()->GetState()) <<
-            "causing the following exception:" << err.What();
-          _log.Pop();
-          return;
-        }
+        ProcessData(from, data, 0);
+      }
+
+      /**
+       * Processes data whose signature has already been checked, such as by
+       * Round::QueueVerify
+       * @param from the sending member
+       * @param data the data sent
+       * @param payload the verified data block of data
+       */
+      void ProcessVerifiedData(const Id &from, const QByteArray &data,
+          const QByteArray &payload)
+      {
+        ProcessData(from, data, &payload);
       }
 
       /**
@@ -173,6 +200,12 @@ namespace Anonymity {
        */
       void IncrementPhase() { ++_phase; }
 
+      /**
+       * Sets the phase, used by members that join a round in progress
+       * @param phase the new phase
+       */
+      void SetPhase(int phase) { _phase = phase; }
+
       /**
        * Returns the current phase
        */
@@ -185,6 +218,28 @@ namespace Anonymity {
 
       void ToggleLog() { _log.ToggleEnabled(); }
 
+      /**
+       * Bounds the memory held by the log of processed messages, messages
+       * waiting for a later state are always kept in full
+       * @param budget the bytes kept, 0 for unbounded
+       * @param digest_threshold messages larger than this are kept as a
+       * hash, 0 to keep all messages
+       */
+      void SetLogLimits(int budget, int digest_threshold)
+      {
+        _log.SetLimits(budget, digest_threshold);
+      }
+
+      /**
+       * Keeps the log of each completed phase, and the messages kept as a
+       * hash, in a file rather than discarding them
+       * @param filename the file, truncated
+       */
+      bool SetLogSpillFile(const QString &filename)
+      {
+        return _log.SetSpillFile(filename);
+      }
+
     private:
       /**
        * An internal immutable state handler
@@ -253,16 +308,42 @@ namespace Anonymity {
         return state;
       }
 
+      /**
+       * Logs the data and processes it, catching any exceptions
+       * @param from the sending member
+       * @param data the data sent
+       * @param verified the data block if the signature was already verified
+       */
+      void ProcessData(const Id &from, const QByteArray &data,
+          const QByteArray *verified)
+      {
+        _log.Append(data, from);
+        try {
+          ProcessDataBase(from, data, verified);
+        } catch (QRunTimeError &err) {
+          qWarning() << _round->GetLocalId() << "received a message from" <<
+            from << "in" << _round->GetNonce().toBase64() << "in state" <<
+            StateToString(GetCurrentState()->GetState()) <<
+            "causing the following exception:" << err.What();
+          _log.Pop();
+          return;
+        }
+      }
+
       /**
        * Does the actual hard work for processing data, this is split since the
        * ProcessData is more used to catch exceptions and handle logging.
        * @param from the sending member
        * @param data the data sent
+       * @param verified the data block if the signature was already verified
        */
-      void ProcessDataBase(const Id &from, const QByteArray &data)
+      void ProcessDataBase(const Id &from, const QByteArray &data,
+          const QByteArray *verified)
       {
         QByteArray payload;
-        if(!_round->Verify(from, data, payload)) {
+        if(verified) {
+          payload = *verified;
+        } else if(!_round->Verify(from, data, payload)) {
           throw QRunTimeError("Invalid signature or data");
         }
         
@@ -293,6 +374,14 @@ namespace Anonymity {
           throw QRunTimeError("Invalid message type: " + MessageTypeToString(mtype));
         }
 
+        if((_phase < phase) && _future_handlers.contains(mtype) &&
+            ((_future_handlers[mtype].second < 0) ||
+             (phase <= _phase + _future_handlers[mtype].second)))
+        {
+          (_round->*_future_handlers[mtype].first)(from, stream, phase);
+          return;
+        }
+
         // XXX need an API to register valid future message types
         // also is it safe to assume *all* messages from future phases
         // are valid?
@@ -310,6 +399,7 @@ namespace Anonymity {
       QHash<int, bool> _valid_message_types;
       QHash<int, int> _state_transitions;
       QHash<int, QSharedPointer<State> > _states;
+      QHash<int, QPair<FutureMessageHandler, int> > _future_handlers;
 
       QSharedPointer<State> _current_sm_state;
 
@@ -0,0 +1,63 @@
+#ifndef DISSENT_ANONYMITY_SLOT_SENDER_H_GUARD
+#define DISSENT_ANONYMITY_SLOT_SENDER_H_GUARD
+
+#include <QSharedPointer>
+#include <QString>
+
+#include "Messaging/ISender.hpp"
+
+namespace Dissent {
+namespace Anonymity {
+  /**
+   * The sender of a message pushed by a round, identifies the anonymous slot
+   * that carried the message.  Slots are numbered within a round.  Sending
+   * through it sends anonymously through the round.
+   */
+  class SlotSender : public Messaging::ISender {
+    public:
+      /**
+       * Constructor
+       * @param round the round delivering the message
+       * @param slot the slot index within the round
+       */
+      explicit SlotSender(const QSharedPointer<Messaging::ISender> &round,
+          int slot) :
+        m_round(round),
+        m_slot(slot)
+      {
+      }
+
+      /**
+       * Destructor
+       */
+      virtual ~SlotSender() {}
+
+      /**
+       * Sends a message through the round
+       * @param data the message
+       */
+      virtual void Send(const QByteArray &data) { m_round->Send(data); }
+
+      virtual QString ToString() const
+      {
+        return m_round->ToString() + " slot " + QString::number(m_slot);
+      }
+
+      /**
+       * Returns the round delivering the message
+       */
+      QSharedPointer<Messaging::ISender> GetRound() const { return m_round; }
+
+      /**
+       * Returns the slot index within the round
+       */
+      int GetSlot() const { return m_slot; }
+
+    private:
+      QSharedPointer<Messaging::ISender> m_round;
+      int m_slot;
+  };
+}
+}
+
+#endif
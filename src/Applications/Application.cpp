@@ -20,6 +20,17 @@ int main(int argc, char **argv)
     return -1;
   }
   Settings::ApplicationSettings = settings;
+  CSDCNetRound::SetDefaultPipelineDepth(settings.PipelineDepth);
+
+  QSharedPointer<TraceRing> trace_ring;
+  if(!settings.TraceFile.isEmpty()) {
+    trace_ring = QSharedPointer<TraceRing>(new TraceRing(settings.TraceFile));
+    if(!trace_ring->IsValid()) {
+      qFatal("Unable to open trace file %s",
+          settings.TraceFile.toLatin1().data());
+    }
+    TraceRing::SetActive(trace_ring.data());
+  }
 
   QList<QSharedPointer<Node> > nodes;
 
@@ -59,6 +70,7 @@ int main(int argc, char **argv)
     QSharedPointer<Overlay> overlay(new Overlay(local_id, local_end_points,
           settings.RemoteEndPoints, settings.ServerIds));
     overlay->SetSharedPointer(overlay);
+    overlay->GetRpcHandler()->SetBinaryFormat(settings.BinaryRpc);
 
     CreateRound create_round = RoundFactory::GetCreateRound(settings.RoundType);
     QSharedPointer<Session> session;
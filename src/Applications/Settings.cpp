@@ -62,6 +62,8 @@ namespace Applications {
     ExitTunnel = (ExitTunnelProxyUrl != QUrl()) || ExitTunnel;
 
     MinimumClients = _settings->value(Param<Params::MinimumClients>()).toInt(0);
+    PipelineDepth = _settings->value(Param<Params::PipelineDepth>()).toInt(0);
+    BinaryRpc = _settings->value(Param<Params::BinaryRpc>(), false).toBool();
 
     if(_settings->contains(Param<Params::RoundType>())) {
       QString stype = _settings->value(Param<Params::RoundType>()).toString();
@@ -71,6 +73,8 @@ namespace Applications {
     }
 
     Log = _settings->value(Param<Params::Log>(), "null").toString();
+    LogLevel = _settings->value(Param<Params::LogLevel>(), "debug").toString();
+    TraceFile = _settings->value(Param<Params::TraceFile>()).toString();
 
     QString log_lower = Log.toLower();
     if(actions) {
@@ -83,6 +87,10 @@ namespace Applications {
       } else {
         Logging::UseFile(Log);
       }
+
+      if(log_lower != "null" && !log_lower.isEmpty()) {
+        Logging::SetLevel(Logging::ParseLevel(LogLevel));
+      }
     }
 
     if(_settings->contains(Param<Params::LocalId>())) {
@@ -235,6 +243,10 @@ namespace Applications {
     _settings->setValue(Param<Params::Console>(), Console);
     _settings->setValue(Param<Params::Auth>(), Auth);
     _settings->setValue(Param<Params::Log>(), Log);
+    _settings->setValue(Param<Params::LogLevel>(), LogLevel);
+    _settings->setValue(Param<Params::TraceFile>(), TraceFile);
+    _settings->setValue(Param<Params::PipelineDepth>(), PipelineDepth);
+    _settings->setValue(Param<Params::BinaryRpc>(), BinaryRpc);
     _settings->setValue(Param<Params::Multithreading>(), Multithreading);
 
     QVariantList local_ids;
@@ -365,6 +377,22 @@ namespace Applications {
         "Minimum number of clients to wait for during registration, 0 = disable",
         QxtCommandOptions::ValueRequired);
 
+    options->add(Param<Params::LogLevel>(),
+        "logging level: trace, debug, or off",
+        QxtCommandOptions::ValueRequired);
+
+    options->add(Param<Params::TraceFile>(),
+        "a path to record binary trace events, read with trace_decode",
+        QxtCommandOptions::ValueRequired);
+
+    options->add(Param<Params::PipelineDepth>(),
+        "phases a DC-net client keeps in flight, must match on all members",
+        QxtCommandOptions::ValueRequired);
+
+    options->add(Param<Params::BinaryRpc>(),
+        "send Rpc messages in the binary format, all members must support it",
+        QxtCommandOptions::NoValue);
+
     return options;
   }
 }
@@ -87,6 +87,27 @@ namespace Applications {
        */
       QString Log;
 
+      /**
+       * Logging level: trace, debug, or off
+       */
+      QString LogLevel;
+
+      /**
+       * Path to a binary trace file, read by trace_decode, or empty
+       */
+      QString TraceFile;
+
+      /**
+       * The number of phases a DC-net client keeps in flight, 0 for the
+       * round's default, all members must agree
+       */
+      int PipelineDepth;
+
+      /**
+       * Send Rpc messages in the binary format, every member must support it
+       */
+      bool BinaryRpc;
+
       /**
        * Provide a Console UI
        */
@@ -177,7 +198,11 @@ namespace Applications {
           "server_ids",
           "path_to_private_keys",
           "path_to_public_keys",
-          "minimum_clients"
+          "minimum_clients",
+          "log_level",
+          "trace_file",
+          "pipeline_depth",
+          "binary_rpc"
         };
         return params[id];
       }
@@ -202,7 +227,11 @@ namespace Applications {
             ServerIds,
             PrivateKeys,
             PublicKeys,
-            MinimumClients
+            MinimumClients,
+            LogLevel,
+            TraceFile,
+            PipelineDepth,
+            BinaryRpc
           };
       };
 
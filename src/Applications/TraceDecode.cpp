@@ -0,0 +1,74 @@
+#include <iostream>
+
+#include <QDateTime>
+#include <QHash>
+#include <QxtCommandOptions>
+
+#include "Dissent.hpp"
+
+const char *CL_HELP = "help";
+const char *CL_FILE = "file";
+const char *CL_EVENT = "event";
+
+void ExitWithWarning(const QxtCommandOptions &options, const char* warning)
+{
+  std::cerr << "Error: " << warning << std::endl;
+  options.showUsage();
+  exit(-1);
+}
+
+int main(int argc, char **argv)
+{
+  QxtCommandOptions options;
+
+  options.add(CL_HELP, "display this help message",
+      QxtCommandOptions::NoValue);
+  options.add(CL_FILE, "the trace file to decode",
+      QxtCommandOptions::ValueRequired);
+  options.add(CL_EVENT, "only print events with this name",
+      QxtCommandOptions::ValueRequired);
+
+  options.parse(argc, argv);
+
+  if(options.count(CL_HELP) || options.showUnrecognizedWarning()) {
+    options.showUsage();
+    return -1;
+  }
+
+  QMultiHash<QString, QVariant> params = options.parameters();
+  if(!params.contains(CL_FILE)) {
+    ExitWithWarning(options, "No trace file");
+  }
+
+  TraceRing::Header header;
+  QList<TraceRing::Record> records;
+  if(!TraceRing::Read(params.value(CL_FILE).toString(), header, records)) {
+    ExitWithWarning(options, "Invalid trace file");
+  }
+
+  QString filter = params.value(CL_EVENT).toString();
+  QDateTime start = QDateTime::fromMSecsSinceEpoch(header.start);
+  std::cout << "Started " <<
+    start.toString("yyyy-MM-ddThh:mm:ss.zzz").toStdString() << ", " <<
+    records.count() << " of " << header.capacity << " records" << std::endl;
+
+  // Threads are numbered in order of appearance
+  QHash<quint64, int> threads;
+  foreach(const TraceRing::Record &record, records) {
+    if(!threads.contains(record.thread)) {
+      int thread = threads.count();
+      threads[record.thread] = thread;
+    }
+
+    QString name = TraceRing::EventName(record.event);
+    if(!filter.isEmpty() && name != filter) {
+      continue;
+    }
+
+    std::cout << record.sequence << " " << (record.time / 1000) << "us " <<
+      "thread " << threads[record.thread] << " " << name.toStdString() <<
+      " " << record.a << " " << record.b << std::endl;
+  }
+
+  return 0;
+}
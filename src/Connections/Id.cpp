@@ -4,6 +4,25 @@
 
 namespace Dissent {
 namespace Connections {
+  namespace {
+    /**
+     * Strips leading zeroes, as the Integer encoding does, zero itself is
+     * encoded as a single byte
+     */
+    QByteArray Canonical(const QByteArray &bytes)
+    {
+      int idx = 0;
+      while(idx < bytes.size() - 1 && bytes[idx] == 0) {
+        idx++;
+      }
+
+      if(bytes.isEmpty()) {
+        return QByteArray(1, 0);
+      }
+      return idx == 0 ? bytes : bytes.mid(idx);
+    }
+  }
+
   const Id &Id::Zero()
   {
     static Id zero(QByteArray(Id::ByteSize, 0));
@@ -14,22 +33,30 @@ namespace Connections {
   {
     QByteArray bid(Id::ByteSize, 0);
     Crypto::CryptoRandom().GenerateBlock(bid);
-    _integer = Integer(bid);
+    Init(bid);
   }
   
-  Id::Id(const QByteArray &bid) : _integer(bid)
+  Id::Id(const QByteArray &bid)
   {
+    Init(bid);
   }
 
-  Id::Id(const Integer &integer) : _integer(integer)
+  Id::Id(const Integer &integer)
   {
+    Init(integer.GetByteArray());
   }
 
-  Id::Id(const QString &sid) : _integer(sid)
+  Id::Id(const QString &sid)
   {
-    if(_integer.ToString() != sid) {
-      _integer = Zero()._integer;
+    Init(Utils::FromUrlSafeBase64(sid.toLatin1()));
+    if(_data->string != sid) {
+      _data = Zero()._data;
     }
   }
+
+  void Id::Init(const QByteArray &bytes)
+  {
+    _data = new IdData(Canonical(bytes));
+  }
 }
 }
@@ -1,15 +1,41 @@
 #ifndef DISSENT_CONNECTIONS_ADDRESS_H_GUARD
 #define DISSENT_CONNECTIONS_ADDRESS_H_GUARD
 
+#include <cstring>
+
 #include <QByteArray>
 #include <QDebug>
+#include <QHash>
+#include <QSharedData>
 #include <QString>
+
 #include "Crypto/Integer.hpp"
+#include "Utils/Utils.hpp"
 
 namespace Dissent {
 namespace Connections {
+  class IdData : public QSharedData {
+    public:
+      /**
+       * @param bytes the unsigned big endian value without leading zeroes
+       */
+      explicit IdData(const QByteArray &bytes) :
+        bytes(bytes),
+        string(QString::fromLatin1(Utils::ToUrlSafeBase64(bytes))),
+        hash(qHash(bytes))
+      {
+      }
+
+      const QByteArray bytes;
+      const QString string;
+      const uint hash;
+  };
+
   /**
-   * A globally unique identifier.
+   * A globally unique identifier.  Ids are immutable, share their data on
+   * copy, and compute their byte, string, and hash forms once on
+   * construction so that use as a key costs no more than a QByteArray.
+   * The byte form is the minimal unsigned encoding of the Id as an Integer.
    */
   class Id {
     public:
@@ -44,25 +70,51 @@ namespace Connections {
       /**
        * Returns a printable Id string
        */
-      inline QString ToString() const { return _integer.ToString(); }
+      inline QString ToString() const { return _data->string; }
 
-      inline bool operator==(const Id &other) const { return _integer == other._integer; }
-      inline bool operator!=(const Id &other) const { return _integer != other._integer; }
-      inline bool operator<(const Id &other) const { return _integer < other._integer; }
-      inline bool operator>(const Id &other) const { return _integer > other._integer; }
+      inline bool operator==(const Id &other) const
+      {
+        return _data == other._data || (_data->hash == other._data->hash &&
+            _data->bytes == other._data->bytes);
+      }
+
+      inline bool operator!=(const Id &other) const { return !(*this == other); }
+      inline bool operator<(const Id &other) const { return Compare(other) < 0; }
+      inline bool operator>(const Id &other) const { return Compare(other) > 0; }
 
       /**
        * Returns the byte array for the Id
        */
-      inline QByteArray GetByteArray() const { return _integer.GetByteArray(); }
+      inline QByteArray GetByteArray() const { return _data->bytes; }
 
       /**
        * Returns the (big) Integer for the Id
        */
-      inline const Integer &GetInteger() const { return _integer; }
+      inline Integer GetInteger() const { return Integer(_data->bytes); }
+
+      /**
+       * Returns the precomputed hash of the Id
+       */
+      inline uint GetHash() const { return _data->hash; }
       
     private:
-      Integer _integer;
+      /**
+       * Numeric comparison, as the byte forms have no leading zeroes a
+       * longer form is a larger Id
+       */
+      inline int Compare(const Id &other) const
+      {
+        const QByteArray &lhs = _data->bytes;
+        const QByteArray &rhs = other._data->bytes;
+        if(lhs.size() != rhs.size()) {
+          return lhs.size() - rhs.size();
+        }
+        return memcmp(lhs.constData(), rhs.constData(), lhs.size());
+      }
+
+      void Init(const QByteArray &bytes);
+
+      QExplicitlySharedDataPointer<IdData> _data;
   };
 
   /**
@@ -71,7 +123,7 @@ namespace Connections {
    */
   inline uint qHash(const Id &id)
   {
-    return qHash(id.GetByteArray());
+    return id.GetHash();
   }
 
   inline QDebug operator<<(QDebug dbg, const Id &id)
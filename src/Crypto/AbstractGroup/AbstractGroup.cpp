@@ -1,10 +1,41 @@
 #include "Crypto/Hash.hpp"
+#include "Crypto/MultiExponentiation.hpp"
 #include "AbstractGroup.hpp"
 
 namespace Dissent {
 namespace Crypto {
 namespace AbstractGroup {
 
+  namespace {
+    /**
+     * Group operations for MultiExponentiation
+     */
+    class GroupOps {
+      public:
+        typedef Dissent::Crypto::AbstractGroup::Element Element;
+
+        explicit GroupOps(const AbstractGroup &group) : m_group(group) {}
+
+        Element Multiply(const Element &a, const Element &b) const
+        {
+          return m_group.Multiply(a, b);
+        }
+
+        Element Square(const Element &a) const
+        {
+          return m_group.Multiply(a, a);
+        }
+
+        Element Identity() const
+        {
+          return m_group.GetIdentity();
+        }
+
+      private:
+        const AbstractGroup &m_group;
+    };
+  }
+
     Element AbstractGroup::HashIntoElement(const QByteArray &to_hash) const
     {
       // XXX TODO This is probably not a secure way to hash into 
@@ -12,6 +43,72 @@ namespace AbstractGroup {
       return EncodeBytes(Hash().ComputeHash(to_hash).left(BytesPerElement()));
     }
 
+    Element AbstractGroup::MultiExponentiate(const QVector<Element> &bases,
+        const QVector<Integer> &exps) const
+    {
+      Q_ASSERT(bases.size() == exps.size());
+      QVector<Element> mbases;
+      QVector<ExponentDigits> mexps;
+      mbases.reserve(bases.size());
+      mexps.reserve(exps.size());
+
+      for(int idx = 0; idx < bases.size(); idx++) {
+        if(exps[idx] < Integer(0)) {
+          mbases.append(Inverse(bases[idx]));
+          mexps.append(ExponentDigits((Integer(0) - exps[idx]).GetByteArray()));
+        } else {
+          mbases.append(bases[idx]);
+          mexps.append(ExponentDigits(exps[idx].GetByteArray()));
+        }
+      }
+
+      return MultiExponentiation::MultiExponentiate(GroupOps(*this), mbases, mexps);
+    }
+
+    Element AbstractGroup::FixedBaseExponentiate(const Element &a,
+        const Integer &exp) const
+    {
+      return GetPrecomputedBase(a)->Exponentiate(*this, exp);
+    }
+
+    QSharedPointer<const PrecomputedBase> AbstractGroup::GetPrecomputedBase(
+        const Element &base) const
+    {
+      const QByteArray key = ElementToByteArray(base);
+      {
+        QMutexLocker locker(&_precomputed->lock);
+        if(_precomputed->bases.contains(key)) {
+          // Keep the most recently used tables at the end of the order
+          _precomputed->order.removeOne(key);
+          _precomputed->order.append(key);
+          return _precomputed->bases[key];
+        }
+      }
+
+      // Build outside of the lock, a concurrent build of the same base
+      // simply loses the race below
+      QSharedPointer<const PrecomputedBase> table = CreatePrecomputedBase(base);
+
+      QMutexLocker locker(&_precomputed->lock);
+      if(_precomputed->bases.contains(key)) {
+        return _precomputed->bases[key];
+      }
+
+      while(_precomputed->order.size() >= MAX_PRECOMPUTED_BASES) {
+        _precomputed->bases.remove(_precomputed->order.takeFirst());
+      }
+
+      _precomputed->bases[key] = table;
+      _precomputed->order.append(key);
+      return table;
+    }
+
+    QSharedPointer<PrecomputedBase> AbstractGroup::CreatePrecomputedBase(
+        const Element &base) const
+    {
+      return QSharedPointer<PrecomputedBase>(new PrecomputedBase(*this, base));
+    }
+
 }
 }
 }
@@ -1,11 +1,17 @@
 #ifndef DISSENT_CRYPTO_ABSTRACT_GROUP_ABSTRACT_GROUP_H_GUARD
 #define DISSENT_CRYPTO_ABSTRACT_GROUP_ABSTRACT_GROUP_H_GUARD
 
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QMutex>
 #include <QSharedPointer>
 #include <QString>
+#include <QVector>
 
 #include "Crypto/Integer.hpp"
 #include "Element.hpp"
+#include "PrecomputedBase.hpp"
 
 namespace Dissent {
 namespace Crypto {
@@ -37,7 +43,7 @@ namespace AbstractGroup {
       /**
        * Constructor
        */
-      AbstractGroup() {}
+      AbstractGroup() : _precomputed(new PrecomputedCache()) {}
 
       /**
        * Destructor
@@ -76,6 +82,39 @@ namespace AbstractGroup {
       virtual Element CascadeExponentiate(const Element &a1, const Integer &e1,
           const Element &a2, const Integer &e2) const = 0;
 
+      /**
+       * Compute prod_i bases[i]^exps[i], sharing the squarings across all
+       * terms with Straus' method for a few terms or Pippenger's method for
+       * many. Negative exponents use the inverse of the base.
+       * @param bases the bases
+       * @param exps the exponents, one per base
+       */
+      virtual Element MultiExponentiate(const QVector<Element> &bases,
+          const QVector<Integer> &exps) const;
+
+      /**
+       * Compute a^exp using a table of precomputed powers of a, built on
+       * first use and cached with the group. Use this for bases raised to
+       * many exponents, such as the generator or a long-lived public key.
+       * @param a base
+       * @param exp exponent
+       */
+      Element FixedBaseExponentiate(const Element &a, const Integer &exp) const;
+
+      /**
+       * Return the cached table of precomputed powers of base, building it
+       * if necessary. The cache holds the MAX_PRECOMPUTED_BASES most
+       * recently used tables and is shared with copies of this group.
+       * @param base the fixed base
+       */
+      QSharedPointer<const PrecomputedBase> GetPrecomputedBase(
+          const Element &base) const;
+
+      /**
+       * The number of fixed-base tables kept per group
+       */
+      static const int MAX_PRECOMPUTED_BASES = 64;
+
       /**
        * Compute b such that ab is the group identity
        * @param a element to invert
@@ -187,8 +226,29 @@ namespace AbstractGroup {
        */ 
       virtual int GetSecurityParameter() const = 0;
 
+    protected:
+
+      /**
+       * Build a fixed-base table for base, groups with a faster native
+       * precomputation should override this
+       * @param base the fixed base
+       */
+      virtual QSharedPointer<PrecomputedBase> CreatePrecomputedBase(
+          const Element &base) const;
+
     private:
 
+      /**
+       * Fixed-base tables indexed by the serialized base
+       */
+      class PrecomputedCache {
+        public:
+          QMutex lock;
+          QHash<QByteArray, QSharedPointer<const PrecomputedBase> > bases;
+          QList<QByteArray> order;
+      };
+
+      QSharedPointer<PrecomputedCache> _precomputed;
   };
 
 }
@@ -1,9 +1,11 @@
 #include <QDataStream>
 #include <QDebug>
+#include <cryptopp/eprecomp.h>
 #include <cryptopp/nbtheory.h>
 
 #include "Crypto/CryptoRandom.hpp"
 #include "Crypto/CryptoPP/Helper.hpp"
+#include "Crypto/MultiExponentiation.hpp"
 #include "CppECElementData.hpp"
 #include "CppECGroup.hpp"
 
@@ -11,6 +13,74 @@ namespace Dissent {
 namespace Crypto {
 namespace AbstractGroup {
 
+  namespace {
+    /**
+     * A fixed-base table maintained by Crypto++
+     */
+    class CppECPrecomputedBase : public PrecomputedBase {
+      public:
+        CppECPrecomputedBase(const CryptoPP::ECP &curve, const Element &base,
+            int bits) :
+          PrecomputedBase(base, bits),
+          _curve(curve)
+        {
+          CryptoPP::EcPrecomputation<CryptoPP::ECP> group;
+          group.SetCurve(_curve);
+          _precomputation.SetBase(group, CppECElementData::GetPoint(base.GetData()));
+          _precomputation.Precompute(group, bits, STORAGE);
+        }
+
+        virtual Element Exponentiate(const AbstractGroup &group,
+            const Integer &exp) const
+        {
+          if(!InRange(exp)) {
+            return group.Exponentiate(GetBase(), exp);
+          }
+
+          // The precomputation's curve has scratch space, so each call
+          // uses its own to remain safe across threads
+          CryptoPP::EcPrecomputation<CryptoPP::ECP> ec_group;
+          ec_group.SetCurve(_curve);
+          return Element(new CppECElementData(
+                _precomputation.Exponentiate(ec_group, ToCppInteger(exp))));
+        }
+
+      private:
+        static const unsigned int STORAGE = 16;
+
+        const CryptoPP::ECP _curve;
+        CryptoPP::DL_FixedBasePrecomputationImpl<CryptoPP::ECPPoint> _precomputation;
+    };
+
+    /**
+     * Point operations for MultiExponentiation
+     */
+    class CurveOps {
+      public:
+        typedef CryptoPP::ECPPoint Element;
+
+        explicit CurveOps(const CryptoPP::ECP &curve) : _curve(curve) {}
+
+        Element Multiply(const Element &a, const Element &b) const
+        {
+          return _curve.Add(a, b);
+        }
+
+        Element Square(const Element &a) const
+        {
+          return _curve.Double(a);
+        }
+
+        Element Identity() const
+        {
+          return _curve.Identity();
+        }
+
+      private:
+        const CryptoPP::ECP &_curve;
+    };
+  }
+
   CppECGroup::CppECGroup(const Integer &p, const Integer &q, const Integer &a,
       const Integer &b, const Integer &gx, const Integer &gy) :
       _curve(ToCppInteger(p), ToCppInteger(a), ToCppInteger(b)),
@@ -75,6 +145,54 @@ namespace AbstractGroup {
     
   }
 
+  Element CppECGroup::MultiExponentiate(const QVector<Element> &bases,
+      const QVector<Integer> &exps) const
+  {
+    Q_ASSERT(bases.size() == exps.size());
+    // The curve keeps scratch space for its results
+    CryptoPP::ECP curve(_curve);
+
+    QVector<CryptoPP::ECPPoint> points;
+    QVector<CryptoPP::Integer> scalars;
+    points.reserve(bases.size());
+    scalars.reserve(exps.size());
+
+    for(int idx = 0; idx < bases.size(); idx++) {
+      CryptoPP::Integer scalar = ToCppInteger(exps[idx]);
+      if(scalar.IsNegative()) {
+        points.append(curve.Inverse(GetPoint(bases[idx])));
+        scalars.append(-scalar);
+      } else {
+        points.append(GetPoint(bases[idx]));
+        scalars.append(scalar);
+      }
+    }
+
+    if(bases.size() < MIN_SHARED_TERMS) {
+      CryptoPP::ECPPoint result = curve.Identity();
+      for(int idx = 0; idx < points.size(); idx++) {
+        result = curve.Add(result, curve.Multiply(scalars[idx], points[idx]));
+      }
+      return Element(new CppECElementData(result));
+    }
+
+    QVector<ExponentDigits> digits;
+    digits.reserve(scalars.size());
+    foreach(const CryptoPP::Integer &scalar, scalars) {
+      digits.append(ExponentDigits(FromCppInteger(scalar).GetByteArray()));
+    }
+
+    return Element(new CppECElementData(
+          MultiExponentiation::MultiExponentiate(CurveOps(curve), points, digits)));
+  }
+
+  QSharedPointer<PrecomputedBase> CppECGroup::CreatePrecomputedBase(
+      const Element &base) const
+  {
+    return QSharedPointer<PrecomputedBase>(new CppECPrecomputedBase(_curve,
+          base, GetOrder().GetBitCount()));
+  }
+
   Element CppECGroup::Inverse(const Element &a) const
   {
     return Element(new CppECElementData(_curve.Inverse(GetPoint(a))));
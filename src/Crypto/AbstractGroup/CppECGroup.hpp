@@ -72,6 +72,21 @@ namespace AbstractGroup {
       virtual Element CascadeExponentiate(const Element &a1, const Integer &e1,
           const Element &a2, const Integer &e2) const;
 
+      /**
+       * Compute sum_i exps[i]bases[i]. Crypto++'s point multiplication
+       * works in projective coordinates, so the shared-doubling methods
+       * only pay off for MIN_SHARED_TERMS or more terms.
+       * @param bases the bases
+       * @param exps the exponents, one per base
+       */
+      virtual Element MultiExponentiate(const QVector<Element> &bases,
+          const QVector<Integer> &exps) const;
+
+      /**
+       * The fewest terms for which MultiExponentiate shares doublings
+       */
+      static const int MIN_SHARED_TERMS = 32;
+
       /**
        * Compute b such that a+b = O (identity)
        * @param a element to invert
@@ -203,6 +218,14 @@ namespace AbstractGroup {
 
       inline virtual Integer GetSmallSubgroupOrder() { return Integer(2); }
 
+      /**
+       * Uses Crypto++'s fixed-base precomputation, which works in
+       * projective coordinates rather than through Multiply
+       * @param base the fixed base
+       */
+      virtual QSharedPointer<PrecomputedBase> CreatePrecomputedBase(
+          const Element &base) const;
+
     private:
 
       CryptoPP::ECPPoint GetPoint(const Element &e) const;
@@ -14,6 +14,14 @@ namespace AbstractGroup {
       _q((p-1)/2)
     {};
 
+  IntegerGroup::IntegerGroup(const Integer &p, const Integer &g,
+      const Integer &q) :
+    _p(p),
+    _g(g),
+    _q(q)
+  {
+  }
+
   IntegerGroup::IntegerGroup(const char *p_bytes, const char *g_bytes) :
     _p(QByteArray::fromHex(p_bytes)),
     _g(QByteArray::fromHex(g_bytes)),
@@ -189,6 +197,24 @@ namespace AbstractGroup {
           _p.PowCascade(GetInteger(a1), e1, GetInteger(a2), e2)));
   }
 
+  Element IntegerGroup::MultiExponentiate(const QVector<Element> &bases,
+      const QVector<Integer> &exps) const
+  {
+    QVector<Integer> ibases;
+    ibases.reserve(bases.size());
+    foreach(const Element &base, bases) {
+      ibases.append(GetInteger(base));
+    }
+    return Element(new IntegerElementData(_p.MultiPow(ibases, exps)));
+  }
+
+  Integer IntegerGroup::FixedBasePow(const Integer &base,
+      const Integer &exp) const
+  {
+    return GetInteger(FixedBaseExponentiate(
+          Element(new IntegerElementData(base)), exp));
+  }
+
   Element IntegerGroup::Inverse(const Element &a) const
   {
     return Element(new IntegerElementData(GetInteger(a).Inverse(_p)));
@@ -41,6 +41,16 @@ namespace AbstractGroup {
        */
       IntegerGroup(const Integer &p, const Integer &g);
 
+      /**
+       * Constructor for a prime-order subgroup of Z*_p that need not
+       * be the quadratic residues, such as a DSA group. The byte encoding
+       * methods assume a safe prime and should not be used.
+       * @param p the modulus
+       * @param g generator of the subgroup
+       * @param q the order of the subgroup
+       */
+      IntegerGroup(const Integer &p, const Integer &g, const Integer &q);
+
       /**
        * Get a fixed group with modulus of length 1024 bits
        */
@@ -86,12 +96,28 @@ namespace AbstractGroup {
       virtual Element CascadeExponentiate(const Element &a1, const Integer &e1,
           const Element &a2, const Integer &e2) const;
 
+      /**
+       * Compute prod_i bases[i]^exps[i] in Montgomery form
+       * @param bases the bases
+       * @param exps the exponents, one per base
+       */
+      virtual Element MultiExponentiate(const QVector<Element> &bases,
+          const QVector<Integer> &exps) const;
+
       /**
        * Compute b such that ab = 1
        * @param a element to invert
        */
       virtual Element Inverse(const Element &a) const;
 
+      /**
+       * Compute base^exp mod p using the group's cached fixed-base table
+       * for base
+       * @param base base
+       * @param exp exponent
+       */
+      Integer FixedBasePow(const Integer &base, const Integer &exp) const;
+
       /**
        * Serialize the element as a QByteArray
        * @param a element to serialize 
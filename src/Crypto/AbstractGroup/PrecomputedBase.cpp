@@ -0,0 +1,105 @@
+#include "AbstractGroup.hpp"
+#include "PrecomputedBase.hpp"
+
+namespace Dissent {
+namespace Crypto {
+namespace AbstractGroup {
+
+  PrecomputedBase::PrecomputedBase(const AbstractGroup &group,
+      const Element &base) :
+    _base(base),
+    _bits(group.GetOrder().GetBitCount()),
+    _window(OptimalWindow(_bits))
+  {
+    int entries = (_bits + _window - 1) / _window;
+    _table.reserve(entries);
+
+    Element current = base;
+    for(int idx = 0; idx < entries; idx++) {
+      if(idx > 0) {
+        for(int sq = 0; sq < _window; sq++) {
+          current = group.Multiply(current, current);
+        }
+      }
+      _table.append(current);
+    }
+  }
+
+  PrecomputedBase::PrecomputedBase(const Element &base, int bits) :
+    _base(base),
+    _bits(bits),
+    _window(0)
+  {
+  }
+
+  Element PrecomputedBase::Exponentiate(const AbstractGroup &group,
+      const Integer &exp) const
+  {
+    if(!InRange(exp) || _table.isEmpty()) {
+      return group.Exponentiate(_base, exp);
+    }
+
+    // Split the big-endian exponent into _window sized digits and bucket
+    // the table entries by digit
+    const QByteArray bytes = exp.GetByteArray();
+    const int nbits = bytes.size() * 8;
+    const int digit_count = 1 << _window;
+    QVector<QVector<int> > buckets(digit_count);
+
+    for(int idx = 0; idx < _table.size(); idx++) {
+      int digit = 0;
+      for(int bit = 0; bit < _window; bit++) {
+        int pos = idx * _window + bit;
+        if(pos >= nbits) {
+          break;
+        }
+        unsigned char byte = bytes[bytes.size() - 1 - (pos / 8)];
+        digit |= ((byte >> (pos % 8)) & 1) << bit;
+      }
+
+      if(digit) {
+        buckets[digit].append(idx);
+      }
+    }
+
+    // Yao's method: result = prod_j (prod_{digit_i >= j} table[i])
+    Element result, partial;
+    bool have_result = false, have_partial = false;
+
+    for(int digit = digit_count - 1; digit > 0; digit--) {
+      foreach(int idx, buckets[digit]) {
+        partial = have_partial ? group.Multiply(partial, _table[idx]) : _table[idx];
+        have_partial = true;
+      }
+
+      if(have_partial) {
+        result = have_result ? group.Multiply(result, partial) : partial;
+        have_result = true;
+      }
+    }
+
+    return have_result ? result : group.GetIdentity();
+  }
+
+  bool PrecomputedBase::InRange(const Integer &exp) const
+  {
+    return (exp >= Integer(0)) && (exp.GetBitCount() <= _bits);
+  }
+
+  int PrecomputedBase::OptimalWindow(int bits)
+  {
+    int best = 1;
+    int best_cost = bits + 2;
+    for(int window = 2; window <= 8; window++) {
+      int cost = ((bits + window - 1) / window) + (1 << window);
+      if(cost < best_cost) {
+        best = window;
+        best_cost = cost;
+      }
+    }
+    return best;
+  }
+
+}
+}
+}
@@ -0,0 +1,99 @@
+#ifndef DISSENT_CRYPTO_ABSTRACT_GROUP_PRECOMPUTED_BASE_H_GUARD
+#define DISSENT_CRYPTO_ABSTRACT_GROUP_PRECOMPUTED_BASE_H_GUARD
+
+#include <QVector>
+
+#include "Crypto/Integer.hpp"
+#include "Element.hpp"
+
+namespace Dissent {
+namespace Crypto {
+namespace AbstractGroup {
+
+  class AbstractGroup;
+
+  /**
+   * A table of precomputed powers of a single base, for bases that are
+   * raised to many different exponents such as the group generator or a
+   * long-lived public key. The default table stores
+   *   base^(2^(w*i)) for i in [0, ceil(bits/w))
+   * and exponentiates with Yao's method, costing about bits/w + 2^w group
+   * operations instead of the bits squarings a plain exponentiation needs.
+   */
+  class PrecomputedBase {
+
+    public:
+
+      /**
+       * Constructor, builds the table for base using group operations
+       * @param group the group containing base
+       * @param base the fixed base
+       */
+      PrecomputedBase(const AbstractGroup &group, const Element &base);
+
+      /**
+       * Destructor
+       */
+      virtual ~PrecomputedBase() {}
+
+      /**
+       * Compute base^exp. Exponents outside of [0, 2^bits) fall back to
+       * group.Exponentiate.
+       * @param group the group used to build the table (or a copy of it)
+       * @param exp exponent
+       */
+      virtual Element Exponentiate(const AbstractGroup &group,
+          const Integer &exp) const;
+
+      /**
+       * Return the base
+       */
+      inline Element GetBase() const { return _base; }
+
+      /**
+       * Return the largest exponent size in bits handled by the table
+       */
+      inline int GetExponentBits() const { return _bits; }
+
+      /**
+       * Return the number of exponent bits consumed per table entry
+       */
+      inline int GetWindowSize() const { return _window; }
+
+    protected:
+
+      /**
+       * Constructor for subclasses that maintain their own tables
+       * @param base the fixed base
+       * @param bits the largest exponent size in bits
+       */
+      PrecomputedBase(const Element &base, int bits);
+
+      /**
+       * Returns true if exp can be handled by a table of GetExponentBits
+       * @param exp exponent
+       */
+      bool InRange(const Integer &exp) const;
+
+    private:
+
+      /**
+       * Return the window size minimizing the number of group operations
+       * @param bits exponent size in bits
+       */
+      static int OptimalWindow(int bits);
+
+      Element _base;
+
+      int _bits;
+
+      int _window;
+
+      QVector<Element> _table;
+  };
+
+}
+}
+}
+
+#endif
@@ -5,6 +5,7 @@
 #include <QSharedData>
 #include <QSharedPointer>
 #include <QString>
+#include <QVector>
 
 namespace Dissent {
 namespace Crypto {
@@ -20,6 +21,7 @@ namespace Crypto {
       virtual QByteArray GetByteArray() const = 0;
       virtual QByteArray Sign(const QByteArray &data) const = 0;
       virtual bool Verify(const QByteArray &data, const QByteArray &sig) const = 0;
+
       virtual QByteArray Encrypt(const QByteArray &data) const = 0;
       virtual QByteArray Decrypt(const QByteArray &data) const = 0;
   };
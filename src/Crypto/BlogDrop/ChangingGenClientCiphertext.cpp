@@ -94,7 +94,7 @@ namespace BlogDrop {
     QList<Element> ts;
 
     Integer v_auth = _params->GetKeyGroup()->RandomExponent();
-    ts.append(_params->GetKeyGroup()->Exponentiate(gs[0], v_auth));
+    ts.append(_params->GetKeyGroup()->FixedBaseExponentiate(gs[0], v_auth));
 
     ts.append(_params->GetKeyGroup()->CascadeExponentiate(ys[1], w, gs[1], v));
     for(int i=0; i<GetNElements(); i++) { 
@@ -148,7 +148,7 @@ namespace BlogDrop {
     Integer v_auth = _params->GetKeyGroup()->RandomExponent();
     ts.append(_params->GetKeyGroup()->CascadeExponentiate(ys[0], w, gs[0], v_auth));
 
-    ts.append(_params->GetKeyGroup()->Exponentiate(gs[1], v));
+    ts.append(_params->GetKeyGroup()->FixedBaseExponentiate(gs[1], v));
     for(int i=0; i<GetNElements(); i++) {
       ts.append(_params->GetMessageGroup()->Exponentiate(gs[i+2], v));
     }
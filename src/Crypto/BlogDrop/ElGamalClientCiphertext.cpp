@@ -108,7 +108,7 @@ namespace BlogDrop {
     QList<Integer> vs;
 
     Integer v_auth = _params->GetKeyGroup()->RandomExponent();
-    ts.append(_params->GetKeyGroup()->Exponentiate(gs[0], v_auth));
+    ts.append(_params->GetKeyGroup()->FixedBaseExponentiate(gs[0], v_auth));
 
     for(int i=0; i<(2*_n_elms); i++) { 
       Integer v = _params->GetMessageGroup()->RandomExponent();
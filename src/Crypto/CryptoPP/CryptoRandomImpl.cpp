@@ -2,12 +2,24 @@
 
 #include <QDebug>
 #include <QScopedPointer>
+#include <QSharedPointer>
+#include <QThreadStorage>
 #include <cryptopp/osrng.h> 
 #include "Crypto/CryptoRandom.hpp"
 #include "Helper.hpp"
 
 namespace Dissent {
 namespace Crypto {
+  namespace {
+    struct ThreadRandom {
+      ThreadRandom() : uses(0) {}
+
+      QSharedPointer<CryptoRandom> rand;
+      int uses;
+    };
+
+    QThreadStorage<ThreadRandom *> thread_random;
+  }
 
   class CryptoRandomImpl : public ICryptoRandomImpl {
     public:
@@ -83,6 +95,20 @@ namespace Crypto {
     return CryptoPP::AES::DEFAULT_KEYLENGTH;
   }
 
+  CryptoRandom &CryptoRandom::GetThreadInstance()
+  {
+    if(!thread_random.hasLocalData()) {
+      thread_random.setLocalData(new ThreadRandom());
+    }
+
+    ThreadRandom *state = thread_random.localData();
+    if(state->rand.isNull() || ++state->uses >= RESEED_INTERVAL) {
+      state->rand = QSharedPointer<CryptoRandom>(new CryptoRandom());
+      state->uses = 0;
+    }
+    return *state->rand;
+  }
+
   CryptoPP::RandomNumberGenerator &GetCppRandom(CryptoRandom &rand)
   {
     CryptoRandomImpl *randimpl = dynamic_cast<CryptoRandomImpl *>(rand.GetHandle());
@@ -92,11 +92,14 @@ namespace Crypto {
           return QByteArray();
         }
 
-        KeyBase::Signer signer(*GetDsaPrivateKey());
-        QByteArray sig(signer.MaxSignatureLength(), 0);
-        CryptoRandom rand;
-        signer.SignMessage(GetCppRandom(rand), reinterpret_cast<const byte *>(data.data()),
-            data.size(), reinterpret_cast<byte *>(sig.data()));
+        ContextPool<KeyBase::Signer>::Entry entry =
+          m_signers.Take(*GetDsaPrivateKey(), 1);
+        QByteArray sig(entry.context->MaxSignatureLength(), 0);
+        entry.context->SignMessage(
+            GetCppRandom(CryptoRandom::GetThreadInstance()),
+            reinterpret_cast<const byte *>(data.data()), data.size(),
+            reinterpret_cast<byte *>(sig.data()));
+        m_signers.Release(entry);
         return sig;
       }
 
@@ -123,6 +126,7 @@ namespace Crypto {
 
     private:
       KeyBase::PublicKey *m_public_key;
+      mutable ContextPool<KeyBase::Signer> m_signers;
   };
 
   DsaPrivateKey::DsaPrivateKey(const Integer &modulus, const Integer &subgroup,
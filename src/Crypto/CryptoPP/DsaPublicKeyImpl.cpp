@@ -73,8 +73,11 @@ namespace Crypto {
 
   int CppDsaPublicKeyImpl::GetSignatureLength() const
   {
-    KeyBase::Verifier verifier(*GetDsaPublicKey());
-    return verifier.SignatureLength();
+    ContextPool<KeyBase::Verifier>::Entry entry =
+      m_verifiers.Take(*GetDsaPublicKey(), 0);
+    int length = entry.context->SignatureLength();
+    m_verifiers.Release(entry);
+    return length;
   }
 
   bool CppDsaPublicKeyImpl::SupportsEncryption() const
@@ -119,9 +122,13 @@ namespace Crypto {
       return false;
     }
 
-    KeyBase::Verifier verifier(*GetDsaPublicKey());
-    return verifier.VerifyMessage(reinterpret_cast<const byte *>(data.data()),
-        data.size(), reinterpret_cast<const byte *>(sig.data()), sig.size());
+    ContextPool<KeyBase::Verifier>::Entry entry =
+      m_verifiers.Take(*GetDsaPublicKey(), 1);
+    bool valid = entry.context->VerifyMessage(
+        reinterpret_cast<const byte *>(data.data()), data.size(),
+        reinterpret_cast<const byte *>(sig.data()), sig.size());
+    m_verifiers.Release(entry);
+    return valid;
   }
 
   QByteArray CppDsaPublicKeyImpl::Encrypt(const QByteArray &data) const
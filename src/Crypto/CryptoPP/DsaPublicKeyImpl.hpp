@@ -2,6 +2,8 @@
 #define DISSENT_CRYPTO_CPP_DSA_PUBLIC_KEY_IMPL_H_GUARD
 
 #include <QByteArray>
+#include <QList>
+#include <QMutex>
 #include <QSharedPointer>
 #include <QString>
 #include "Crypto/DsaPublicKey.hpp"
@@ -36,6 +38,75 @@ namespace Crypto {
       virtual Integer GetPublicElement() const;
       virtual Integer GetSubgroupOrder() const;
 
+      /**
+       * Once a key has verified (or signed) this many messages, its contexts
+       * precompute tables for the generator and public element, which costs
+       * about as much as a verification
+       */
+      static const int PRECOMPUTE_USES = 8;
+
+      /**
+       * Signers or verifiers built once for a key and then reused.
+       * Exponentiation writes scratch space in the key's group, so a context
+       * is held by one thread at a time: Take hands out an idle context,
+       * building another only while every one is in use, and Release
+       * returns it.  The pool thus grows to one context per thread using
+       * the key at once.
+       */
+      template<typename Context> class ContextPool {
+        public:
+          struct Entry {
+            QSharedPointer<Context> context;
+            bool precomputed;
+          };
+
+          ContextPool() : m_uses(0) {}
+
+          /**
+           * Returns a context for use by the calling thread alone
+           * @param key the key to build a new context from
+           * @param uses the number of operations about to be performed
+           */
+          template<typename KeyType> Entry Take(const KeyType &key, int uses)
+          {
+            Entry entry;
+            entry.precomputed = false;
+            bool precompute;
+            {
+              QMutexLocker locker(&m_lock);
+              m_uses = qMin(m_uses + uses, int(PRECOMPUTE_USES));
+              precompute = m_uses == PRECOMPUTE_USES;
+              if(!m_idle.isEmpty()) {
+                entry = m_idle.takeLast();
+              }
+            }
+
+            // The thread holds the context, so it can be updated unlocked
+            if(entry.context.isNull()) {
+              entry.context = QSharedPointer<Context>(new Context(key));
+            }
+            if(precompute && !entry.precomputed) {
+              entry.context->AccessKey().Precompute();
+              entry.precomputed = true;
+            }
+            return entry;
+          }
+
+          /**
+           * Returns a context obtained from Take to the pool
+           */
+          void Release(const Entry &entry)
+          {
+            QMutexLocker locker(&m_lock);
+            m_idle.append(entry);
+          }
+
+        private:
+          QMutex m_lock;
+          QList<Entry> m_idle;
+          int m_uses;
+      };
+
     protected:
       virtual KeyBase::PublicKey *GetDsaPublicKey() const
       {
@@ -44,6 +115,9 @@ namespace Crypto {
 
       Key *m_key;
       bool m_valid;
+
+    private:
+      mutable ContextPool<KeyBase::Verifier> m_verifiers;
   };
 }
 }
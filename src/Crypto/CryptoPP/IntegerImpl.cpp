@@ -1,14 +1,47 @@
 #ifdef CRYPTOPP
 
+#include <QScopedPointer>
 #include <cryptopp/integer.h>
 #include <cryptopp/nbtheory.h>
 #include <cryptopp/modarith.h>
 
 #include "Crypto/Integer.hpp"
+#include "Crypto/MultiExponentiation.hpp"
 #include "Helper.hpp"
 
 namespace Dissent {
 namespace Crypto {
+  namespace {
+    /**
+     * Modular multiplication for MultiExponentiation, in Montgomery form
+     * when the modulus is odd
+     */
+    class ModularOps {
+      public:
+        typedef CryptoPP::Integer Element;
+
+        explicit ModularOps(const CryptoPP::ModularArithmetic &ma) : m_ma(ma) {}
+
+        Element Multiply(const Element &a, const Element &b) const
+        {
+          return m_ma.Multiply(a, b);
+        }
+
+        Element Square(const Element &a) const
+        {
+          return m_ma.Square(a);
+        }
+
+        Element Identity() const
+        {
+          return m_ma.MultiplicativeIdentity();
+        }
+
+      private:
+        const CryptoPP::ModularArithmetic &m_ma;
+    };
+  }
+
   class CppIntegerImpl : public IIntegerImpl {
     public:
       CppIntegerImpl(int value) : m_data(value)
@@ -88,6 +121,37 @@ namespace Crypto {
               GetData(x0), GetData(e0), GetData(x1), GetData(e1)));
       }
 
+      virtual IIntegerImpl *MultiPow(const QVector<const IIntegerImpl *> &bases,
+          const QVector<const IIntegerImpl *> &exps) const
+      {
+        QScopedPointer<CryptoPP::ModularArithmetic> ma(m_data.IsOdd() ?
+            new CryptoPP::MontgomeryRepresentation(m_data) :
+            new CryptoPP::ModularArithmetic(m_data));
+
+        QVector<CryptoPP::Integer> cbases;
+        QVector<ExponentDigits> cexps;
+        cbases.reserve(bases.size());
+        cexps.reserve(exps.size());
+
+        for(int idx = 0; idx < bases.size(); idx++) {
+          CryptoPP::Integer base = GetData(bases[idx]);
+          CryptoPP::Integer exp = GetData(exps[idx]);
+          if(exp.IsNegative()) {
+            base = base.InverseMod(m_data);
+            exp = -exp;
+          }
+
+          QByteArray bytes(exp.MinEncodedSize(), 0);
+          exp.Encode(reinterpret_cast<byte *>(bytes.data()), bytes.size());
+          cbases.append(ma->ConvertIn(base));
+          cexps.append(ExponentDigits(bytes));
+        }
+
+        CryptoPP::Integer result = MultiExponentiation::MultiExponentiate(
+            ModularOps(*ma), cbases, cexps);
+        return new CppIntegerImpl(ma->ConvertOut(result));
+      }
+
       virtual IIntegerImpl *Inverse(const IIntegerImpl * const mod) const
       {
         return new CppIntegerImpl(m_data.InverseMod(GetData(mod)));
@@ -0,0 +1,111 @@
+#ifdef CRYPTOPP
+
+#include <cryptopp/aes.h>
+#include <cryptopp/modes.h>
+#include "Crypto/CryptoRandom.hpp"
+#include "Crypto/PadGenerator.hpp"
+
+namespace Dissent {
+namespace Crypto {
+  /**
+   * Wraps the X9.17 RNG used by CryptoRandom
+   */
+  class CompatiblePadGeneratorImpl : public IPadGeneratorImpl {
+    public:
+      CompatiblePadGeneratorImpl(const QByteArray &seed) :
+        m_seed(seed),
+        m_rng(seed)
+      {
+      }
+
+      virtual void XorPad(char *data, int length)
+      {
+        m_buffer.resize(length);
+        m_rng.GenerateBlock(m_buffer);
+
+        const char *pad = m_buffer.constData();
+        for(int idx = 0; idx < length; idx++) {
+          data[idx] ^= pad[idx];
+        }
+      }
+
+      virtual char GetByte(int offset)
+      {
+        // X9.17 output cannot be seeked, so replay the stream up to offset
+        QByteArray prefix(offset + 1, 0);
+        CryptoRandom(m_seed).GenerateBlock(prefix);
+        return prefix[offset];
+      }
+
+    private:
+      QByteArray m_seed;
+      CryptoRandom m_rng;
+      QByteArray m_buffer;
+  };
+
+  /**
+   * AES-CTR keyed by the seed with an all zero counter
+   */
+  class CtrPadGeneratorImpl : public IPadGeneratorImpl {
+    public:
+      CtrPadGeneratorImpl(const QByteArray &seed)
+      {
+        int key_length = CryptoPP::AES::DEFAULT_KEYLENGTH;
+        QByteArray key(seed);
+        if(key.size() < key_length) {
+          key.append(QByteArray(key_length - key.size(), 0));
+        } else if(key_length < key.size()) {
+          key.resize(key_length);
+        }
+
+        QByteArray iv(CryptoPP::AES::BLOCKSIZE, 0);
+        m_cipher.SetKeyWithIV(reinterpret_cast<const byte *>(key.constData()),
+            key.size(), reinterpret_cast<const byte *>(iv.constData()));
+        m_block.SetKey(reinterpret_cast<const byte *>(key.constData()),
+            key.size());
+      }
+
+      virtual void XorPad(char *data, int length)
+      {
+        byte *bdata = reinterpret_cast<byte *>(data);
+        m_cipher.ProcessData(bdata, bdata, length);
+      }
+
+      virtual char GetByte(int offset)
+      {
+        // The counter block for a given offset is its block index, big endian
+        byte counter[CryptoPP::AES::BLOCKSIZE] = { 0 };
+        quint64 block = offset / CryptoPP::AES::BLOCKSIZE;
+        for(int idx = CryptoPP::AES::BLOCKSIZE - 1; block > 0; idx--) {
+          counter[idx] = static_cast<byte>(block & 0xff);
+          block >>= 8;
+        }
+
+        byte keystream[CryptoPP::AES::BLOCKSIZE];
+        m_block.ProcessBlock(counter, keystream);
+        return keystream[offset % CryptoPP::AES::BLOCKSIZE];
+      }
+
+    private:
+      CryptoPP::CTR_Mode<CryptoPP::AES>::Encryption m_cipher;
+      CryptoPP::AES::Encryption m_block;
+  };
+
+  PadGenerator::PadGenerator(const QByteArray &seed, Mode mode) :
+    m_mode(mode)
+  {
+    if(mode == AES_CTR) {
+      m_data = new CtrPadGeneratorImpl(seed);
+    } else {
+      m_data = new CompatiblePadGeneratorImpl(seed);
+    }
+  }
+
+  int PadGenerator::BlockSize()
+  {
+    return CryptoPP::AES::BLOCKSIZE;
+  }
+}
+}
+
+#endif
@@ -35,6 +35,16 @@ namespace Crypto {
        */
       static uint OptimalSeedSize();
 
+      /**
+       * Returns a generator owned by the calling thread, seeded from the
+       * operating system.  It is replaced by a freshly seeded generator
+       * after every RESEED_INTERVAL calls, so frequent users, such as
+       * signing nonces, avoid reading the entropy source each time.
+       */
+      static CryptoRandom &GetThreadInstance();
+
+      static const int RESEED_INTERVAL = 4096;
+
       virtual int GetInt(int min = 0, int max = RAND_MAX)
       {
         return m_data->GetInt(min, max);
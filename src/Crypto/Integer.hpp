@@ -4,6 +4,7 @@
 #include <QByteArray>
 #include <QSharedData>
 #include <QString>
+#include <QVector>
 #include "Utils/Utils.hpp"
 
 namespace Dissent {
@@ -22,6 +23,8 @@ namespace Crypto {
       virtual IIntegerImpl *Pow(const IIntegerImpl * const pow, const IIntegerImpl * const mod) const = 0;
       virtual IIntegerImpl *PowCascade(const IIntegerImpl * const x0, const IIntegerImpl * const e0,
           const IIntegerImpl * const x1, const IIntegerImpl * const e1) const = 0;
+      virtual IIntegerImpl *MultiPow(const QVector<const IIntegerImpl *> &bases,
+          const QVector<const IIntegerImpl *> &exps) const = 0;
       virtual IIntegerImpl *Inverse(const IIntegerImpl * const mod) const = 0;
       virtual bool Equals(const IIntegerImpl * const other) const = 0;
       virtual bool LessThan(const IIntegerImpl * const other) const = 0;
@@ -160,6 +163,26 @@ namespace Crypto {
             x2.m_data.constData(), e2.m_data.constData()));
       }
 
+      /**
+       * Computes prod_i bases[i]^exps[i] modulo this, sharing the squarings
+       * across all terms.  Negative exponents use the inverse of the base.
+       * @param bases the bases
+       * @param exps the exponents, one per base
+       */
+      Integer MultiPow(const QVector<Integer> &bases,
+          const QVector<Integer> &exps) const
+      {
+        Q_ASSERT(bases.size() == exps.size());
+        QVector<const IIntegerImpl *> cbases, cexps;
+        cbases.reserve(bases.size());
+        cexps.reserve(exps.size());
+        for(int idx = 0; idx < bases.size(); idx++) {
+          cbases.append(bases[idx].m_data.constData());
+          cexps.append(exps[idx].m_data.constData());
+        }
+        return Integer(m_data->MultiPow(cbases, cexps));
+      }
+
       /**
        * Compute x such that ax == 1 mod p
        * @param mod inverse modulo this group
@@ -0,0 +1,100 @@
+#include <QDebug>
+#include <QTime>
+#include <QtConcurrentRun>
+
+#include "Utils/Utils.hpp"
+
+#include "DsaPrivateKey.hpp"
+#include "KeyPool.hpp"
+
+namespace Dissent {
+namespace Crypto {
+  namespace {
+    KeyPool::GeneratedKey GenerateKey()
+    {
+      QTime timer;
+      timer.start();
+      KeyPool::GeneratedKey generated;
+      generated.key = QSharedPointer<AsymmetricKey>(new DsaPrivateKey());
+      generated.msecs = timer.elapsed();
+      return generated;
+    }
+  }
+
+  KeyPool::KeyPool(int low_watermark, int high_watermark) :
+    m_low_watermark(low_watermark),
+    m_high_watermark(qMax(low_watermark, high_watermark)),
+    m_generated(0),
+    m_generation_time(0),
+    m_hits(0),
+    m_misses(0)
+  {
+  }
+
+  KeyPool::~KeyPool()
+  {
+    // Outstanding generations finish on their own, their keys are dropped
+    // along with the watchers
+  }
+
+  QSharedPointer<AsymmetricKey> KeyPool::Take()
+  {
+    QSharedPointer<AsymmetricKey> key;
+    if(m_keys.isEmpty()) {
+      m_misses++;
+      GeneratedKey generated = GenerateKey();
+      Account(generated);
+      key = generated.key;
+    } else {
+      m_hits++;
+      key = m_keys.takeFirst();
+    }
+
+    Refill();
+    return key;
+  }
+
+  void KeyPool::Refill()
+  {
+    int available = m_keys.size() + m_pending.size();
+    if(!Utils::MultiThreading || available >= m_low_watermark) {
+      return;
+    }
+
+    for(; available < m_high_watermark; available++) {
+      QFutureWatcher<GeneratedKey> *watcher =
+        new QFutureWatcher<GeneratedKey>(this);
+      QObject::connect(watcher, SIGNAL(finished()), this, SLOT(KeyGenerated()));
+      watcher->setFuture(QtConcurrent::run(GenerateKey));
+      m_pending.append(watcher);
+    }
+  }
+
+  void KeyPool::KeyGenerated()
+  {
+    QFutureWatcher<GeneratedKey> *watcher =
+      static_cast<QFutureWatcher<GeneratedKey> *>(sender());
+    if(!m_pending.removeOne(watcher)) {
+      return;
+    }
+
+    GeneratedKey generated = watcher->result();
+    watcher->deleteLater();
+    Account(generated);
+
+    if(m_keys.size() < m_high_watermark) {
+      m_keys.append(generated.key);
+      emit KeyAvailable();
+    }
+    Refill();
+  }
+
+  void KeyPool::Account(const GeneratedKey &generated)
+  {
+    m_generated++;
+    m_generation_time += generated.msecs;
+    qDebug() << "KeyPool: generated a key in" << generated.msecs << "ms," <<
+      m_keys.size() << "ready," << m_pending.size() << "pending";
+  }
+}
+}
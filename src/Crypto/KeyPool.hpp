@@ -0,0 +1,118 @@
+#ifndef DISSENT_CRYPTO_KEY_POOL_H_GUARD
+#define DISSENT_CRYPTO_KEY_POOL_H_GUARD
+
+#include <QFutureWatcher>
+#include <QList>
+#include <QObject>
+#include <QSharedPointer>
+
+#include "AsymmetricKey.hpp"
+
+namespace Dissent {
+namespace Crypto {
+  /**
+   * Holds ephemeral signing keys generated ahead of time on the thread pool,
+   * so that, for example, accepting a SOCKS connection need not generate a
+   * key on the event thread.  Nothing is generated until the first Take.
+   * From then on, whenever the keys on hand, including those being
+   * generated, fall below the low watermark, generation resumes until the
+   * high watermark is reached.  When the pool is empty, or multithreading
+   * is disabled, a key is generated synchronously.
+   */
+  class KeyPool : public QObject {
+    Q_OBJECT
+
+    public:
+      static const int DEFAULT_LOW_WATERMARK = 4;
+      static const int DEFAULT_HIGH_WATERMARK = 16;
+
+      /**
+       * The result of a key generation
+       */
+      struct GeneratedKey {
+        GeneratedKey() : msecs(0) {}
+
+        QSharedPointer<AsymmetricKey> key;
+        qint64 msecs;
+      };
+
+      /**
+       * Constructor
+       * @param low_watermark generation begins below this many keys
+       * @param high_watermark generation stops at this many keys
+       */
+      explicit KeyPool(int low_watermark = DEFAULT_LOW_WATERMARK,
+          int high_watermark = DEFAULT_HIGH_WATERMARK);
+
+      /**
+       * Destructor
+       */
+      virtual ~KeyPool();
+
+      /**
+       * Removes and returns a key from the pool, and begins filling the pool
+       * if it is running low
+       */
+      QSharedPointer<AsymmetricKey> Take();
+
+      /**
+       * Returns the number of keys ready
+       */
+      int Count() const { return m_keys.size(); }
+
+      /**
+       * Returns the number of keys being generated
+       */
+      int Pending() const { return m_pending.size(); }
+
+      int GetLowWatermark() const { return m_low_watermark; }
+      int GetHighWatermark() const { return m_high_watermark; }
+
+      /**
+       * Returns the number of keys generated, in the background or not
+       */
+      qint64 GetKeysGenerated() const { return m_generated; }
+
+      /**
+       * Returns the total time in ms spent generating keys
+       */
+      qint64 GetGenerationTime() const { return m_generation_time; }
+
+      /**
+       * Returns the number of keys handed out from the pool
+       */
+      qint64 GetHits() const { return m_hits; }
+
+      /**
+       * Returns the number of keys generated synchronously as the pool was
+       * empty
+       */
+      qint64 GetMisses() const { return m_misses; }
+
+    signals:
+      /**
+       * Emitted when a key generated in the background enters the pool
+       */
+      void KeyAvailable();
+
+    private slots:
+      void KeyGenerated();
+
+    private:
+      void Refill();
+      void Account(const GeneratedKey &generated);
+
+      const int m_low_watermark;
+      const int m_high_watermark;
+      QList<QSharedPointer<AsymmetricKey> > m_keys;
+      QList<QFutureWatcher<GeneratedKey> *> m_pending;
+
+      qint64 m_generated;
+      qint64 m_generation_time;
+      qint64 m_hits;
+      qint64 m_misses;
+  };
+}
+}
+
+#endif
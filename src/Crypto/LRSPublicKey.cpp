@@ -19,6 +19,8 @@ namespace Crypto {
     m_generator = key.GetGenerator();
     m_modulus = key.GetModulus();
     m_subgroup = key.GetSubgroupOrder();
+    m_group = QSharedPointer<AbstractGroup::IntegerGroup>(
+        new AbstractGroup::IntegerGroup(m_modulus, m_generator, m_subgroup));
 
     foreach(const DsaPublicKey &key, public_keys) {
       if(!AddKey(key)) {
@@ -38,6 +40,7 @@ namespace Crypto {
     m_generator(generator),
     m_modulus(modulus),
     m_subgroup(subgroup),
+    m_group(new AbstractGroup::IntegerGroup(modulus, generator, subgroup)),
     m_valid(true)
   {
     if(m_keys.count() == 0) {
@@ -110,11 +113,13 @@ namespace Crypto {
 
     Integer tcommit = sig.GetCommit1();
 
+    // The generator and group generator are raised to one exponent per ring
+    // member on every verification, so their tables are kept with the key
     QVector<Integer> keys = GetKeys();
     for(int idx = 0; idx < keys.count(); idx++) {
-      Integer z_p = (GetGenerator().Pow(sig.GetSignature(idx), GetModulus()) *
+      Integer z_p = (m_group->FixedBasePow(GetGenerator(), sig.GetSignature(idx)) *
           keys[idx].Pow(tcommit, GetModulus())) % GetModulus();
-      Integer z_pp = (GetGroupGenerator().Pow(sig.GetSignature(idx), GetModulus()) *
+      Integer z_pp = (m_group->FixedBasePow(GetGroupGenerator(), sig.GetSignature(idx)) *
           sig.GetTag().Pow(tcommit, GetModulus())) % GetModulus();
 
       hashalgo.Update(precompute);
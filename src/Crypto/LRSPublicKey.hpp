@@ -2,7 +2,9 @@
 #define DISSENT_CRYPTO_LRS_PUBLIC_KEY_H_GUARD
 
 #include <QByteArray>
+#include <QSharedPointer>
 
+#include "Crypto/AbstractGroup/IntegerGroup.hpp"
 #include "DsaPublicKey.hpp"
 #include "Integer.hpp"
 #include "LRSSignature.hpp"
@@ -186,6 +188,7 @@ namespace Crypto {
       Integer m_subgroup;
       QByteArray m_linkage_context;
       Integer m_group_gen;
+      QSharedPointer<AbstractGroup::IntegerGroup> m_group;
       bool m_valid;
   };
 }
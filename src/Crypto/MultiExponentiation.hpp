@@ -0,0 +1,267 @@
+#ifndef DISSENT_CRYPTO_MULTI_EXPONENTIATION_H_GUARD
+#define DISSENT_CRYPTO_MULTI_EXPONENTIATION_H_GUARD
+
+#include <QByteArray>
+#include <QVector>
+
+namespace Dissent {
+namespace Crypto {
+  /**
+   * A non-negative exponent, stored big-endian, with access to fixed
+   * width digits
+   */
+  class ExponentDigits {
+    public:
+      /**
+       * Constructor
+       * @param bytes the big-endian unsigned representation
+       */
+      explicit ExponentDigits(const QByteArray &bytes = QByteArray()) :
+        m_bytes(bytes),
+        m_bits(0)
+      {
+        for(int idx = 0; idx < m_bytes.size(); idx++) {
+          unsigned char byte = m_bytes[idx];
+          if(byte == 0) {
+            continue;
+          }
+
+          int top = 8;
+          while(!(byte & 0x80)) {
+            byte <<= 1;
+            top--;
+          }
+          m_bits = (m_bytes.size() - idx - 1) * 8 + top;
+          break;
+        }
+      }
+
+      /**
+       * Returns the number of significant bits
+       */
+      int BitCount() const { return m_bits; }
+
+      /**
+       * Returns the width bit digit starting at bit offset (from the least
+       * significant bit)
+       * @param offset the bit offset
+       * @param width the digit width, at most 16
+       */
+      int Digit(int offset, int width) const
+      {
+        int digit = 0;
+        for(int bit = 0; bit < width; bit++) {
+          int pos = offset + bit;
+          if(pos >= m_bits) {
+            break;
+          }
+          unsigned char byte = m_bytes[m_bytes.size() - 1 - (pos / 8)];
+          digit |= ((byte >> (pos % 8)) & 1) << bit;
+        }
+        return digit;
+      }
+
+    private:
+      QByteArray m_bytes;
+      int m_bits;
+  };
+
+  /**
+   * Computing prod_i bases[i]^exps[i] over any group.  Ops must provide:
+   *   typedef ... Element;
+   *   Element Multiply(const Element &, const Element &) const;
+   *   Element Square(const Element &) const;
+   *   Element Identity() const;
+   * Straus' interleaved window method suits a few terms and Pippenger's
+   * bucket method suits many, MultiExponentiate picks whichever needs
+   * fewer group operations.
+   */
+  class MultiExponentiation {
+    public:
+      /**
+       * Computes prod_i bases[i]^exps[i] with the cheaper method
+       * @param ops the group operations
+       * @param bases the bases
+       * @param exps the exponents, one per base
+       */
+      template<typename Ops> static typename Ops::Element MultiExponentiate(
+          const Ops &ops, const QVector<typename Ops::Element> &bases,
+          const QVector<ExponentDigits> &exps)
+      {
+        int bits = MaxBits(exps);
+        int straus = StrausWindow(bits);
+        int pippenger = PippengerWindow(bases.size(), bits);
+        if(StrausCost(bases.size(), bits, straus) <=
+            PippengerCost(bases.size(), bits, pippenger))
+        {
+          return Straus(ops, bases, exps, straus);
+        }
+        return Pippenger(ops, bases, exps, pippenger);
+      }
+
+      /**
+       * Straus' method: a table of bases[i]^d for every w bit digit d,
+       * consumed w bits at a time with one shared chain of squarings
+       * @param ops the group operations
+       * @param bases the bases
+       * @param exps the exponents, one per base
+       * @param window the digit width w
+       */
+      template<typename Ops> static typename Ops::Element Straus(
+          const Ops &ops, const QVector<typename Ops::Element> &bases,
+          const QVector<ExponentDigits> &exps, int window)
+      {
+        typedef typename Ops::Element Element;
+        const int digit_count = 1 << window;
+
+        QVector<QVector<Element> > tables(bases.size());
+        for(int idx = 0; idx < bases.size(); idx++) {
+          if(exps[idx].BitCount() == 0) {
+            continue;
+          }
+          QVector<Element> &table = tables[idx];
+          table.reserve(digit_count);
+          table.append(ops.Identity());
+          table.append(bases[idx]);
+          for(int digit = 2; digit < digit_count; digit++) {
+            table.append(ops.Multiply(table[digit - 1], bases[idx]));
+          }
+        }
+
+        int bits = MaxBits(exps);
+        Element result = ops.Identity();
+        bool have_result = false;
+
+        for(int offset = ((bits - 1) / window) * window; offset >= 0; offset -= window) {
+          if(have_result) {
+            for(int sq = 0; sq < window; sq++) {
+              result = ops.Square(result);
+            }
+          }
+
+          for(int idx = 0; idx < bases.size(); idx++) {
+            int digit = exps[idx].Digit(offset, window);
+            if(digit == 0) {
+              continue;
+            }
+            result = have_result ? ops.Multiply(result, tables[idx][digit]) :
+              tables[idx][digit];
+            have_result = true;
+          }
+        }
+
+        return result;
+      }
+
+      /**
+       * Pippenger's method: for each w bit digit position, bases sharing a
+       * digit are multiplied into a bucket and the buckets are combined
+       * with a running product
+       * @param ops the group operations
+       * @param bases the bases
+       * @param exps the exponents, one per base
+       * @param window the digit width w
+       */
+      template<typename Ops> static typename Ops::Element Pippenger(
+          const Ops &ops, const QVector<typename Ops::Element> &bases,
+          const QVector<ExponentDigits> &exps, int window)
+      {
+        typedef typename Ops::Element Element;
+        const int digit_count = 1 << window;
+
+        int bits = MaxBits(exps);
+        Element result = ops.Identity();
+        bool have_result = false;
+
+        QVector<Element> buckets(digit_count);
+        QVector<bool> filled(digit_count);
+
+        for(int offset = ((bits - 1) / window) * window; offset >= 0; offset -= window) {
+          if(have_result) {
+            for(int sq = 0; sq < window; sq++) {
+              result = ops.Square(result);
+            }
+          }
+
+          filled.fill(false);
+          for(int idx = 0; idx < bases.size(); idx++) {
+            int digit = exps[idx].Digit(offset, window);
+            if(digit == 0) {
+              continue;
+            }
+            buckets[digit] = filled[digit] ?
+              ops.Multiply(buckets[digit], bases[idx]) : bases[idx];
+            filled[digit] = true;
+          }
+
+          // prod_d bucket[d]^d == prod_d (prod_{d' >= d} bucket[d'])
+          Element running, window_sum;
+          bool have_running = false, have_sum = false;
+          for(int digit = digit_count - 1; digit > 0; digit--) {
+            if(filled[digit]) {
+              running = have_running ? ops.Multiply(running, buckets[digit]) :
+                buckets[digit];
+              have_running = true;
+            }
+
+            if(have_running) {
+              window_sum = have_sum ? ops.Multiply(window_sum, running) : running;
+              have_sum = true;
+            }
+          }
+
+          if(have_sum) {
+            result = have_result ? ops.Multiply(result, window_sum) : window_sum;
+            have_result = true;
+          }
+        }
+
+        return result;
+      }
+
+    private:
+      static int MaxBits(const QVector<ExponentDigits> &exps)
+      {
+        int bits = 0;
+        foreach(const ExponentDigits &exp, exps) {
+          bits = qMax(bits, exp.BitCount());
+        }
+        return bits;
+      }
+
+      static int StrausCost(int terms, int bits, int window)
+      {
+        return bits + terms * ((1 << window) + (bits / window));
+      }
+
+      static int StrausWindow(int bits)
+      {
+        int best = 1;
+        for(int window = 2; window <= 8; window++) {
+          if(StrausCost(1, bits, window) < StrausCost(1, bits, best)) {
+            best = window;
+          }
+        }
+        return best;
+      }
+
+      static int PippengerCost(int terms, int bits, int window)
+      {
+        return bits + ((bits + window - 1) / window) * (terms + (2 << window));
+      }
+
+      static int PippengerWindow(int terms, int bits)
+      {
+        int best = 1;
+        for(int window = 2; window <= 16; window++) {
+          if(PippengerCost(terms, bits, window) < PippengerCost(terms, bits, best)) {
+            best = window;
+          }
+        }
+        return best;
+      }
+  };
+}
+}
+
+#endif
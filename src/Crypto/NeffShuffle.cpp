@@ -1,5 +1,6 @@
 #include <QDataStream>
 #include <QDebug>
+#include <QtConcurrentMap>
 
 #include "DsaPrivateKey.hpp"
 #include "DsaPublicKey.hpp"
@@ -9,6 +10,164 @@
 
 namespace Dissent {
 namespace Crypto {
+namespace {
+  /**
+   * A single exponentiation within a shuffle stage:
+   *   result = base^exp * factor mod modulus
+   * using the group's fixed-base table for base when group is set and
+   * inverting factor first when invert_factor is set
+   */
+  struct PowJob {
+    const AbstractGroup::IntegerGroup *group;
+    Integer modulus;
+    Integer base;
+    Integer exp;
+    Integer factor;
+    bool invert_factor;
+    Integer result;
+  };
+
+  PowJob FixedPow(const AbstractGroup::IntegerGroup &group,
+      const Integer &base, const Integer &exp,
+      const Integer &factor = Integer(1), bool invert_factor = false)
+  {
+    PowJob job = { &group, group.GetModulus(), base, exp, factor,
+      invert_factor, Integer() };
+    return job;
+  }
+
+  PowJob VariablePow(const Integer &modulus, const Integer &base,
+      const Integer &exp, const Integer &factor = Integer(1))
+  {
+    PowJob job = { 0, modulus, base, exp, factor, false, Integer() };
+    return job;
+  }
+
+  void ComputePow(PowJob &job)
+  {
+    Integer value = job.group ? job.group->FixedBasePow(job.base, job.exp) :
+      job.base.Pow(job.exp, job.modulus);
+    Integer factor = job.invert_factor ? job.factor.Inverse(job.modulus) :
+      job.factor;
+    job.result = (value * factor) % job.modulus;
+  }
+
+  /**
+   * A verification equation prod_i bases[i]^exps[i] == expected mod modulus
+   */
+  struct ProductCheck {
+    Integer modulus;
+    QVector<Integer> bases;
+    QVector<Integer> exps;
+    Integer expected;
+    bool valid;
+  };
+
+  ProductCheck Check(const Integer &modulus, const Integer &expected,
+      const Integer &b0, const Integer &e0)
+  {
+    ProductCheck check = { modulus, QVector<Integer>() << b0,
+      QVector<Integer>() << e0, expected, false };
+    return check;
+  }
+
+  ProductCheck Check(const Integer &modulus, const Integer &expected,
+      const Integer &b0, const Integer &e0,
+      const Integer &b1, const Integer &e1)
+  {
+    ProductCheck check = { modulus, QVector<Integer>() << b0 << b1,
+      QVector<Integer>() << e0 << e1, expected, false };
+    return check;
+  }
+
+  void ComputeCheck(ProductCheck &check)
+  {
+    check.valid = check.modulus.MultiPow(check.bases, check.exps) == check.expected;
+  }
+
+  /**
+   * A layer of decryption and the commitment for its proof
+   */
+  struct DecryptJob {
+    const DsaPrivateKey *key;
+    QByteArray encrypted;
+    Integer t;
+    QByteArray decrypted;
+    Integer T;
+  };
+
+  void ComputeDecrypt(DecryptJob &job)
+  {
+    job.decrypted = job.key->SeriesDecrypt(job.encrypted);
+    QDataStream tstream(job.encrypted);
+    Integer shared;
+    tstream >> shared;
+    job.T = shared.Pow(job.t, job.key->GetModulus());
+  }
+
+  /**
+   * Runs each job of a stage, across the thread pool when multithreaded.
+   * Jobs only write to their own entry, so results do not depend on
+   * scheduling.
+   */
+  template<typename T> void RunStage(QVector<T> &jobs, void (*compute)(T &))
+  {
+    if(!Utils::MultiThreading || jobs.size() < 2) {
+      for(int idx = 0; idx < jobs.size(); idx++) {
+        compute(jobs[idx]);
+      }
+      return;
+    }
+
+    QtConcurrent::blockingMap(jobs, compute);
+  }
+
+  QVector<Integer> RunPows(QVector<PowJob> &jobs)
+  {
+    RunStage(jobs, ComputePow);
+    QVector<Integer> results;
+    results.reserve(jobs.size());
+    foreach(const PowJob &job, jobs) {
+      results.append(job.result);
+    }
+    return results;
+  }
+
+  /**
+   * Returns the index of the first failed check or -1 if all passed
+   */
+  int RunChecks(QVector<ProductCheck> &checks)
+  {
+    RunStage(checks, ComputeCheck);
+    for(int idx = 0; idx < checks.size(); idx++) {
+      if(!checks[idx].valid) {
+        return idx;
+      }
+    }
+    return -1;
+  }
+}
+
+  NeffShuffle::NeffShuffle(const QSharedPointer<IntegerGroup> &group) :
+    _group(group)
+  {
+  }
+
+  QSharedPointer<NeffShuffle::IntegerGroup> NeffShuffle::GetGroup(
+      const Integer &modulus, const Integer &generator,
+      const Integer &subgroup)
+  {
+    if(_group.isNull() || (_group->GetModulus() != modulus) ||
+        (_group->GetOrder() != subgroup) ||
+        (_group->GetGenerator() != AbstractGroup::Element(
+          new AbstractGroup::IntegerElementData(generator))))
+    {
+      _group = QSharedPointer<IntegerGroup>(
+          new IntegerGroup(modulus, generator, subgroup));
+    }
+    return _group;
+  }
+
   bool NeffShuffle::Shuffle(const QVector<QByteArray> &input,
       const DsaPrivateKey &private_key,
       const QVector<DsaPublicKey> &remaining_keys,
@@ -35,6 +194,12 @@ namespace Crypto {
       h = (h * key.GetPublicElement()) % modulus;
     }
 
+    // The generator and h are raised to several exponents per input, so
+    // those use precomputed fixed-base tables
+    QSharedPointer<IntegerGroup> shared_group = GetGroup(modulus, generator,
+        subgroup);
+    const IntegerGroup &group = *shared_group;
+
     if(input.size() == 0) {
       qCritical() << "Cannot perform a shuffle on a 0 sized input";
       return false;
@@ -58,21 +223,20 @@ namespace Crypto {
     }
 
     // Rencryption
-    QVector<Integer> X_bar, Y_bar;
+    QVector<PowJob> X_jobs, Y_jobs;
+    for(int idx = 0; idx < k; idx++) {
+      X_jobs.append(FixedPow(group, generator, beta[idx], X[idx]));
+      Y_jobs.append(FixedPow(group, h, beta[idx], Y[idx]));
+    }
+
+    QVector<Integer> X_bar = RunPows(X_jobs);
+    QVector<Integer> Y_bar = RunPows(Y_jobs);
     QVector<QPair<QByteArray, int> > sortable;
     
     for(int idx = 0; idx < k; idx++) {
-      Integer X_bar_l = (X[idx] *
-          generator.Pow(beta[idx], modulus)) % modulus;
-      X_bar.append(X_bar_l);
-
-      Integer Y_bar_l = (Y[idx] *
-          h.Pow(beta[idx], modulus)) % modulus;
-      Y_bar.append(Y_bar_l);
-
       QByteArray toutput;
       QDataStream tstream(&toutput, QIODevice::WriteOnly);
-      tstream << X_bar_l << Y_bar_l;
+      tstream << X_bar[idx] << Y_bar[idx];
       sortable.append(QPair<QByteArray, int>(toutput, idx));
     }
 
@@ -108,26 +272,34 @@ namespace Crypto {
 
     // Part 1 -- Generation of initial shares
 
-    Integer Gamma = generator.Pow(gamma, modulus);
-    QVector<Integer> A, C, U, W;
+    Integer Gamma = group.FixedBasePow(generator, gamma);
+    QVector<PowJob> A_jobs, U_jobs, W_jobs;
     for(int idx = 0; idx < k; idx++) {
-      A.append(generator.Pow(a[idx], modulus));
-      U.append(generator.Pow(u[idx], modulus));
-      W.append(generator.Pow((gamma * w[idx]) % subgroup, modulus));
+      A_jobs.append(FixedPow(group, generator, a[idx]));
+      U_jobs.append(FixedPow(group, generator, u[idx]));
+      W_jobs.append(FixedPow(group, generator, (gamma * w[idx]) % subgroup));
     }
 
+    QVector<Integer> A = RunPows(A_jobs);
+    QVector<Integer> U = RunPows(U_jobs);
+    QVector<Integer> W = RunPows(W_jobs);
+
+    QVector<PowJob> C_jobs;
     for(int idx = 0; idx < k; idx++) {
-      C.append(A[pi[idx]].Pow(gamma, modulus));
+      C_jobs.append(VariablePow(modulus, A[pi[idx]], gamma));
     }
+    QVector<Integer> C = RunPows(C_jobs);
 
-    Integer delta_sum = tau_0, x_multi = 1, y_multi = 1;
+    Integer delta_sum = tau_0;
+    QVector<Integer> multi_exps;
     for(int idx = 0; idx < k; idx++) {
       delta_sum = (delta_sum + w[idx] * beta[pi[idx]]) % subgroup;
-      x_multi = (x_multi * X[idx].Pow((w[inv_pi[idx]] - u[idx]) % subgroup, modulus)) % modulus;
-      y_multi = (y_multi * Y[idx].Pow((w[inv_pi[idx]] - u[idx]) % subgroup, modulus)) % modulus;
+      multi_exps.append((w[inv_pi[idx]] - u[idx]) % subgroup);
     }
-    Integer Delta_0 = (generator.Pow(delta_sum, modulus) * x_multi) % modulus;
-    Integer Delta_1 = (h.Pow(delta_sum, modulus) * y_multi) % modulus;
+    Integer x_multi = modulus.MultiPow(X, multi_exps);
+    Integer y_multi = modulus.MultiPow(Y, multi_exps);
+    Integer Delta_0 = (group.FixedBasePow(generator, delta_sum) * x_multi) % modulus;
+    Integer Delta_1 = (group.FixedBasePow(h, delta_sum) * y_multi) % modulus;
 
     stream << output << Gamma << A << C << U << W << Delta_0 << Delta_1;
 
@@ -136,24 +308,25 @@ namespace Crypto {
     cseed = hash.ComputeHash(proof);
     rand = CryptoRandom(cseed);
 
-    QVector<Integer> p, B;
+    // The prover never uses B, so only the challenges are drawn
+    QVector<Integer> p;
     for(int idx = 0; idx < k; idx++) {
       p.append(rand.GetInteger(2, subgroup));
-      B.append((generator.Pow(p[idx], modulus) *
-            U[idx].Inverse(modulus)) % modulus);
     }
 
     // Part 3 -- Prover
 
-    QVector<Integer> b, d, D;
+    QVector<Integer> b, d;
     for(int idx = 0; idx < k; idx++) {
       b.append((p[idx] - u[idx]) % subgroup);
     }
 
+    QVector<PowJob> D_jobs;
     for(int idx = 0; idx < k; idx++) {
       d.append((gamma * b[pi[idx]]) % subgroup);
-      D.append(generator.Pow(d[idx], modulus));
+      D_jobs.append(FixedPow(group, generator, d[idx]));
     }
+    QVector<Integer> D = RunPows(D_jobs);
 
     stream << D;
 
@@ -206,17 +379,18 @@ namespace Crypto {
       theta.append(erand.GetInteger(0, subgroup));
     }
 
-    QVector<Integer> Theta;
-    Theta.append(generator.Pow(subgroup - (theta[0] * s_t[0]) % subgroup, modulus));
+    QVector<PowJob> Theta_jobs;
+    Theta_jobs.append(FixedPow(group, generator, subgroup - (theta[0] * s_t[0]) % subgroup));
     for(int idx = 1; idx < k; idx++) {
-      Theta.append(generator.Pow((theta[idx - 1] * r_t[idx] - theta[idx] * s_t[idx]) % subgroup, modulus));
+      Theta_jobs.append(FixedPow(group, generator, (theta[idx - 1] * r_t[idx] - theta[idx] * s_t[idx]) % subgroup));
     }
 
     for(int idx = k; idx < (2 * k - 1); idx++) {
-      Theta.append(generator.Pow((gamma * theta[idx - 1] - theta[idx]) % subgroup, modulus));
+      Theta_jobs.append(FixedPow(group, generator, (gamma * theta[idx - 1] - theta[idx]) % subgroup));
     }
 
-    Theta.append(generator.Pow((gamma * theta[2 * k - 2]) % subgroup, modulus));
+    Theta_jobs.append(FixedPow(group, generator, (gamma * theta[2 * k - 2]) % subgroup));
+    QVector<Integer> Theta = RunPows(Theta_jobs);
 
     stream << Theta;
 
@@ -250,25 +424,27 @@ namespace Crypto {
     cseed = hash.ComputeHash(proof);
     rand = CryptoRandom(cseed);
 
+    QVector<DecryptJob> decrypt_jobs;
+    foreach(const QByteArray &encrypted, output) {
+      DecryptJob job = { &private_key, encrypted,
+        erand.GetInteger(2, subgroup), QByteArray(), Integer() };
+      decrypt_jobs.append(job);
+    }
+    RunStage(decrypt_jobs, ComputeDecrypt);
+
     QVector<QByteArray> decrypted;
     QVector<QPair<Integer, Integer> > decryption_proof;
 
-    foreach(const QByteArray &encrypted, output) {
-      decrypted.append(private_key.SeriesDecrypt(encrypted));
-      if(decrypted.last().isEmpty()) {
+    foreach(const DecryptJob &job, decrypt_jobs) {
+      if(job.decrypted.isEmpty()) {
         qDebug() << "Invalid encryption";
         return false;
       }
 
-      QDataStream tstream(encrypted);
-      Integer shared;
-      tstream >> shared;
-
-      Integer t = erand.GetInteger(2, subgroup);
-      Integer T = shared.Pow(t, modulus);
+      decrypted.append(job.decrypted);
       Integer c = rand.GetInteger(2, subgroup);
-      Integer s = (t + c * private_key.GetPrivateExponent()) % subgroup;
-      decryption_proof.append(QPair<Integer, Integer>(T, s));
+      Integer s = (job.t + c * private_key.GetPrivateExponent()) % subgroup;
+      decryption_proof.append(QPair<Integer, Integer>(job.T, s));
     }
 
     stream << decrypted;
@@ -297,6 +473,10 @@ namespace Crypto {
       h = (h * keys[idx].GetPublicElement()) % modulus;
     }
 
+    QSharedPointer<IntegerGroup> shared_group = GetGroup(modulus, generator,
+        subgroup);
+    const IntegerGroup &group = *shared_group;
+
     QVector<Integer> X, Y;
     for(int idx = 0; idx < input.size(); idx++) {
       QDataStream tstream(input[idx]);
@@ -361,12 +541,13 @@ namespace Crypto {
     cseed = hash.ComputeHash(proof);
     rand = CryptoRandom(cseed);
 
-    QVector<Integer> p, B;
+    QVector<Integer> p;
+    QVector<PowJob> B_jobs;
     for(int idx = 0; idx < k; idx++) {
       p.append(rand.GetInteger(2, subgroup));
-      B.append((generator.Pow(p[idx], modulus) *
-            U[idx].Inverse(modulus)) % modulus);
+      B_jobs.append(FixedPow(group, generator, p[idx], U[idx], true));
     }
+    QVector<Integer> B = RunPows(B_jobs);
 
     // Part 3 -- Prover
 
@@ -391,6 +572,11 @@ namespace Crypto {
     ostream >> tau >> sigma;
     istream << tau << sigma;
 
+    if(sigma.size() != k) {
+      qDebug() << "Invalid sigma size";
+      return false;
+    }
+
     // Part 6 -- SimpleKShuffle (R, S, G, Gamma)
 
     hash.Update(base_seed);
@@ -428,71 +614,75 @@ namespace Crypto {
     ostream >> alpha;
     istream << alpha;
 
+    if(alpha.size() != 2 * k - 1) {
+      qDebug() << "Invalid alpha size";
+      return false;
+    }
+
     // Part 6.5 - Verifier
 
-    QVector<Integer> R, S, R_t, S_t;
+    QVector<Integer> R_t, S_t;
     Integer U_ = generator.Pow(subgroup - t, modulus);
     Integer W_ = Gamma.Pow(subgroup - t, modulus);
 
+    QVector<PowJob> R_jobs, S_jobs;
     for(int idx = 0; idx < k; idx++) {
-      R.append((A[idx] * B[idx].Pow(lambda, modulus)) % modulus);
-      R_t.append((R[idx] * U_) % modulus);
+      R_jobs.append(VariablePow(modulus, B[idx], lambda, A[idx]));
+      S_jobs.append(VariablePow(modulus, D[idx], lambda, C[idx]));
+    }
+    QVector<Integer> R = RunPows(R_jobs);
+    QVector<Integer> S = RunPows(S_jobs);
 
-      S.append((C[idx] * D[idx].Pow(lambda, modulus)) % modulus);
+    for(int idx = 0; idx < k; idx++) {
+      R_t.append((R[idx] * U_) % modulus);
       S_t.append((S[idx] * W_) % modulus);
     }
 
-    if(Theta[0] !=
-        ((R_t[0].Pow(c, modulus) *
-         S_t[0].Pow(subgroup - alpha[0], modulus)) % modulus))
-    {
-      qDebug() << "Failed Theta[0] check";
-      return false;
-    }
+    QVector<ProductCheck> Theta_checks;
+    Theta_checks.append(Check(modulus, Theta[0],
+          R_t[0], c, S_t[0], subgroup - alpha[0]));
 
     for(int idx = 1; idx < k; idx++) {
-      if(Theta[idx] !=
-          ((R_t[idx].Pow(alpha[idx - 1], modulus) *
-            S_t[idx].Pow(subgroup - alpha[idx], modulus)) % modulus))
-      {
-        qDebug().nospace() << "Failed Theta[" << idx <<"] check";
-        return false;
-      }
+      Theta_checks.append(Check(modulus, Theta[idx],
+            R_t[idx], alpha[idx - 1], S_t[idx], subgroup - alpha[idx]));
     }
 
     for(int idx = k; idx < 2 * k - 1; idx++) {
-      if(Theta[idx] !=
-          ((Gamma.Pow(alpha[idx - 1], modulus) *
-            generator.Pow(subgroup - alpha[idx], modulus)) % modulus))
-      {
-        qDebug().nospace() << "Failed Theta[" << idx <<"] check";
-        return false;
-      }
+      Theta_checks.append(Check(modulus, Theta[idx],
+            Gamma, alpha[idx - 1], generator, subgroup - alpha[idx]));
     }
 
-    if(Theta[2 * k - 1] !=
-        ((Gamma.Pow(alpha[2 * k - 2], modulus) *
-          generator.Pow(subgroup - c, modulus)) % modulus))
-    {
-      qDebug().nospace() << "Failed Theta[" << (2 * k - 1) <<"] check";
+    Theta_checks.append(Check(modulus, Theta[2 * k - 1],
+          Gamma, alpha[2 * k - 2], generator, subgroup - c));
+
+    int failed = RunChecks(Theta_checks);
+    if(failed != -1) {
+      qDebug().nospace() << "Failed Theta[" << failed << "] check";
       return false;
     }
 
     // Part 7 -- Verifier
 
-    Integer iota_0 = 1, iota_1 = 1;
+    QVector<ProductCheck> sigma_checks;
+    QVector<Integer> iota_0_bases, iota_1_bases, iota_exps;
     for(int idx = 0; idx < k; idx++) {
-      iota_0 = (iota_0 * X_bar[idx].Pow(sigma[idx], modulus) *
-          X[idx].Pow(subgroup - p[idx], modulus)) % modulus;
-      iota_1 = (iota_1 * Y_bar[idx].Pow(sigma[idx], modulus) *
-          Y[idx].Pow(subgroup - p[idx], modulus)) % modulus;
-      if(Gamma.Pow(sigma[idx], modulus) != ((W[idx] * D[idx]) % modulus)) {
-        qDebug().nospace() << "Failed sigma[" << idx << "] check";
-        return false;
-      }
+      sigma_checks.append(Check(modulus, (W[idx] * D[idx]) % modulus,
+            Gamma, sigma[idx]));
+      iota_0_bases << X_bar[idx] << X[idx];
+      iota_1_bases << Y_bar[idx] << Y[idx];
+      iota_exps << sigma[idx] << (subgroup - p[idx]);
+    }
+
+    failed = RunChecks(sigma_checks);
+    if(failed != -1) {
+      qDebug().nospace() << "Failed sigma[" << failed << "] check";
+      return false;
     }
 
-    if(iota_0 != ((Delta_0 * generator.Pow(tau, modulus)) % modulus)) {
+    Integer iota_0 = modulus.MultiPow(iota_0_bases, iota_exps);
+    Integer iota_1 = modulus.MultiPow(iota_1_bases, iota_exps);
+
+    if(iota_0 != ((Delta_0 * group.FixedBasePow(generator, tau)) % modulus)) {
       qDebug() << "Failed Iota_0 check";
       return false;
     }
@@ -521,6 +711,8 @@ namespace Crypto {
     cseed = hash.ComputeHash(proof);
     rand = CryptoRandom(cseed);
 
+    // shared^s == T * pair^c, checked as shared^s * pair^-c == T
+    QVector<ProductCheck> decryption_checks;
     for(int idx = 0; idx < k; idx++) {
       QDataStream tstream_in(shuffle_output[idx]);
       Integer shared_in, secret_in;
@@ -539,10 +731,32 @@ namespace Crypto {
         return false;
       }
 
-      if(shared_out.Pow(s, modulus) != ((T * pair.Pow(c, modulus)) % modulus)) {
-        qDebug() << "Invalid decryption proof";
-        return false;
-      }
+      decryption_checks.append(Check(modulus, T,
+            shared_out, s, pair, Integer(0) - c));
+    }
+
+    if(RunChecks(decryption_checks) != -1) {
+      qDebug() << "Invalid decryption proof";
+      return false;
+    }
+
+    output = decrypted;
+    return true;
+  }
+  bool NeffShuffle::ParseOutput(const QByteArray &proof,
+      QVector<QByteArray> &output)
+  {
+    QDataStream stream(proof);
+    QVector<QByteArray> shuffle_output;
+    Integer Gamma, Delta_0, Delta_1, tau;
+    QVector<Integer> A, C, U, W, D, sigma, Theta, alpha;
+    QVector<QByteArray> decrypted;
+
+    stream >> shuffle_output >> Gamma >> A >> C >> U >> W >> Delta_0 >>
+      Delta_1 >> D >> tau >> sigma >> Theta >> alpha >> decrypted;
+
+    if(stream.status() != QDataStream::Ok) {
+      return false;
     }
 
     output = decrypted;
@@ -3,8 +3,10 @@
 
 #include <QByteArray>
 #include <QPair>
+#include <QSharedPointer>
 #include <QVector>
 
+#include "Crypto/AbstractGroup/IntegerGroup.hpp"
 #include "DsaPrivateKey.hpp"
 #include "DsaPublicKey.hpp"
 #include "Integer.hpp"
@@ -13,6 +15,16 @@ namespace Dissent {
 namespace Crypto {
   class NeffShuffle {
     public:
+      typedef AbstractGroup::IntegerGroup IntegerGroup;
+
+      /**
+       * Constructor
+       * @param group the group of the keys, shared so that its fixed-base
+       * tables are reused across shuffles, built from the keys when null
+       */
+      explicit NeffShuffle(const QSharedPointer<IntegerGroup> &group =
+          QSharedPointer<IntegerGroup>());
+
       /**
        * Performs a non-interactive verifiable Neff Mix
        * with a verifiable decryption.
@@ -43,6 +55,26 @@ namespace Crypto {
           const QVector<DsaPublicKey> &keys,
           const QByteArray &input_proof,
           QVector<QByteArray> &output);
+
+      /**
+       * Returns the decrypted output claimed by a transcript without
+       * verifying it, so that the transcripts of a chain of shufflers can
+       * be verified concurrently, each against its predecessor's output.
+       * @param proof the transcript
+       * @param output the claimed output
+       */
+      static bool ParseOutput(const QByteArray &proof,
+          QVector<QByteArray> &output);
+
+    private:
+      /**
+       * Returns the group given at construction, or a group for the keys if
+       * it does not match them
+       */
+      QSharedPointer<IntegerGroup> GetGroup(const Integer &modulus,
+          const Integer &generator, const Integer &subgroup);
+
+      QSharedPointer<IntegerGroup> _group;
   };
 }
 }
@@ -70,9 +70,9 @@ namespace Crypto {
       const QVector<QByteArray> &cleartext,
       const QVector<QByteArray> &ciphertext) const
   {
-    foreach(QByteArray cph, ciphertext) {
-      QByteArray clr = key->Decrypt(cph);
-      if(!cleartext.contains(clr)) {
+    CleartextIndex index = IndexCleartext(cleartext);
+    foreach(const QByteArray &cph, ciphertext) {
+      if(!TakeCleartext(index, key->Decrypt(cph))) {
         return false;
       }
     }
@@ -82,16 +82,10 @@ namespace Crypto {
   bool OnionEncryptor::VerifyAll(const QVector<QSharedPointer<AsymmetricKey> > &keys,
       const QVector<QVector<QByteArray> > &onion, QBitArray &bad) const
   {
-    if(keys.count() != onion.count() - 1) {
-      qWarning() << "Incorrect key to onion layers ratio: " << keys.count() <<
-        ":" << onion.count();
+    if(!CheckLayers(keys, onion, bad)) {
       return false;
     }
 
-    if(keys.count() != bad.count()) {
-      bad = QBitArray(keys.count(), false);
-    }
-
     bool res = true;
     for(int idx = 0; idx < keys.count(); idx++) {
       if(!VerifyOne(keys[idx], onion[idx], onion[idx + 1])) {
@@ -103,6 +97,47 @@ namespace Crypto {
     return res;
   }
 
+  OnionEncryptor::CleartextIndex OnionEncryptor::IndexCleartext(
+      const QVector<QByteArray> &cleartext)
+  {
+    CleartextIndex index;
+    index.reserve(cleartext.count());
+    foreach(const QByteArray &clr, cleartext) {
+      index[clr]++;
+    }
+    return index;
+  }
+
+  bool OnionEncryptor::TakeCleartext(CleartextIndex &index,
+      const QByteArray &decrypted)
+  {
+    CleartextIndex::iterator it = index.find(decrypted);
+    if(it == index.end()) {
+      return false;
+    }
+
+    if(--it.value() == 0) {
+      index.erase(it);
+    }
+    return true;
+  }
+
+  bool OnionEncryptor::CheckLayers(
+      const QVector<QSharedPointer<AsymmetricKey> > &keys,
+      const QVector<QVector<QByteArray> > &onion, QBitArray &bad)
+  {
+    if(keys.count() != onion.count() - 1) {
+      qWarning() << "Incorrect key to onion layers ratio: " << keys.count() <<
+        ":" << onion.count();
+      return false;
+    }
+
+    if(keys.count() != bad.count()) {
+      bad = QBitArray(keys.count(), false);
+    }
+    return true;
+  }
+
   int OnionEncryptor::ReorderRandomBits(
       const QVector<QVector<QByteArray> > &in_bits,
       QVector<QVector<QByteArray> > &out_bits) const
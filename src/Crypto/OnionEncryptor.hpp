@@ -4,6 +4,7 @@
 #include <QBitArray>
 #include <QByteArray>
 #include <QDebug>
+#include <QHash>
 #include <QVector>
 
 #include "AsymmetricKey.hpp"
@@ -41,12 +42,14 @@ namespace Crypto {
 
       /**
        * Verifies that the ciphertext and cleartext match, returning true
-       * if that is the case, false otherwise
+       * if that is the case, false otherwise.  Each ciphertext must decrypt
+       * to a distinct entry of cleartext, which is indexed by hash so that
+       * the check is linear in the number of ciphertexts.
        * @param key the key used for verification
        * @param cleartext the unencrypted data
        * @param ciphertext the encrypted data
        */
-      bool VerifyOne(const QSharedPointer<AsymmetricKey> &key,
+      virtual bool VerifyOne(const QSharedPointer<AsymmetricKey> &key,
           const QVector<QByteArray> &cleartext,
           const QVector<QByteArray> &ciphertext) const;
 
@@ -59,7 +62,7 @@ namespace Crypto {
        * encrypted and the maximum index being the most encrypted
        * @param bad indexes are set if the key had issue decrypting
        */
-      bool VerifyAll(const QVector<QSharedPointer<AsymmetricKey> > &keys,
+      virtual bool VerifyAll(const QVector<QSharedPointer<AsymmetricKey> > &keys,
           const QVector<QVector<QByteArray> > &onion,
           QBitArray &bad) const;
 
@@ -78,6 +81,36 @@ namespace Crypto {
        * Destructor
        */
       virtual ~OnionEncryptor() {}
+
+    protected:
+      /**
+       * A multiset of cleartexts, mapping each to its number of occurrences
+       */
+      typedef QHash<QByteArray, int> CleartextIndex;
+
+      /**
+       * Returns an index over the cleartexts
+       * @param cleartext the unencrypted data
+       */
+      static CleartextIndex IndexCleartext(const QVector<QByteArray> &cleartext);
+
+      /**
+       * Removes one occurrence of a decrypted ciphertext from the index,
+       * returns false if there was none left
+       * @param index the cleartext index
+       * @param decrypted the decrypted ciphertext
+       */
+      static bool TakeCleartext(CleartextIndex &index, const QByteArray &decrypted);
+
+      /**
+       * Checks that the bounds of onion and bad are consistent with keys,
+       * resizing bad if necessary, returns false if the onion is malformed
+       * @param keys keys used for verification
+       * @param onion the set of onion data
+       * @param bad the bad key indexes
+       */
+      static bool CheckLayers(const QVector<QSharedPointer<AsymmetricKey> > &keys,
+          const QVector<QVector<QByteArray> > &onion, QBitArray &bad);
   };
 }
 }
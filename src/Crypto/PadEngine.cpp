@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <QThreadPool>
+#include <QtConcurrentMap>
+
+#include "Utils/Utils.hpp"
+#include "PadEngine.hpp"
+
+namespace Dissent {
+namespace Crypto {
+  namespace {
+    /**
+     * A range of pads to be accumulated into a single buffer
+     */
+    struct PadRange {
+      const QVector<QSharedPointer<PadGenerator> > *generators;
+      int start;
+      int end;
+      int tile_size;
+      char *output;
+      int length;
+      QVector<char *> pads;
+    };
+
+    /**
+     * XORs the pads in [start, end) into output, one tile at a time.  If pads
+     * is non-empty, each pad is also written into pads[idx - start].
+     */
+    void AccumulateRange(PadRange &range)
+    {
+      for(int offset = 0; offset < range.length; offset += range.tile_size) {
+        int tile = std::min(range.tile_size, range.length - offset);
+        for(int idx = range.start; idx < range.end; idx++) {
+          // Read only access, so that ranges never detach the shared vector
+          PadGenerator *generator = range.generators->at(idx).data();
+          if(range.pads.isEmpty()) {
+            generator->XorPad(range.output + offset, tile);
+          } else {
+            char *pad = range.pads[idx - range.start] + offset;
+            generator->XorPad(pad, tile);
+            Utils::Xor(range.output + offset, pad, tile);
+          }
+        }
+      }
+    }
+
+    /**
+     * Prepares pads to receive a copy of every pad and returns a pointer to
+     * each, so they can be written concurrently
+     */
+    QVector<char *> PreparePads(QVector<QByteArray> &pads, int count, int length)
+    {
+      pads.clear();
+      pads.fill(QByteArray(length, 0), count);
+      QVector<char *> pad_data(count);
+      for(int idx = 0; idx < count; idx++) {
+        pad_data[idx] = pads[idx].data();
+      }
+      return pad_data;
+    }
+  }
+
+  PadEngine::PadEngine(PadGenerator::Mode mode, int tile_size) :
+    m_mode(mode)
+  {
+    int block = PadGenerator::BlockSize();
+    m_tile_size = std::max(block, (tile_size / block) * block);
+  }
+
+  void PadEngine::Accumulate(QByteArray &output)
+  {
+    PadRange range = { &m_pads, 0, m_pads.size(), m_tile_size,
+      output.data(), output.size(), QVector<char *>() };
+    AccumulateRange(range);
+  }
+
+  void PadEngine::Accumulate(QByteArray &output, QVector<QByteArray> &pads)
+  {
+    PadRange range = { &m_pads, 0, m_pads.size(), m_tile_size,
+      output.data(), output.size(),
+      PreparePads(pads, m_pads.size(), output.size()) };
+    AccumulateRange(range);
+  }
+
+  void PadEngine::ParallelAccumulate(QByteArray &output)
+  {
+    ParallelAccumulate(output, static_cast<QVector<QByteArray> *>(0));
+  }
+
+  void PadEngine::ParallelAccumulate(QByteArray &output, QVector<QByteArray> &pads)
+  {
+    ParallelAccumulate(output, &pads);
+  }
+
+  void PadEngine::ParallelAccumulate(QByteArray &output, QVector<QByteArray> *pads)
+  {
+    int parts = std::min(QThreadPool::globalInstance()->maxThreadCount(),
+        m_pads.size());
+
+    if(!Utils::MultiThreading || parts < 2) {
+      if(pads) {
+        Accumulate(output, *pads);
+      } else {
+        Accumulate(output);
+      }
+      return;
+    }
+
+    int length = output.size();
+    QVector<char *> pad_data;
+    if(pads) {
+      pad_data = PreparePads(*pads, m_pads.size(), length);
+    }
+
+    // The first range accumulates directly into output
+    QVector<QByteArray> partials(parts - 1, QByteArray(length, 0));
+    QList<PadRange> ranges;
+    for(int part = 0; part < parts; part++) {
+      int start = (m_pads.size() * part) / parts;
+      int end = (m_pads.size() * (part + 1)) / parts;
+      char *buffer = part == 0 ? output.data() : partials[part - 1].data();
+
+      PadRange range = { &m_pads, start, end, m_tile_size, buffer, length,
+        pads ? pad_data.mid(start, end - start) : QVector<char *>() };
+      ranges.append(range);
+    }
+
+    QtConcurrent::blockingMap(ranges, AccumulateRange);
+
+    foreach(const QByteArray &partial, partials) {
+      Utils::Xor(output.data(), partial.constData(), length);
+    }
+  }
+}
+}
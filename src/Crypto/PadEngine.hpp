@@ -0,0 +1,106 @@
+#ifndef DISSENT_CRYPTO_PAD_ENGINE_H_GUARD
+#define DISSENT_CRYPTO_PAD_ENGINE_H_GUARD
+
+#include <QByteArray>
+#include <QSharedPointer>
+#include <QVector>
+
+#include "PadGenerator.hpp"
+
+namespace Dissent {
+namespace Crypto {
+  /**
+   * Expands many DC-net pads and XOR-accumulates them into a single buffer.
+   * The buffer is processed in cache-sized tiles: every pad is XORed into a
+   * tile before moving onto the next tile, so a server with thousands of
+   * clients makes one pass over the ciphertext rather than one per client.
+   */
+  class PadEngine {
+    public:
+      /**
+       * Size of a tile in bytes, chosen to remain resident in L1 / L2 cache
+       */
+      static const int DEFAULT_TILE_SIZE = 16384;
+
+      /**
+       * Constructor
+       * @param mode the keystream used by the pads
+       * @param tile_size the number of bytes processed per tile, rounded to
+       * a multiple of the PadGenerator block size
+       */
+      explicit PadEngine(PadGenerator::Mode mode = PadGenerator::COMPATIBLE,
+          int tile_size = DEFAULT_TILE_SIZE);
+
+      /**
+       * Adds another pad to the engine
+       * @param seed the seed for the pad
+       */
+      void AddSeed(const QByteArray &seed)
+      {
+        m_pads.append(QSharedPointer<PadGenerator>(
+              new PadGenerator(seed, m_mode)));
+      }
+
+      /**
+       * Removes all pads
+       */
+      void Clear() { m_pads.clear(); }
+
+      /**
+       * Returns the number of pads
+       */
+      int Count() const { return m_pads.size(); }
+
+      /**
+       * Returns the keystream used by the pads
+       */
+      PadGenerator::Mode GetMode() const { return m_mode; }
+
+      /**
+       * Returns the number of bytes processed per tile
+       */
+      int GetTileSize() const { return m_tile_size; }
+
+      /**
+       * XORs the next output.size() bytes of every pad into output
+       * @param output the buffer to accumulate into
+       */
+      void Accumulate(QByteArray &output);
+
+      /**
+       * XORs the next output.size() bytes of every pad into output and
+       * returns a copy of each individual pad, indexed in the order the seeds
+       * were added
+       * @param output the buffer to accumulate into
+       * @param pads returns the individual pads
+       */
+      void Accumulate(QByteArray &output, QVector<QByteArray> &pads);
+
+      /**
+       * Same as Accumulate, but partitions the pads into ranges, each
+       * accumulated into its own buffer on the global thread pool, and then
+       * XORs the partial results into output
+       * @param output the buffer to accumulate into
+       */
+      void ParallelAccumulate(QByteArray &output);
+
+      /**
+       * Same as Accumulate, but partitions the pads into ranges, each
+       * accumulated into its own buffer on the global thread pool, and then
+       * XORs the partial results into output
+       * @param output the buffer to accumulate into
+       * @param pads returns the individual pads
+       */
+      void ParallelAccumulate(QByteArray &output, QVector<QByteArray> &pads);
+
+    private:
+      void ParallelAccumulate(QByteArray &output, QVector<QByteArray> *pads);
+
+      PadGenerator::Mode m_mode;
+      int m_tile_size;
+      QVector<QSharedPointer<PadGenerator> > m_pads;
+  };
+}
+}
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef DISSENT_CRYPTO_PAD_GENERATOR_H_GUARD
+#define DISSENT_CRYPTO_PAD_GENERATOR_H_GUARD
+
+#include <QByteArray>
+#include <QSharedData>
+
+namespace Dissent {
+namespace Crypto {
+  class IPadGeneratorImpl : public QSharedData {
+    public:
+      virtual ~IPadGeneratorImpl() {}
+      virtual void XorPad(char *data, int length) = 0;
+      virtual char GetByte(int offset) = 0;
+  };
+
+  /**
+   * Produces the deterministic keystream (pad) shared between a DC-net
+   * client and server.  Rather than returning the pad, the pad is XORed
+   * into a caller supplied buffer, so that many pads can be accumulated
+   * into a single ciphertext without temporary copies.
+   */
+  class PadGenerator {
+    public:
+      /**
+       * The keystream used to produce pads
+       */
+      enum Mode {
+        /**
+         * Byte compatible with CryptoRandom(seed).GenerateBlock, an X9.17 RNG
+         * producing one AES block at a time
+         */
+        COMPATIBLE = 0,
+        /**
+         * AES in counter mode keyed by the seed, this lets the underlying
+         * library pipeline (and use AES-NI for) many blocks at once
+         */
+        AES_CTR
+      };
+
+      /**
+       * Constructor
+       * @param seed the seed for the pad
+       * @param mode the keystream to use
+       */
+      explicit PadGenerator(const QByteArray &seed, Mode mode = COMPATIBLE);
+
+      /**
+       * Returns the size of the underlying cipher block.  In COMPATIBLE mode,
+       * consecutive calls to XorPad continue the same stream only if the
+       * length of each call but the last is a multiple of the block size,
+       * exactly like CryptoRandom::GenerateBlock.
+       */
+      static int BlockSize();
+
+      /**
+       * XORs the next length bytes of the pad into data
+       * @param data the buffer to XOR the pad into
+       * @param length the number of bytes to XOR
+       */
+      void XorPad(char *data, int length) { m_data->XorPad(data, length); }
+
+      /**
+       * XORs the next data.size() bytes of the pad into data
+       * @param data the buffer to XOR the pad into
+       */
+      void XorPad(QByteArray &data) { XorPad(data.data(), data.size()); }
+
+      /**
+       * Returns the byte at offset from the start of the pad, without
+       * affecting the position used by XorPad.  This is constant time in
+       * AES_CTR mode, COMPATIBLE mode regenerates the bytes before offset.
+       * @param offset the position of the byte within the pad
+       */
+      char GetByte(int offset) { return m_data->GetByte(offset); }
+
+      /**
+       * Returns the next length bytes of the pad
+       * @param length the number of bytes to return
+       */
+      QByteArray GeneratePad(int length)
+      {
+        QByteArray pad(length, 0);
+        XorPad(pad);
+        return pad;
+      }
+
+      Mode GetMode() const { return m_mode; }
+
+    private:
+      Mode m_mode;
+      QExplicitlySharedDataPointer<IPadGeneratorImpl> m_data;
+  };
+}
+}
+
+#endif
@@ -1,5 +1,6 @@
 #include "ThreadedOnionEncryptor.hpp"
 #include <qcoreapplication.h>
+#include <QPair>
 #include <QtConcurrentMap>
 
 namespace Dissent {
@@ -20,6 +21,29 @@ namespace Crypto {
 
       const QSharedPointer<AsymmetricKey> _key;
     };
+
+    /**
+     * Decrypts the element of an onion layer named by a (key, element)
+     * pair, so that all layers can share one QtConcurrent map
+     */
+    struct LayerDecryptor {
+      LayerDecryptor(const QVector<QSharedPointer<AsymmetricKey> > &keys,
+          const QVector<QVector<QByteArray> > &onion) :
+        _keys(keys), _onion(onion)
+      {
+      }
+
+      typedef QByteArray result_type;
+
+      QByteArray operator()(const QPair<int, int> &element) const
+      {
+        return _keys[element.first]->Decrypt(
+            _onion[element.first + 1][element.second]);
+      }
+
+      const QVector<QSharedPointer<AsymmetricKey> > &_keys;
+      const QVector<QVector<QByteArray> > &_onion;
+    };
   }
 
   bool ThreadedOnionEncryptor::Decrypt(const QSharedPointer<AsymmetricKey> &key,
@@ -48,5 +72,57 @@ namespace Crypto {
     }
     return res;
   }
+
+  bool ThreadedOnionEncryptor::VerifyOne(const QSharedPointer<AsymmetricKey> &key,
+      const QVector<QByteArray> &cleartext,
+      const QVector<QByteArray> &ciphertext) const
+  {
+    QVector<QByteArray> decrypted = QtConcurrent::blockingMapped<QVector<QByteArray> >(
+        ciphertext, Decryptor(key));
+
+    CleartextIndex index = IndexCleartext(cleartext);
+    foreach(const QByteArray &data, decrypted) {
+      if(!TakeCleartext(index, data)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool ThreadedOnionEncryptor::VerifyAll(
+      const QVector<QSharedPointer<AsymmetricKey> > &keys,
+      const QVector<QVector<QByteArray> > &onion, QBitArray &bad) const
+  {
+    if(!CheckLayers(keys, onion, bad)) {
+      return false;
+    }
+
+    QVector<QPair<int, int> > elements;
+    for(int idx = 0; idx < keys.count(); idx++) {
+      for(int jdx = 0; jdx < onion[idx + 1].count(); jdx++) {
+        elements.append(QPair<int, int>(idx, jdx));
+      }
+    }
+
+    QVector<QByteArray> decrypted = QtConcurrent::blockingMapped<QVector<QByteArray> >(
+        elements, LayerDecryptor(keys, onion));
+
+    bool res = true;
+    int offset = 0;
+    for(int idx = 0; idx < keys.count(); idx++) {
+      CleartextIndex index = IndexCleartext(onion[idx]);
+      int count = onion[idx + 1].count();
+      for(int jdx = offset; jdx < offset + count; jdx++) {
+        if(!TakeCleartext(index, decrypted[jdx])) {
+          bad[idx] = true;
+          res = false;
+          break;
+        }
+      }
+      offset += count;
+    }
+
+    return res;
+  }
 }
 }
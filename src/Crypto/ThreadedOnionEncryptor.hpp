@@ -10,7 +10,9 @@
 namespace Dissent {
 namespace Crypto {
   /**
-   * Provides a multithreaded tool around onion encrypting messages
+   * Provides a multithreaded tool around onion encrypting messages.
+   * Verification decrypts every element of every layer across the thread
+   * pool before matching each layer against its cleartext index.
    */
   class ThreadedOnionEncryptor : public QObject, public OnionEncryptor {
     public:
@@ -26,6 +28,30 @@ namespace Crypto {
           const QVector<QByteArray> &ciphertext,
           QVector<QByteArray> &cleartext, QVector<int> *bad) const;
 
+      /**
+       * Verifies that the ciphertext and cleartext match, returning true
+       * if that is the case, false otherwise
+       * @param key the key used for verification
+       * @param cleartext the unencrypted data
+       * @param ciphertext the encrypted data
+       */
+      virtual bool VerifyOne(const QSharedPointer<AsymmetricKey> &key,
+          const QVector<QByteArray> &cleartext,
+          const QVector<QByteArray> &ciphertext) const;
+
+      /**
+       * Like Verify one, but checks against a set of keys and returns the
+       * indexes of the bad blocks in the bad array, though only if it
+       * returns false
+       * @param keys keys used for verification
+       * @param onion the set of onion data with the 0th index being the least
+       * encrypted and the maximum index being the most encrypted
+       * @param bad indexes are set if the key had issue decrypting
+       */
+      virtual bool VerifyAll(const QVector<QSharedPointer<AsymmetricKey> > &keys,
+          const QVector<QVector<QByteArray> > &onion,
+          QBitArray &bad) const;
+
       /**
        * Destructor
        */
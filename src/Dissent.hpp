@@ -9,6 +9,7 @@
 #include "Anonymity/NullRound.hpp"
 #include "Anonymity/Round.hpp"
 #include "Anonymity/RoundFactory.hpp"
+#include "Anonymity/SlotSender.hpp"
 
 #include "Applications/CommandLine.hpp"
 #include "Applications/ConsoleSink.hpp"
@@ -37,11 +38,15 @@
 #include "Crypto/DiffieHellman.hpp"
 #include "Crypto/Hash.hpp"
 #include "Crypto/Integer.hpp"
+#include "Crypto/KeyPool.hpp"
 #include "Crypto/KeyShare.hpp"
 #include "Crypto/LRSPrivateKey.hpp"
 #include "Crypto/LRSPublicKey.hpp"
 #include "Crypto/LRSSignature.hpp"
+#include "Crypto/MultiExponentiation.hpp"
 #include "Crypto/OnionEncryptor.hpp"
+#include "Crypto/PadEngine.hpp"
+#include "Crypto/PadGenerator.hpp"
 #include "Crypto/Serialization.hpp"
 #include "Crypto/ThreadedOnionEncryptor.hpp"
 #include "Crypto/Utils.hpp"
@@ -54,6 +59,7 @@
 #include "Crypto/AbstractGroup/AbstractGroup.hpp"
 #include "Crypto/AbstractGroup/ECParams.hpp"
 #include "Crypto/AbstractGroup/IntegerElementData.hpp"
+#include "Crypto/AbstractGroup/PrecomputedBase.hpp"
 
 #include "Crypto/BlogDrop/PublicKey.hpp"
 #include "Crypto/BlogDrop/Parameters.hpp"
@@ -103,6 +109,8 @@
 #include "Session/ClientRegister.hpp"
 #include "Session/ClientSession.hpp"
 #include "Session/ClientStates.hpp"
+#include "Session/DataAssembler.hpp"
+#include "Session/DataQueue.hpp"
 #include "Session/SerializeList.hpp"
 #include "Session/ServerAgree.hpp"
 #include "Session/ServerEnlist.hpp"
@@ -130,10 +138,21 @@
 #include "Transports/EdgeFactory.hpp"
 #include "Transports/EdgeListener.hpp"
 #include "Transports/EdgeListenerFactory.hpp"
+#include "Transports/EpollAddress.hpp"
+#include "Transports/EpollEdge.hpp"
+#include "Transports/EpollEdgeListener.hpp"
+#include "Transports/EpollReactor.hpp"
+#include "Transports/FrameReader.hpp"
+#include "Transports/FrameWriter.hpp"
 #include "Transports/TcpAddress.hpp"
 #include "Transports/TcpEdge.hpp"
 #include "Transports/TcpEdgeListener.hpp"
+#include "Transports/UdpAddress.hpp"
+#include "Transports/UdpEdge.hpp"
+#include "Transports/UdpEdgeListener.hpp"
+#include "Transports/UdpSession.hpp"
 
+#include "Utils/DnsCache.hpp"
 #include "Utils/Logging.hpp"
 #include "Utils/QRunTimeError.hpp"
 #include "Utils/Random.hpp"
@@ -146,8 +165,10 @@
 #include "Utils/Timer.hpp"
 #include "Utils/TimerCallback.hpp"
 #include "Utils/TimerEvent.hpp"
+#include "Utils/TraceRing.hpp"
 #include "Utils/Triggerable.hpp"
 #include "Utils/Triple.hpp"
+#include "Utils/TunnelScheduler.hpp"
 #include "Utils/Utils.hpp"
 
 #include "Web/EchoService.hpp"
@@ -12,10 +12,7 @@ namespace Identity {
 
   int Roster::GetIndex(const Connections::Id &id) const
   {
-    if(!Contains(id)) {
-      return -1;
-    }
-    return m_id_to_int[id];
+    return m_id_to_int.value(id, -1);
   }
 
   Connections::Id Roster::GetId(int index) const
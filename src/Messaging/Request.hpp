@@ -20,14 +20,17 @@ namespace Messaging {
        * @param responder a callback object for the response
        * @param from the sender of the request
        * @param container the information about the request
+       * @param binary the request arrived in the binary format
        */
       Request(const QSharedPointer<RequestResponder> &responder =
             QSharedPointer<RequestResponder>(),
           const QSharedPointer<ISender> &from = QSharedPointer<ISender>(),
-          const QVariantList &container = QVariantList()) :
+          const QVariantList &container = QVariantList(),
+          bool binary = false) :
         _responder(responder),
         _from(from),
-        _container(container)
+        _container(container),
+        _binary(binary)
       {
         while(_container.size() < 4) {
           _container.append(QVariant());
@@ -82,6 +85,11 @@ namespace Messaging {
        */
       inline QVariant GetData() const { return _container.at(3); };
 
+      /**
+       * Arrived in the binary format, the response will use it as well
+       */
+      inline bool IsBinary() const { return _binary; }
+
       /**
        * Respond to the request
        */
@@ -106,6 +114,7 @@ namespace Messaging {
       QSharedPointer<RequestResponder> _responder;
       QSharedPointer<ISender> _from;
       QVariantList _container;
+      bool _binary;
   };
 }
 }
@@ -1,19 +1,32 @@
 #include <QDataStream>
 #include <QVariant>
 
+#include "Utils/Logging.hpp"
+#include "Utils/Serialization.hpp"
 #include "Utils/Time.hpp"
 #include "Utils/Timer.hpp"
+#include "Utils/TraceRing.hpp"
 
 #include "RpcHandler.hpp"
 
+using Dissent::Utils::Serialization;
+
 namespace Dissent {
 namespace Messaging {
+  namespace {
+    /**
+     * The payload is a serialized QVariant rather than raw bytes
+     */
+    const int VARIANT_PAYLOAD = 0x01;
+  }
+
   const QString Request::NotificationType = QString("n");
   const QString Request::RequestType = QString("r");
   const QString Response::ResponseType = QString("p");
 
   RpcHandler::RpcHandler() :
     _current_id(1),
+    _binary(false),
     _responder(new RequestResponder())
   {
     QObject::connect(_responder.data(),
@@ -52,6 +65,13 @@ namespace Messaging {
   void RpcHandler::HandleData(const QSharedPointer<ISender> &from,
       const QByteArray &data)
   {
+    if(data.size() >= BinaryHeaderSize &&
+        static_cast<unsigned char>(data[0]) == BinaryMagic)
+    {
+      HandleBinary(from, data);
+      return;
+    }
+
     QVariantList container;
     QDataStream stream(data);
     stream >> container;
@@ -70,7 +90,8 @@ namespace Messaging {
     if(type == Request::RequestType ||
         type == Request::NotificationType)
     {
-      HandleRequest(Request(_responder, from, container));
+      HandleRequest(Request(_responder, from, container),
+          _callbacks.value(container.value(2).toString()));
     } else if(type == Response::ResponseType) {
       HandleResponse(Response(from, container));
     } else {
@@ -78,7 +99,57 @@ namespace Messaging {
     }
   }
 
-  void RpcHandler::HandleRequest(const Request &request)
+  void RpcHandler::HandleBinary(const QSharedPointer<ISender> &from,
+      const QByteArray &data)
+  {
+    int type = static_cast<unsigned char>(data[1]);
+    int flags = static_cast<unsigned char>(data[2]);
+    int id = Serialization::ReadInt(data, 4);
+    quint32 field = quint32(Serialization::ReadInt(data, 8));
+
+    QVariant payload;
+    if(flags & VARIANT_PAYLOAD) {
+      QByteArray serialized = QByteArray::fromRawData(
+          data.constData() + BinaryHeaderSize, data.size() - BinaryHeaderSize);
+      QDataStream stream(serialized);
+      stream >> payload;
+    } else {
+      payload = data.mid(BinaryHeaderSize);
+    }
+
+    switch(type) {
+      case BinaryNotification:
+      case BinaryRequest:
+      {
+        QString method = _id_names.value(field, "#" + QString::number(field));
+        QVariantList container;
+        container.append(type == BinaryRequest ?
+            Request::RequestType : Request::NotificationType);
+        container.append(id);
+        container.append(method);
+        container.append(payload);
+        HandleRequest(Request(_responder, from, container, true),
+            _id_callbacks.value(field));
+        break;
+      }
+      case BinaryResponse:
+        HandleResponse(Response(from, Response::Build(id, payload)));
+        break;
+      case BinaryFailed:
+      {
+        QVariantList failure = payload.toList();
+        HandleResponse(Response(from, Response::Failed(id,
+                static_cast<Response::ErrorTypes>(field),
+                failure.value(0).toString(), failure.value(1))));
+        break;
+      }
+      default:
+        qDebug() << "Received an unknown binary Rpc type:" << type;
+    }
+  }
+
+  void RpcHandler::HandleRequest(const Request &request,
+      const QSharedPointer<RequestHandler> &cb)
   {
     int id = request.GetId();
     if(id <= 0) {
@@ -88,7 +159,6 @@ namespace Messaging {
     }
 
     QString method = request.GetMethod();
-    QSharedPointer<RequestHandler> cb = _callbacks[method];
     if(cb.isNull()) {
       qDebug() << "RpcHandler: Request: No such method: " << method <<
         ", from: " << request.GetFrom()->ToString();
@@ -97,8 +167,9 @@ namespace Messaging {
       return;
     }
 
-    qDebug() << "RpcHandler: Request " << request.GetId()  << "Method:" <<
-      method << ", from:" << request.GetFrom()->ToString();
+    DISSENT_TRACE_EVENT(RPC_HANDLE_REQUEST, request.GetId(), 0);
+    DISSENT_LOG(LOG_TRACE) << "RpcHandler: Request " << request.GetId() <<
+      "Method:" << method << ", from:" << request.GetFrom()->ToString();
     cb->MakeRequest(request);
 #ifdef RESPOND_NOTIFICATION
     if(request.GetType() == Request::NotificationType) {
@@ -148,14 +219,13 @@ namespace Messaging {
       const QString &method, const QVariant &data)
   {
     int id = IncrementId();
-    QVariantList container = Request::BuildNotification(id, method, data);
-
-    QByteArray msg;
-    QDataStream stream(&msg, QIODevice::WriteOnly);
-    stream << container;
+    QByteArray msg = _binary ?
+      EncodeBinary(BinaryNotification, id, MethodId(method), data) :
+      Serialize(Request::BuildNotification(id, method, data));
 
-    qDebug() << "RpcHandler: Sending notification" << id << "for" << method <<
-      "to" << to->ToString();
+    DISSENT_TRACE_EVENT(RPC_NOTIFICATION, id, msg.size());
+    DISSENT_LOG(LOG_TRACE) << "RpcHandler: Sending notification" << id <<
+      "for" << method << "to" << to->ToString();
     to->Send(msg);
   }
 
@@ -172,24 +242,22 @@ namespace Messaging {
 
     _requests[id] = QSharedPointer<RequestState>(
         new RequestState(to, cb, ctime, timer, timeout));
-    QVariantList container = Request::BuildRequest(id, method, data);
-
-    QByteArray msg;
-    QDataStream stream(&msg, QIODevice::WriteOnly);
-    stream << container;
-    qDebug() << "RpcHandler: Sending request" << id << "for" << method <<
-      "to" << to->ToString();
+    QByteArray msg = _binary ?
+      EncodeBinary(BinaryRequest, id, MethodId(method), data) :
+      Serialize(Request::BuildRequest(id, method, data));
+    DISSENT_TRACE_EVENT(RPC_REQUEST, id, msg.size());
+    DISSENT_LOG(LOG_TRACE) << "RpcHandler: Sending request" << id <<
+      "for" << method << "to" << to->ToString();
     to->Send(msg);
     return id;
   }
 
   void RpcHandler::SendResponse(const Request &request, const QVariant &data)
   {
-    QVariantList container = Response::Build(request.GetId(), data);
-    QByteArray msg;
-    QDataStream stream(&msg, QIODevice::WriteOnly);
-    stream << container;
-    qDebug() << "RpcHandler: Sending response" << request.GetId() <<
+    QByteArray msg = request.IsBinary() ?
+      EncodeBinary(BinaryResponse, request.GetId(), 0, data) :
+      Serialize(Response::Build(request.GetId(), data));
+    DISSENT_LOG(LOG_TRACE) << "RpcHandler: Sending response" << request.GetId() <<
       "to" << request.GetFrom()->ToString();
     request.GetFrom()->Send(msg);
   }
@@ -198,11 +266,16 @@ namespace Messaging {
       Response::ErrorTypes error, const QString &reason,
       const QVariant &error_data)
   {
-    QVariantList container = Response::Failed(request.GetId(), error,
-        reason, error_data);
     QByteArray msg;
-    QDataStream stream(&msg, QIODevice::WriteOnly);
-    stream << container;
+    if(request.IsBinary()) {
+      QVariantList failure;
+      failure.append(reason);
+      failure.append(error_data);
+      msg = EncodeBinary(BinaryFailed, request.GetId(), error, failure);
+    } else {
+      msg = Serialize(Response::Failed(request.GetId(), error, reason,
+            error_data));
+    }
     qDebug() << "RpcHandler: Sending failed response" << request.GetId() <<
       "to" << request.GetFrom()->ToString();
     request.GetFrom()->Send(msg);
@@ -213,17 +286,72 @@ namespace Messaging {
     return _current_id++;
   }
 
-  bool RpcHandler::Register(const QString &name,
+  quint32 RpcHandler::MethodId(const QString &name)
+  {
+    // FNV-1a, stable across platforms and Qt versions unlike qHash
+    QByteArray bytes = name.toUtf8();
+    quint32 hash = 2166136261u;
+    for(int idx = 0; idx < bytes.size(); idx++) {
+      hash ^= static_cast<unsigned char>(bytes[idx]);
+      hash *= 16777619u;
+    }
+    return hash;
+  }
+
+  QByteArray RpcHandler::Serialize(const QVariantList &container)
+  {
+    QByteArray msg;
+    QDataStream stream(&msg, QIODevice::WriteOnly);
+    stream << container;
+    return msg;
+  }
+
+  QByteArray RpcHandler::EncodeBinary(int type, int id, quint32 field,
+      const QVariant &data)
+  {
+    QByteArray msg(BinaryHeaderSize, 0);
+    msg[0] = char(BinaryMagic);
+    msg[1] = char(type);
+    Serialization::WriteInt(id, msg, 4);
+    Serialization::WriteUInt(field, msg, 8);
+
+    if(data.type() == QVariant::ByteArray) {
+      msg.append(data.toByteArray());
+    } else {
+      msg[2] = char(VARIANT_PAYLOAD);
+      QDataStream stream(&msg, QIODevice::WriteOnly);
+      stream.device()->seek(BinaryHeaderSize);
+      stream << data;
+    }
+    return msg;
+  }
+
+  bool RpcHandler::AddCallback(const QString &name,
       const QSharedPointer<RequestHandler> &cb)
   {
     if(_callbacks.contains(name)) {
       return false;
     }
 
+    quint32 id = MethodId(name);
+    if(_id_callbacks.contains(id)) {
+      qWarning() << "RpcHandler: Method" << name << "has the same id as" <<
+        _id_names[id];
+      return false;
+    }
+
     _callbacks[name] = cb;
+    _id_callbacks[id] = cb;
+    _id_names[id] = name;
     return true;
   }
 
+  bool RpcHandler::Register(const QString &name,
+      const QSharedPointer<RequestHandler> &cb)
+  {
+    return AddCallback(name, cb);
+  }
+
   bool RpcHandler::Register(const QString &name, const QObject *obj,
       const char *method)
   {
@@ -231,9 +359,8 @@ namespace Messaging {
       return false;
     }
 
-    _callbacks[name] =
-      QSharedPointer<RequestHandler>(new RequestHandler(obj, method));
-    return true;
+    return AddCallback(name,
+        QSharedPointer<RequestHandler>(new RequestHandler(obj, method)));
   }
 
   bool RpcHandler::Unregister(const QString &name)
@@ -244,6 +371,9 @@ namespace Messaging {
     }
 
     _callbacks.remove(name);
+    quint32 id = MethodId(name);
+    _id_callbacks.remove(id);
+    _id_names.remove(id);
     return true;
   }
 }
@@ -24,7 +24,18 @@ namespace Messaging {
   class RequestState;
 
   /**
-   * Rpc mechanism assumes a reliable sending mechanism
+   * Rpc mechanism assumes a reliable sending mechanism.
+   *
+   * Messages are either a serialized QVariantList or, when the binary format
+   * is enabled, a binary frame with a fixed header:
+   *   magic (1), type (1), flags (1), reserved (1), id (4),
+   *   method id or error type (4)
+   * followed by the payload.  A QByteArray payload is carried as is, any
+   * other QVariant is serialized.  Method ids are derived from the method
+   * name, so both ends agree on them without exchanging names, and
+   * registering a name whose id collides with that of another is refused.
+   * Both formats are always accepted and responses use the format of the
+   * request.
    */
   class RpcHandler : public ISinkObject {
     Q_OBJECT
@@ -33,6 +44,20 @@ namespace Messaging {
       typedef Utils::TimerMethod<RpcHandler, int> TimerCallback;
       static const int TimeoutDelta = 60000;
 
+      /**
+       * The first byte of a binary frame, a serialized QVariantList begins
+       * with the high byte of its length, which is zero
+       */
+      static const int BinaryMagic = 0xDB;
+      static const int BinaryHeaderSize = 12;
+
+      enum BinaryType {
+        BinaryNotification = 1,
+        BinaryRequest = 2,
+        BinaryResponse = 3,
+        BinaryFailed = 4
+      };
+
       inline static QSharedPointer<RpcHandler> GetEmpty()
       {
         static QSharedPointer<RpcHandler> handler(new RpcHandler());
@@ -65,6 +90,25 @@ namespace Messaging {
       void HandleData(const QSharedPointer<ISender> &from,
           const QVariantList &container);
 
+      /**
+       * Returns the id carried in binary frames for a method
+       * @param name the method name
+       */
+      static quint32 MethodId(const QString &name);
+
+      /**
+       * Send outgoing notifications and requests in the binary format,
+       * should only be enabled when all peers accept it
+       * @param binary true to send the binary format
+       */
+      void SetBinaryFormat(bool binary) { _binary = binary; }
+
+      /**
+       * Returns true if outgoing notifications and requests use the binary
+       * format
+       */
+      bool UsesBinaryFormat() const { return _binary; }
+
       /**
        * Send a request
        * @param to the destination for the notification
@@ -144,11 +188,21 @@ namespace Messaging {
       void StartTimer();
       void Timeout(const int &);
 
+      /**
+       * Handle an incoming binary frame
+       * @param from a return path to the requestor
+       * @param data the frame
+       */
+      void HandleBinary(const QSharedPointer<ISender> &from,
+          const QByteArray &data);
+
       /**
        * Handle an incoming request
        * @param request the request
+       * @param cb the handler registered for the method, if any
        */
-      void HandleRequest(const Request &request);
+      void HandleRequest(const Request &request,
+          const QSharedPointer<RequestHandler> &cb);
 
       /**
        * Handle an incoming response
@@ -161,11 +215,35 @@ namespace Messaging {
        */
       inline int IncrementId();
 
+      /**
+       * Returns a container serialized in the QVariantList format
+       */
+      static QByteArray Serialize(const QVariantList &container);
+
+      /**
+       * Returns a binary frame
+       * @param type the BinaryType
+       * @param id the request id
+       * @param field the method id or error type
+       * @param data the payload
+       */
+      static QByteArray EncodeBinary(int type, int id, quint32 field,
+          const QVariant &data);
+
+      bool AddCallback(const QString &name,
+          const QSharedPointer<RequestHandler> &cb);
+
       /**
        * Maps a string to a method to call
        */
       QHash<QString, QSharedPointer<RequestHandler> > _callbacks;
 
+      /**
+       * Maps a method id to a method to call and its name
+       */
+      QHash<quint32, QSharedPointer<RequestHandler> > _id_callbacks;
+      QHash<quint32, QString> _id_names;
+
       /**
        * Maps id to a callback method to handle responses
        */
@@ -176,6 +254,11 @@ namespace Messaging {
        */
       int _current_id;
 
+      /**
+       * Send notifications and requests in the binary format
+       */
+      bool _binary;
+
       /**
        * Used to asynchronously respond to requests
        */
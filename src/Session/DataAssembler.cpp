@@ -0,0 +1,128 @@
+#include <QDebug>
+
+#include "Utils/Serialization.hpp"
+
+#include "DataAssembler.hpp"
+#include "DataQueue.hpp"
+
+using Dissent::Utils::Serialization;
+
+namespace Dissent {
+namespace Session {
+  DataAssembler::DataAssembler() :
+    m_dropped(0)
+  {
+  }
+
+  QList<QByteArray> DataAssembler::Unpack(const QByteArray &data, int slot)
+  {
+    QList<QByteArray> messages;
+    int offset = 0;
+    while(offset < data.size()) {
+      int type = static_cast<unsigned char>(data[offset]);
+      if(type == DataQueue::Padding) {
+        break;
+      } else if(type != DataQueue::Whole && type != DataQueue::Fragment) {
+        qDebug() << "Unknown record type:" << type;
+        m_dropped++;
+        break;
+      }
+
+      int header = type == DataQueue::Whole ?
+        int(DataQueue::WHOLE_HEADER) : int(DataQueue::FRAGMENT_HEADER);
+      if(data.size() - offset < header) {
+        qDebug() << "Truncated record header";
+        m_dropped++;
+        break;
+      }
+
+      int length = Serialization::ReadInt(data, offset + 1);
+      if(length < 0 || data.size() - offset - header < length) {
+        qDebug() << "Invalid record length:" << length;
+        m_dropped++;
+        break;
+      }
+
+      const char *payload = data.constData() + offset + header;
+      if(type == DataQueue::Whole) {
+        messages.append(QByteArray(payload, length));
+      } else {
+        HandleFragment(Key(slot, Serialization::ReadInt(data, offset + 5)),
+            Serialization::ReadInt(data, offset + 9),
+            Serialization::ReadInt(data, offset + 13),
+            payload, length, messages);
+      }
+      offset += header + length;
+    }
+
+    return messages;
+  }
+
+  void DataAssembler::Clear()
+  {
+    m_dropped += m_partial.count();
+    m_partial.clear();
+    m_order.clear();
+  }
+
+  void DataAssembler::HandleFragment(const Key &key, int offset, int total,
+      const char *payload, int length, QList<QByteArray> &messages)
+  {
+    if(total <= 0 || total > MAX_MESSAGE_SIZE || offset < 0 ||
+        offset > total - length)
+    {
+      qDebug() << "Invalid fragment:" << offset << length << total;
+      m_dropped++;
+      return;
+    }
+
+    QHash<Key, Partial>::iterator it = m_partial.find(key);
+    if(it != m_partial.end() && it.value().total != total) {
+      // Another message with the same id
+      Remove(key);
+      m_dropped++;
+      it = m_partial.end();
+    }
+
+    if(it == m_partial.end()) {
+      if(offset != 0) {
+        // The beginning was missed, e.g., we joined in between, or was sent
+        // in another slot
+        return;
+      }
+
+      if(m_partial.count() >= MAX_PARTIAL) {
+        m_partial.remove(m_order.takeFirst());
+        m_dropped++;
+      }
+      it = m_partial.insert(key, Partial(total));
+      m_order.append(key);
+    }
+
+    Partial &partial = it.value();
+    int received = partial.data.size();
+    if(offset > received) {
+      qDebug() << "Missing fragment, abandoning message";
+      Remove(key);
+      m_dropped++;
+      return;
+    } else if(offset + length <= received) {
+      // Sent again after a failed round
+      return;
+    }
+
+    partial.data.append(payload + (received - offset),
+        offset + length - received);
+    if(partial.data.size() == total) {
+      messages.append(partial.data);
+      Remove(key);
+    }
+  }
+
+  void DataAssembler::Remove(const Key &key)
+  {
+    m_partial.remove(key);
+    m_order.removeOne(key);
+  }
+}
+}
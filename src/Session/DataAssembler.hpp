@@ -0,0 +1,76 @@
+#ifndef DISSENT_SESSION_DATA_ASSEMBLER_H_GUARD
+#define DISSENT_SESSION_DATA_ASSEMBLER_H_GUARD
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QPair>
+
+namespace Dissent {
+namespace Session {
+  /**
+   * Recovers the messages packed into slot messages by DataQueue.  Whole
+   * records are returned immediately, fragments are held until the rest of
+   * their message arrives.  Fragments sent again after a failed round are
+   * ignored, while a missing fragment abandons its message.  At most
+   * MAX_PARTIAL messages are held, beyond which the oldest is abandoned.
+   * Fragments are reassembled by slot and id, so a slot cannot add to a
+   * message sent in another slot even though the ids are public.
+   */
+  class DataAssembler {
+    public:
+      static const int MAX_PARTIAL = 256;
+      static const int MAX_MESSAGE_SIZE = 16 * 1024 * 1024;
+
+      /**
+       * Constructor
+       */
+      DataAssembler();
+
+      /**
+       * Parses a slot message, returns the messages completed by it
+       * @param data the slot message
+       * @param slot the slot that carried the message
+       */
+      QList<QByteArray> Unpack(const QByteArray &data, int slot);
+
+      /**
+       * Abandons the messages partially received, such as when the slots
+       * are reassigned
+       */
+      void Clear();
+
+      /**
+       * Returns the number of messages partially received
+       */
+      int Pending() const { return m_partial.count(); }
+
+      /**
+       * Returns the number of malformed records and abandoned messages
+       */
+      qint64 GetDropped() const { return m_dropped; }
+
+    private:
+      struct Partial {
+        explicit Partial(int total = 0) : total(total) {}
+
+        QByteArray data;
+        int total;
+      };
+
+      /* A message's slot and id */
+      typedef QPair<int, int> Key;
+
+      void HandleFragment(const Key &key, int offset, int total,
+          const char *payload, int length, QList<QByteArray> &messages);
+      void Remove(const Key &key);
+
+      QHash<Key, Partial> m_partial;
+      /* Partial messages, oldest first */
+      QList<Key> m_order;
+      qint64 m_dropped;
+  };
+}
+}
+
+#endif
@@ -0,0 +1,127 @@
+#include <cstring>
+
+#include "Crypto/CryptoRandom.hpp"
+#include "Utils/Serialization.hpp"
+
+#include "DataQueue.hpp"
+
+namespace Dissent {
+namespace Session {
+  DataQueue::DataQueue() :
+    m_queued_bytes(0),
+    m_offset(0),
+    m_trim(0),
+    m_trim_offset(0),
+    m_payload_bytes(0),
+    m_header_bytes(0),
+    m_fragments(0),
+    m_get_data(this, &DataQueue::GetData)
+  {
+  }
+
+  void DataQueue::AddData(const QByteArray &data)
+  {
+    if(data.isEmpty()) {
+      return;
+    }
+
+    m_queue.append(Entry(data, NewId()));
+    m_queued_bytes += data.size();
+  }
+
+  QPair<QByteArray, bool> DataQueue::GetData(int max)
+  {
+    Commit();
+
+    QByteArray data;
+    int idx = 0;
+    int offset = m_offset;
+    while(idx < m_queue.count()) {
+      const Entry &entry = m_queue[idx];
+      int remaining = entry.data.size() - offset;
+      int room = max - data.size();
+      int header = offset == 0 ? int(WHOLE_HEADER) : int(FRAGMENT_HEADER);
+
+      if(header + remaining <= room) {
+        AppendRecord(data, entry, offset, remaining);
+        offset = 0;
+        idx++;
+        continue;
+      }
+
+      // Fill the rest of the slot, unless only a sliver would fit
+      int length = room - FRAGMENT_HEADER;
+      if(length >= MIN_FRAGMENT || (data.isEmpty() && length > 0)) {
+        AppendRecord(data, entry, offset, length);
+        offset += length;
+      }
+      break;
+    }
+
+    m_trim = idx;
+    m_trim_offset = offset;
+
+    bool more = idx < m_queue.count();
+    return QPair<QByteArray, bool>(data, more);
+  }
+
+  void DataQueue::UnGet()
+  {
+    m_trim = 0;
+    m_trim_offset = m_offset;
+  }
+
+  void DataQueue::Restart()
+  {
+    Commit();
+    if(m_offset == 0) {
+      return;
+    }
+
+    m_offset = 0;
+    m_trim_offset = 0;
+    m_queue.first().id = NewId();
+  }
+
+  int DataQueue::NewId()
+  {
+    QByteArray id(4, 0);
+    Crypto::CryptoRandom::GetThreadInstance().GenerateBlock(id);
+    return Utils::Serialization::ReadInt(id, 0);
+  }
+
+  void DataQueue::Commit()
+  {
+    for(int idx = 0; idx < m_trim; idx++) {
+      m_queued_bytes -= m_queue.first().data.size();
+      m_queue.removeFirst();
+    }
+
+    m_offset = m_trim_offset;
+    m_trim = 0;
+  }
+
+  void DataQueue::AppendRecord(QByteArray &data, const Entry &entry,
+      int offset, int length)
+  {
+    // A message is sent whole only if it is sent in one piece
+    bool whole = offset == 0 && length == entry.data.size();
+    int header = whole ? int(WHOLE_HEADER) : int(FRAGMENT_HEADER);
+    int pos = data.size();
+    data.resize(pos + header + length);
+
+    data[pos] = char(whole ? Whole : Fragment);
+    Utils::Serialization::WriteInt(length, data, pos + 1);
+    if(!whole) {
+      Utils::Serialization::WriteInt(entry.id, data, pos + 5);
+      Utils::Serialization::WriteInt(offset, data, pos + 9);
+      Utils::Serialization::WriteInt(entry.data.size(), data, pos + 13);
+      m_fragments++;
+    }
+    memcpy(data.data() + pos + header, entry.data.constData() + offset, length);
+
+    m_payload_bytes += length;
+    m_header_bytes += header;
+  }
+}
+}
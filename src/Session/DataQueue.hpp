@@ -0,0 +1,142 @@
+#ifndef DISSENT_SESSION_DATA_QUEUE_H_GUARD
+#define DISSENT_SESSION_DATA_QUEUE_H_GUARD
+
+#include <QByteArray>
+#include <QList>
+#include <QPair>
+
+#include "Messaging/GetDataCallback.hpp"
+
+namespace Dissent {
+namespace Session {
+  /**
+   * A light weight class for handling semi-reliable sends across the
+   * anonymous communication channel.  Queued messages are packed into the
+   * slot messages requested by the round as a series of records, each with
+   * a compact header, so that many small messages share a slot.  A message
+   * that does not fit into the remainder of a slot is fragmented and
+   * continued in the following slots.  As the round sizes a slot by the
+   * data returned, slots grow with the queue up to the round's maximum.
+   *
+   * Whole record:     type (1), length (4), message
+   * Fragment record:  type (1), length (4), id (4), offset (4), total (4),
+   *                   part of a message
+   *
+   * Fragments carry a random id per message, so fragments of different
+   * messages cannot be linked.  DataAssembler recovers the messages.
+   */
+  class DataQueue {
+    public:
+      enum RecordType {
+        Padding = 0,
+        Whole = 1,
+        Fragment = 2
+      };
+
+      static const int WHOLE_HEADER = 5;
+      static const int FRAGMENT_HEADER = 17;
+
+      /**
+       * The smallest fragment split off to fill the end of a slot
+       */
+      static const int MIN_FRAGMENT = 64;
+
+      /**
+       * Constructor
+       */
+      DataQueue();
+
+      /**
+       * Adds new data to the send queue
+       * @param data the data to add
+       */
+      void AddData(const QByteArray &data);
+
+      /**
+       * Retrieves data from the data waiting queue, returns the byte array
+       * containing data and a bool which is true if there is more data
+       * available.  The data returned by the previous call is considered
+       * sent.
+       * @param max the maximum amount of data to retrieve
+       */
+      QPair<QByteArray, bool> GetData(int max);
+
+      /**
+       * Returns the data retrieved by the last GetData to the queue
+       */
+      void UnGet();
+
+      /**
+       * Resends a partially sent message from its start under a new id, for
+       * when the rounds' slots are reassigned and the rest could no longer
+       * be matched to it
+       */
+      void Restart();
+
+      /**
+       * Returns a callback into this object,
+       * which is valid so long as this object is
+       */
+      Messaging::GetDataCallback &GetCallback()
+      {
+        return m_get_data;
+      }
+
+      /**
+       * Returns the number of messages not completely sent
+       */
+      int Count() const { return m_queue.count(); }
+
+      /**
+       * Returns the bytes of messages not yet sent
+       */
+      qint64 QueuedBytes() const { return m_queued_bytes - m_offset; }
+
+      /**
+       * Returns the bytes of messages handed to the round
+       */
+      qint64 GetPayloadBytes() const { return m_payload_bytes; }
+
+      /**
+       * Returns the bytes of record headers handed to the round
+       */
+      qint64 GetHeaderBytes() const { return m_header_bytes; }
+
+      /**
+       * Returns the number of fragment records handed to the round
+       */
+      qint64 GetFragments() const { return m_fragments; }
+
+    private:
+      struct Entry {
+        Entry(const QByteArray &data = QByteArray(), int id = 0) :
+          data(data), id(id)
+        {
+        }
+
+        QByteArray data;
+        int id;
+      };
+
+      static int NewId();
+      void Commit();
+      void AppendRecord(QByteArray &data, const Entry &entry, int offset,
+          int length);
+
+      QList<Entry> m_queue;
+      qint64 m_queued_bytes;
+      /* Bytes of the head message sent */
+      int m_offset;
+      /* Retrieved by the last GetData, not yet committed */
+      int m_trim;
+      int m_trim_offset;
+
+      qint64 m_payload_bytes;
+      qint64 m_header_bytes;
+      qint64 m_fragments;
+      Messaging::GetDataMethod<DataQueue> m_get_data;
+  };
+}
+}
+
+#endif
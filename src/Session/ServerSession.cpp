@@ -1,10 +1,12 @@
 #include <QDebug>
+#include <QSet>
 
 #include "Applications/Settings.hpp"
 #include "Connections/IOverlaySender.hpp"
 #include "Crypto/AsymmetricKey.hpp"
 #include "Crypto/CryptoRandom.hpp"
 #include "Crypto/Hash.hpp"
+#include "Identity/PublicIdentity.hpp"
 #include "Messaging/ISender.hpp"
 #include "Messaging/StateData.hpp"
 #include "Utils/QRunTimeError.hpp"
@@ -999,6 +1001,9 @@ namespace Server {
         AddMessageProcessor(SessionMessage::ServerInit,
             QSharedPointer<StateCallback>(new StateCallbackImpl<CommState>(this,
                 &CommState::HandleServerInit)));
+        AddMessageProcessor(SessionMessage::ClientRegister,
+            QSharedPointer<StateCallback>(new StateCallbackImpl<CommState>(this,
+                &CommState::HandleClientRegister)));
 
         QSharedPointer<SessionSharedState> state =
           GetSharedState().dynamicCast<SessionSharedState>();
@@ -1051,10 +1056,30 @@ namespace Server {
         return NoChange;
       }
 
+      virtual ProcessResult HandleConnection(const Connections::Id &remote)
+      {
+        QSharedPointer<ServerSessionSharedState> state =
+          GetSharedState().dynamicCast<ServerSessionSharedState>();
+        QSharedPointer<Anonymity::Round> round = state->GetRound();
+        if(state->GetOverlay()->IsServer(remote) || !round ||
+            !round->AdmitsClients())
+        {
+          return NoChange;
+        }
+
+        // Clients arriving late can register into the running round
+        ServerQueued queued(state->GetServers(), QByteArray(16, 0),
+            state->GetServersBytes());
+        queued.SetSignature(state->GetPrivateKey()->Sign(queued.GetPayload()));
+        state->GetOverlay()->SendNotification(remote, "SessionData", queued.GetPacket());
+        return NoChange;
+      }
+
       virtual ProcessResult HandleDisconnection(const Connections::Id &id)
       {
         QSharedPointer<ServerSessionSharedState> state =
           GetSharedState().dynamicCast<ServerSessionSharedState>();
+        m_admitted.remove(id);
         return state->DefaultHandleDisconnection(id);
       }
 
@@ -1065,6 +1090,48 @@ namespace Server {
       {
         return StoreMessage;
       }
+
+      ProcessResult HandleClientRegister(
+          const QSharedPointer<Messaging::ISender> &,
+          const QSharedPointer<Messaging::Message> &msg)
+      {
+        QSharedPointer<ServerSessionSharedState> state =
+          GetSharedState().dynamicCast<ServerSessionSharedState>();
+        QSharedPointer<ClientRegister> clr = msg.dynamicCast<ClientRegister>();
+
+        Connections::Id remote_id = clr->GetId();
+        if(state->GetOverlay()->IsServer(remote_id)) {
+          throw Utils::QRunTimeError("Is server: " + remote_id.ToString());
+        }
+
+        if(state->GetClientRegisterMsgs().contains(remote_id) ||
+            m_admitted.contains(remote_id))
+        {
+          throw Utils::QRunTimeError("Already registered: " + remote_id.ToString());
+        }
+
+        QSharedPointer<Anonymity::Round> round = state->GetRound();
+        if(!round || !round->AdmitsClients()) {
+          qDebug() << state->GetOverlay()->GetId() << this << remote_id <<
+            "must wait for the next round";
+          return NoChange;
+        }
+
+        state->CheckClientRegister(*clr);
+        round->AdmitClient(Identity::PublicIdentity(clr->GetId(), clr->GetKey(),
+              clr->GetOptional().toByteArray()));
+        m_admitted.insert(remote_id);
+        qDebug() << state->GetOverlay()->GetId() << this << remote_id <<
+          "registered into the running round";
+
+        // The client joins the round started from the original roster
+        ServerStart start(state->GetClients(), state->GetVerifyMap().values());
+        state->GetOverlay()->SendNotification(remote_id, "SessionData",
+            start.GetPacket());
+        return NoChange;
+      }
+
+      QSet<Connections::Id> m_admitted;
   };
 }
 
@@ -1,5 +1,6 @@
 #include "Session.hpp"
 
+#include "Anonymity/SlotSender.hpp"
 #include "Crypto/DiffieHellman.hpp"
 #include "Crypto/DsaPrivateKey.hpp"
 
@@ -43,8 +44,24 @@ namespace Session {
     GetSharedState()->AddData(data);
   }
 
+  void Session::HandleData(const QSharedPointer<Messaging::ISender> &from,
+      const QByteArray &data)
+  {
+    // Rounds that do not number their slots share a single context
+    QSharedPointer<Anonymity::SlotSender> slot =
+      from.dynamicCast<Anonymity::SlotSender>();
+    int idx = slot ? slot->GetSlot() : -1;
+
+    foreach(const QByteArray &msg, m_assembler.Unpack(data, idx)) {
+      PushData(GetSharedPointer(), msg);
+    }
+  }
+
   void Session::HandleRoundStartedSlot(const QSharedPointer<Anonymity::Round> &round)
   {
+    if(round->ReassignsSlots()) {
+      m_assembler.Clear();
+    }
     round->SetSink(this);
     QObject::connect(round.data(), SIGNAL(Finished()),
         this, SLOT(HandleRoundFinishedSlot()));
@@ -19,6 +19,7 @@
 #include "Messaging/Request.hpp"
 
 #include "ClientRegister.hpp"
+#include "DataAssembler.hpp"
 #include "ServerAgree.hpp"
 #include "SessionSharedState.hpp"
 #include "SessionState.hpp"
@@ -56,6 +57,24 @@ namespace Session {
 
       QSharedPointer<Anonymity::Round> GetRound() const { return m_shared_state->GetRound(); }
 
+      /**
+       * Returns the number of rounds that started with round data prepared
+       * during the previous round
+       */
+      int GetPreparedRoundData() const
+      {
+        return m_shared_state->GetPreparedRoundData();
+      }
+
+      /**
+       * Unpacks the slot messages output by the round and passes the
+       * messages within to the sink
+       * @param from the round
+       * @param data a slot message
+       */
+      virtual void HandleData(const QSharedPointer<Messaging::ISender> &from,
+          const QByteArray &data);
+
     signals:
       /**
        * Signals that a round is beginning.
@@ -138,6 +157,7 @@ namespace Session {
       QSharedPointer<SessionSharedState> m_shared_state;
       SessionStateMachine m_sm;
       Messaging::MessageDemuxer m_md;
+      DataAssembler m_assembler;
       QWeakPointer<Session> m_shared;
 
       typedef Messaging::Request Request;
@@ -1,9 +1,12 @@
+#include <QtConcurrentRun>
+
 #include "SessionSharedState.hpp"
 
 #include "Crypto/DiffieHellman.hpp"
 #include "Crypto/DsaPrivateKey.hpp"
 #include "Crypto/Hash.hpp"
 #include "Utils/QRunTimeError.hpp"
+#include "Utils/Utils.hpp"
 
 #include "SerializeList.hpp"
 
@@ -18,20 +21,52 @@ namespace Session {
     m_overlay(overlay),
     m_my_key(my_key),
     m_keys(keys),
-    m_create_round(create_round)
+    m_create_round(create_round),
+    m_round_data_pending(false),
+    m_prepared_round_data(0)
   {
   }
 
   SessionSharedState::~SessionSharedState()
   {
+    // An outstanding generation touches no state and is simply dropped
   }
 
   void SessionSharedState::GenerateRoundData()
   {
-    m_ephemeral_key = QSharedPointer<Crypto::AsymmetricKey>(new Crypto::DsaPrivateKey());
+    RoundData data;
+    if(m_round_data_pending) {
+      // Usually long finished, as it began when the last round started
+      data = m_next_round_data.result();
+      m_round_data_pending = false;
+      m_prepared_round_data++;
+    } else {
+      data = CreateRoundData();
+    }
+
+    m_ephemeral_key = data.ephemeral_key;
+    m_optional_public = data.optional_public;
+    m_optional_private = data.optional_private;
+  }
+
+  SessionSharedState::RoundData SessionSharedState::CreateRoundData()
+  {
+    RoundData data;
+    data.ephemeral_key = QSharedPointer<Crypto::AsymmetricKey>(new Crypto::DsaPrivateKey());
     Crypto::DiffieHellman dh_key;
-    m_optional_public = dh_key.GetPublicComponent();
-    m_optional_private = dh_key.GetPrivateComponent();
+    data.optional_public = dh_key.GetPublicComponent();
+    data.optional_private = dh_key.GetPrivateComponent();
+    return data;
+  }
+
+  void SessionSharedState::PrepareRoundData()
+  {
+    if(!Utils::MultiThreading || m_round_data_pending) {
+      return;
+    }
+
+    m_next_round_data = QtConcurrent::run(&SessionSharedState::CreateRoundData);
+    m_round_data_pending = true;
   }
 
   void SessionSharedState::SetServers(
@@ -139,12 +174,19 @@ namespace Session {
     Identity::Roster clients(client_idents);
     Identity::Roster servers(server_idents);
 
+    // Receivers cannot match the rest of a message to the new slots
+    if(m_round && m_round->ReassignsSlots()) {
+      m_send_queue.Restart();
+    }
+
     Crypto::DiffieHellman dh_key(GetOptionalPrivate().toByteArray(), false);
     Identity::PrivateIdentity my_ident(GetOverlay()->GetId(),
         GetEphemeralKey(), dh_key);
     m_round = m_create_round(clients, servers, my_ident,
           GetRoundId(), GetOverlay(), m_send_queue.GetCallback());
 
+    // The following round's keys are generated while this one transmits
+    PrepareRoundData();
     GetRoundAnnouncer()->AnnounceHelper(m_round);
   }
 
@@ -153,33 +195,6 @@ namespace Session {
     m_send_queue.AddData(data);
   }
 
-  QPair<QByteArray, bool> SessionSharedState::DataQueue::GetData(int max)
-  {
-    if(m_trim > 0) {
-      m_queue = m_queue.mid(m_trim);
-    }
-
-    QByteArray data;
-    int idx = 0;
-    while(idx < m_queue.count()) {
-      if(max < m_queue[idx].count()) {
-        qDebug() << "Message in queue is larger than max data:" <<
-          m_queue[idx].count() << "/" << max;
-        idx++;
-        continue;
-      } else if(max < (data.count() + m_queue[idx].count())) {
-        break;
-      }
-
-      data.append(m_queue[idx++]);
-    }
-
-    m_trim = idx;
-
-    bool more = m_queue.count() != m_trim;
-    return QPair<QByteArray, bool>(data, more);
-  }
-
   void SessionSharedState::RoundFinished(const QSharedPointer<Anonymity::Round> &round)
   {
     if(!round->Successful()) {
@@ -1,6 +1,7 @@
 #ifndef DISSENT_SESSION_SESSION_SHARED_STATE_H_GUARD
 #define DISSENT_SESSION_SESSION_SHARED_STATE_H_GUARD
 
+#include <QFuture>
 #include <QObject>
 
 #include "Anonymity/Round.hpp"
@@ -9,6 +10,7 @@
 #include "Messaging/StateData.hpp"
 
 #include "ClientRegister.hpp"
+#include "DataQueue.hpp"
 #include "ServerAgree.hpp"
 #include "ServerStop.hpp"
 
@@ -67,10 +69,18 @@ namespace Session {
 
       /**
        * Generates round data for the upcoming round, including ephemeral signing key
-       * and in some cases a DiffieHellman key.
+       * and in some cases a DiffieHellman key.  The data is taken from that
+       * prepared in the background since NextRound launched the previous
+       * round, so the switch to a new round need not wait on key generation.
        */
       void GenerateRoundData();
 
+      /**
+       * Returns the number of times GenerateRoundData used round data
+       * prepared in the background
+       */
+      int GetPreparedRoundData() const { return m_prepared_round_data; }
+
       /**
        * Returns the ephemeral round key
        */
@@ -155,7 +165,8 @@ namespace Session {
       QSharedPointer<RoundAnnouncer> &GetRoundAnnouncer() { return m_round_announcer; }
 
       /**
-       * Launches the next round
+       * Launches the next round and begins preparing the round data for
+       * the one after it
        */
       void NextRound();
 
@@ -173,56 +184,20 @@ namespace Session {
 
     private:
       /**
-       * A light weight class for handling semi-reliable sends
-       * across the anonymous communication channel
-       */
-      class DataQueue {
-        public:
-          DataQueue() : m_trim(0), m_get_data(this, &DataQueue::GetData) {}
-
-          /**
-           * Adds new data to the send queue
-           * @param data the data to add
-           */
-          void AddData(const QByteArray &data)
-          {
-            m_queue.append(data);
-          }
-
-          /**
-           * Retrieves data from the data waiting queue, returns the byte array
-           * containing data and a bool which is true if there is more data
-           * available.
-           * @param max the maximum amount of data to retrieve
-           */
-          QPair<QByteArray, bool> GetData(int max);
-
-          /**
-           * Resets the current offset in the GetData queue
-           */
-          void UnGet()
-          {
-            m_trim = 0;
-          }
-
-          /** 
-           * Returns a callback into this object,
-           * which is valid so long as this object is
-           */
-          Messaging::GetDataCallback &GetCallback()
-          {
-            return m_get_data;
-          }
-
-        private:
-          QList<QByteArray> m_queue;
-          int m_trim;
-          Messaging::GetDataMethod<DataQueue> m_get_data;
+       * The keys generated for a round
+       */
+      struct RoundData {
+        QSharedPointer<Crypto::AsymmetricKey> ephemeral_key;
+        QVariant optional_public;
+        QVariant optional_private;
       };
 
+      static RoundData CreateRoundData();
+
       /**
-       * Used to store messages to be transmitted in an upcoming round
+       * Begins generating the next round's data on the thread pool
        */
+      void PrepareRoundData();
 
       QSharedPointer<RoundAnnouncer> m_round_announcer;
       QSharedPointer<ClientServer::Overlay> m_overlay;
@@ -233,6 +208,9 @@ namespace Session {
       QSharedPointer<Crypto::AsymmetricKey> m_ephemeral_key;
       QVariant m_optional_public;
       QVariant m_optional_private;
+      QFuture<RoundData> m_next_round_data;
+      bool m_round_data_pending;
+      int m_prepared_round_data;
 
       QSharedPointer<Anonymity::Round> m_round;
       QByteArray m_round_id;
@@ -0,0 +1,201 @@
+#include "AbstractGroupHelpers.hpp"
+#include "DissentTest.hpp"
+
+namespace Dissent {
+namespace Tests {
+
+  void TestFixedBase(const QSharedPointer<AbstractGroup> &group)
+  {
+    Element g = group->GetGenerator();
+    Element y = group->RandomElement();
+    Integer q = group->GetOrder();
+
+    QList<Integer> exps;
+    exps << Integer(0) << Integer(1) << Integer(2) << (q - 1) << q;
+    for(int idx = 0; idx < 20; idx++) {
+      exps << group->RandomExponent();
+    }
+
+    foreach(const Integer &exp, exps) {
+      EXPECT_EQ(group->Exponentiate(g, exp), group->FixedBaseExponentiate(g, exp));
+      EXPECT_EQ(group->Exponentiate(y, exp), group->FixedBaseExponentiate(y, exp));
+    }
+
+    // Out of range exponents fall back to Exponentiate
+    Integer large = q * q + 5;
+    EXPECT_EQ(group->Exponentiate(y, large), group->FixedBaseExponentiate(y, large));
+
+    // Tables are cached and shared with copies
+    EXPECT_EQ(group->GetPrecomputedBase(g), group->GetPrecomputedBase(g));
+    QSharedPointer<AbstractGroup> copy = group->Copy();
+    EXPECT_EQ(group->GetPrecomputedBase(y), copy->GetPrecomputedBase(y));
+    EXPECT_EQ(y, copy->GetPrecomputedBase(y)->GetBase());
+  }
+
+  void BenchmarkFixedBase(const QSharedPointer<AbstractGroup> &group, int count)
+  {
+    Element g = group->GetGenerator();
+    Element y = group->RandomElement();
+    QVector<Element> bases;
+    QVector<Integer> exps;
+    for(int idx = 0; idx < count; idx++) {
+      bases.append(group->RandomElement());
+      exps.append(group->RandomExponent());
+    }
+
+    QTime timer;
+    timer.start();
+    for(int idx = 0; idx < count; idx++) {
+      group->Exponentiate(g, exps[idx]);
+    }
+    int plain_ms = std::max(1, timer.restart());
+
+    group->GetPrecomputedBase(g);
+    group->GetPrecomputedBase(y);
+    timer.restart();
+
+    for(int idx = 0; idx < count; idx++) {
+      group->FixedBaseExponentiate(g, exps[idx]);
+    }
+    int generator_ms = std::max(1, timer.restart());
+
+    for(int idx = 0; idx < count; idx++) {
+      group->FixedBaseExponentiate(y, exps[idx]);
+    }
+    int key_ms = std::max(1, timer.restart());
+
+    for(int idx = 0; idx < count; idx++) {
+      group->Exponentiate(bases[idx], exps[idx]);
+    }
+    int variable_ms = std::max(1, timer.restart());
+
+    std::cout << group->ToString().toStdString() << " exponentiations per second, " <<
+      "generator (plain): " << (count * 1000 / plain_ms) <<
+      ", generator (fixed): " << (count * 1000 / generator_ms) <<
+      ", fixed key: " << (count * 1000 / key_ms) <<
+      ", variable base: " << (count * 1000 / variable_ms) << std::endl;
+  }
+
+  void TestMultiExponentiate(const QSharedPointer<AbstractGroup> &group)
+  {
+    QList<int> sizes;
+    sizes << 0 << 1 << 2 << 5 << 40 << 200;
+
+    foreach(int size, sizes) {
+      QVector<Element> bases;
+      QVector<Integer> exps;
+      Element expected = group->GetIdentity();
+
+      for(int idx = 0; idx < size; idx++) {
+        Element base = group->RandomElement();
+        Integer exp = group->RandomExponent();
+        if(idx % 3 == 1) {
+          exp = Integer(0) - exp;
+        } else if(idx % 5 == 2) {
+          exp = Integer(idx);
+        }
+
+        bases.append(base);
+        exps.append(exp);
+        Element term = (exp < Integer(0)) ?
+          group->Inverse(group->Exponentiate(base, Integer(0) - exp)) :
+          group->Exponentiate(base, exp);
+        expected = group->Multiply(expected, term);
+      }
+
+      EXPECT_EQ(expected, group->MultiExponentiate(bases, exps));
+    }
+  }
+
+  void BenchmarkMultiExponentiate(const QSharedPointer<AbstractGroup> &group,
+      int count)
+  {
+    QVector<Element> bases;
+    QVector<Integer> exps;
+    for(int idx = 0; idx < count; idx++) {
+      bases.append(group->RandomElement());
+      exps.append(group->RandomExponent());
+    }
+
+    QTime timer;
+    timer.start();
+    Element product = group->GetIdentity();
+    for(int idx = 0; idx < count; idx++) {
+      product = group->Multiply(product, group->Exponentiate(bases[idx], exps[idx]));
+    }
+    int naive_ms = std::max(1, timer.restart());
+
+    Element multi = group->MultiExponentiate(bases, exps);
+    int multi_ms = std::max(1, timer.restart());
+
+    EXPECT_EQ(product, multi);
+    std::cout << group->ToString().toStdString() << " " << count <<
+      " term product, naive: " << naive_ms << " ms, multi-exponentiation: " <<
+      multi_ms << " ms" << std::endl;
+  }
+
+  TEST(AbstractGroup, FixedBaseInteger)
+  {
+    TestFixedBase(IntegerGroup::GetGroup(IntegerGroup::TESTING_512));
+  }
+
+  TEST(AbstractGroup, FixedBaseCppEC)
+  {
+    TestFixedBase(CppECGroup::GetGroup(ECParams::NIST_P256));
+  }
+
+  TEST(AbstractGroup, FixedBaseDsaSubgroup)
+  {
+    DsaPrivateKey key;
+    IntegerGroup group(key.GetModulus(), key.GetGenerator(),
+        key.GetSubgroupOrder());
+
+    for(int idx = 0; idx < 20; idx++) {
+      Integer exp = CryptoRandom().GetInteger(0, key.GetSubgroupOrder());
+      EXPECT_EQ(key.GetGenerator().Pow(exp, key.GetModulus()),
+          group.FixedBasePow(key.GetGenerator(), exp));
+      EXPECT_EQ(key.GetPublicElement().Pow(exp, key.GetModulus()),
+          group.FixedBasePow(key.GetPublicElement(), exp));
+    }
+  }
+
+  TEST(AbstractGroup, MultiExponentiateInteger)
+  {
+    TestMultiExponentiate(IntegerGroup::GetGroup(IntegerGroup::TESTING_256));
+  }
+
+  TEST(AbstractGroup, MultiExponentiateCppEC)
+  {
+    TestMultiExponentiate(CppECGroup::GetGroup(ECParams::NIST_P256));
+  }
+
+  TEST(AbstractGroup, MultiPowEvenModulus)
+  {
+    // Even moduli take the plain modular arithmetic path
+    Integer modulus = Integer(1) + CryptoRandom().GetInteger(512);
+    modulus = modulus + modulus;
+    QVector<Integer> bases, exps;
+    Integer expected(1);
+    for(int idx = 0; idx < 10; idx++) {
+      bases.append(CryptoRandom().GetInteger(0, modulus));
+      exps.append(CryptoRandom().GetInteger(256));
+      expected = (expected * bases[idx].Pow(exps[idx], modulus)) % modulus;
+    }
+    EXPECT_EQ(expected, modulus.MultiPow(bases, exps));
+  }
+
+  TEST(AbstractGroup, MultiExponentiateBenchmark)
+  {
+    BenchmarkMultiExponentiate(IntegerGroup::GetGroup(IntegerGroup::PRODUCTION_1024), 2);
+    BenchmarkMultiExponentiate(IntegerGroup::GetGroup(IntegerGroup::PRODUCTION_1024), 200);
+    BenchmarkMultiExponentiate(CppECGroup::GetGroup(ECParams::NIST_P256), 200);
+  }
+
+  TEST(AbstractGroup, FixedBaseBenchmark)
+  {
+    BenchmarkFixedBase(IntegerGroup::GetGroup(IntegerGroup::PRODUCTION_1024), 100);
+    BenchmarkFixedBase(CppECGroup::GetGroup(ECParams::NIST_P256), 200);
+  }
+
+}
+}
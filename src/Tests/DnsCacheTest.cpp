@@ -0,0 +1,168 @@
+#include <QSet>
+#include <QStringList>
+
+#include "DissentTest.hpp"
+
+namespace Dissent {
+namespace Tests {
+  namespace {
+    /**
+     * Answers lookups only when told to
+     */
+    class StubResolver : public DnsResolver {
+      public:
+        StubResolver() : lookups(0) {}
+
+        virtual void Lookup(const QString &host)
+        {
+          lookups++;
+          outstanding.append(host);
+        }
+
+        void Answer(const QString &host, const QList<QHostAddress> &addresses,
+            int ttl)
+        {
+          outstanding.removeAll(host);
+          emit Resolved(host, addresses, ttl);
+        }
+
+        int lookups;
+        QStringList outstanding;
+    };
+
+    QList<QHostAddress> Addresses(const QString &address)
+    {
+      return QList<QHostAddress>() << QHostAddress(address);
+    }
+  }
+
+  TEST(DnsCache, Ttl)
+  {
+    Timer::GetInstance().UseVirtualTime();
+    StubResolver *resolver = new StubResolver();
+    DnsCache cache(resolver);
+    SignalCounter sc;
+    QObject::connect(&cache, SIGNAL(LookupFinished(int, const QString &,
+            const QList<QHostAddress> &)), &sc, SLOT(Counter()));
+
+    QList<QHostAddress> addresses;
+    EXPECT_NE(0, cache.Lookup("example.com", addresses));
+    EXPECT_EQ(1, resolver->lookups);
+    EXPECT_EQ(1, cache.Pending());
+
+    Time::GetInstance().IncrementVirtualClock(40);
+    resolver->Answer("example.com", Addresses("10.0.0.1"), 10);
+    EXPECT_EQ(1, sc.GetCount());
+    EXPECT_EQ(0, cache.Pending());
+    EXPECT_EQ(40, cache.GetResolutionTime());
+    EXPECT_EQ(40, cache.GetMaxResolutionTime());
+
+    // Host names are case insensitive
+    EXPECT_EQ(0, cache.Lookup("Example.COM", addresses));
+    EXPECT_EQ(Addresses("10.0.0.1"), addresses);
+    EXPECT_EQ(1, resolver->lookups);
+
+    Time::GetInstance().IncrementVirtualClock(9999);
+    EXPECT_EQ(0, cache.Lookup("example.com", addresses));
+
+    Time::GetInstance().IncrementVirtualClock(1);
+    EXPECT_NE(0, cache.Lookup("example.com", addresses));
+    EXPECT_EQ(2, resolver->lookups);
+
+    // Unknown TTLs are cached for the default, zero TTLs are not cached
+    resolver->Answer("example.com", Addresses("10.0.0.2"), -1);
+    Time::GetInstance().IncrementVirtualClock(DnsCache::DEFAULT_TTL * 1000 - 1);
+    EXPECT_EQ(0, cache.Lookup("example.com", addresses));
+    EXPECT_EQ(Addresses("10.0.0.2"), addresses);
+
+    EXPECT_NE(0, cache.Lookup("uncacheable.com", addresses));
+    resolver->Answer("uncacheable.com", Addresses("10.0.0.3"), 0);
+    EXPECT_NE(0, cache.Lookup("uncacheable.com", addresses));
+    EXPECT_EQ(4, resolver->lookups);
+
+    EXPECT_EQ(3, cache.GetHits());
+    EXPECT_EQ(4, cache.GetMisses());
+  }
+
+  TEST(DnsCache, Negative)
+  {
+    Timer::GetInstance().UseVirtualTime();
+    StubResolver *resolver = new StubResolver();
+    DnsCache cache(resolver);
+
+    QList<QHostAddress> addresses;
+    EXPECT_NE(0, cache.Lookup("missing.example", addresses));
+    resolver->Answer("missing.example", QList<QHostAddress>(), 300);
+
+    addresses = Addresses("10.0.0.1");
+    EXPECT_EQ(0, cache.Lookup("missing.example", addresses));
+    EXPECT_TRUE(addresses.isEmpty());
+    EXPECT_EQ(1, cache.GetNegativeHits());
+
+    // Failures are held for NEGATIVE_TTL, regardless of the TTL given
+    Time::GetInstance().IncrementVirtualClock(DnsCache::NEGATIVE_TTL * 1000);
+    EXPECT_NE(0, cache.Lookup("missing.example", addresses));
+    EXPECT_EQ(2, resolver->lookups);
+  }
+
+  TEST(DnsCache, Coalesce)
+  {
+    Timer::GetInstance().UseVirtualTime();
+    StubResolver *resolver = new StubResolver();
+    DnsCache cache(resolver);
+    SignalCounter sc;
+    QObject::connect(&cache, SIGNAL(LookupFinished(int, const QString &,
+            const QList<QHostAddress> &)), &sc, SLOT(Counter()));
+
+    QList<QHostAddress> addresses;
+    QSet<int> ids;
+    for(int idx = 0; idx < 10; idx++) {
+      int id = cache.Lookup("popular.example", addresses);
+      EXPECT_NE(0, id);
+      ids.insert(id);
+    }
+    EXPECT_EQ(10, ids.count());
+    EXPECT_EQ(1, resolver->lookups);
+    EXPECT_EQ(9, cache.GetCoalesced());
+
+    resolver->Answer("popular.example", Addresses("10.0.0.1"), 60);
+    EXPECT_EQ(10, sc.GetCount());
+    EXPECT_EQ(1, cache.GetResolutions());
+    EXPECT_EQ(0, cache.Lookup("popular.example", addresses));
+  }
+
+  TEST(DnsCache, Capacity)
+  {
+    Timer::GetInstance().UseVirtualTime();
+    StubResolver *resolver = new StubResolver();
+    DnsCache cache(resolver, 8);
+
+    QList<QHostAddress> addresses;
+    for(int idx = 0; idx < 8; idx++) {
+      QString host = QString("host%1.example").arg(idx);
+      cache.Lookup(host, addresses);
+      resolver->Answer(host, Addresses("10.0.0.1"), 100 + idx);
+    }
+    EXPECT_EQ(8, cache.Count());
+
+    // The entry closest to expiring makes room
+    cache.Lookup("new.example", addresses);
+    resolver->Answer("new.example", Addresses("10.0.0.2"), 500);
+    EXPECT_EQ(8, cache.Count());
+    EXPECT_EQ(1, cache.GetEvictions());
+    EXPECT_NE(0, cache.Lookup("host0.example", addresses));
+    EXPECT_EQ(0, cache.Lookup("host1.example", addresses));
+    resolver->Answer("host0.example", Addresses("10.0.0.1"), 1000);
+    EXPECT_EQ(8, cache.Count());
+    EXPECT_EQ(2, cache.GetEvictions());
+    EXPECT_NE(0, cache.Lookup("host1.example", addresses));
+
+    // Expired entries, here host2 and host3, go before unexpired ones
+    Time::GetInstance().IncrementVirtualClock(103 * 1000);
+    cache.Lookup("newer.example", addresses);
+    resolver->Answer("newer.example", Addresses("10.0.0.3"), 100);
+    EXPECT_EQ(7, cache.Count());
+    EXPECT_EQ(2, cache.GetEvictions());
+  }
+}
+}
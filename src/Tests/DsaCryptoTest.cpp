@@ -3,6 +3,9 @@
 #include <cryptopp/des.h>
 #include <cryptopp/osrng.h>
 #include <cryptopp/sha.h>
+#include <QTime>
+#include <QtConcurrentMap>
+#include <iostream>
 
 namespace Dissent {
 namespace Tests {
@@ -110,6 +113,101 @@ namespace Tests {
       EXPECT_TRUE(key3.Validate(rng, idx));
   }
 
+  CryptoPP::Integer ToCpp(const Integer &value)
+  {
+    QByteArray bytes = value.GetByteArray();
+    return CryptoPP::Integer(reinterpret_cast<const byte *>(bytes.constData()),
+        bytes.size());
+  }
+
+  bool SignAndVerify(const QByteArray &msg)
+  {
+    static DsaPrivateKey key;
+    return key.Verify(msg, key.Sign(msg));
+  }
+
+  TEST(Crypto, DsaSharedContexts)
+  {
+    // Cross the precomputation threshold from many threads at once
+    QList<QByteArray> msgs;
+    for(int idx = 0; idx < 64; idx++) {
+      msgs.append(QByteArray(64, char(idx)));
+    }
+
+    QList<bool> results = QtConcurrent::blockingMapped(msgs, SignAndVerify);
+    EXPECT_EQ(msgs.size(), results.count(true));
+
+    DsaPrivateKey key;
+    QSharedPointer<AsymmetricKey> pub_key = key.GetPublicKey();
+    QByteArray sig = key.Sign(msgs[0]);
+    // Before and after the pooled verifier precomputes its tables
+    for(int idx = 0; idx < 20; idx++) {
+      EXPECT_TRUE(pub_key->Verify(msgs[0], sig));
+      EXPECT_FALSE(pub_key->Verify(msgs[1], sig));
+    }
+  }
+
+  TEST(Crypto, DsaContextBenchmark)
+  {
+    typedef CryptoPP::GDSA<CryptoPP::SHA256> Dsa;
+    const int count = 256;
+
+    DsaPrivateKey key;
+    QSharedPointer<AsymmetricKey> pub_key = key.GetPublicKey();
+
+    Dsa::PrivateKey cpp_key;
+    cpp_key.Initialize(ToCpp(key.GetModulus()), ToCpp(key.GetSubgroupOrder()),
+        ToCpp(key.GetGenerator()), ToCpp(key.GetPrivateExponent()));
+    Dsa::PublicKey cpp_pub_key;
+    cpp_key.MakePublicKey(cpp_pub_key);
+
+    CryptoRandom rand;
+    QVector<QByteArray> msgs;
+    for(int idx = 0; idx < count; idx++) {
+      QByteArray msg(256, 0);
+      rand.GenerateBlock(msg);
+      msgs.append(msg);
+    }
+
+    // A signer, verifier, and operating system seeded generator per message
+    QTime timer;
+    timer.start();
+    QVector<QByteArray> sigs;
+    for(int idx = 0; idx < count; idx++) {
+      Dsa::Signer signer(cpp_key);
+      CryptoPP::AutoSeededX917RNG<CryptoPP::DES_EDE3> rng;
+      QByteArray sig(signer.MaxSignatureLength(), 0);
+      signer.SignMessage(rng, reinterpret_cast<const byte *>(msgs[idx].constData()),
+          msgs[idx].size(), reinterpret_cast<byte *>(sig.data()));
+      sigs.append(sig);
+    }
+    int fresh_sign_ms = std::max(1, timer.restart());
+
+    for(int idx = 0; idx < count; idx++) {
+      Dsa::Verifier verifier(cpp_pub_key);
+      EXPECT_TRUE(verifier.VerifyMessage(
+            reinterpret_cast<const byte *>(msgs[idx].constData()), msgs[idx].size(),
+            reinterpret_cast<const byte *>(sigs[idx].constData()), sigs[idx].size()));
+    }
+    int fresh_verify_ms = std::max(1, timer.restart());
+
+    for(int idx = 0; idx < count; idx++) {
+      sigs[idx] = key.Sign(msgs[idx]);
+    }
+    int cached_sign_ms = std::max(1, timer.restart());
+
+    for(int idx = 0; idx < count; idx++) {
+      EXPECT_TRUE(pub_key->Verify(msgs[idx], sigs[idx]));
+    }
+    int cached_verify_ms = std::max(1, timer.restart());
+
+    std::cout << "DSA " << key.GetKeySize() << " signs per second, fresh: " <<
+      (count * 1000 / fresh_sign_ms) << ", cached: " <<
+      (count * 1000 / cached_sign_ms) << "; verifies per second, fresh: " <<
+      (count * 1000 / fresh_verify_ms) << ", cached: " <<
+      (count * 1000 / cached_verify_ms) << std::endl;
+  }
+
   TEST(Crypto, LRSTest)
   {
     DsaPrivateKey base_key;
@@ -201,6 +299,63 @@ namespace Tests {
     }
   }
 
+  TEST(Crypto, NeffShuffleThreading)
+  {
+    int values = 20;
+    int keys = 3;
+
+    DsaPrivateKey base_key;
+    Integer generator = base_key.GetGenerator();
+    Integer subgroup = base_key.GetSubgroupOrder();
+    Integer modulus = base_key.GetModulus();
+
+    QVector<DsaPrivateKey> private_keys;
+    QVector<DsaPublicKey> public_keys;
+
+    for(int idx = 0; idx < keys; idx++) {
+      private_keys.append(DsaPrivateKey(modulus, subgroup, generator));
+      public_keys.append(DsaPublicKey(modulus, subgroup, generator,
+            private_keys.last().GetPublicElement()));
+    }
+
+    CryptoRandom rand;
+    QVector<QByteArray> input;
+    for(int idx = 0; idx < values; idx++) {
+      Integer tmp_val = rand.GetInteger(0, subgroup);
+      input.append(DsaPublicKey::SeriesEncrypt(public_keys,
+            generator.Pow(tmp_val, modulus).GetByteArray()));
+    }
+
+    bool multithreading = Utils::MultiThreading;
+    NeffShuffle shuffle;
+    QVector<DsaPublicKey> npub_keys = public_keys, cpub_keys = public_keys;
+
+    // Proofs made with one threading mode verify with the other
+    for(int idx = 0; idx < keys; idx++) {
+      npub_keys.pop_front();
+      QVector<QByteArray> output, verified, parsed;
+      QByteArray proof;
+
+      Utils::MultiThreading = (idx % 2) == 0;
+      EXPECT_TRUE(shuffle.Shuffle(input, private_keys[idx], npub_keys, output, proof));
+      Utils::MultiThreading = (idx % 2) == 1;
+      EXPECT_TRUE(shuffle.Verify(input, cpub_keys, proof, verified));
+      EXPECT_EQ(output.size(), values);
+
+      EXPECT_TRUE(NeffShuffle::ParseOutput(proof, parsed));
+      EXPECT_EQ(verified, parsed);
+
+      QByteArray bad_proof = proof;
+      bad_proof[bad_proof.size() / 2] = ~bad_proof[bad_proof.size() / 2];
+      EXPECT_FALSE(shuffle.Verify(input, cpub_keys, bad_proof, parsed));
+
+      input = verified;
+      cpub_keys = npub_keys;
+    }
+
+    Utils::MultiThreading = multithreading;
+  }
+
   TEST(Crypto, NeffDataShuffle)
   {
     int values = 10;
@@ -1,5 +1,8 @@
 #include "DissentTest.hpp"
 #include <QDebug>
+#include <QTime>
+#include <iostream>
+#include <sys/resource.h>
 
 namespace Dissent {
 namespace Tests {
@@ -146,5 +149,619 @@ namespace Tests {
     MockExecLoop(sc);
     EXPECT_EQ(sc.GetCount(), 1);
   }
+  TEST(EdgeTest, Framing)
+  {
+    CryptoRandom rand;
+    QList<QByteArray> messages;
+    FrameWriter writer;
+    int sizes[] = {0, 1, 100, FrameWriter::COALESCE_LIMIT,
+      FrameWriter::COALESCE_LIMIT + 1, FrameReader::BUFFER_SIZE - 8,
+      FrameReader::BUFFER_SIZE - 5, 3 * FrameReader::BUFFER_SIZE, 17};
+
+    foreach(int size, sizes) {
+      QByteArray msg(size, 0);
+      rand.GenerateBlock(msg);
+      messages.append(msg);
+      writer.Append(msg);
+    }
+
+    QByteArray stream;
+    foreach(const QByteArray &piece, writer.TakeAll()) {
+      stream.append(piece);
+    }
+    EXPECT_TRUE(writer.IsEmpty());
+
+    // Deliver the stream in awkward chunks
+    FrameReader reader;
+    QList<QByteArray> received;
+    int offset = 0, chunk = 1;
+    while(offset < stream.size()) {
+      int count = qMin(qMin(chunk, reader.GetWriteSpace()), stream.size() - offset);
+      memcpy(reader.GetWritePointer(), stream.constData() + offset, count);
+      EXPECT_TRUE(reader.Commit(count));
+      received.append(reader.TakeFrames());
+      offset += count;
+      chunk = (chunk * 7) % 100003 + 1;
+    }
+
+    EXPECT_EQ(messages, received);
+  }
+
+  TEST(EdgeTest, FramingLimit)
+  {
+    // A large frame's payload grows only as its bytes arrive
+    QByteArray header(4, 0);
+    Utils::Serialization::WriteInt(FrameReader::MAX_FRAME_SIZE, header, 0);
+    FrameReader reader;
+    memcpy(reader.GetWritePointer(), header.constData(), header.size());
+    EXPECT_TRUE(reader.Commit(header.size()));
+    EXPECT_TRUE(reader.GetWriteSpace() <= 2 * FrameReader::BUFFER_SIZE);
+
+    Utils::Serialization::WriteInt(FrameReader::MAX_FRAME_SIZE + 1, header, 0);
+    FrameReader oversized;
+    memcpy(oversized.GetWritePointer(), header.constData(), header.size());
+    EXPECT_FALSE(oversized.Commit(header.size()));
+
+    Utils::Serialization::WriteInt(-1, header, 0);
+    FrameReader negative;
+    memcpy(negative.GetWritePointer(), header.constData(), header.size());
+    EXPECT_FALSE(negative.Commit(header.size()));
+  }
+
+  TEST(EdgeTest, TcpFraming)
+  {
+    Timer::GetInstance().UseRealTime();
+
+    const TcpAddress addr0("127.0.0.1", TEST_PORT);
+    TcpEdgeListener te0(addr0);
+    MockEdgeHandler meh0(&te0);
+    te0.Start();
+
+    const TcpAddress addr1("127.0.0.1", TEST_PORT + 1);
+    TcpEdgeListener te1(addr1);
+    MockEdgeHandler meh1(&te1);
+    te1.Start();
+
+    SignalCounter edges(2);
+    QObject::connect(&te0, SIGNAL(NewEdge(const QSharedPointer<Edge> &)),
+        &edges, SLOT(Counter()));
+    QObject::connect(&te1, SIGNAL(NewEdge(const QSharedPointer<Edge> &)),
+        &edges, SLOT(Counter()));
+
+    te1.CreateEdgeTo(addr0);
+    MockExecLoop(edges);
+
+    BufferSink sink;
+    meh0.edge->SetSink(&sink);
+
+    // Small messages sent together are coalesced, large ones are not
+    CryptoRandom rand;
+    QList<QByteArray> messages;
+    for(int idx = 0; idx < 40; idx++) {
+      QByteArray msg(idx % 10 == 9 ? 1024 * 1024 : idx * 10, 0);
+      rand.GenerateBlock(msg);
+      messages.append(msg);
+    }
+
+    SignalCounter received(messages.size());
+    QObject::connect(&sink, SIGNAL(DataReceived()), &received, SLOT(Counter()));
+
+    foreach(const QByteArray &msg, messages) {
+      meh1.edge->Send(msg);
+    }
+    MockExecLoop(received);
+
+    ASSERT_EQ(messages.size(), sink.Count());
+    for(int idx = 0; idx < messages.size(); idx++) {
+      EXPECT_EQ(messages[idx], sink.At(idx).second);
+    }
+
+    meh0.edge->Stop("Finished");
+    meh1.edge->Stop("Finished");
+    te0.Stop();
+    te1.Stop();
+    MockExec();
+  }
+
+  TEST(EdgeTest, EpollFraming)
+  {
+    Timer::GetInstance().UseRealTime();
+
+    const EpollAddress addr0("127.0.0.1", TEST_PORT + 2);
+    EpollEdgeListener ee0(addr0);
+    MockEdgeHandler meh0(&ee0);
+    ee0.Start();
+
+    const EpollAddress addr1("127.0.0.1", TEST_PORT + 3);
+    EpollEdgeListener ee1(addr1);
+    MockEdgeHandler meh1(&ee1);
+    ee1.Start();
+
+    SignalCounter edges(2);
+    QObject::connect(&ee0, SIGNAL(NewEdge(const QSharedPointer<Edge> &)),
+        &edges, SLOT(Counter()));
+    QObject::connect(&ee1, SIGNAL(NewEdge(const QSharedPointer<Edge> &)),
+        &edges, SLOT(Counter()));
+
+    ee1.CreateEdgeTo(addr0);
+    MockExecLoop(edges);
+    EXPECT_TRUE(meh1.edge->Outbound());
+    EXPECT_FALSE(meh0.edge->Outbound());
+
+    BufferSink sink;
+    meh0.edge->SetSink(&sink);
+
+    CryptoRandom rand;
+    QList<QByteArray> messages;
+    for(int idx = 0; idx < 40; idx++) {
+      QByteArray msg(idx % 10 == 9 ? 1024 * 1024 : idx * 10, 0);
+      rand.GenerateBlock(msg);
+      messages.append(msg);
+    }
+
+    SignalCounter received(messages.size());
+    QObject::connect(&sink, SIGNAL(DataReceived()), &received, SLOT(Counter()));
+
+    foreach(const QByteArray &msg, messages) {
+      meh1.edge->Send(msg);
+    }
+    MockExecLoop(received);
+
+    ASSERT_EQ(messages.size(), sink.Count());
+    for(int idx = 0; idx < messages.size(); idx++) {
+      EXPECT_EQ(messages[idx], sink.At(idx).second);
+    }
+
+    // Closing one side closes the other
+    SignalCounter stopped(1);
+    QObject::connect(meh0.edge.data(), SIGNAL(StoppedSignal()),
+        &stopped, SLOT(Counter()));
+    meh1.edge->Stop("Finished");
+    MockExecLoop(stopped);
+    EXPECT_TRUE(meh0.edge->Stopped());
+
+    ee0.Stop();
+    ee1.Stop();
+    MockExec();
+  }
+
+  TEST(EdgeTest, EpollFail)
+  {
+    Timer::GetInstance().UseRealTime();
+
+    const EpollAddress addr("127.0.0.1", 33348);
+    EpollEdgeListener ee(addr);
+    ee.Start();
+    SignalCounter sc(1);
+    QObject::connect(&ee, SIGNAL(EdgeCreationFailure(const Address &, const QString &)),
+        &sc, SLOT(Counter()));
+
+    // Nothing listens here
+    EpollAddress closed_addr("127.0.0.1", 33349);
+    ee.CreateEdgeTo(closed_addr);
+    MockExecLoop(sc);
+    EXPECT_EQ(sc.GetCount(), 1);
+    sc.Reset();
+
+    EpollAddress bad_addr(QUrl("epoll://ha!"));
+    ee.CreateEdgeTo(bad_addr);
+    MockExecLoop(sc);
+    EXPECT_EQ(sc.GetCount(), 1);
+
+    ee.Stop();
+    MockExec();
+  }
+
+  /**
+   * Runs events until the counter fills, false if timeout ms pass first
+   */
+  bool MockExecLoopFor(SignalCounter &sc, int timeout)
+  {
+    QTime timer;
+    timer.start();
+    while(sc.GetCount() != sc.Max()) {
+      if(timer.elapsed() > timeout) {
+        return false;
+      }
+      MockExec();
+    }
+    return true;
+  }
+
+  void BenchmarkEpollConnections(int count)
+  {
+    const int timeout = 120000;
+
+    // Each connection costs a descriptor at either end
+    EpollReactor::GetInstance();
+    struct rlimit limit;
+    getrlimit(RLIMIT_NOFILE, &limit);
+    if(limit.rlim_cur != RLIM_INFINITY && rlim_t(2 * count + 256) > limit.rlim_cur) {
+      std::cout << "Epoll " << count << " connections: skipped, descriptor limit " <<
+        limit.rlim_cur << std::endl;
+      return;
+    }
+
+    // A loopback destination offers about 28k ephemeral source ports
+    const int per_server = 20000;
+    QList<QSharedPointer<EpollEdgeListener> > servers;
+    QList<QSharedPointer<MockEdgeHandler> > server_edges;
+    QList<EpollAddress> server_addrs;
+    for(int idx = 0; idx * per_server < count; idx++) {
+      EpollAddress addr("127.0.0.1", TEST_PORT + 10 + idx);
+      QSharedPointer<EpollEdgeListener> server(new EpollEdgeListener(addr));
+      server_edges.append(QSharedPointer<MockEdgeHandler>(
+            new MockEdgeHandler(server.data())));
+      server->Start();
+      servers.append(server);
+      server_addrs.append(addr);
+    }
+
+    const EpollAddress client_addr("127.0.0.1", TEST_PORT + 9);
+    EpollEdgeListener client(client_addr);
+    MockEdgeHandler client_edges(&client);
+    client.Start();
+
+    SignalCounter outcomes(count);
+    QObject::connect(&client, SIGNAL(NewEdge(const QSharedPointer<Edge> &)),
+        &outcomes, SLOT(Counter()));
+    QObject::connect(&client, SIGNAL(EdgeCreationFailure(const Address &, const QString &)),
+        &outcomes, SLOT(Counter()));
+
+    QTime timer;
+    timer.start();
+    for(int idx = 0; idx < count; idx++) {
+      client.CreateEdgeTo(server_addrs[idx / per_server]);
+    }
+    bool finished = MockExecLoopFor(outcomes, timeout);
+
+    int accepted = 0;
+    while(finished && accepted < client_edges.edges.size()) {
+      if(timer.elapsed() > timeout) {
+        finished = false;
+        break;
+      }
+      MockExec();
+      accepted = 0;
+      foreach(const QSharedPointer<MockEdgeHandler> &handler, server_edges) {
+        accepted += handler->edges.size();
+      }
+    }
+    int connect_ms = std::max(1, timer.restart());
+
+    BufferSink sink;
+    if(finished) {
+      EXPECT_EQ(count, client_edges.edges.size());
+      foreach(const QSharedPointer<MockEdgeHandler> &handler, server_edges) {
+        foreach(const QSharedPointer<Edge> &edge, handler->edges) {
+          edge->SetSink(&sink);
+        }
+      }
+
+      SignalCounter received(client_edges.edges.size());
+      QObject::connect(&sink, SIGNAL(DataReceived()), &received, SLOT(Counter()));
+
+      timer.restart();
+      QByteArray msg(64, 1);
+      foreach(const QSharedPointer<Edge> &edge, client_edges.edges) {
+        edge->Send(msg);
+      }
+      finished = MockExecLoopFor(received, timeout);
+      int exchange_ms = std::max(1, timer.restart());
+      EXPECT_EQ(client_edges.edges.size(), sink.Count());
+
+      std::cout << "Epoll " << client_edges.edges.size() << " of " << count <<
+        " connections, connect: " << connect_ms << " ms, one message each: " <<
+        exchange_ms << " ms" << std::endl;
+    }
+
+    if(!finished) {
+      ADD_FAILURE() << "Epoll " << count << " connections timed out";
+    }
+
+    foreach(const QSharedPointer<Edge> &edge, client_edges.edges) {
+      edge->Stop("Finished");
+    }
+    foreach(const QSharedPointer<MockEdgeHandler> &handler, server_edges) {
+      foreach(const QSharedPointer<Edge> &edge, handler->edges) {
+        edge->Stop("Finished");
+      }
+    }
+    foreach(const QSharedPointer<EpollEdgeListener> &server, servers) {
+      server->Stop();
+    }
+    client.Stop();
+    MockExec();
+  }
+
+  /**
+   * Opens tens of thousands of loopback connections, run it explicitly with
+   * --gtest_also_run_disabled_tests
+   */
+  TEST(EdgeTest, DISABLED_EpollConnectionBenchmark)
+  {
+    Timer::GetInstance().UseRealTime();
+    BenchmarkEpollConnections(1000);
+    BenchmarkEpollConnections(10000);
+    BenchmarkEpollConnections(50000);
+  }
+
+  /**
+   * Carries datagrams between UdpSessions, dropping, duplicating, and
+   * delaying, and thereby reordering, them at random
+   */
+  class LossyChannel {
+    public:
+      LossyChannel(CryptoRandom &rand, int loss, int duplicate, int jitter) :
+        _rand(rand), _loss(loss), _duplicate(duplicate), _jitter(jitter)
+      {
+      }
+
+      void Transmit(const QList<QByteArray> &datagrams, qint64 now)
+      {
+        foreach(const QByteArray &datagram, datagrams) {
+          if(_rand.GetInt(0, 100) < _loss) {
+            continue;
+          }
+          qint64 due = now + 5 + _rand.GetInt(0, _jitter + 1);
+          _queue.append(QPair<qint64, QByteArray>(due, datagram));
+          if(_rand.GetInt(0, 100) < _duplicate) {
+            _queue.append(QPair<qint64, QByteArray>(due + 3, datagram));
+          }
+        }
+      }
+
+      void Deliver(UdpSession &session, qint64 now)
+      {
+        QList<QPair<qint64, QByteArray> > pending;
+        for(int idx = 0; idx < _queue.size(); idx++) {
+          if(_queue[idx].first <= now) {
+            session.Receive(_queue[idx].second, now);
+          } else {
+            pending.append(_queue[idx]);
+          }
+        }
+        _queue = pending;
+      }
+
+    private:
+      CryptoRandom &_rand;
+      int _loss;
+      int _duplicate;
+      int _jitter;
+      QList<QPair<qint64, QByteArray> > _queue;
+  };
+
+  void UdpSessionExchange(int loss, int duplicate, int jitter)
+  {
+    CryptoRandom rand(Hash().ComputeHash(QByteArray("UdpSession")));
+    UdpSession initiator(77, true);
+    UdpSession responder(77, false);
+    LossyChannel to_responder(rand, loss, duplicate, jitter);
+    LossyChannel to_initiator(rand, loss, duplicate, jitter);
+
+    // Empty, single fragment, and many fragment messages in both directions
+    QList<QByteArray> sent0, sent1;
+    for(int idx = 0; idx < 40; idx++) {
+      QByteArray msg0(rand.GetInt(0, 20000), 0);
+      rand.GenerateBlock(msg0);
+      sent0.append(msg0);
+      initiator.Send(msg0);
+
+      QByteArray msg1(idx % 4 == 0 ? 0 : rand.GetInt(0, 3000), 0);
+      rand.GenerateBlock(msg1);
+      sent1.append(msg1);
+      responder.Send(msg1);
+    }
+
+    QList<QByteArray> received0, received1;
+    qint64 now = 0;
+    while(received0.size() < sent1.size() || received1.size() < sent0.size() ||
+        initiator.HasTimers() || responder.HasTimers())
+    {
+      ASSERT_FALSE(initiator.Failed());
+      ASSERT_FALSE(responder.Failed());
+      ASSERT_LT(now, 600000);
+
+      now++;
+      to_responder.Transmit(initiator.TakeDatagrams(now), now);
+      to_initiator.Transmit(responder.TakeDatagrams(now), now);
+      to_responder.Deliver(responder, now);
+      to_initiator.Deliver(initiator, now);
+      received0.append(initiator.TakeMessages());
+      received1.append(responder.TakeMessages());
+    }
+
+    EXPECT_EQ(sent1, received0);
+    EXPECT_EQ(sent0, received1);
+  }
+
+  TEST(EdgeTest, UdpSession)
+  {
+    UdpSessionExchange(0, 0, 0);
+    UdpSessionExchange(20, 10, 30);
+    UdpSessionExchange(40, 20, 50);
+  }
+
+  TEST(EdgeTest, UdpSessionFail)
+  {
+    // A silent remote side
+    UdpSession initiator(5, true);
+    initiator.Send(QByteArray(100, 1));
+    qint64 now = 0;
+    while(!initiator.Failed() && now < 600000) {
+      initiator.TakeDatagrams(++now);
+    }
+    EXPECT_TRUE(initiator.Failed());
+    EXPECT_FALSE(initiator.Connected());
+
+    // A remote side that stops acknowledging
+    UdpSession responder(6, false);
+    QByteArray syn(UdpSession::HEADER_SIZE, 0);
+    syn[0] = char(UdpSession::Syn);
+    syn[4] = 6;
+    responder.Receive(syn, 0);
+    EXPECT_TRUE(responder.Connected());
+    responder.Send(QByteArray(100, 1));
+    now = 0;
+    while(!responder.Failed() && now < 600000) {
+      responder.TakeDatagrams(++now);
+    }
+    EXPECT_TRUE(responder.Failed());
+    EXPECT_EQ(responder.GetFailReason(), QString("Timed out"));
+  }
+
+  TEST(EdgeTest, UdpSessionOversized)
+  {
+    UdpSession responder(7, false);
+    QByteArray syn(UdpSession::HEADER_SIZE, 0);
+    syn[0] = char(UdpSession::Syn);
+    syn[4] = 7;
+    responder.Receive(syn, 0);
+    ASSERT_TRUE(responder.Connected());
+
+    // Fragments that never end a message
+    QByteArray data(UdpSession::HEADER_SIZE + UdpSession::MAX_PAYLOAD, 1);
+    data[0] = char(UdpSession::Data);
+    data[1] = 0;
+    Utils::Serialization::WriteInt(7, data, 4);
+    int limit = UdpSession::MAX_MESSAGE_SIZE / UdpSession::MAX_PAYLOAD + 1;
+    for(int seq = 0; seq <= limit && !responder.Failed(); seq++) {
+      Utils::Serialization::WriteInt(seq, data, 8);
+      responder.Receive(data, 1);
+    }
+
+    EXPECT_TRUE(responder.Failed());
+    EXPECT_EQ(responder.GetFailReason(), QString("Message too large"));
+    EXPECT_TRUE(responder.TakeMessages().isEmpty());
+  }
+
+  TEST(EdgeTest, UdpFraming)
+  {
+    Timer::GetInstance().UseRealTime();
+
+    const UdpAddress addr0("127.0.0.1", TEST_PORT + 6);
+    UdpEdgeListener ue0(addr0);
+    MockEdgeHandler meh0(&ue0);
+    ue0.Start();
+
+    const UdpAddress addr1("127.0.0.1", TEST_PORT + 7);
+    UdpEdgeListener ue1(addr1);
+    MockEdgeHandler meh1(&ue1);
+    ue1.Start();
+
+    SignalCounter edges(2);
+    QObject::connect(&ue0, SIGNAL(NewEdge(const QSharedPointer<Edge> &)),
+        &edges, SLOT(Counter()));
+    QObject::connect(&ue1, SIGNAL(NewEdge(const QSharedPointer<Edge> &)),
+        &edges, SLOT(Counter()));
+
+    ue1.CreateEdgeTo(addr0);
+    MockExecLoop(edges);
+    EXPECT_TRUE(meh1.edge->Outbound());
+    EXPECT_FALSE(meh0.edge->Outbound());
+
+    BufferSink sink0, sink1;
+    meh0.edge->SetSink(&sink0);
+    meh1.edge->SetSink(&sink1);
+
+    CryptoRandom rand;
+    QList<QByteArray> messages;
+    for(int idx = 0; idx < 40; idx++) {
+      QByteArray msg(idx % 10 == 9 ? 1024 * 1024 : idx * 100, 0);
+      rand.GenerateBlock(msg);
+      messages.append(msg);
+    }
+
+    SignalCounter received(2 * messages.size());
+    QObject::connect(&sink0, SIGNAL(DataReceived()), &received, SLOT(Counter()));
+    QObject::connect(&sink1, SIGNAL(DataReceived()), &received, SLOT(Counter()));
+
+    foreach(const QByteArray &msg, messages) {
+      meh1.edge->Send(msg);
+      meh0.edge->Send(msg);
+    }
+    MockExecLoop(received);
+
+    ASSERT_EQ(messages.size(), sink0.Count());
+    ASSERT_EQ(messages.size(), sink1.Count());
+    for(int idx = 0; idx < messages.size(); idx++) {
+      EXPECT_EQ(messages[idx], sink0.At(idx).second);
+      EXPECT_EQ(messages[idx], sink1.At(idx).second);
+    }
+
+    // Closing one side closes the other
+    SignalCounter stopped(1);
+    QObject::connect(meh0.edge.data(), SIGNAL(StoppedSignal()),
+        &stopped, SLOT(Counter()));
+    meh1.edge->Stop("Finished");
+    MockExecLoop(stopped);
+    EXPECT_TRUE(meh0.edge->Stopped());
+
+    ue0.Stop();
+    ue1.Stop();
+    MockExec();
+  }
+
+  template<typename L, typename A> int MeasureThroughput(int port, int count, int size)
+  {
+    const A addr0("127.0.0.1", port);
+    L el0(addr0);
+    MockEdgeHandler meh0(&el0);
+    el0.Start();
+
+    const A addr1("127.0.0.1", port + 1);
+    L el1(addr1);
+    MockEdgeHandler meh1(&el1);
+    el1.Start();
+
+    SignalCounter edges(2);
+    QObject::connect(&el0, SIGNAL(NewEdge(const QSharedPointer<Edge> &)),
+        &edges, SLOT(Counter()));
+    QObject::connect(&el1, SIGNAL(NewEdge(const QSharedPointer<Edge> &)),
+        &edges, SLOT(Counter()));
+    el1.CreateEdgeTo(addr0);
+    MockExecLoop(edges);
+
+    BufferSink sink;
+    meh0.edge->SetSink(&sink);
+    SignalCounter received(count);
+    QObject::connect(&sink, SIGNAL(DataReceived()), &received, SLOT(Counter()));
+
+    QByteArray msg(size, 1);
+    QTime timer;
+    timer.start();
+    for(int idx = 0; idx < count; idx++) {
+      meh1.edge->Send(msg);
+    }
+    MockExecLoop(received);
+    int ms = std::max(1, timer.elapsed());
+    EXPECT_EQ(count, sink.Count());
+
+    meh0.edge->Stop("Finished");
+    meh1.edge->Stop("Finished");
+    el0.Stop();
+    el1.Stop();
+    MockExec();
+    return ms;
+  }
+
+  void BenchmarkUdpThroughput(int count, int size)
+  {
+    int udp_ms = MeasureThroughput<UdpEdgeListener, UdpAddress>(TEST_PORT + 6, count, size);
+    int tcp_ms = MeasureThroughput<TcpEdgeListener, TcpAddress>(TEST_PORT + 6, count, size);
+    qint64 bytes = qint64(count) * size;
+    std::cout << count << " x " << size << " byte messages, udp: " << udp_ms <<
+      " ms (" << bytes / 1000 / udp_ms << " MB/s), tcp: " << tcp_ms << " ms (" <<
+      bytes / 1000 / tcp_ms << " MB/s)" << std::endl;
+  }
+
+  TEST(EdgeTest, UdpThroughputBenchmark)
+  {
+    Timer::GetInstance().UseRealTime();
+    BenchmarkUdpThroughput(20000, 100);
+    BenchmarkUdpThroughput(2000, 10000);
+    BenchmarkUdpThroughput(200, 100000);
+  }
 }
 }
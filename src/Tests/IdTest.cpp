@@ -1,4 +1,6 @@
 #include <QDataStream>
+#include <QTime>
+#include <iostream>
 
 #include "DissentTest.hpp"
 
@@ -84,5 +86,89 @@ namespace Tests {
     EXPECT_FALSE(id1 < id0);
     EXPECT_EQ(id1, id0);
   }
+
+  TEST(Id, MatchesInteger)
+  {
+    // The cached forms must match those of the Integer they replace
+    for(int idx = 0; idx < 50; idx++) {
+      QByteArray bytes(Id::ByteSize, 0);
+      CryptoRandom().GenerateBlock(bytes);
+      for(int zero = 0; zero < idx % 4; zero++) {
+        bytes[zero] = 0;
+      }
+
+      Id id(bytes);
+      Integer integer(bytes);
+      EXPECT_EQ(integer.GetByteArray(), id.GetByteArray());
+      EXPECT_EQ(integer.ToString(), id.ToString());
+      EXPECT_EQ(integer, id.GetInteger());
+      EXPECT_EQ(id, Id(integer));
+      EXPECT_EQ(qHash(id), qHash(Id(id.ToString())));
+
+      Id other;
+      EXPECT_EQ(integer < other.GetInteger(), id < other);
+      EXPECT_EQ(integer > other.GetInteger(), id > other);
+    }
+
+    EXPECT_EQ(Integer(0).GetByteArray(), Id::Zero().GetByteArray());
+    EXPECT_EQ(Id::Zero(), Id(QByteArray()));
+    EXPECT_TRUE(Id::Zero() < Id(QByteArray(1, 1)));
+  }
+
+  TEST(Id, LookupBenchmark)
+  {
+    const int count = 1000;
+    const int rounds = 200;
+
+    QVector<PublicIdentity> identities;
+    QVector<Id> ids;
+    ConnectionTable table;
+    for(int idx = 0; idx < count; idx++) {
+      Id id;
+      ids.append(id);
+      identities.append(PublicIdentity(id));
+
+      QSharedPointer<Edge> edge(new BufferEdge(BufferAddress(1),
+            BufferAddress(idx + 2), true));
+      table.AddConnection(QSharedPointer<Connection>(
+            new Connection(edge, Id::Zero(), id)));
+    }
+    Roster roster(identities);
+
+    QTime timer;
+    timer.start();
+    int found = 0;
+    for(int round = 0; round < rounds; round++) {
+      for(int idx = 0; idx < count; idx++) {
+        found += roster.GetIndex(ids[idx]) == idx;
+      }
+    }
+    int roster_ms = std::max(1, timer.restart());
+    EXPECT_EQ(count * rounds, found);
+
+    found = 0;
+    for(int round = 0; round < rounds; round++) {
+      for(int idx = 0; idx < count; idx++) {
+        found += !table.GetConnection(ids[idx]).isNull();
+      }
+    }
+    int table_ms = std::max(1, timer.restart());
+    EXPECT_EQ(count * rounds, found);
+
+    // The cost each lookup used to pay to hash an Id
+    uint hash = 0;
+    for(int round = 0; round < rounds; round++) {
+      for(int idx = 0; idx < count; idx++) {
+        hash ^= qHash(ids[idx].GetInteger().GetByteArray());
+      }
+    }
+    int serialize_ms = std::max(1, timer.restart());
+    Q_UNUSED(hash);
+
+    std::cout << count * rounds << " lookups in " << count <<
+      " entries, roster: " << roster_ms << " ms, connection table: " <<
+      table_ms << " ms, serializing the Integer alone: " << serialize_ms <<
+      " ms" << std::endl;
+  }
 }
 }
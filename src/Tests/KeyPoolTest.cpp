@@ -0,0 +1,75 @@
+#include "DissentTest.hpp"
+
+namespace Dissent {
+namespace Tests {
+  TEST(KeyPool, EmptyFallback)
+  {
+    bool tmp = Utils::MultiThreading;
+    Utils::MultiThreading = false;
+
+    KeyPool pool(2, 4);
+    EXPECT_EQ(0, pool.Count());
+    EXPECT_EQ(0, pool.Pending());
+
+    // Without the thread pool every key is generated on demand
+    for(int idx = 0; idx < 2; idx++) {
+      QSharedPointer<AsymmetricKey> key = pool.Take();
+      ASSERT_FALSE(key.isNull());
+      EXPECT_TRUE(key->IsValid());
+    }
+    EXPECT_EQ(0, pool.Count());
+    EXPECT_EQ(0, pool.Pending());
+    EXPECT_EQ(0, pool.GetHits());
+    EXPECT_EQ(2, pool.GetMisses());
+    EXPECT_EQ(2, pool.GetKeysGenerated());
+
+    Utils::MultiThreading = tmp;
+  }
+
+  TEST(KeyPool, TakeAndRefill)
+  {
+    bool tmp = Utils::MultiThreading;
+    Utils::MultiThreading = true;
+
+    // Nothing is generated before the first key is taken
+    KeyPool pool(2, 3);
+    EXPECT_EQ(0, pool.Pending());
+
+    SignalCounter sc(3);
+    QObject::connect(&pool, SIGNAL(KeyAvailable()), &sc, SLOT(Counter()));
+
+    // The empty pool generates one synchronously and fills up behind it
+    QSharedPointer<AsymmetricKey> first = pool.Take();
+    ASSERT_FALSE(first.isNull());
+    EXPECT_EQ(1, pool.GetMisses());
+    EXPECT_EQ(3, pool.Pending());
+
+    MockExecLoop(sc, 10);
+    EXPECT_EQ(3, pool.Count());
+    EXPECT_EQ(0, pool.Pending());
+    EXPECT_EQ(4, pool.GetKeysGenerated());
+
+    // Taking down to the low watermark does not refill
+    QSharedPointer<AsymmetricKey> second = pool.Take();
+    ASSERT_FALSE(second.isNull());
+    EXPECT_NE(first->GetByteArray(), second->GetByteArray());
+    EXPECT_EQ(2, pool.Count());
+    EXPECT_EQ(0, pool.Pending());
+
+    // Falling below it refills up to the high watermark
+    EXPECT_FALSE(pool.Take().isNull());
+    EXPECT_EQ(1, pool.Count());
+    EXPECT_EQ(2, pool.Pending());
+    EXPECT_EQ(2, pool.GetHits());
+    EXPECT_EQ(1, pool.GetMisses());
+
+    SignalCounter refill(2);
+    QObject::connect(&pool, SIGNAL(KeyAvailable()), &refill, SLOT(Counter()));
+    MockExecLoop(refill, 10);
+    EXPECT_EQ(3, pool.Count());
+    EXPECT_EQ(0, pool.Pending());
+
+    Utils::MultiThreading = tmp;
+  }
+}
+}
@@ -0,0 +1,99 @@
+#include "DissentTest.hpp"
+
+namespace Dissent {
+namespace Tests {
+  namespace {
+    QByteArray Packet(int size, char fill)
+    {
+      return QByteArray(size, fill);
+    }
+  }
+
+  TEST(Log, Basic)
+  {
+    Log log;
+    Id id0, id1;
+    log.Append(Packet(10, 'a'), id0);
+    log.Append(Packet(5000, 'b'), id1);
+    ASSERT_EQ(log.Count(), 2);
+    EXPECT_FALSE(log.IsDigest(1));
+    EXPECT_EQ(log.At(1).first, Packet(5000, 'b'));
+    EXPECT_EQ(log.At(1).second, id1);
+    EXPECT_EQ(log.Bytes(), 5010);
+
+    log.Pop();
+    ASSERT_EQ(log.Count(), 1);
+    EXPECT_EQ(log.At(0).first, Packet(10, 'a'));
+    EXPECT_TRUE(log.At(1).first.isEmpty());
+
+    Log copy(log.Serialize());
+    ASSERT_EQ(copy.Count(), 1);
+    EXPECT_EQ(copy.At(0).first, Packet(10, 'a'));
+    EXPECT_EQ(copy.At(0).second, id0);
+  }
+
+  TEST(Log, Bounded)
+  {
+    Log log;
+    log.SetLimits(100, 50);
+    Id id;
+
+    log.Append(Packet(1000, 'a'), id);
+    ASSERT_TRUE(log.IsDigest(0));
+    EXPECT_EQ(log.GetDigest(0), Hash().ComputeHash(Packet(1000, 'a')));
+    EXPECT_TRUE(log.At(0).first.isEmpty());
+    EXPECT_TRUE(log.Bytes() < 100);
+
+    for(int idx = 0; idx < 10; idx++) {
+      log.Append(Packet(40, 'b' + idx), id);
+    }
+    EXPECT_TRUE(log.Bytes() <= 100);
+    EXPECT_EQ(log.Count() + log.Dropped(), 11);
+    EXPECT_EQ(log.At(log.Count() - 1).first, Packet(40, 'b' + 9));
+
+    log.Clear();
+    EXPECT_EQ(log.Count(), 0);
+    EXPECT_EQ(log.Bytes(), 0);
+    EXPECT_EQ(log.Dropped(), 0);
+  }
+
+  TEST(Log, Spill)
+  {
+    QString filename = "log_spill_test";
+    Id id;
+    {
+      Log log;
+      log.SetLimits(0, 50);
+      ASSERT_TRUE(log.SetSpillFile(filename));
+
+      log.Append(Packet(10, 'a'), id);
+      log.Append(Packet(100, 'b'), id);
+      EXPECT_TRUE(log.IsDigest(1));
+      EXPECT_EQ(log.At(1).first, Packet(100, 'b'));
+      log.Spill();
+      EXPECT_EQ(log.Count(), 0);
+
+      // A popped packet is reclaimed from the file
+      qint64 size = QFile(filename).size();
+      log.Append(Packet(200, 'c'), id);
+      log.Pop();
+      EXPECT_EQ(QFile(filename).size(), size);
+
+      log.Append(Packet(300, 'd'), id);
+      log.Spill();
+    }
+
+    QList<Log> logs;
+    ASSERT_TRUE(Log::ReadSpillFile(filename, logs));
+    ASSERT_EQ(logs.count(), 2);
+    ASSERT_EQ(logs[0].Count(), 2);
+    EXPECT_EQ(logs[0].At(0).first, Packet(10, 'a'));
+    EXPECT_EQ(logs[0].At(1).first, Packet(100, 'b'));
+    ASSERT_EQ(logs[1].Count(), 1);
+    EXPECT_EQ(logs[1].GetDigest(0), Hash().ComputeHash(Packet(300, 'd')));
+    EXPECT_EQ(logs[1].At(0).first, Packet(300, 'd'));
+
+    QFile(filename).remove();
+  }
+}
+}
@@ -1,6 +1,7 @@
 #ifndef DISSENT_TESTS_MOCK_EDGE_HANDLER_H_GUARD
 #define DISSENT_TESTS_MOCK_EDGE_HANDLER_H_GUARD
 
+#include <QList>
 #include <QObject>
 #include <QSharedPointer>
 
@@ -20,11 +21,13 @@ namespace Tests {
 
       virtual ~MockEdgeHandler() {}
       QSharedPointer<Edge> edge;
+      QList<QSharedPointer<Edge> > edges;
 
     private slots:
       void HandleEdge(const QSharedPointer<Edge> &edge)
       {
         this->edge = edge;
+        edges.append(edge);
       }
   };
 }
@@ -1,4 +1,6 @@
 #include "DissentTest.hpp"
+#include <QTime>
+#include <iostream>
 
 namespace Dissent {
 namespace Tests {
@@ -350,6 +352,65 @@ namespace Tests {
     }
   }
 
+  /**
+   * Builds a verifiable onion of count messages under the keys, returns the
+   * time in ms taken by VerifyAll
+   */
+  int VerifyAllTime(OnionEncryptor &oe,
+      const QVector<QSharedPointer<AsymmetricKey> > &private_keys,
+      const QVector<QSharedPointer<AsymmetricKey> > &public_keys, int count)
+  {
+    QVector<QByteArray> cleartexts;
+    QVector<QByteArray> ciphertexts;
+    QVector<QVector<QByteArray> > random_bits;
+    CryptoRandom rand;
+
+    for(int idx = 0; idx < count; idx++) {
+      QByteArray cleartext(64, 0);
+      rand.GenerateBlock(cleartext);
+      QByteArray ciphertext;
+      QVector<QByteArray> random;
+      EXPECT_EQ(oe.Encrypt(public_keys, cleartext, ciphertext, &random), -1);
+      cleartexts.append(cleartext);
+      ciphertexts.append(ciphertext);
+      random_bits.append(random);
+    }
+
+    QVector<QVector<QByteArray> > onions;
+    EXPECT_EQ(oe.ReorderRandomBits(random_bits, onions), -1);
+    onions.prepend(cleartexts);
+    onions.append(ciphertexts);
+
+    QBitArray bad;
+    QTime timer;
+    timer.start();
+    EXPECT_TRUE(oe.VerifyAll(private_keys, onions, bad));
+    return std::max(1, timer.elapsed());
+  }
+
+  TEST(Crypto, VerifyAllBenchmark)
+  {
+    int layers = 4;
+    QVector<QSharedPointer<AsymmetricKey> > private_keys;
+    QVector<QSharedPointer<AsymmetricKey> > public_keys;
+    for(int idx = 0; idx < layers; idx++) {
+      private_keys.append(QSharedPointer<AsymmetricKey>(new RsaPrivateKey()));
+      public_keys.append(QSharedPointer<AsymmetricKey>(private_keys.last()->GetPublicKey()));
+    }
+
+    OnionEncryptor oe;
+    ThreadedOnionEncryptor toe;
+    for(int count = 32; count <= 256; count *= 2) {
+      int single_ms = VerifyAllTime(oe, private_keys, public_keys, count);
+      int threaded_ms = VerifyAllTime(toe, private_keys, public_keys, count);
+      std::cout << "VerifyAll of " << count << " messages over " << layers <<
+        " layers, single threaded: " << single_ms << " ms (" <<
+        (single_ms * 1000 / count) << " us per message), multithreaded: " <<
+        threaded_ms << " ms (" << (threaded_ms * 1000 / count) <<
+        " us per message)" << std::endl;
+    }
+  }
+
   TEST(Crypto, DecryptSingleThreaded)
   {
     OnionEncryptor oe;
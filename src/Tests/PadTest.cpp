@@ -0,0 +1,221 @@
+#include "DissentTest.hpp"
+
+namespace Dissent {
+namespace Tests {
+  QList<QByteArray> GenerateSeeds(int count)
+  {
+    CryptoRandom rand;
+    QList<QByteArray> seeds;
+    for(int idx = 0; idx < count; idx++) {
+      QByteArray seed(CryptoRandom::OptimalSeedSize(), 0);
+      rand.GenerateBlock(seed);
+      seeds.append(seed);
+    }
+    return seeds;
+  }
+
+  /**
+   * The original CSDCNetRound::GenerateCiphertext pad expansion
+   */
+  QByteArray LegacyPads(const QList<QByteArray> &seeds, int length,
+      QVector<QByteArray> *pads = 0)
+  {
+    QByteArray xor_msg(length, 0);
+    QByteArray tmsg(length, 0);
+    foreach(const QByteArray &seed, seeds) {
+      CryptoRandom(seed).GenerateBlock(tmsg);
+      if(pads) {
+        pads->append(tmsg);
+      }
+      BaseDCNetRound::Xor(xor_msg, xor_msg, tmsg);
+    }
+    return xor_msg;
+  }
+
+  QByteArray EnginePads(const QList<QByteArray> &seeds, int length,
+      PadGenerator::Mode mode, int tile_size = PadEngine::DEFAULT_TILE_SIZE)
+  {
+    PadEngine engine(mode, tile_size);
+    foreach(const QByteArray &seed, seeds) {
+      engine.AddSeed(seed);
+    }
+
+    QByteArray output(length, 0);
+    engine.Accumulate(output);
+    return output;
+  }
+
+  TEST(PadEngine, CompatibleMatchesCryptoRandom)
+  {
+    QList<QByteArray> seeds = GenerateSeeds(10);
+    int length = 3 * 64 + 5;
+
+    QByteArray legacy = LegacyPads(seeds, length);
+    EXPECT_EQ(legacy, EnginePads(seeds, length, PadGenerator::COMPATIBLE, 64));
+    EXPECT_EQ(legacy, EnginePads(seeds, length, PadGenerator::COMPATIBLE));
+  }
+
+  TEST(PadEngine, TiledOutputIndependentOfTileSize)
+  {
+    QList<QByteArray> seeds = GenerateSeeds(10);
+    int length = 5 * 1024 + 7;
+
+    QByteArray ctr = EnginePads(seeds, length, PadGenerator::AES_CTR);
+    EXPECT_EQ(ctr, EnginePads(seeds, length, PadGenerator::AES_CTR, 16));
+    EXPECT_EQ(ctr, EnginePads(seeds, length, PadGenerator::AES_CTR, 1000));
+    EXPECT_NE(ctr, EnginePads(seeds, length, PadGenerator::COMPATIBLE));
+    EXPECT_NE(ctr, QByteArray(length, 0));
+  }
+
+  TEST(PadEngine, IndividualPads)
+  {
+    QList<QByteArray> seeds = GenerateSeeds(5);
+    int length = 1000;
+
+    QVector<QByteArray> legacy_pads;
+    QByteArray legacy = LegacyPads(seeds, length, &legacy_pads);
+
+    PadEngine engine(PadGenerator::COMPATIBLE, 256);
+    foreach(const QByteArray &seed, seeds) {
+      engine.AddSeed(seed);
+    }
+
+    QVector<QByteArray> pads;
+    QByteArray output(length, 0);
+    engine.Accumulate(output, pads);
+    EXPECT_EQ(legacy, output);
+    EXPECT_EQ(legacy_pads, pads);
+
+    for(int idx = 0; idx < seeds.size(); idx++) {
+      EXPECT_EQ(pads[idx], PadGenerator(seeds[idx]).GeneratePad(length));
+      EXPECT_NE(pads[idx], PadGenerator(seeds[idx],
+            PadGenerator::AES_CTR).GeneratePad(length));
+    }
+  }
+
+  TEST(PadEngine, Parallel)
+  {
+    QList<QByteArray> seeds = GenerateSeeds(33);
+    int length = 4 * 1024 + 3;
+
+    QVector<QByteArray> legacy_pads;
+    QByteArray legacy = LegacyPads(seeds, length, &legacy_pads);
+
+    PadEngine engine(PadGenerator::COMPATIBLE, 1024);
+    foreach(const QByteArray &seed, seeds) {
+      engine.AddSeed(seed);
+    }
+
+    QVector<QByteArray> pads;
+    QByteArray output(length, 0);
+    engine.ParallelAccumulate(output, pads);
+    EXPECT_EQ(legacy, output);
+    EXPECT_EQ(legacy_pads, pads);
+
+    PadEngine ctr_engine(PadGenerator::AES_CTR);
+    foreach(const QByteArray &seed, seeds) {
+      ctr_engine.AddSeed(seed);
+    }
+
+    QByteArray ctr(length, 0);
+    ctr_engine.ParallelAccumulate(ctr);
+    EXPECT_EQ(EnginePads(seeds, length, PadGenerator::AES_CTR), ctr);
+  }
+
+  TEST(PadGenerator, GetByte)
+  {
+    QList<QByteArray> seeds = GenerateSeeds(2);
+    int length = 1000;
+    QList<PadGenerator::Mode> modes;
+    modes << PadGenerator::COMPATIBLE << PadGenerator::AES_CTR;
+
+    foreach(PadGenerator::Mode mode, modes) {
+      PadGenerator generator(seeds[0], mode);
+      QByteArray pad = PadGenerator(seeds[0], mode).GeneratePad(length);
+
+      QList<int> offsets;
+      offsets << 0 << 15 << 16 << 17 << 255 << 256 << (length - 1);
+      for(int idx = 0; idx < 10; idx++) {
+        offsets << Random::GetInstance().GetInt(0, length);
+      }
+
+      foreach(int offset, offsets) {
+        EXPECT_EQ(pad[offset], generator.GetByte(offset));
+      }
+
+      // GetByte does not disturb the stream
+      EXPECT_EQ(pad.left(32), generator.GeneratePad(32));
+      EXPECT_EQ(pad[5], generator.GetByte(5));
+      EXPECT_EQ(pad.mid(32, 32), generator.GeneratePad(32));
+    }
+  }
+
+  TEST(PadEngine, Benchmark)
+  {
+    QList<QByteArray> seeds = GenerateSeeds(64);
+    int length = 64 * 1024;
+    int pads = seeds.size();
+
+    QTime timer;
+    timer.start();
+    QByteArray legacy = LegacyPads(seeds, length);
+    int legacy_ms = std::max(1, timer.restart());
+    QByteArray compatible = EnginePads(seeds, length, PadGenerator::COMPATIBLE);
+    int compatible_ms = std::max(1, timer.restart());
+    QByteArray ctr = EnginePads(seeds, length, PadGenerator::AES_CTR);
+    int ctr_ms = std::max(1, timer.restart());
+
+    EXPECT_EQ(legacy, compatible);
+    EXPECT_NE(legacy, ctr);
+
+    std::cout << "Pads of " << length << " bytes per second, legacy: " <<
+      (pads * 1000 / legacy_ms) << ", compatible: " <<
+      (pads * 1000 / compatible_ms) << ", aes-ctr: " <<
+      (pads * 1000 / ctr_ms) << std::endl;
+  }
+
+  TEST(PadGenerator, BlameBenchmark)
+  {
+    // Blame reads one byte of every client's pad, deep into the phase
+    QList<QByteArray> seeds = GenerateSeeds(256);
+    int length = 64 * 1024;
+    int offset = length - 1;
+
+    QVector<QByteArray> stored;
+    LegacyPads(seeds, length, &stored);
+
+    QTime timer;
+    timer.start();
+    QByteArray stored_bytes;
+    foreach(const QByteArray &pad, stored) {
+      stored_bytes.append(pad[offset]);
+    }
+    int stored_ms = timer.restart();
+
+    QByteArray compatible_bytes;
+    foreach(const QByteArray &seed, seeds) {
+      compatible_bytes.append(PadGenerator(seed,
+            PadGenerator::COMPATIBLE).GetByte(offset));
+    }
+    int compatible_ms = timer.restart();
+
+    PadGenerator::Mode mode = CSDCNetRound::PAD_MODE;
+    QByteArray round_bytes;
+    foreach(const QByteArray &seed, seeds) {
+      round_bytes.append(PadGenerator(seed, mode).GetByte(offset));
+    }
+    int round_ms = timer.restart();
+
+    EXPECT_EQ(stored_bytes, compatible_bytes);
+    if(mode == PadGenerator::COMPATIBLE) {
+      EXPECT_EQ(stored_bytes, round_bytes);
+    }
+
+    std::cout << "Blame over " << seeds.size() << " pads at byte " <<
+      offset << ", stored pads: " << stored_ms << " ms, compatible: " <<
+      compatible_ms << " ms, round default (" <<
+      (mode == PadGenerator::AES_CTR ? "aes-ctr" : "compatible") << "): " <<
+      round_ms << " ms" << std::endl;
+  }
+}
+}
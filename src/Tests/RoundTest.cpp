@@ -1,3 +1,6 @@
+#include <iostream>
+#include <QTime>
+
 #include "DissentTest.hpp"
 #include "OverlayTest.hpp"
 #include "SessionTest.hpp"
@@ -131,6 +134,111 @@ namespace Tests {
     ConnectionManager::UseTimer = true;
   }
 
+  /**
+   * Returns true if every server's round has exactly count clients
+   */
+  bool ServerRosters(const Sessions &sessions, int count)
+  {
+    foreach(const ServerPointer &ss, sessions.servers) {
+      QSharedPointer<Round> round = ss->GetRound();
+      if(!round || round->GetClients().Count() != count) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void StartLateClient(const Sessions &late, int idx)
+  {
+    late.network.second[idx]->Start();
+    late.clients[idx]->Start();
+  }
+
+  void TestRoundJoin(CreateRound create_round)
+  {
+    int servers = 3, clients = 10, joiners = CSDCNetRound::MIN_JOIN_BATCH;
+    ConnectionManager::UseTimer = false;
+    Timer::GetInstance().UseVirtualTime();
+    OverlayNetwork net = ConstructOverlay(servers, clients + joiners);
+    VerifyStoppedNetwork(net);
+    Sessions sessions = BuildSessions(net, create_round);
+
+    // The last clients come online once the round is running
+    Sessions late;
+    for(int idx = 0; idx < joiners; idx++) {
+      late.network.second.prepend(sessions.network.second.takeLast());
+      late.clients.prepend(sessions.clients.takeLast());
+      late.sinks.prepend(sessions.sinks.takeLast());
+      late.signal_sinks.prepend(sessions.signal_sinks.takeLast());
+      late.sink_multiplexers.prepend(sessions.sink_multiplexers.takeLast());
+    }
+
+    StartNetwork(sessions.network);
+    VerifyNetwork(sessions.network);
+
+    qDebug() << "Starting sessions...";
+    StartSessions(sessions);
+    SendTest(sessions);
+
+    QList<QSharedPointer<Round> > rounds;
+    foreach(const ServerPointer &ss, sessions.servers) {
+      rounds.append(ss->GetRound());
+    }
+
+    // Fewer than a batch are held back
+    for(int idx = 0; idx < joiners - 1; idx++) {
+      StartLateClient(late, idx);
+    }
+    SendTest(sessions);
+    SendTest(sessions);
+    EXPECT_TRUE(ServerRosters(sessions, clients));
+
+    StartLateClient(late, joiners - 1);
+    qint64 next = Timer::GetInstance().VirtualRun();
+    while(next != -1 && !ServerRosters(sessions, clients + joiners)) {
+      Time::GetInstance().IncrementVirtualClock(next);
+      next = Timer::GetInstance().VirtualRun();
+    }
+    ASSERT_TRUE(ServerRosters(sessions, clients + joiners));
+
+    while(!late.clients.isEmpty()) {
+      sessions.network.second.append(late.network.second.takeFirst());
+      sessions.clients.append(late.clients.takeFirst());
+      sessions.sinks.append(late.sinks.takeFirst());
+      sessions.signal_sinks.append(late.signal_sinks.takeFirst());
+      sessions.sink_multiplexers.append(late.sink_multiplexers.takeFirst());
+    }
+
+    // Both the admitted and the existing slots carry messages
+    SendTest(sessions);
+    SendTest(sessions);
+    for(int idx = 0; idx < servers; idx++) {
+      EXPECT_EQ(rounds[idx], sessions.servers[idx]->GetRound());
+      EXPECT_FALSE(rounds[idx]->Stopped());
+    }
+
+    // An admitted client going offline leaves the others' slots alone
+    late.network.second.append(sessions.network.second.takeLast());
+    late.clients.append(sessions.clients.takeLast());
+    late.sinks.append(sessions.sinks.takeLast());
+    late.signal_sinks.append(sessions.signal_sinks.takeLast());
+    late.sink_multiplexers.append(sessions.sink_multiplexers.takeLast());
+    late.clients.last()->Stop("Offline");
+    late.network.second.last()->Stop();
+
+    SendTest(sessions);
+    SendTest(sessions);
+    for(int idx = 0; idx < servers; idx++) {
+      EXPECT_EQ(rounds[idx], sessions.servers[idx]->GetRound());
+      EXPECT_FALSE(rounds[idx]->Stopped());
+    }
+
+    StopSessions(sessions);
+    StopNetwork(sessions.network);
+    VerifyStoppedNetwork(sessions.network);
+    ConnectionManager::UseTimer = true;
+  }
+
   template <int N> class CSDCNetRoundBad : public CSDCNetRound, public Triggerable {
     public:
       explicit CSDCNetRoundBad(const Identity::Roster &clients,
@@ -141,7 +249,10 @@ namespace Tests {
           Messaging::GetDataCallback &get_data,
           CreateRound create_shuffle) :
         CSDCNetRound(clients, servers, ident, nonce, overlay, get_data,
-            create_shuffle)
+            create_shuffle),
+        _bad_phase(-1),
+        _bad_client(-1),
+        _bad_offset(-1)
       {
       }
 
@@ -170,9 +281,10 @@ namespace Tests {
           QSharedPointer<CSDCNetRound::State> cstate = GetState();
           QSharedPointer<CSDCNetRound::ServerState> state =
             cstate.dynamicCast<CSDCNetRound::ServerState>();
-          int bc = Random::GetInstance().GetInt(0, state->anonymous_rngs.size());
-          state->current_phase_log->my_sub_ciphertexts[bc][offset] =
-            state->current_phase_log->my_sub_ciphertexts[bc][offset] ^ 0xff;
+          int bc = Random::GetInstance().GetInt(0, state->anonymous_pads.Count());
+          _bad_phase = state->current_phase_log->phase;
+          _bad_client = state->rng_to_gidx[bc];
+          _bad_offset = offset;
         }
 
         qDebug() << "up to no good";
@@ -194,6 +306,19 @@ namespace Tests {
         }
       }
 
+      /**
+       * Claims the pad shared with _bad_client covered the damage
+       */
+      virtual QPair<QBitArray, QBitArray> GetBlameBits(int phase, int msg_idx)
+      {
+        QPair<QBitArray, QBitArray> bits =
+          CSDCNetRound::GetBlameBits(phase, msg_idx);
+        if(phase == _bad_phase && msg_idx / 8 == _bad_offset) {
+          bits.second[_bad_client] = !bits.second[_bad_client];
+        }
+        return bits;
+      }
+
     private:
       void GenerateBadServerCiphertext()
       {
@@ -231,17 +356,28 @@ namespace Tests {
           return CSDCNetRound::GenerateServerCiphertext();
         }
 
-        int size = state->client_ciphertexts.size();
+        int size = state->client_ciphertext_count;
         if(size == 0) {
           qDebug() << "No damage done";
           return CSDCNetRound::GenerateServerCiphertext();
         }
 
-        int tochange = Random::GetInstance().GetInt(0, size);
-        QPair<int, QByteArray> &data = state->client_ciphertexts[tochange];
+        int tochange = -1;
+        int count = Random::GetInstance().GetInt(0, size);
+        for(int idx = 0; idx < state->handled_clients.size(); idx++) {
+          if(state->current_phase_log->GetMessage(idx).isEmpty()) {
+            continue;
+          } else if(count-- == 0) {
+            tochange = idx;
+            break;
+          }
+        }
+
+        QByteArray data = state->current_phase_log->GetMessage(tochange);
         int offset = Random::GetInstance().GetInt(GetState()->base_msg_length + 1, mlen);
-        data.second[offset] = data.second[offset] ^ 0xff;
-        state->current_phase_log->messages[data.first][offset] = data.second[offset];
+        data[offset] = data[offset] ^ 0xff;
+        state->client_aggregate[offset] = state->client_aggregate[offset] ^ 0xff;
+        state->current_phase_log->AddMessage(tochange, data);
         CSDCNetRound::GenerateServerCiphertext();
 
         qDebug() << "up to no good";
@@ -251,8 +387,170 @@ namespace Tests {
       void GenerateMatchingCiphertext()
       {
       }
+
+      int _bad_phase;
+      int _bad_client;
+      int _bad_offset;
+  };
+
+  /**
+   * Sets the pipeline depth of the rounds a test constructs, restoring the
+   * previous depth when the test ends
+   */
+  class PipelineDepthGuard {
+    public:
+      explicit PipelineDepthGuard(int depth) :
+        _depth(CSDCNetRound::GetDefaultPipelineDepth())
+      {
+        CSDCNetRound::SetDefaultPipelineDepth(depth);
+      }
+
+      ~PipelineDepthGuard()
+      {
+        CSDCNetRound::SetDefaultPipelineDepth(_depth);
+      }
+
+    private:
+      int _depth;
+  };
+
+  class CSDCNetRoundPipelined : public CSDCNetRound {
+    public:
+      explicit CSDCNetRoundPipelined(const Identity::Roster &clients,
+          const Identity::Roster &servers,
+          const Identity::PrivateIdentity &ident,
+          const QByteArray &nonce,
+          const QSharedPointer<ClientServer::Overlay> &overlay,
+          Messaging::GetDataCallback &get_data,
+          CreateRound create_shuffle) :
+        CSDCNetRound(clients, servers, ident, nonce, overlay, get_data,
+            create_shuffle)
+      {
+        SetPipelineDepth(3);
+      }
+  };
+
+  /**
+   * Records the packets QueueVerify and QueuePacket hand back
+   */
+  class VerifyQueueRound : public NullRound {
+    public:
+      struct Delivery {
+        Id from;
+        QByteArray packet;
+        bool signed_packet;
+        QByteArray verified;
+      };
+
+      explicit VerifyQueueRound(const Identity::Roster &clients,
+          const Identity::PrivateIdentity &ident) :
+        NullRound(clients, Identity::Roster(), ident, QByteArray(),
+            QSharedPointer<ClientServer::Overlay>(),
+            Messaging::EmptyGetDataCallback::GetInstance())
+      {
+      }
+
+      using Round::QueueVerify;
+      using Round::QueuePacket;
+      using Round::VerifyPending;
+
+      QList<Delivery> deliveries;
+
+    protected:
+      virtual void ProcessQueued(const Id &from, const QByteArray &packet,
+          const QByteArray *verified)
+      {
+        Delivery delivery;
+        delivery.from = from;
+        delivery.packet = packet;
+        delivery.signed_packet = verified != 0;
+        if(verified) {
+          delivery.verified = *verified;
+        }
+        deliveries.append(delivery);
+      }
   };
 
+  void TestQueueVerify()
+  {
+    CryptoRandom rand;
+    QVector<QSharedPointer<AsymmetricKey> > keys;
+    QVector<PublicIdentity> roster;
+    for(int idx = 0; idx < 3; idx++) {
+      QSharedPointer<AsymmetricKey> key(new DsaPrivateKey());
+      keys.append(key);
+      roster.append(PublicIdentity(Id(), key->GetPublicKey()));
+    }
+
+    VerifyQueueRound round(Roster(roster),
+        PrivateIdentity(roster[0].GetId(), keys[0]));
+
+    QList<VerifyQueueRound::Delivery> expected;
+    for(int idx = 0; idx < 40; idx++) {
+      int key_idx = idx % keys.size();
+      Id from = roster[key_idx].GetId();
+      QByteArray msg(32, 0);
+      rand.GenerateBlock(msg);
+
+      if(idx % 10 == 5) {
+        QByteArray packet = QByteArray(1, 'p') + msg;
+        round.QueuePacket(from, packet);
+        VerifyQueueRound::Delivery delivery = {from, packet, false, QByteArray()};
+        expected.append(delivery);
+        continue;
+      }
+
+      QByteArray sig = keys[key_idx]->Sign(msg);
+      bool valid = true;
+      if(idx % 7 == 3) {
+        sig[0] = char(~sig[0]);
+        valid = false;
+      } else if(idx == 22) {
+        from = Id();
+        valid = false;
+      }
+
+      QByteArray packet = QByteArray(1, 'x') + msg + sig;
+      round.QueueVerify(from, packet, 1);
+      if(valid) {
+        VerifyQueueRound::Delivery delivery = {from, packet, true, msg};
+        expected.append(delivery);
+      }
+    }
+
+    int count = 0;
+    while(round.VerifyPending() && ++count != 1000) {
+      MockExec();
+      Sleeper::MSleep(1);
+    }
+    EXPECT_FALSE(round.VerifyPending());
+
+    ASSERT_EQ(expected.size(), round.deliveries.size());
+    for(int idx = 0; idx < expected.size(); idx++) {
+      const VerifyQueueRound::Delivery &delivery = round.deliveries[idx];
+      EXPECT_EQ(expected[idx].from, delivery.from);
+      EXPECT_EQ(expected[idx].packet, delivery.packet);
+      EXPECT_EQ(expected[idx].signed_packet, delivery.signed_packet);
+      EXPECT_EQ(expected[idx].verified, delivery.verified);
+    }
+  }
+
+  TEST(Round, QueueVerify)
+  {
+    bool tmp = Utils::MultiThreading;
+    Utils::MultiThreading = true;
+    TestQueueVerify();
+    Utils::MultiThreading = tmp;
+  }
+
+  TEST(Round, QueueVerifySynchronous)
+  {
+    bool tmp = Utils::MultiThreading;
+    Utils::MultiThreading = false;
+    TestQueueVerify();
+    Utils::MultiThreading = tmp;
+  }
+
   TEST(NeffShuffleRound, Basic)
   {
     TestRoundBasic(TCreateRound<NeffShuffleRound>);
@@ -268,6 +566,163 @@ namespace Tests {
     TestRoundBasic(TCreateDCNetRound<CSDCNetRound, NeffKeyShuffleRound>);
   }
 
+  TEST(CSDCNetRound, Pipelined)
+  {
+    TestRoundBasic(TCreateDCNetRound<CSDCNetRoundPipelined, NullRound>);
+  }
+
+  TEST(CSDCNetRound, Join)
+  {
+    TestRoundJoin(TCreateDCNetRound<CSDCNetRound, NullRound>);
+  }
+
+  TEST(CSDCNetRound, JoinPipelined)
+  {
+    PipelineDepthGuard depth(3);
+    TestRoundJoin(TCreateDCNetRound<CSDCNetRound, NullRound>);
+  }
+
+  /**
+   * Exposes the phase log to the tests
+   */
+  class PhaseLogAccess : public CSDCNetRound {
+    public:
+      typedef CSDCNetRound::PhaseLog Log;
+      using CSDCNetRound::RetirePhaseLogs;
+  };
+
+  TEST(CSDCNetRound, PhaseLog)
+  {
+    typedef PhaseLogAccess::Log PhaseLog;
+    const PadGenerator::Mode mode = PadGenerator::AES_CTR;
+    PhaseLog log(3, 4, mode);
+    CryptoRandom rand;
+
+    // The last client sent nothing this phase
+    QVector<QByteArray> msgs;
+    qint64 size = 0;
+    for(int idx = 0; idx < 3; idx++) {
+      QByteArray msg(64, 0);
+      rand.GenerateBlock(msg);
+      log.AddMessage(idx, msg);
+      msgs.append(msg);
+      size += msg.size();
+    }
+    EXPECT_EQ(3, log.MessageCount());
+    EXPECT_EQ(size, log.FileSize());
+    for(int idx = 0; idx < msgs.size(); idx++) {
+      EXPECT_EQ(msgs[idx], log.GetMessage(idx));
+    }
+    EXPECT_EQ(QByteArray(), log.GetMessage(3));
+
+    QVector<QByteArray> seeds;
+    for(int idx = 0; idx < 4; idx++) {
+      QByteArray seed(CryptoRandom::OptimalSeedSize(), 0);
+      rand.GenerateBlock(seed);
+      log.SetPadSeed(idx, seed);
+      seeds.append(seed);
+    }
+
+    // Pads are regenerated from the seeds rather than stored
+    for(int bit = 0; bit < 64 * 8; bit += 37) {
+      int byte_idx = bit / 8;
+      unsigned char mask = bit_masks[bit % 8];
+      const QPair<QBitArray, QBitArray> bits = log.GetBitsAtIndex(bit);
+      for(int idx = 0; idx < 4; idx++) {
+        bool client = idx < msgs.size() && (msgs[idx][byte_idx] & mask);
+        EXPECT_EQ(client, bits.first[idx]);
+        bool mine = PadGenerator(seeds[idx], mode).GetByte(byte_idx) & mask;
+        EXPECT_EQ(mine, bits.second[idx]);
+      }
+    }
+
+    // Server ciphertexts reach the file only once archived
+    Id server;
+    QByteArray server_msg(64, 0);
+    rand.GenerateBlock(server_msg);
+    log.AddServerMessage(server, server_msg);
+    EXPECT_EQ(size, log.FileSize());
+    for(int bit = 0; bit < 64 * 8; bit += 37) {
+      char expected = (server_msg[bit / 8] >> (bit % 8)) & 1;
+      EXPECT_EQ(expected, log.GetBitAtIndex(server, bit));
+    }
+
+    log.Archive();
+    EXPECT_EQ(size + server_msg.size(), log.FileSize());
+    log.Archive();
+    EXPECT_EQ(size + server_msg.size(), log.FileSize());
+    for(int bit = 0; bit < 64 * 8; bit += 37) {
+      char expected = (server_msg[bit / 8] >> (bit % 8)) & 1;
+      EXPECT_EQ(expected, log.GetBitAtIndex(server, bit));
+    }
+
+    // Appends after reads still land at the end of the file
+    QByteArray late(32, 0);
+    rand.GenerateBlock(late);
+    log.AddMessage(3, late);
+    EXPECT_EQ(late, log.GetMessage(3));
+    EXPECT_EQ(msgs[0], log.GetMessage(0));
+    EXPECT_EQ(size + server_msg.size() + late.size(), log.FileSize());
+  }
+
+  TEST(CSDCNetRound, PhaseLogRetention)
+  {
+    typedef PhaseLogAccess::Log PhaseLog;
+    const int retention = 4, memory_window = 2;
+    QHash<int, QSharedPointer<PhaseLog> > logs;
+    for(int phase = 0; phase < 10; phase++) {
+      PhaseLogAccess::RetirePhaseLogs(logs, phase, retention, memory_window);
+      EXPECT_GE(retention, logs.size());
+
+      QSharedPointer<PhaseLog> log(new PhaseLog(phase, 1,
+            PadGenerator::AES_CTR));
+      log->AddServerMessage(Id(), QByteArray(16, char(phase)));
+      logs[phase] = log;
+    }
+
+    // Phases 6 and earlier can no longer be blamed, 7 and 8 are on disk
+    PhaseLogAccess::RetirePhaseLogs(logs, 10, retention, memory_window);
+    EXPECT_EQ(3, logs.size());
+    EXPECT_FALSE(logs.contains(6));
+    EXPECT_EQ(16, logs[7]->FileSize());
+    EXPECT_EQ(16, logs[8]->FileSize());
+    EXPECT_EQ(0, logs[9]->FileSize());
+  }
+
+  TEST(CSDCNetRound, LoggingBenchmark)
+  {
+    Logging::LogLevel level = Logging::GetLevel();
+    const char *names[] = {"trace", "debug", "off"};
+    Logging::LogLevel levels[] = {Logging::LOG_TRACE, Logging::LOG_DEBUG,
+      Logging::LOG_OFF};
+
+    for(int idx = 0; idx < 3; idx++) {
+      Logging::SetLevel(levels[idx]);
+      QTime timer;
+      timer.start();
+      TestRoundBasic(TCreateDCNetRound<CSDCNetRound, NullRound>);
+      std::cout << "CSDCNetRound logging " << names[idx] << ": " <<
+        timer.elapsed() << " ms" << std::endl;
+    }
+
+    QString filename = "round_trace_test";
+    {
+      TraceRing ring(filename);
+      ASSERT_TRUE(ring.IsValid());
+      TraceRing::SetActive(&ring);
+      QTime timer;
+      timer.start();
+      TestRoundBasic(TCreateDCNetRound<CSDCNetRound, NullRound>);
+      std::cout << "CSDCNetRound logging off, tracing " <<
+        ring.GetAppended() << " events: " << timer.elapsed() << " ms" <<
+        std::endl;
+      EXPECT_TRUE(ring.GetAppended() > 0);
+    }
+
+    QFile(filename).remove();
+    Logging::SetLevel(level);
+  }
+
   TEST(CSDCNetRound, BadClient)
   {
     typedef CSDCNetRoundBad<-1> bad;
@@ -284,6 +739,25 @@ namespace Tests {
         TBadGuyCB<bad>, false, true);
   }
 
+  TEST(CSDCNetRound, BadClientPipelined)
+  {
+    // Blame runs while later phases' ciphertexts are already in flight
+    typedef CSDCNetRoundBad<-1> bad;
+    PipelineDepthGuard depth(3);
+    TestRoundBad(TCreateDCNetRound<CSDCNetRound, NullRound>,
+        TCreateDCNetRound<bad, NullRound>,
+        TBadGuyCB<bad>, true, true);
+  }
+
+  TEST(CSDCNetRound, BadServerPipelined)
+  {
+    typedef CSDCNetRoundBad<-1> bad;
+    PipelineDepthGuard depth(3);
+    TestRoundBad(TCreateDCNetRound<CSDCNetRound, NullRound>,
+        TCreateDCNetRound<bad, NullRound>,
+        TBadGuyCB<bad>, false, true);
+  }
+
   TEST(CSDCNetRound, BadServerBadServerCiphertext)
   {
     typedef CSDCNetRoundBad<0> bad;
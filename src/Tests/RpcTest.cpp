@@ -1,4 +1,6 @@
 #include "DissentTest.hpp"
+#include <QTime>
+#include <iostream>
 
 namespace Dissent {
 namespace Tests {
@@ -63,5 +65,141 @@ namespace Tests {
     EXPECT_EQ(test1.GetResponse().GetErrorType(), Response::InvalidMethod);
     qWarning() << test1.GetResponse().GetError() << test1.GetResponse().GetErrorType();
   }
+
+  class RpcPair {
+    public:
+      RpcPair() :
+        ms0(new MockSource()),
+        ms1(new MockSource()),
+        to_ms0(new MockSender(ms0)),
+        to_ms1(new MockSender(ms1))
+      {
+        ms0->SetSink(&rpc0);
+        ms1->SetSink(&rpc1);
+        to_ms0->SetReturnPath(to_ms1);
+        to_ms1->SetReturnPath(to_ms0);
+      }
+
+      RpcHandler rpc0;
+      RpcHandler rpc1;
+      QSharedPointer<MockSource> ms0;
+      QSharedPointer<MockSource> ms1;
+      QSharedPointer<MockSender> to_ms0;
+      QSharedPointer<MockSender> to_ms1;
+  };
+
+  TEST(Rpc, Binary)
+  {
+    RpcPair pair;
+    pair.rpc1.SetBinaryFormat(true);
+    EXPECT_TRUE(pair.rpc1.UsesBinaryFormat());
+
+    TestRpc test0;
+    pair.rpc0.Register("add", &test0, "Add");
+    pair.rpc0.Register("echo", &test0, "Echo");
+
+    TestResponse test1;
+    QSharedPointer<ResponseHandler> res_h(
+        new ResponseHandler(&test1, "HandleResponse"));
+
+    // Raw bytes
+    QByteArray bytes(1000, 'x');
+    bytes[0] = char(RpcHandler::BinaryMagic);
+    pair.rpc1.SendRequest(pair.to_ms0, "echo", bytes, res_h);
+    EXPECT_TRUE(test1.GetResponse().Successful());
+    EXPECT_EQ(bytes, test1.GetResponse().GetData().toByteArray());
+
+    pair.rpc1.SendRequest(pair.to_ms0, "echo", QByteArray(), res_h);
+    EXPECT_TRUE(test1.GetResponse().Successful());
+    EXPECT_TRUE(test1.GetResponse().GetData().toByteArray().isEmpty());
+
+    // Anything else is serialized
+    QVariantList data;
+    data.append(3);
+    data.append(6);
+    pair.rpc1.SendRequest(pair.to_ms0, "add", data, res_h);
+    EXPECT_EQ(9, test1.GetValue());
+    EXPECT_TRUE(test1.GetResponse().Successful());
+
+    data[1] = "Haha";
+    pair.rpc1.SendRequest(pair.to_ms0, "add", data, res_h);
+    EXPECT_FALSE(test1.GetResponse().Successful());
+    EXPECT_EQ(test1.GetResponse().GetErrorType(), Response::InvalidInput);
+    EXPECT_EQ(QString("Term 1 is invalid"), test1.GetResponse().GetError());
+
+    pair.rpc1.SendRequest(pair.to_ms0, "Haha", data, res_h);
+    EXPECT_FALSE(test1.GetResponse().Successful());
+    EXPECT_EQ(test1.GetResponse().GetErrorType(), Response::InvalidMethod);
+
+    // The legacy format is still accepted and answered in kind
+    pair.rpc1.SetBinaryFormat(false);
+    data[1] = 7;
+    pair.rpc1.SendRequest(pair.to_ms0, "add", data, res_h);
+    EXPECT_EQ(10, test1.GetValue());
+
+    // Unregistered methods no longer resolve by id
+    EXPECT_TRUE(pair.rpc0.Unregister("echo"));
+    pair.rpc1.SetBinaryFormat(true);
+    pair.rpc1.SendRequest(pair.to_ms0, "echo", bytes, res_h);
+    EXPECT_EQ(test1.GetResponse().GetErrorType(), Response::InvalidMethod);
+    EXPECT_TRUE(pair.rpc0.Register("echo", &test0, "Echo"));
+    EXPECT_FALSE(pair.rpc0.Register("echo", &test0, "Echo"));
+  }
+
+  TEST(Rpc, MethodId)
+  {
+    EXPECT_EQ(RpcHandler::MethodId("SessionData"),
+        RpcHandler::MethodId(QString("Session") + "Data"));
+    EXPECT_NE(RpcHandler::MethodId("SessionData"),
+        RpcHandler::MethodId("SessionDatb"));
+    // FNV-1a of the empty string is its offset basis
+    EXPECT_EQ(2166136261u, RpcHandler::MethodId(QString()));
+  }
+
+  int RoundTrips(bool binary, const QVariant &data, int count)
+  {
+    RpcPair pair;
+    pair.rpc1.SetBinaryFormat(binary);
+
+    TestRpc test0;
+    pair.rpc0.Register("echo", &test0, "Echo");
+
+    TestResponse test1;
+    QSharedPointer<ResponseHandler> res_h(
+        new ResponseHandler(&test1, "HandleResponse"));
+
+    QTime timer;
+    timer.start();
+    for(int idx = 0; idx < count; idx++) {
+      pair.rpc1.SendRequest(pair.to_ms0, "echo", data, res_h);
+    }
+    int ms = std::max(1, timer.elapsed());
+
+    EXPECT_EQ(data, test1.GetResponse().GetData());
+    return ms;
+  }
+
+  TEST(Rpc, RoundTripBenchmark)
+  {
+    int sizes[] = {64, 4096, 65536};
+    for(int idx = 0; idx < 3; idx++) {
+      int count = 2000;
+      QByteArray payload(sizes[idx], 'a');
+      int variant_ms = RoundTrips(false, payload, count);
+      int binary_ms = RoundTrips(true, payload, count);
+      std::cout << count << " round trips of " << sizes[idx] <<
+        " bytes, QVariantList: " << variant_ms << " ms, binary: " <<
+        binary_ms << " ms" << std::endl;
+    }
+
+    QVariantList list;
+    for(int idx = 0; idx < 16; idx++) {
+      list.append(idx);
+    }
+    int variant_ms = RoundTrips(false, list, 2000);
+    int binary_ms = RoundTrips(true, list, 2000);
+    std::cout << "2000 round trips of a 16 int list, QVariantList: " <<
+      variant_ms << " ms, binary: " << binary_ms << " ms" << std::endl;
+  }
 }
 }
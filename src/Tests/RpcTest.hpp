@@ -31,6 +31,11 @@ namespace Tests {
 
         request.Respond(x + y);
       }
+
+      void Echo(const Request &request)
+      {
+        request.Respond(request.GetData());
+      }
   };
 
   class TestResponse : public QObject {
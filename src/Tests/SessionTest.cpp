@@ -1,9 +1,43 @@
+#include <iostream>
+
 #include "DissentTest.hpp"
 #include "OverlayTest.hpp"
 #include "SessionTest.hpp"
 
 namespace Dissent {
 namespace Tests {
+  namespace {
+    /**
+     * Drains messages as whole entries, dropping those larger than a slot,
+     * returns the slots used
+     */
+    int DrainWhole(const QList<QByteArray> &queue, int max, qint64 &payload)
+    {
+      int slots = 0;
+      int idx = 0;
+      while(idx < queue.count()) {
+        int size = 0;
+        while(idx < queue.count()) {
+          int length = queue[idx].size();
+          if(length > max) {
+            idx++;
+            continue;
+          } else if(size + length > max) {
+            break;
+          }
+          size += length;
+          idx++;
+        }
+
+        if(size > 0) {
+          slots++;
+          payload += size;
+        }
+      }
+      return slots;
+    }
+  }
+
   Sessions BuildSessions(const OverlayNetwork &network, CreateRound create_round)
   {
     DsaPrivateKey shared_key;
@@ -213,6 +247,214 @@ namespace Tests {
     qDebug() << "Round started after disconnection";
   }
 
+  TEST(Session, DataQueuePacking)
+  {
+    CryptoRandom rand;
+    DataQueue queue;
+    DataAssembler assembler;
+
+    QList<QByteArray> messages;
+    for(int idx = 0; idx < 50; idx++) {
+      QByteArray msg(40, 0);
+      rand.GenerateBlock(msg);
+      messages.append(msg);
+      queue.AddData(msg);
+    }
+
+    QPair<QByteArray, bool> pair = queue.GetData(4096);
+    EXPECT_FALSE(pair.second);
+    EXPECT_EQ(50 * (40 + DataQueue::WHOLE_HEADER), pair.first.size());
+    EXPECT_EQ(messages, assembler.Unpack(pair.first, 0));
+
+    pair = queue.GetData(4096);
+    EXPECT_TRUE(pair.first.isEmpty());
+    EXPECT_FALSE(pair.second);
+    EXPECT_EQ(0, queue.Count());
+  }
+
+  TEST(Session, DataQueueFragments)
+  {
+    CryptoRandom rand;
+    DataQueue queue;
+    DataAssembler assembler;
+    const int max = 1000;
+
+    QList<int> sizes;
+    sizes << 10000 << 30 << 5000 << 64000 << 700 << 20;
+    QList<QByteArray> messages;
+    foreach(int size, sizes) {
+      QByteArray msg(size, 0);
+      rand.GenerateBlock(msg);
+      messages.append(msg);
+      queue.AddData(msg);
+    }
+
+    QList<QByteArray> received;
+    bool more = true;
+    int count = 0;
+    while(more) {
+      QPair<QByteArray, bool> pair = queue.GetData(max);
+      ASSERT_FALSE(pair.first.isEmpty());
+      ASSERT_TRUE(pair.first.size() <= max);
+
+      // A failed round returns the data to the queue
+      if(++count % 3 == 0) {
+        queue.UnGet();
+        QPair<QByteArray, bool> again = queue.GetData(max);
+        EXPECT_EQ(pair.first, again.first);
+        EXPECT_EQ(pair.second, again.second);
+      }
+
+      received.append(assembler.Unpack(pair.first, 0));
+
+      // Fragments delivered twice are ignored
+      if(pair.first[0] == char(DataQueue::Fragment) &&
+          Serialization::ReadInt(pair.first, 1) == max - DataQueue::FRAGMENT_HEADER)
+      {
+        received.append(assembler.Unpack(pair.first, 0));
+      }
+      more = pair.second;
+    }
+
+    EXPECT_EQ(messages, received);
+    EXPECT_EQ(0, queue.Count());
+    EXPECT_EQ(0, queue.QueuedBytes());
+    EXPECT_EQ(0, assembler.Pending());
+    EXPECT_EQ(0, assembler.GetDropped());
+    EXPECT_TRUE(queue.GetFragments() > 0);
+  }
+
+  TEST(Session, DataAssemblerMalformed)
+  {
+    DataAssembler assembler;
+
+    QByteArray record(DataQueue::FRAGMENT_HEADER + 10, 0);
+    record[0] = char(DataQueue::Fragment);
+    Serialization::WriteInt(10, record, 1);
+    Serialization::WriteInt(7, record, 5);
+    Serialization::WriteInt(0, record, 9);
+    Serialization::WriteInt(30, record, 13);
+    EXPECT_TRUE(assembler.Unpack(record, 0).isEmpty());
+    EXPECT_EQ(1, assembler.Pending());
+
+    // A gap abandons the message
+    Serialization::WriteInt(20, record, 9);
+    EXPECT_TRUE(assembler.Unpack(record, 0).isEmpty());
+    EXPECT_EQ(0, assembler.Pending());
+    EXPECT_EQ(1, assembler.GetDropped());
+
+    // Lengths beyond the slot
+    Serialization::WriteInt(1000, record, 1);
+    EXPECT_TRUE(assembler.Unpack(record, 0).isEmpty());
+    EXPECT_EQ(2, assembler.GetDropped());
+
+    // Trailing padding
+    QByteArray padded(DataQueue::WHOLE_HEADER + 3, 0);
+    padded[0] = char(DataQueue::Whole);
+    Serialization::WriteInt(3, padded, 1);
+    padded.append(QByteArray(16, 0));
+    EXPECT_EQ(1, assembler.Unpack(padded, 0).count());
+    EXPECT_EQ(2, assembler.GetDropped());
+  }
+
+  TEST(Session, DataAssemblerSlots)
+  {
+    CryptoRandom rand;
+    DataQueue queue;
+    DataAssembler assembler;
+    const int max = 1000;
+
+    QByteArray msg(2500, 0);
+    rand.GenerateBlock(msg);
+    queue.AddData(msg);
+
+    QPair<QByteArray, bool> first = queue.GetData(max);
+    EXPECT_TRUE(assembler.Unpack(first.first, 3).isEmpty());
+    EXPECT_EQ(1, assembler.Pending());
+
+    // Another slot cannot continue the message, though the id is public
+    QPair<QByteArray, bool> second = queue.GetData(max);
+    QByteArray forged = second.first;
+    forged[forged.size() - 1] = ~forged[forged.size() - 1];
+    EXPECT_TRUE(assembler.Unpack(forged, 5).isEmpty());
+    EXPECT_EQ(1, assembler.Pending());
+
+    EXPECT_TRUE(assembler.Unpack(second.first, 3).isEmpty());
+    QPair<QByteArray, bool> third = queue.GetData(max);
+    EXPECT_FALSE(third.second);
+    QList<QByteArray> received = assembler.Unpack(third.first, 3);
+    ASSERT_EQ(1, received.count());
+    EXPECT_EQ(msg, received[0]);
+
+    // Slots reassigned part way through a message, it is sent again
+    queue.AddData(msg);
+    first = queue.GetData(max);
+    EXPECT_TRUE(assembler.Unpack(first.first, 3).isEmpty());
+    assembler.Clear();
+    queue.Restart();
+    EXPECT_EQ(0, assembler.Pending());
+
+    received.clear();
+    bool more = true;
+    while(more) {
+      QPair<QByteArray, bool> pair = queue.GetData(max);
+      received += assembler.Unpack(pair.first, 7);
+      more = pair.second;
+    }
+    ASSERT_EQ(1, received.count());
+    EXPECT_EQ(msg, received[0]);
+    EXPECT_EQ(0, queue.Count());
+  }
+
+  TEST(Session, DataQueueUtilization)
+  {
+    CryptoRandom rand;
+    DataQueue queue;
+    DataAssembler assembler;
+    const int max = 4096;
+
+    // Mostly small interactive packets among bulk transfers
+    QList<QByteArray> messages;
+    qint64 total = 0;
+    for(int idx = 0; idx < 2000; idx++) {
+      int size = rand.GetInt(0, 10) < 7 ? rand.GetInt(40, 300) :
+        rand.GetInt(1000, 64000);
+      QByteArray msg(size, 0);
+      rand.GenerateBlock(msg);
+      messages.append(msg);
+      queue.AddData(msg);
+      total += size;
+    }
+
+    qint64 whole_payload = 0;
+    int whole_slots = DrainWhole(messages, max, whole_payload);
+
+    int slots = 0;
+    int received = 0;
+    bool more = true;
+    while(more) {
+      QPair<QByteArray, bool> pair = queue.GetData(max);
+      slots++;
+      received += assembler.Unpack(pair.first, 0).count();
+      more = pair.second;
+    }
+
+    EXPECT_EQ(messages.count(), received);
+    EXPECT_EQ(total, queue.GetPayloadBytes());
+
+    double whole_fill = double(whole_payload) / (qMax(1, whole_slots) * max);
+    double fill = double(total) / (slots * max);
+    std::cout << "Whole entries: " << whole_slots << " slots, " <<
+      whole_payload << " of " << total << " bytes, " <<
+      int(100 * whole_fill) << "% full" << std::endl;
+    std::cout << "Packed: " << slots << " slots, " << total << " of " <<
+      total << " bytes, " << int(100 * fill) << "% full, " <<
+      queue.GetHeaderBytes() << " header bytes" << std::endl;
+
+    EXPECT_TRUE(fill > whole_fill);
+    EXPECT_TRUE(fill > 0.95);
+  }
+
   TEST(Session, Servers)
   {
     Timer::GetInstance().UseVirtualTime();
@@ -291,5 +533,82 @@ namespace Tests {
     VerifyStoppedNetwork(sessions.network);
     ConnectionManager::UseTimer = true;
   }
+
+  TEST(Session, ClientsServersBinaryRpc)
+  {
+    Timer::GetInstance().UseVirtualTime();
+    ConnectionManager::UseTimer = false;
+    OverlayNetwork net = ConstructOverlay(4, 10);
+    foreach(const OverlayPointer &server, net.first) {
+      server->GetRpcHandler()->SetBinaryFormat(true);
+    }
+    foreach(const OverlayPointer &client, net.second) {
+      client->GetRpcHandler()->SetBinaryFormat(true);
+    }
+
+    VerifyStoppedNetwork(net);
+    StartNetwork(net);
+    VerifyNetwork(net);
+
+    Sessions sessions = BuildSessions(net);
+    qDebug() << "Starting sessions...";
+    StartSessions(sessions);
+    StartRound(sessions);
+    SendTest(sessions);
+    SendTest(sessions);
+    StopSessions(sessions);
+
+    StopNetwork(sessions.network);
+    VerifyStoppedNetwork(sessions.network);
+    ConnectionManager::UseTimer = true;
+  }
+
+  TEST(Session, PreparedRoundData)
+  {
+    bool tmp = Utils::MultiThreading;
+    Utils::MultiThreading = true;
+    Timer::GetInstance().UseVirtualTime();
+    ConnectionManager::UseTimer = false;
+    OverlayNetwork net = ConstructOverlay(4, 10);
+    VerifyStoppedNetwork(net);
+    StartNetwork(net);
+    VerifyNetwork(net);
+
+    Sessions sessions = BuildSessions(net);
+    StartSessions(sessions);
+
+    // Nothing is prepared before the first round is launched
+    StartRound(sessions);
+    foreach(const ServerPointer &ss, sessions.servers) {
+      EXPECT_EQ(0, ss->GetPreparedRoundData());
+    }
+    foreach(const ClientPointer &cs, sessions.clients) {
+      EXPECT_EQ(0, cs->GetPreparedRoundData());
+    }
+
+    // The second round's keys were generated while the first one ran
+    StartRound(sessions);
+    foreach(const ServerPointer &ss, sessions.servers) {
+      EXPECT_EQ(1, ss->GetPreparedRoundData());
+    }
+    foreach(const ClientPointer &cs, sessions.clients) {
+      EXPECT_EQ(1, cs->GetPreparedRoundData());
+    }
+
+    SendTest(sessions);
+    SendTest(sessions);
+    foreach(const ServerPointer &ss, sessions.servers) {
+      EXPECT_LE(2, ss->GetPreparedRoundData());
+    }
+    foreach(const ClientPointer &cs, sessions.clients) {
+      EXPECT_LE(2, cs->GetPreparedRoundData());
+    }
+    StopSessions(sessions);
+
+    StopNetwork(sessions.network);
+    VerifyStoppedNetwork(sessions.network);
+    ConnectionManager::UseTimer = true;
+    Utils::MultiThreading = tmp;
+  }
 }
 }
@@ -25,6 +25,8 @@ namespace Tests {
     EXPECT_EQ(settings0.LocalEndPoints.count(), 1);
     EXPECT_EQ(settings0.RemoteEndPoints.count(), 1);
     EXPECT_EQ(settings0.MinimumClients, 0);
+    EXPECT_EQ(settings0.PipelineDepth, 0);
+    EXPECT_FALSE(settings0.BinaryRpc);
 
     EXPECT_EQ(settings0.LocalEndPoints[0],
         AddressFactory::GetInstance().CreateAddress("buffer://5"));
@@ -72,7 +74,8 @@ namespace Tests {
       "--exit_tunnel" << "--multithreading" <<
       "--local_id" << "'HJf+qfK7oZVR3dOqeUQcM8TGeVA='" <<
       "--server_ids" << "'HJf+qfK7oZVR3dOqeUQcM8TGeVA='" <<
-      "--minimum_clients" << "1";
+      "--minimum_clients" << "1" << "--pipeline_depth" << "3" <<
+      "--binary_rpc";
 
     Settings settings2 = Settings::CommandLineParse(settings_list, false);
     settings2.Auth = false;
@@ -99,6 +102,8 @@ namespace Tests {
     EXPECT_TRUE(settings2.ExitTunnel);
     EXPECT_TRUE(settings2.Multithreading);
     EXPECT_EQ(settings2.MinimumClients, 1);
+    EXPECT_EQ(settings2.PipelineDepth, 3);
+    EXPECT_TRUE(settings2.BinaryRpc);
   }
 
   TEST(Settings, Invalid)
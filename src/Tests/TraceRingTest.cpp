@@ -0,0 +1,110 @@
+#include <cstddef>
+
+#include "DissentTest.hpp"
+
+namespace Dissent {
+namespace Tests {
+  TEST(TraceRing, ReadBack)
+  {
+    QString filename = "trace_ring_test";
+    {
+      TraceRing ring(filename, 8);
+      ASSERT_TRUE(ring.IsValid());
+      for(int idx = 0; idx < 5; idx++) {
+        ring.Append(TraceRing::RPC_REQUEST, idx, 10 * idx);
+      }
+      EXPECT_EQ(ring.GetAppended(), 5);
+    }
+
+    TraceRing::Header header;
+    QList<TraceRing::Record> records;
+    ASSERT_TRUE(TraceRing::Read(filename, header, records));
+    EXPECT_EQ(header.capacity, quint32(8));
+    ASSERT_EQ(records.count(), 5);
+    for(int idx = 0; idx < records.count(); idx++) {
+      EXPECT_EQ(records[idx].sequence, quint32(idx + 1));
+      EXPECT_EQ(records[idx].event, quint32(TraceRing::RPC_REQUEST));
+      EXPECT_EQ(records[idx].a, qint64(idx));
+      EXPECT_EQ(records[idx].b, qint64(10 * idx));
+      if(idx > 0) {
+        EXPECT_LE(records[idx - 1].time, records[idx].time);
+      }
+    }
+
+    QFile(filename).remove();
+  }
+
+  TEST(TraceRing, Wrap)
+  {
+    QString filename = "trace_ring_test";
+    {
+      TraceRing ring(filename, 4);
+      ASSERT_TRUE(ring.IsValid());
+      TraceRing::SetActive(&ring);
+      for(int idx = 0; idx < 10; idx++) {
+        DISSENT_TRACE_EVENT(TUNNEL_READ, idx, 0);
+      }
+      EXPECT_EQ(TraceRing::GetActive(), &ring);
+    }
+    EXPECT_EQ(TraceRing::GetActive(), static_cast<TraceRing *>(0));
+
+    TraceRing::Header header;
+    QList<TraceRing::Record> records;
+    ASSERT_TRUE(TraceRing::Read(filename, header, records));
+    ASSERT_EQ(records.count(), 4);
+    for(int idx = 0; idx < records.count(); idx++) {
+      EXPECT_EQ(records[idx].a, qint64(6 + idx));
+    }
+
+    QFile(filename).remove();
+    EXPECT_FALSE(TraceRing::Read(filename, header, records));
+  }
+
+  TEST(TraceRing, Torn)
+  {
+    QString filename = "trace_ring_test";
+    {
+      TraceRing ring(filename, 4);
+      ASSERT_TRUE(ring.IsValid());
+      for(int idx = 0; idx < 3; idx++) {
+        ring.Append(TraceRing::RPC_NOTIFICATION, idx, 0);
+      }
+    }
+
+    // A record whose stamp was not yet written is being rewritten
+    QFile file(filename);
+    ASSERT_TRUE(file.open(QIODevice::ReadWrite));
+    quint32 stamp = 0;
+    ASSERT_TRUE(file.seek(sizeof(TraceRing::Header) +
+          sizeof(TraceRing::Record) + offsetof(TraceRing::Record, stamp)));
+    ASSERT_EQ(file.write(reinterpret_cast<const char *>(&stamp),
+          sizeof(stamp)), qint64(sizeof(stamp)));
+    file.close();
+
+    TraceRing::Header header;
+    QList<TraceRing::Record> records;
+    ASSERT_TRUE(TraceRing::Read(filename, header, records));
+    ASSERT_EQ(records.count(), 2);
+    EXPECT_EQ(records[0].sequence, quint32(1));
+    EXPECT_EQ(records[1].sequence, quint32(3));
+
+    QFile(filename).remove();
+  }
+
+  TEST(Logging, Levels)
+  {
+    EXPECT_EQ(Logging::ParseLevel("trace"), Logging::LOG_TRACE);
+    EXPECT_EQ(Logging::ParseLevel("DEBUG"), Logging::LOG_DEBUG);
+    EXPECT_EQ(Logging::ParseLevel("off"), Logging::LOG_OFF);
+    EXPECT_EQ(Logging::ParseLevel("bogus"), Logging::LOG_DEBUG);
+
+    Logging::LogLevel level = Logging::GetLevel();
+    Logging::SetLevel(Logging::LOG_DEBUG);
+    EXPECT_FALSE(Logging::Enabled(Logging::LOG_TRACE));
+    EXPECT_TRUE(Logging::Enabled(Logging::LOG_DEBUG));
+    Logging::SetLevel(Logging::LOG_TRACE);
+    EXPECT_EQ(Logging::Enabled(Logging::LOG_TRACE), DISSENT_LOG_LEVEL == 0);
+    Logging::SetLevel(level);
+  }
+}
+}
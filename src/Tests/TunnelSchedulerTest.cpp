@@ -0,0 +1,156 @@
+#include "DissentTest.hpp"
+
+namespace Dissent {
+namespace Tests {
+  namespace {
+    /**
+     * Builds a packet whose first byte names its connection
+     */
+    QByteArray Packet(const QByteArray &flow, int size)
+    {
+      QByteArray packet(size, 0);
+      packet[0] = flow[0];
+      return packet;
+    }
+
+    /**
+     * Returns the connection of each packet, in order
+     */
+    QByteArray Flows(const QList<QByteArray> &packets)
+    {
+      QByteArray flows;
+      foreach(const QByteArray &packet, packets) {
+        flows.append(packet[0]);
+      }
+      return flows;
+    }
+  }
+
+  TEST(TunnelScheduler, QuantumFairness)
+  {
+    TunnelScheduler scheduler(1000, 1 << 20, 0);
+    scheduler.SetWeight("c", 2);
+    for(int idx = 0; idx < 10; idx++) {
+      scheduler.Enqueue("a", Packet("a", 1000));
+      scheduler.Enqueue("b", Packet("b", 1000));
+      scheduler.Enqueue("c", Packet("c", 1000));
+    }
+    EXPECT_EQ(3, scheduler.ActiveFlows());
+
+    // Each visit grants the quantum times the weight
+    EXPECT_EQ(QByteArray("abcc"), Flows(scheduler.Dequeue(4000)));
+    EXPECT_EQ(QByteArray("abcc"), Flows(scheduler.Dequeue(4000)));
+    EXPECT_EQ(22, scheduler.QueuedPackets());
+  }
+
+  TEST(TunnelScheduler, QuantumFairnessBytes)
+  {
+    // Connections share bytes, not packets
+    TunnelScheduler scheduler(1500, 1 << 20, 0);
+    for(int idx = 0; idx < 10; idx++) {
+      scheduler.Enqueue("b", Packet("b", 1500));
+    }
+    for(int idx = 0; idx < 30; idx++) {
+      scheduler.Enqueue("s", Packet("s", 500));
+    }
+
+    QList<QByteArray> packets = scheduler.Dequeue(12000);
+    int big = 0, small = 0;
+    foreach(const QByteArray &packet, packets) {
+      if(packet[0] == 'b') {
+        big += packet.size();
+      } else {
+        small += packet.size();
+      }
+    }
+    EXPECT_EQ(6000, big);
+    EXPECT_EQ(6000, small);
+    EXPECT_EQ(QByteArray("bsssbsssbsssbsss"), Flows(packets));
+  }
+
+  TEST(TunnelScheduler, QuantumFairnessInteractive)
+  {
+    // A connection that joins behind a bulk transfer waits one visit
+    TunnelScheduler scheduler(1000, 1 << 20, 0);
+    for(int idx = 0; idx < 20; idx++) {
+      scheduler.Enqueue("b", Packet("b", 1000));
+    }
+    scheduler.Enqueue("i", Packet("i", 100));
+
+    QList<QByteArray> packets = scheduler.Dequeue(2000);
+    EXPECT_EQ(QByteArray("bi"), Flows(packets));
+    EXPECT_EQ(1, scheduler.ActiveFlows());
+    EXPECT_EQ(0, scheduler.QueuedBytes("i"));
+  }
+
+  TEST(TunnelScheduler, Watermarks)
+  {
+    TunnelScheduler scheduler(1000, 4000, 0);
+    SignalCounter sc;
+    QObject::connect(&scheduler, SIGNAL(FlowWritable(const QByteArray &)),
+        &sc, SLOT(Counter()));
+
+    // Paused once the queue reaches the cap
+    EXPECT_TRUE(scheduler.Enqueue("a", Packet("a", 1000)));
+    EXPECT_TRUE(scheduler.Enqueue("a", Packet("a", 1000)));
+    EXPECT_TRUE(scheduler.Enqueue("a", Packet("a", 1000)));
+    EXPECT_FALSE(scheduler.Enqueue("a", Packet("a", 1000)));
+    EXPECT_TRUE(scheduler.IsBlocked("a"));
+    EXPECT_FALSE(scheduler.Enqueue("a", Packet("a", 1000)));
+    EXPECT_EQ(1, scheduler.GetBlockedCount());
+    EXPECT_EQ(5000, scheduler.QueuedBytes("a"));
+
+    // Other connections are unaffected
+    EXPECT_TRUE(scheduler.Enqueue("b", Packet("b", 1000)));
+    EXPECT_FALSE(scheduler.IsBlocked("b"));
+
+    // Resumed only once drained to half the cap
+    EXPECT_EQ(QByteArray("a"), Flows(scheduler.Dequeue(1000)));
+    EXPECT_EQ(QByteArray("b"), Flows(scheduler.Dequeue(1000)));
+    EXPECT_EQ(QByteArray("a"), Flows(scheduler.Dequeue(1000)));
+    EXPECT_TRUE(scheduler.IsBlocked("a"));
+    EXPECT_EQ(0, sc.GetCount());
+
+    EXPECT_EQ(QByteArray("a"), Flows(scheduler.Dequeue(1000)));
+    EXPECT_FALSE(scheduler.IsBlocked("a"));
+    EXPECT_EQ(2000, scheduler.QueuedBytes("a"));
+    EXPECT_EQ(1, sc.GetCount());
+
+    EXPECT_TRUE(scheduler.Enqueue("a", Packet("a", 1000)));
+    EXPECT_FALSE(scheduler.Enqueue("a", Packet("a", 1000)));
+    EXPECT_EQ(2, scheduler.GetBlockedCount());
+  }
+
+  TEST(TunnelScheduler, Release)
+  {
+    Timer::GetInstance().UseVirtualTime();
+    TunnelScheduler scheduler(1000, 1 << 20, 2000);
+    SignalCounter sc;
+    QObject::connect(&scheduler, SIGNAL(PacketReady(const QByteArray &)),
+        &sc, SLOT(Counter()));
+
+    for(int idx = 0; idx < 5; idx++) {
+      scheduler.Enqueue("a", Packet("a", 1000));
+    }
+    MockExec();
+    EXPECT_EQ(0, sc.GetCount());
+
+    // Released up to the budget of each interval
+    scheduler.Start();
+    MockExec();
+    EXPECT_EQ(2, sc.GetCount());
+
+    Time::GetInstance().IncrementVirtualClock(TunnelScheduler::RELEASE_INTERVAL);
+    Timer::GetInstance().VirtualRun();
+    MockExec();
+    EXPECT_EQ(4, sc.GetCount());
+
+    scheduler.Stop();
+    EXPECT_EQ(0, scheduler.QueuedPackets());
+    Time::GetInstance().IncrementVirtualClock(TunnelScheduler::RELEASE_INTERVAL);
+    Timer::GetInstance().VirtualRun();
+    MockExec();
+    EXPECT_EQ(4, sc.GetCount());
+  }
+}
+}
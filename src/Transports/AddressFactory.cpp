@@ -1,6 +1,8 @@
 #include "AddressFactory.hpp"
 #include "BufferAddress.hpp"
+#include "EpollAddress.hpp"
 #include "TcpAddress.hpp"
+#include "UdpAddress.hpp"
 #include <QDebug>
 
 namespace Dissent {
@@ -17,6 +19,10 @@ namespace Transports {
     AddAnyCallback("buffer", BufferAddress::CreateAny);
     AddCreateCallback(TcpAddress::Scheme, TcpAddress::Create);
     AddAnyCallback(TcpAddress::Scheme, TcpAddress::CreateAny);
+    AddCreateCallback(EpollAddress::Scheme, EpollAddress::Create);
+    AddAnyCallback(EpollAddress::Scheme, EpollAddress::CreateAny);
+    AddCreateCallback(UdpAddress::Scheme, UdpAddress::Create);
+    AddAnyCallback(UdpAddress::Scheme, UdpAddress::CreateAny);
   }
 
   void AddressFactory::AddCreateCallback(const QString &scheme, CreateCallback cb)
@@ -1,6 +1,8 @@
 #include "EdgeListenerFactory.hpp"
 #include "BufferEdgeListener.hpp"
+#include "EpollEdgeListener.hpp"
 #include "TcpEdgeListener.hpp"
+#include "UdpEdgeListener.hpp"
 
 namespace Dissent {
 namespace Transports {
@@ -14,6 +16,8 @@ namespace Transports {
   {
     AddCallback("buffer", BufferEdgeListener::Create);
     AddCallback(TcpEdgeListener::Scheme, TcpEdgeListener::Create);
+    AddCallback(EpollEdgeListener::Scheme, EpollEdgeListener::Create);
+    AddCallback(UdpEdgeListener::Scheme, UdpEdgeListener::Create);
   }
 
   void EdgeListenerFactory::AddCallback(const QString &type, Callback cb)
@@ -0,0 +1,72 @@
+#include <QDebug>
+#include "EpollEdge.hpp"
+
+namespace Dissent {
+namespace Transports {
+  EpollEdge::EpollEdge(const Address &local, const Address &remote,
+      bool outgoing, int id) :
+    Edge(local, remote, outgoing),
+    _id(id),
+    _flush_pending(false)
+  {
+    EpollReactor::GetInstance().SetHandler(_id, this);
+  }
+
+  EpollEdge::~EpollEdge()
+  {
+    EpollReactor::GetInstance().Remove(_id);
+  }
+
+  void EpollEdge::Send(const QByteArray &data)
+  {
+    if(Stopped()) {
+      qWarning() << "Attempted to send on a closed edge:" << ToString();
+      return;
+    }
+
+    EpollReactor &reactor = EpollReactor::GetInstance();
+    if(reactor.GetPendingBytes(_id) > MAX_PENDING) {
+      qWarning() << "Remote side is not reading, closing:" << ToString();
+      Stop("Send buffer overflow");
+      return;
+    }
+
+    if(!reactor.Send(_id, data)) {
+      return;
+    }
+
+    if(!_flush_pending) {
+      _flush_pending = true;
+      QMetaObject::invokeMethod(this, "Flush", Qt::QueuedConnection);
+    }
+    Sent();
+  }
+
+  void EpollEdge::Flush()
+  {
+    _flush_pending = false;
+    EpollReactor::GetInstance().Flush(_id);
+  }
+
+  void EpollEdge::HandleEvent(const EpollEvent &event)
+  {
+    switch(event.type) {
+      case EpollEvent::Data:
+        PushData(GetSharedPointer(), event.data);
+        break;
+      case EpollEvent::Closed:
+        Stop(event.reason);
+        break;
+      default:
+        qWarning() << "Unexpected event" << event.type << "on" << ToString();
+    }
+  }
+
+  void EpollEdge::OnStop()
+  {
+    Flush();
+    EpollReactor::GetInstance().Remove(_id);
+    Edge::OnStop();
+  }
+}
+}
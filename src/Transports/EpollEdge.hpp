@@ -0,0 +1,90 @@
+#ifndef DISSENT_TRANSPORTS_EPOLL_EDGE_H_GUARD
+#define DISSENT_TRANSPORTS_EPOLL_EDGE_H_GUARD
+
+#include "Edge.hpp"
+#include "EpollAddress.hpp"
+#include "EpollReactor.hpp"
+
+namespace Dissent {
+namespace Transports {
+  /**
+   * A Tcp edge whose socket is served by the EpollReactor
+   */
+  class EpollEdge : public Edge, public EpollReactor::Handler {
+    Q_OBJECT
+
+    public:
+      /**
+       * Unwritten bytes at which the remote side is considered stalled and
+       * the edge is closed
+       */
+      static const qint64 MAX_PENDING = 64 * 1024 * 1024;
+
+      /**
+       * Constructor
+       * @param local the local address of the edge
+       * @param remote the address of the remote point of the edge
+       * @param outgoing true if the local side requested the creation of this edge
+       * @param id the reactor id of the connected socket
+       */
+      explicit EpollEdge(const Address &local, const Address &remote,
+          bool outgoing, int id);
+
+      /**
+       * Destructor
+       */
+      virtual ~EpollEdge();
+
+      /**
+       * Queues data for the socket, messages sent during the same event
+       * loop iteration are written together
+       * @param data the message
+       */
+      virtual void Send(const QByteArray &data);
+
+      /**
+       * Handles the reactor's events for the socket
+       * @param event the event
+       */
+      virtual void HandleEvent(const EpollEvent &event);
+
+      virtual inline void SetRemotePersistentAddress(const Address &addr)
+      {
+        const TcpAddress &new_ta = static_cast<const TcpAddress &>(addr);
+        const TcpAddress &old_ta = static_cast<const TcpAddress &>(GetRemoteAddress());
+
+        QHostAddress ha = old_ta.GetIP();
+
+        if(old_ta.GetIP() != new_ta.GetIP()) {
+          if(ha == QHostAddress::Null ||
+              ha == QHostAddress::LocalHost ||
+              ha == QHostAddress::LocalHostIPv6 ||
+              ha == QHostAddress::Broadcast ||
+              ha == QHostAddress::Any ||
+              ha == QHostAddress::AnyIPv6)
+          {
+            ha = new_ta.GetIP();
+          }
+        }
+        Edge::SetRemotePersistentAddress(EpollAddress(ha.toString(), new_ta.GetPort()));
+      }
+
+    protected:
+      /**
+       * Called as a result of Stop has been called
+       */
+      virtual void OnStop();
+
+    private slots:
+      /**
+       * Writes all queued messages
+       */
+      void Flush();
+
+    private:
+      const int _id;
+      bool _flush_pending;
+  };
+}
+}
+#endif
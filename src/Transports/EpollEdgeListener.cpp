@@ -0,0 +1,227 @@
+#include <QDebug>
+#include <QNetworkInterface>
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "EpollEdgeListener.hpp"
+
+namespace Dissent {
+namespace Transports {
+  namespace {
+    QString ErrorString(int error)
+    {
+      return QString::fromLocal8Bit(strerror(error));
+    }
+
+    socklen_t ToSockAddr(const QHostAddress &ip, int port,
+        struct sockaddr_storage &addr)
+    {
+      memset(&addr, 0, sizeof(addr));
+      if(ip.protocol() == QAbstractSocket::IPv6Protocol) {
+        struct sockaddr_in6 *addr6 = reinterpret_cast<struct sockaddr_in6 *>(&addr);
+        addr6->sin6_family = AF_INET6;
+        addr6->sin6_port = htons(port);
+        Q_IPV6ADDR bytes = ip.toIPv6Address();
+        memcpy(&addr6->sin6_addr, &bytes, sizeof(addr6->sin6_addr));
+        return sizeof(struct sockaddr_in6);
+      }
+
+      struct sockaddr_in *addr4 = reinterpret_cast<struct sockaddr_in *>(&addr);
+      addr4->sin_family = AF_INET;
+      addr4->sin_port = htons(port);
+      addr4->sin_addr.s_addr = htonl(ip.toIPv4Address());
+      return sizeof(struct sockaddr_in);
+    }
+  }
+
+  const QString EpollEdgeListener::Scheme = "epoll";
+
+  EpollEdgeListener::EpollEdgeListener(const EpollAddress &local_address) :
+    EdgeListener(local_address),
+    _listener_id(-1)
+  {
+  }
+
+  EdgeListener *EpollEdgeListener::Create(const Address &local_address)
+  {
+    const EpollAddress &ea = static_cast<const EpollAddress &>(local_address);
+    return new EpollEdgeListener(ea);
+  }
+
+  EpollEdgeListener::~EpollEdgeListener()
+  {
+    DestructorCheck();
+    EpollReactor &reactor = EpollReactor::GetInstance();
+    reactor.Remove(_listener_id);
+    foreach(int id, _outstanding.keys()) {
+      reactor.Remove(id);
+    }
+  }
+
+  void EpollEdgeListener::OnStart()
+  {
+    EdgeListener::OnStart();
+
+    const EpollAddress &addr = static_cast<const EpollAddress &>(GetAddress());
+
+    struct sockaddr_storage saddr;
+    socklen_t length = ToSockAddr(addr.GetIP(), addr.GetPort(), saddr);
+
+    int fd = ::socket(saddr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int one = 1;
+    if(fd < 0 ||
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) ||
+        ::bind(fd, reinterpret_cast<struct sockaddr *>(&saddr), length) ||
+        ::listen(fd, SOMAXCONN) ||
+        ::getsockname(fd, reinterpret_cast<struct sockaddr *>(&saddr), &length))
+    {
+      qFatal("%s", QString("Unable to bind to " + addr.ToString() + ": " +
+            ErrorString(errno)).toUtf8().data());
+    }
+
+    _listener_id = EpollReactor::GetInstance().AddListener(fd, this);
+
+    // XXX the following is a hack so I don't need to support multiple local addresses
+    QHostAddress ip(reinterpret_cast<struct sockaddr *>(&saddr));
+    if(ip == QHostAddress::Any || ip == QHostAddress::AnyIPv6) {
+      ip = QHostAddress::LocalHost;
+      foreach(const QHostAddress &local_ip, QNetworkInterface::allAddresses()) {
+        if(local_ip == QHostAddress::Null ||
+            local_ip == QHostAddress::LocalHost ||
+            local_ip == QHostAddress::LocalHostIPv6 ||
+            local_ip == QHostAddress::Broadcast ||
+            local_ip == QHostAddress::Any ||
+            local_ip == QHostAddress::AnyIPv6)
+        {
+            continue;
+        }
+        ip = local_ip;
+        break;
+      }
+    }
+
+    int port = saddr.ss_family == AF_INET6 ?
+      ntohs(reinterpret_cast<struct sockaddr_in6 *>(&saddr)->sin6_port) :
+      ntohs(reinterpret_cast<struct sockaddr_in *>(&saddr)->sin_port);
+    SetAddress(EpollAddress(ip.toString(), port));
+  }
+
+  void EpollEdgeListener::OnStop()
+  {
+    EdgeListener::OnStop();
+
+    EpollReactor &reactor = EpollReactor::GetInstance();
+    reactor.Remove(_listener_id);
+    _listener_id = -1;
+
+    QHash<int, EpollAddress> outstanding = _outstanding;
+    _outstanding.clear();
+    for(QHash<int, EpollAddress>::const_iterator it = outstanding.constBegin();
+        it != outstanding.constEnd(); ++it)
+    {
+      reactor.Remove(it.key());
+      ProcessEdgeCreationFailure(it.value(), "EdgeListner Stopped");
+    }
+  }
+
+  void EpollEdgeListener::CreateEdgeTo(const Address &to)
+  {
+    if(Stopped()) {
+      qWarning() << "Cannot CreateEdgeTo Stopped EL";
+      return;
+    }
+
+    if(!Started()) {
+      qWarning() << "Cannot CreateEdgeTo non-Started EL";
+      return;
+    }
+
+    qDebug() << "Connecting to" << to.ToString();
+    const EpollAddress &rem_ea = static_cast<const EpollAddress &>(to);
+
+    struct sockaddr_storage saddr;
+    socklen_t length = ToSockAddr(rem_ea.GetIP(), rem_ea.GetPort(), saddr);
+
+    int fd = ::socket(saddr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(fd < 0) {
+      Fail(rem_ea, ErrorString(errno));
+      return;
+    }
+
+    if(::connect(fd, reinterpret_cast<struct sockaddr *>(&saddr), length) &&
+        errno != EINPROGRESS)
+    {
+      Fail(rem_ea, ErrorString(errno));
+      ::close(fd);
+      return;
+    }
+
+    int one = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &one, sizeof(one));
+    _outstanding.insert(EpollReactor::GetInstance().AddConnection(fd, this, true), rem_ea);
+  }
+
+  void EpollEdgeListener::HandleEvent(const EpollEvent &event)
+  {
+    switch(event.type) {
+      case EpollEvent::Accepted:
+      {
+        int id = EpollReactor::GetInstance().AddConnection(event.fd, this);
+        EpollAddress remote(event.ip.toString(), event.port);
+        qDebug() << "Incoming connection from" << remote.ToString();
+        AddEdge(id, remote, false);
+        break;
+      }
+      case EpollEvent::Connected:
+      {
+        EpollAddress remote = _outstanding.take(event.id);
+        qDebug() << "Handling a successful connectTo from" << remote.ToString();
+        AddEdge(event.id, remote, true);
+        break;
+      }
+      case EpollEvent::ConnectFailed:
+      {
+        EpollAddress remote = _outstanding.take(event.id);
+        EpollReactor::GetInstance().Remove(event.id);
+        qDebug() << "Unable to connect to host: " << remote.ToString() << event.reason;
+        ProcessEdgeCreationFailure(remote, event.reason);
+        break;
+      }
+      default:
+        qWarning() << "Unexpected event" << event.type << "on" << GetAddress().ToString();
+    }
+  }
+
+  void EpollEdgeListener::AddEdge(int id, const EpollAddress &remote, bool outgoing)
+  {
+    QSharedPointer<Edge> edge(new EpollEdge(GetAddress(), remote, outgoing, id),
+        &QObject::deleteLater);
+    SetSharedPointer(edge);
+    ProcessNewEdge(edge);
+  }
+
+  void EpollEdgeListener::Fail(const EpollAddress &to, const QString &reason)
+  {
+    // Failures are reported asynchronously, as they are for Tcp
+    if(_failures.isEmpty()) {
+      QMetaObject::invokeMethod(this, "ReportFailures", Qt::QueuedConnection);
+    }
+    _failures.append(QPair<EpollAddress, QString>(to, reason));
+  }
+
+  void EpollEdgeListener::ReportFailures()
+  {
+    QList<QPair<EpollAddress, QString> > failures = _failures;
+    _failures.clear();
+    for(int idx = 0; idx < failures.size(); idx++) {
+      qDebug() << "Unable to connect to host: " << failures[idx].first.ToString() <<
+        failures[idx].second;
+      ProcessEdgeCreationFailure(failures[idx].first, failures[idx].second);
+    }
+  }
+}
+}
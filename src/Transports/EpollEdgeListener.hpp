@@ -0,0 +1,61 @@
+#ifndef DISSENT_TRANSPORTS_EPOLL_EDGE_LISTENER_H_GUARD
+#define DISSENT_TRANSPORTS_EPOLL_EDGE_LISTENER_H_GUARD
+
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QPair>
+
+#include "EdgeListener.hpp"
+#include "EpollAddress.hpp"
+#include "EpollEdge.hpp"
+#include "EpollReactor.hpp"
+
+namespace Dissent {
+namespace Transports {
+  /**
+   * Creates Tcp edges served by the EpollReactor, which unlike
+   * TcpEdgeListener is not bound by the descriptor limits of Qt's event
+   * dispatcher.  Linux only.
+   */
+  class EpollEdgeListener : public EdgeListener, public EpollReactor::Handler {
+    Q_OBJECT
+
+    public:
+      const static QString Scheme;
+
+      explicit EpollEdgeListener(const EpollAddress &local_address);
+      static EdgeListener *Create(const Address &local_address);
+
+      /**
+       * Destructor
+       */
+      virtual ~EpollEdgeListener();
+
+      virtual void CreateEdgeTo(const Address &to);
+
+      /**
+       * Handles accepted sockets and the outcome of connects
+       * @param event the event
+       */
+      virtual void HandleEvent(const EpollEvent &event);
+
+    protected:
+      virtual void OnStart();
+      virtual void OnStop();
+
+    private slots:
+      void ReportFailures();
+
+    private:
+      void AddEdge(int id, const EpollAddress &remote, bool outgoing);
+      void Fail(const EpollAddress &to, const QString &reason);
+
+      int _listener_id;
+      QHash<int, EpollAddress> _outstanding;
+      QList<QPair<EpollAddress, QString> > _failures;
+  };
+}
+}
+
+#endif
@@ -0,0 +1,434 @@
+#include <QDebug>
+
+#include <climits>
+#include <errno.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "EpollReactor.hpp"
+
+namespace Dissent {
+namespace Transports {
+  namespace {
+    const quint64 WAKE_ID = 0;
+
+    QString ErrorString(int error)
+    {
+      return QString::fromLocal8Bit(strerror(error));
+    }
+  }
+
+  EpollReactor &EpollReactor::GetInstance()
+  {
+    static EpollReactor reactor;
+    return reactor;
+  }
+
+  EpollReactor::EpollReactor() :
+    _epoll_fd(::epoll_create1(EPOLL_CLOEXEC)),
+    _wake_fd(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+    _next_id(1)
+  {
+    if(_epoll_fd < 0 || _wake_fd < 0) {
+      qFatal("Unable to create epoll descriptors: %s", strerror(errno));
+    }
+
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.u64 = WAKE_ID;
+    ::epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, _wake_fd, &event);
+
+    // Descriptors are the only limit on connections, use all we may
+    struct rlimit limit;
+    if(::getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+      limit.rlim_cur = limit.rlim_max;
+      if(::setrlimit(RLIMIT_NOFILE, &limit)) {
+        qWarning() << "Unable to raise the descriptor limit:" << ErrorString(errno);
+      }
+    }
+
+    start();
+  }
+
+  EpollReactor::~EpollReactor()
+  {
+    quint64 one = 1;
+    if(::write(_wake_fd, &one, sizeof(one)) != sizeof(one)) {
+      qCritical() << "Unable to wake the epoll loop:" << ErrorString(errno);
+    }
+    wait();
+
+    foreach(const QSharedPointer<Connection> &conn, _connections) {
+      ::close(conn->fd);
+    }
+    ::close(_wake_fd);
+    ::close(_epoll_fd);
+  }
+
+  int EpollReactor::AddListener(int fd, Handler *handler)
+  {
+    return Add(fd, handler, true, false);
+  }
+
+  int EpollReactor::AddConnection(int fd, Handler *handler, bool connecting)
+  {
+    return Add(fd, handler, false, connecting);
+  }
+
+  int EpollReactor::Add(int fd, Handler *handler, bool listener, bool connecting)
+  {
+    int id = _next_id;
+    _next_id = _next_id == INT_MAX ? 1 : _next_id + 1;
+
+    _handlers[id] = handler;
+    QSharedPointer<Connection> conn(new Connection(id, fd, listener, connecting));
+    {
+      QMutexLocker locker(&_connections_lock);
+      _connections[id] = conn;
+    }
+
+    QMutexLocker locker(&conn->lock);
+    Watch(conn.data(), EPOLL_CTL_ADD);
+    return id;
+  }
+
+  void EpollReactor::SetHandler(int id, Handler *handler)
+  {
+    if(_handlers.contains(id)) {
+      _handlers[id] = handler;
+    }
+  }
+
+  void EpollReactor::Remove(int id)
+  {
+    _handlers.remove(id);
+
+    QSharedPointer<Connection> conn;
+    {
+      QMutexLocker locker(&_connections_lock);
+      conn = _connections.take(id);
+    }
+
+    if(!conn) {
+      return;
+    }
+
+    QMutexLocker locker(&conn->lock);
+    if(!conn->closed) {
+      ::epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, conn->fd, 0);
+      conn->closed = true;
+    }
+    ::close(conn->fd);
+  }
+
+  bool EpollReactor::Send(int id, const QByteArray &data)
+  {
+    QSharedPointer<Connection> conn = Lookup(id);
+    if(!conn) {
+      return false;
+    }
+
+    QMutexLocker locker(&conn->lock);
+    if(conn->closed) {
+      return false;
+    }
+    conn->writer.Append(data);
+    return true;
+  }
+
+  void EpollReactor::Flush(int id)
+  {
+    QSharedPointer<Connection> conn = Lookup(id);
+    if(!conn) {
+      return;
+    }
+
+    QList<EpollEvent> out;
+    {
+      QMutexLocker locker(&conn->lock);
+      // Once the socket has filled, the epoll loop writes as it drains
+      if(conn->closed || conn->connecting || conn->want_write) {
+        return;
+      }
+      WriteAll(conn.data(), out);
+    }
+    Post(out);
+  }
+
+  qint64 EpollReactor::GetPendingBytes(int id)
+  {
+    QSharedPointer<Connection> conn = Lookup(id);
+    if(!conn) {
+      return 0;
+    }
+
+    QMutexLocker locker(&conn->lock);
+    return conn->writer.PendingBytes();
+  }
+
+  int EpollReactor::GetCount()
+  {
+    QMutexLocker locker(&_connections_lock);
+    return _connections.size();
+  }
+
+  QSharedPointer<EpollReactor::Connection> EpollReactor::Lookup(int id)
+  {
+    QMutexLocker locker(&_connections_lock);
+    return _connections.value(id);
+  }
+
+  void EpollReactor::Watch(Connection *conn, int op)
+  {
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.data.u64 = conn->id;
+
+    if(conn->listener) {
+      event.events = EPOLLIN | EPOLLET;
+    } else if(conn->connecting) {
+      event.events = EPOLLOUT | EPOLLET;
+    } else {
+      event.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+      if(conn->want_write) {
+        event.events |= EPOLLOUT;
+      }
+    }
+
+    // Modifying an edge triggered descriptor reports it again if it is
+    // still ready, which is what resuming a paused read relies upon
+    if(::epoll_ctl(_epoll_fd, op, conn->fd, &event)) {
+      qCritical() << "Unable to watch descriptor" << conn->fd << ErrorString(errno);
+    }
+  }
+
+  void EpollReactor::run()
+  {
+    struct epoll_event events[MAX_EVENTS];
+
+    while(true) {
+      int count = ::epoll_wait(_epoll_fd, events, MAX_EVENTS, -1);
+      if(count < 0) {
+        if(errno == EINTR) {
+          continue;
+        }
+        qCritical() << "epoll_wait failed:" << ErrorString(errno);
+        return;
+      }
+
+      QList<EpollEvent> out;
+      for(int idx = 0; idx < count; idx++) {
+        if(events[idx].data.u64 == WAKE_ID) {
+          return;
+        }
+
+        QSharedPointer<Connection> conn = Lookup(int(events[idx].data.u64));
+        if(!conn) {
+          continue;
+        }
+
+        QMutexLocker locker(&conn->lock);
+        Process(conn.data(), events[idx].events, out);
+      }
+      Post(out);
+    }
+  }
+
+  void EpollReactor::Process(Connection *conn, unsigned int events,
+      QList<EpollEvent> &out)
+  {
+    if(conn->closed) {
+      return;
+    }
+
+    if(conn->listener) {
+      AcceptAll(conn, out);
+      return;
+    }
+
+    if(conn->connecting) {
+      int error = 0;
+      socklen_t length = sizeof(error);
+      if(::getsockopt(conn->fd, SOL_SOCKET, SO_ERROR, &error, &length)) {
+        error = errno;
+      }
+
+      if(error != 0) {
+        ::epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, conn->fd, 0);
+        conn->closed = true;
+        EpollEvent event(EpollEvent::ConnectFailed, conn->id);
+        event.reason = ErrorString(error);
+        out.append(event);
+        return;
+      }
+
+      conn->connecting = false;
+      conn->want_write = !conn->writer.IsEmpty();
+      Watch(conn, EPOLL_CTL_MOD);
+      out.append(EpollEvent(EpollEvent::Connected, conn->id));
+      return;
+    }
+
+    if(events & EPOLLOUT) {
+      WriteAll(conn, out);
+    }
+
+    if(!conn->closed && (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))) {
+      ReadAll(conn, out);
+    }
+  }
+
+  void EpollReactor::AcceptAll(Connection *conn, QList<EpollEvent> &out)
+  {
+    while(true) {
+      struct sockaddr_storage addr;
+      socklen_t length = sizeof(addr);
+      int fd = ::accept4(conn->fd, reinterpret_cast<struct sockaddr *>(&addr),
+          &length, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+      if(fd < 0) {
+        if(errno == EINTR || errno == ECONNABORTED) {
+          continue;
+        } else if(errno != EAGAIN && errno != EWOULDBLOCK) {
+          qWarning() << "Unable to accept:" << ErrorString(errno);
+        }
+        return;
+      }
+
+      int one = 1;
+      ::setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &one, sizeof(one));
+
+      EpollEvent event(EpollEvent::Accepted, conn->id);
+      event.fd = fd;
+      event.ip = QHostAddress(reinterpret_cast<struct sockaddr *>(&addr));
+      if(addr.ss_family == AF_INET6) {
+        event.port = ntohs(reinterpret_cast<struct sockaddr_in6 *>(&addr)->sin6_port);
+      } else {
+        event.port = ntohs(reinterpret_cast<struct sockaddr_in *>(&addr)->sin_port);
+      }
+      out.append(event);
+    }
+  }
+
+  void EpollReactor::ReadAll(Connection *conn, QList<EpollEvent> &out)
+  {
+    while(!conn->paused) {
+      ssize_t count = ::read(conn->fd, conn->reader.GetWritePointer(),
+          conn->reader.GetWriteSpace());
+
+      if(count == 0) {
+        Close(conn, "Disconnected", out);
+        return;
+      } else if(count < 0) {
+        if(errno == EINTR) {
+          continue;
+        } else if(errno != EAGAIN && errno != EWOULDBLOCK) {
+          Close(conn, ErrorString(errno), out);
+        }
+        return;
+      }
+
+      if(!conn->reader.Commit(count)) {
+        Close(conn, "Error reading Epoll socket", out);
+        return;
+      }
+
+      foreach(const QByteArray &msg, conn->reader.TakeFrames()) {
+        EpollEvent event(EpollEvent::Data, conn->id);
+        event.data = msg;
+        out.append(event);
+        conn->undelivered += msg.size();
+      }
+
+      conn->paused = conn->undelivered > MAX_UNDELIVERED;
+    }
+  }
+
+  void EpollReactor::WriteAll(Connection *conn, QList<EpollEvent> &out)
+  {
+    if(conn->writer.WriteTo(conn->fd) < 0) {
+      Close(conn, ErrorString(errno), out);
+      return;
+    }
+
+    bool want_write = !conn->writer.IsEmpty();
+    if(want_write != conn->want_write) {
+      conn->want_write = want_write;
+      Watch(conn, EPOLL_CTL_MOD);
+    }
+  }
+
+  void EpollReactor::Close(Connection *conn, const QString &reason,
+      QList<EpollEvent> &out)
+  {
+    // The descriptor is closed by Remove, so its number cannot be reused
+    // while the main thread may still refer to the connection
+    ::epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, conn->fd, 0);
+    conn->closed = true;
+
+    EpollEvent event(EpollEvent::Closed, conn->id);
+    event.reason = reason;
+    out.append(event);
+  }
+
+  void EpollReactor::Post(const QList<EpollEvent> &events)
+  {
+    if(events.isEmpty()) {
+      return;
+    }
+
+    QMutexLocker locker(&_inbox_lock);
+    bool idle = _inbox.isEmpty();
+    _inbox.append(events);
+    if(idle) {
+      QMetaObject::invokeMethod(this, "Deliver", Qt::QueuedConnection);
+    }
+  }
+
+  void EpollReactor::Deliver()
+  {
+    QList<EpollEvent> events;
+    {
+      QMutexLocker locker(&_inbox_lock);
+      events.swap(_inbox);
+    }
+
+    QHash<int, qint64> delivered;
+    foreach(const EpollEvent &event, events) {
+      if(event.type == EpollEvent::Data) {
+        delivered[event.id] += event.data.size();
+      }
+
+      // Handlers may remove themselves or others while handling an event
+      Handler *handler = _handlers.value(event.id);
+      if(handler) {
+        handler->HandleEvent(event);
+      } else if(event.type == EpollEvent::Accepted) {
+        ::close(event.fd);
+      }
+    }
+
+    for(QHash<int, qint64>::const_iterator it = delivered.constBegin();
+        it != delivered.constEnd(); ++it)
+    {
+      QSharedPointer<Connection> conn = Lookup(it.key());
+      if(!conn) {
+        continue;
+      }
+
+      QMutexLocker locker(&conn->lock);
+      conn->undelivered -= it.value();
+      if(conn->paused && !conn->closed && conn->undelivered < RESUME_UNDELIVERED) {
+        conn->paused = false;
+        Watch(conn.data(), EPOLL_CTL_MOD);
+      }
+    }
+  }
+}
+}
@@ -0,0 +1,224 @@
+#ifndef DISSENT_TRANSPORTS_EPOLL_REACTOR_H_GUARD
+#define DISSENT_TRANSPORTS_EPOLL_REACTOR_H_GUARD
+
+#include <QByteArray>
+#include <QHash>
+#include <QHostAddress>
+#include <QList>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QThread>
+
+#include "FrameReader.hpp"
+#include "FrameWriter.hpp"
+
+namespace Dissent {
+namespace Transports {
+  /**
+   * Something that happened on a descriptor owned by the EpollReactor,
+   * delivered to the Handler registered for the descriptor's id
+   */
+  struct EpollEvent {
+    enum Type {
+      Accepted,
+      Connected,
+      ConnectFailed,
+      Data,
+      Closed
+    };
+
+    explicit EpollEvent(Type type = Closed, int id = 0) :
+      type(type), id(id), fd(-1), port(0)
+    {
+    }
+
+    Type type;
+    int id;
+    QByteArray data;
+    int fd;
+    QHostAddress ip;
+    int port;
+    QString reason;
+  };
+
+  /**
+   * A single epoll loop serving Tcp descriptors outside of Qt's event
+   * dispatcher, which is select based and thus limited to FD_SETSIZE
+   * descriptors.  Descriptors are watched edge triggered from a dedicated
+   * thread, which accepts, connects, reads, and parses frames into a
+   * per-connection FrameReader and drains a per-connection FrameWriter.
+   * The resulting events are handed to the creating (main) thread in
+   * batches, where they are dispatched to the Handler registered for the
+   * descriptor.
+   *
+   * A connection stops reading once MAX_UNDELIVERED bytes received on it
+   * await dispatch and resumes once dispatch drains it below
+   * RESUME_UNDELIVERED, so a slow consumer backs up into the kernel's
+   * buffers and the remote sender rather than into memory.
+   */
+  class EpollReactor : public QThread {
+    Q_OBJECT
+
+    public:
+      /**
+       * Receives the events for a registered descriptor on the main thread
+       */
+      class Handler {
+        public:
+          virtual ~Handler() {}
+
+          /**
+           * Called for each event on a descriptor registered to the handler
+           * @param event the event
+           */
+          virtual void HandleEvent(const EpollEvent &event) = 0;
+      };
+
+      /**
+       * Received bytes awaiting dispatch at which a connection stops reading
+       */
+      static const qint64 MAX_UNDELIVERED = 8 * 1024 * 1024;
+
+      /**
+       * Received bytes awaiting dispatch at which a connection resumes reading
+       */
+      static const qint64 RESUME_UNDELIVERED = 2 * 1024 * 1024;
+
+      /**
+       * The most events taken from a single epoll_wait
+       */
+      static const int MAX_EVENTS = 256;
+
+      /**
+       * Returns the reactor, starting it on first use
+       */
+      static EpollReactor &GetInstance();
+
+      /**
+       * Destructor
+       */
+      virtual ~EpollReactor();
+
+      /**
+       * Watches a listening socket, accepted sockets are delivered as
+       * Accepted events and must be registered with AddConnection.
+       * Returns the id of the listener.
+       * @param fd a non-blocking listening socket
+       * @param handler receives the Accepted events
+       */
+      int AddListener(int fd, Handler *handler);
+
+      /**
+       * Watches a connected socket or one with a non-blocking connect in
+       * progress, the latter results in a Connected or ConnectFailed event.
+       * Returns the id of the connection.
+       * @param fd a non-blocking socket
+       * @param handler receives the events for the connection
+       * @param connecting true if a connect is in progress
+       */
+      int AddConnection(int fd, Handler *handler, bool connecting = false);
+
+      /**
+       * Changes the handler receiving a descriptor's events
+       * @param id the descriptor's id
+       * @param handler the new handler
+       */
+      void SetHandler(int id, Handler *handler);
+
+      /**
+       * Stops watching and closes a descriptor, no further events are
+       * delivered for it
+       * @param id the descriptor's id
+       */
+      void Remove(int id);
+
+      /**
+       * Queues a message on a connection, the message is written by Flush.
+       * Returns false if the connection has closed.
+       * @param id the connection's id
+       * @param data the message
+       */
+      bool Send(int id, const QByteArray &data);
+
+      /**
+       * Writes the queued messages of a connection as far as the socket
+       * accepts them, the reactor writes the remainder as the socket drains
+       * @param id the connection's id
+       */
+      void Flush(int id);
+
+      /**
+       * Returns the number of bytes queued on a connection but not yet
+       * written to its socket
+       * @param id the connection's id
+       */
+      qint64 GetPendingBytes(int id);
+
+      /**
+       * Returns the number of descriptors being watched
+       */
+      int GetCount();
+
+    protected:
+      /**
+       * The epoll loop
+       */
+      virtual void run();
+
+    private slots:
+      /**
+       * Dispatches the events collected by the epoll loop
+       */
+      void Deliver();
+
+    private:
+      struct Connection {
+        Connection(int id, int fd, bool listener, bool connecting) :
+          id(id), fd(fd), listener(listener), connecting(connecting),
+          closed(false), paused(false), want_write(false), undelivered(0)
+        {
+        }
+
+        const int id;
+        const int fd;
+        const bool listener;
+        bool connecting;
+        bool closed;
+        bool paused;
+        bool want_write;
+        qint64 undelivered;
+        QMutex lock;
+        FrameReader reader;
+        FrameWriter writer;
+      };
+
+      EpollReactor();
+      Q_DISABLE_COPY(EpollReactor)
+
+      int Add(int fd, Handler *handler, bool listener, bool connecting);
+      QSharedPointer<Connection> Lookup(int id);
+      void Watch(Connection *conn, int op);
+      void Process(Connection *conn, unsigned int events, QList<EpollEvent> &out);
+      void AcceptAll(Connection *conn, QList<EpollEvent> &out);
+      void ReadAll(Connection *conn, QList<EpollEvent> &out);
+      void WriteAll(Connection *conn, QList<EpollEvent> &out);
+      void Close(Connection *conn, const QString &reason, QList<EpollEvent> &out);
+      void Post(const QList<EpollEvent> &events);
+
+      int _epoll_fd;
+      int _wake_fd;
+      int _next_id;
+
+      QMutex _connections_lock;
+      QHash<int, QSharedPointer<Connection> > _connections;
+
+      QMutex _inbox_lock;
+      QList<EpollEvent> _inbox;
+
+      // Only touched on the main thread
+      QHash<int, Handler *> _handlers;
+  };
+}
+}
+
+#endif
@@ -0,0 +1,134 @@
+#include <QDebug>
+#include <cstring>
+
+#include "Utils/Serialization.hpp"
+#include "FrameReader.hpp"
+
+using Dissent::Utils::Serialization;
+
+namespace Dissent {
+namespace Transports {
+  FrameReader::FrameReader() :
+    _buffer(BUFFER_SIZE, 0),
+    _start(0),
+    _end(0),
+    _payload_length(0),
+    _payload_filled(0),
+    _direct(false),
+    _trailer(false)
+  {
+  }
+
+  char *FrameReader::GetWritePointer()
+  {
+    if(_direct) {
+      return _payload.data() + _payload_filled;
+    }
+
+    // Move the partial frame to the front, small frames always fit
+    if(_start > 0) {
+      std::memmove(_buffer.data(), _buffer.constData() + _start, _end - _start);
+      _end -= _start;
+      _start = 0;
+    }
+    return _buffer.data() + _end;
+  }
+
+  int FrameReader::GetWriteSpace() const
+  {
+    if(_direct) {
+      return _payload.size() - _payload_filled;
+    }
+    return BUFFER_SIZE - (_end - _start);
+  }
+
+  bool FrameReader::Commit(int count)
+  {
+    if(_direct) {
+      _payload_filled += count;
+      if(_payload_filled < _payload_length) {
+        // Only grow the payload once the peer has filled it
+        if(_payload_filled == _payload.size()) {
+          _payload.resize(qMin(_payload_length, 2 * _payload.size()));
+        }
+        return true;
+      }
+      _direct = false;
+      _trailer = true;
+    } else {
+      _end += count;
+    }
+
+    return Parse();
+  }
+
+  QList<QByteArray> FrameReader::TakeFrames()
+  {
+    QList<QByteArray> frames = _frames;
+    _frames.clear();
+    return frames;
+  }
+
+  bool FrameReader::Parse()
+  {
+    while(true) {
+      int available = _end - _start;
+
+      if(_trailer) {
+        if(available < 4) {
+          return true;
+        }
+
+        if(Serialization::ReadInt(_buffer, _start) != 0) {
+          qCritical() << "Mismatch on byte array!";
+        }
+        _start += 4;
+        _frames.append(_payload);
+        _payload = QByteArray();
+        _trailer = false;
+        continue;
+      }
+
+      if(available < 4) {
+        return true;
+      }
+
+      int length = Serialization::ReadInt(_buffer, _start);
+      if(length < 0 || length > MAX_FRAME_SIZE) {
+        qWarning() << "Frame of" << length << "bytes exceeds" << MAX_FRAME_SIZE;
+        return false;
+      }
+
+      if(length + 8 <= available) {
+        _frames.append(QByteArray(_buffer.constData() + _start + 4, length));
+        if(Serialization::ReadInt(_buffer, _start + 4 + length) != 0) {
+          qCritical() << "Mismatch on byte array!";
+        }
+        _start += length + 8;
+        continue;
+      }
+
+      if(length + 8 <= BUFFER_SIZE) {
+        return true;
+      }
+
+      // Too large for the receive buffer, the rest of the payload is
+      // received in place
+      _payload_length = length;
+      _payload.resize(qMin(length, 2 * BUFFER_SIZE));
+      _payload_filled = qMin(available - 4, length);
+      std::memcpy(_payload.data(), _buffer.constData() + _start + 4, _payload_filled);
+      _start += 4 + _payload_filled;
+
+      if(_payload_filled == length) {
+        _trailer = true;
+        continue;
+      }
+
+      _start = _end = 0;
+      _direct = true;
+      return true;
+    }
+  }
+}
+}
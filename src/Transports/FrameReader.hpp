@@ -0,0 +1,80 @@
+#ifndef DISSENT_TRANSPORTS_FRAME_READER_H_GUARD
+#define DISSENT_TRANSPORTS_FRAME_READER_H_GUARD
+
+#include <QByteArray>
+#include <QList>
+
+namespace Dissent {
+namespace Transports {
+  /**
+   * Incrementally parses the frames written by FrameWriter.  Received bytes
+   * are placed at GetWritePointer and announced with Commit.  Small frames
+   * are parsed in place from a reusable receive buffer, while the payload
+   * of a frame larger than that buffer is received directly into the
+   * payload returned to the caller.  That payload grows as its bytes arrive,
+   * and a frame announcing more than MAX_FRAME_SIZE bytes is rejected.
+   *
+   *   while(data available) {
+   *     int count = read(reader.GetWritePointer(), reader.GetWriteSpace());
+   *     reader.Commit(count);
+   *     foreach(const QByteArray &msg, reader.TakeFrames()) { ... }
+   *   }
+   */
+  class FrameReader {
+    public:
+      /**
+       * Size of the reusable receive buffer
+       */
+      static const int BUFFER_SIZE = 64 * 1024;
+
+      /**
+       * Largest payload accepted from a peer
+       */
+      static const int MAX_FRAME_SIZE = 16 * 1024 * 1024;
+
+      /**
+       * Constructor
+       */
+      FrameReader();
+
+      /**
+       * Returns where the next received bytes should be placed
+       */
+      char *GetWritePointer();
+
+      /**
+       * Returns the number of bytes that can be placed at GetWritePointer
+       */
+      int GetWriteSpace() const;
+
+      /**
+       * Parses count bytes placed at GetWritePointer.  Returns false if the
+       * stream is not correctly framed.
+       * @param count the number of bytes received
+       */
+      bool Commit(int count);
+
+      /**
+       * Removes and returns the completely received frames
+       */
+      QList<QByteArray> TakeFrames();
+
+    private:
+      bool Parse();
+
+      QByteArray _buffer;
+      int _start;
+      int _end;
+
+      QByteArray _payload;
+      int _payload_length;
+      int _payload_filled;
+      bool _direct;
+      bool _trailer;
+
+      QList<QByteArray> _frames;
+  };
+}
+}
+
+#endif
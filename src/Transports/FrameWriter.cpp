@@ -0,0 +1,116 @@
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <cstring>
+
+#include "Utils/Serialization.hpp"
+#include "FrameWriter.hpp"
+
+using Dissent::Utils::Serialization;
+
+namespace Dissent {
+namespace Transports {
+  FrameWriter::FrameWriter() :
+    _offset(0),
+    _pending(0)
+  {
+  }
+
+  void FrameWriter::Append(const QByteArray &payload)
+  {
+    static const char zero[4] = {0, 0, 0, 0};
+
+    int offset = _batch.size();
+    _batch.resize(offset + 4);
+    Serialization::WriteInt(payload.size(), _batch, offset);
+
+    if(payload.size() <= COALESCE_LIMIT) {
+      _batch.append(payload);
+    } else {
+      CloseBatch();
+      _pieces.append(payload);
+    }
+
+    _batch.append(zero, 4);
+    _pending += payload.size() + 8;
+  }
+
+  bool FrameWriter::IsEmpty() const
+  {
+    return _pending == 0;
+  }
+
+  qint64 FrameWriter::WriteTo(int fd)
+  {
+    CloseBatch();
+    qint64 total = 0;
+
+    while(!_pieces.isEmpty()) {
+      struct iovec iov[MAX_IOVECS];
+      int count = 0;
+      for(int idx = 0; idx < _pieces.size() && count < MAX_IOVECS; idx++) {
+        const QByteArray &piece = _pieces[idx];
+        int skip = idx == 0 ? _offset : 0;
+        iov[count].iov_base = const_cast<char *>(piece.constData() + skip);
+        iov[count].iov_len = piece.size() - skip;
+        count++;
+      }
+
+      // MSG_NOSIGNAL turns a write to a closed peer into EPIPE rather than
+      // a SIGPIPE that would end the process
+      struct msghdr msg;
+      std::memset(&msg, 0, sizeof(msg));
+      msg.msg_iov = iov;
+      msg.msg_iovlen = count;
+      ssize_t written = ::sendmsg(fd, &msg, MSG_NOSIGNAL);
+      if(written < 0) {
+        if(errno == EINTR) {
+          continue;
+        } else if(errno == EAGAIN || errno == EWOULDBLOCK) {
+          break;
+        }
+        return -1;
+      }
+
+      total += written;
+      _pending -= written;
+      while(written > 0) {
+        int remaining = _pieces.first().size() - _offset;
+        if(written < remaining) {
+          _offset += written;
+          break;
+        }
+        written -= remaining;
+        _pieces.removeFirst();
+        _offset = 0;
+      }
+    }
+
+    return total;
+  }
+
+  QList<QByteArray> FrameWriter::TakeAll()
+  {
+    CloseBatch();
+    QList<QByteArray> pieces = _pieces;
+    if(_offset > 0) {
+      pieces[0] = pieces[0].mid(_offset);
+    }
+
+    _pieces.clear();
+    _offset = 0;
+    _pending = 0;
+    return pieces;
+  }
+
+  void FrameWriter::CloseBatch()
+  {
+    if(_batch.isEmpty()) {
+      return;
+    }
+
+    _pieces.append(_batch);
+    _batch = QByteArray();
+  }
+}
+}
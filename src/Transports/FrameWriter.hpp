@@ -0,0 +1,74 @@
+#ifndef DISSENT_TRANSPORTS_FRAME_WRITER_H_GUARD
+#define DISSENT_TRANSPORTS_FRAME_WRITER_H_GUARD
+
+#include <QByteArray>
+#include <QList>
+
+namespace Dissent {
+namespace Transports {
+  /**
+   * Queues messages for a stream transport.  Each message is framed as a
+   * 4 byte length, the payload, and a 4 byte zero trailer.  Small frames are
+   * coalesced into a single buffer, while large payloads are kept by
+   * reference and written directly from the caller's buffer, so that all
+   * queued frames can be written with a single scatter / gather write.
+   */
+  class FrameWriter {
+    public:
+      /**
+       * Payloads up to this size are copied into a shared batch buffer
+       */
+      static const int COALESCE_LIMIT = 4096;
+
+      /**
+       * The most buffers passed to a single writev
+       */
+      static const int MAX_IOVECS = 64;
+
+      /**
+       * Constructor
+       */
+      FrameWriter();
+
+      /**
+       * Queues a message
+       * @param payload the message
+       */
+      void Append(const QByteArray &payload);
+
+      /**
+       * Returns true if nothing is queued
+       */
+      bool IsEmpty() const;
+
+      /**
+       * Returns the number of queued bytes including framing
+       */
+      qint64 PendingBytes() const { return _pending; }
+
+      /**
+       * Writes as much as the non-blocking socket accepts.  Returns the
+       * number of bytes written or -1 on an error other than the descriptor
+       * being full, in which case errno is set.
+       * @param fd the descriptor
+       */
+      qint64 WriteTo(int fd);
+
+      /**
+       * Removes and returns the unwritten remainder as a list of buffers,
+       * for writing through a buffered device
+       */
+      QList<QByteArray> TakeAll();
+
+    private:
+      void CloseBatch();
+
+      QList<QByteArray> _pieces;
+      QByteArray _batch;
+      int _offset;
+      qint64 _pending;
+  };
+}
+}
+
+#endif
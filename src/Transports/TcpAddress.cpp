@@ -7,21 +7,36 @@ namespace Transports {
 
   TcpAddress::TcpAddress(const QUrl &url)
   {
-    if(url.scheme() != Scheme) {
-      qCritical() << "Invalid scheme:" << url.scheme() << " expected:" << Scheme;
-      _data = new AddressData(url);
-      return;
-    }
-
-    Init(url.host(), url.port(0));
+    Init(url, Scheme);
   }
 
   TcpAddress::TcpAddress(const QString &ip, int port)
   {
-    Init(ip, port);
+    Init(ip, port, Scheme);
+  }
+
+  TcpAddress::TcpAddress(const QUrl &url, const QString &scheme)
+  {
+    Init(url, scheme);
+  }
+
+  TcpAddress::TcpAddress(const QString &ip, int port, const QString &scheme)
+  {
+    Init(ip, port, scheme);
+  }
+
+  void TcpAddress::Init(const QUrl &url, const QString &scheme)
+  {
+    if(url.scheme() != scheme) {
+      qCritical() << "Invalid scheme:" << url.scheme() << " expected:" << scheme;
+      _data = new AddressData(url);
+      return;
+    }
+
+    Init(url.host(), url.port(0), scheme);
   }
   
-  void TcpAddress::Init(const QString &ip, int port)
+  void TcpAddress::Init(const QString &ip, int port, const QString &scheme)
   {
     bool valid = true;
 
@@ -41,7 +56,7 @@ namespace Transports {
     }
 
     QUrl url;
-    url.setScheme(Scheme);
+    url.setScheme(scheme);
     url.setHost(ip);
     url.setPort(port);
 
@@ -66,7 +81,8 @@ namespace Transports {
   {
     const TcpAddressData *bother = dynamic_cast<const TcpAddressData *>(other);
     if(bother) {
-      return ip == bother->ip && port == bother->port && valid == bother->valid;
+      return ip == bother->ip && port == bother->port && valid == bother->valid &&
+        url.scheme() == bother->url.scheme();
     } else {
       return AddressData::Equals(other);
     }
@@ -91,8 +91,24 @@ namespace Transports {
         }
       }
 
+    protected:
+      /**
+       * Constructors for ip / port addresses under another scheme
+       * @param url the address as a url
+       * @param scheme the expected scheme
+       */
+      TcpAddress(const QUrl &url, const QString &scheme);
+
+      /**
+       * @param ip provided ip or any if non-specified (0.0.0.0)
+       * @param port provided port or any if non-specified (0)
+       * @param scheme the scheme
+       */
+      TcpAddress(const QString &ip, int port, const QString &scheme);
+
     private:
-      void Init(const QString &ip, int port);
+      void Init(const QUrl &url, const QString &scheme);
+      void Init(const QString &ip, int port, const QString &scheme);
   };
 }
 }
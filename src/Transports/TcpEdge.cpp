@@ -1,3 +1,6 @@
+#include <errno.h>
+#include <cstring>
+
 #include "TcpEdge.hpp"
 #include "Utils/Serialization.hpp"
 #include "Utils/Time.hpp"
@@ -12,7 +15,8 @@ namespace Transports {
       QTcpSocket *socket) :
     Edge(local, remote, outgoing),
     _socket(socket, &QObject::deleteLater),
-    _connected(true)
+    _connected(true),
+    _flush_pending(false)
   {
     socket->setParent(0);
 
@@ -37,55 +41,66 @@ namespace Transports {
       return;
     }
 
-    QByteArray length(4, 0);
-    Serialization::WriteInt(data.size(), length, 0);
-    if((_socket->write(length) != 4) ||
-        (_socket->write(data) != data.size()) ||
-        (_socket->write(Zero) != 4))
-    {
-      qCritical() << "Didn't write all data to the socket!!!!!";
+    _writer.Append(data);
+    if(!_flush_pending) {
+      _flush_pending = true;
+      QMetaObject::invokeMethod(this, "Flush", Qt::QueuedConnection);
     }
     Sent();
   }
 
-  void TcpEdge::Read()
+  void TcpEdge::Flush()
   {
-    int total_length = _socket->bytesAvailable();
-    qint64 stime = Utils::Time::GetInstance().MSecsSinceEpoch();
-    qint64 ntime = stime;
-    bool delay = false;
+    _flush_pending = false;
+    if(_writer.IsEmpty()) {
+      return;
+    }
 
-    while(total_length >= 8 && !delay) {
-      QByteArray length_arr = _socket->peek(4);
-      if(length_arr.isEmpty()) {
-        qCritical() << "Error reading Tcp socket in" << ToString();
-        Stop("Error reading Tcp socket");
+    // Writing around the socket's buffer is only safe when it is empty
+    if(_socket->bytesToWrite() == 0 &&
+        _socket->state() == QAbstractSocket::ConnectedState)
+    {
+      if(_writer.WriteTo(_socket->socketDescriptor()) < 0) {
+        QString reason = QString::fromLocal8Bit(strerror(errno));
+        _writer.TakeAll();
+        Stop(reason);
         return;
       }
+    }
 
-      int length = Serialization::ReadInt(length_arr, 0);
-      if(length + 8 > total_length) {
+    // Leave the remainder and any errors to the socket
+    foreach(const QByteArray &piece, _writer.TakeAll()) {
+      if(_socket->write(piece) != piece.size()) {
+        qCritical() << "Didn't write all data to the socket!!!!!";
         break;
       }
+    }
+  }
 
-      if(length < 0) {
+  void TcpEdge::Read()
+  {
+    qint64 stime = Utils::Time::GetInstance().MSecsSinceEpoch();
+    qint64 ntime = stime;
+    bool delay = false;
+
+    while(_socket->bytesAvailable() > 0 && !delay) {
+      qint64 count = _socket->read(_reader.GetWritePointer(),
+          qMin<qint64>(_reader.GetWriteSpace(), _socket->bytesAvailable()));
+      if(count <= 0) {
+        qCritical() << "Error reading Tcp socket in" << ToString();
         Stop("Error reading Tcp socket");
         return;
       }
 
-      QByteArray msg = _socket->read(length + 8);
-      if(msg.isEmpty()) {
+      if(!_reader.Commit(count)) {
         Stop("Error reading Tcp socket");
-        qCritical() << "Error reading Tcp socket in" << ToString();
         return;
       }
 
-      if(Serialization::ReadInt(msg, length + 4) != 0) {
-        qCritical() << "Mismatch on byte array!";
+      foreach(const QByteArray &msg, _reader.TakeFrames()) {
+        PushData(GetSharedPointer(), msg);
       }
 
-      PushData(GetSharedPointer(), msg.mid(4, length));
-      total_length = _socket->bytesAvailable();
       ntime = Utils::Time::GetInstance().MSecsSinceEpoch();
       delay = (ntime - stime) > 1000;
     }
@@ -103,6 +118,7 @@ namespace Transports {
   void TcpEdge::OnStop()
   {
     Edge::OnStop();
+    Flush();
     // The following is somewhat dangerous but we do not have a clear definition of
     // the effect on what a Stop call has on an Edge.
     _socket->abort();
@@ -4,6 +4,8 @@
 #include <QSharedPointer>
 #include <QTcpSocket>
 #include "Edge.hpp"
+#include "FrameReader.hpp"
+#include "FrameWriter.hpp"
 #include "TcpAddress.hpp"
 
 namespace Dissent {
@@ -32,6 +34,11 @@ namespace Transports {
        */
       virtual ~TcpEdge();
 
+      /**
+       * Queues data for the socket, messages sent during the same event
+       * loop iteration are written together
+       * @param data the message
+       */
       virtual void Send(const QByteArray &data);
 
       virtual inline void SetRemotePersistentAddress(const Address &addr)
@@ -68,9 +75,19 @@ namespace Transports {
       void HandleError(QAbstractSocket::SocketError error);
       void Read();
 
+      /**
+       * Writes all queued messages, directly to the socket descriptor
+       * with a single scatter / gather write when the socket's own buffer
+       * is empty
+       */
+      void Flush();
+
     private:
       QSharedPointer<QTcpSocket> _socket;
       bool _connected;
+      FrameReader _reader;
+      FrameWriter _writer;
+      bool _flush_pending;
 
     signals:
       void DelayedRead();
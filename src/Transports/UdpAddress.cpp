@@ -0,0 +1,30 @@
+#include "UdpAddress.hpp"
+
+namespace Dissent {
+namespace Transports {
+  const QString UdpAddress::Scheme = "udp";
+
+  UdpAddress::UdpAddress(const QUrl &url) : TcpAddress(url, Scheme)
+  {
+  }
+
+  UdpAddress::UdpAddress(const QString &ip, int port) :
+    TcpAddress(ip, port, Scheme)
+  {
+  }
+
+  UdpAddress::UdpAddress(const UdpAddress &other) : TcpAddress(other)
+  {
+  }
+
+  const Address UdpAddress::Create(const QUrl &url)
+  {
+    return UdpAddress(url);
+  }
+
+  const Address UdpAddress::CreateAny()
+  {
+    return UdpAddress();
+  }
+}
+}
@@ -0,0 +1,36 @@
+#ifndef DISSENT_TRANSPORTS_UDP_ADDRESS_H_GUARD
+#define DISSENT_TRANSPORTS_UDP_ADDRESS_H_GUARD
+
+#include "TcpAddress.hpp"
+
+namespace Dissent {
+namespace Transports {
+  /**
+   * A Udp end point, which shares the form of a Tcp end point
+   */
+  class UdpAddress : public TcpAddress {
+    public:
+      const static QString Scheme;
+
+      explicit UdpAddress(const QUrl &url);
+      UdpAddress(const UdpAddress &other);
+
+      /**
+       * Creates a Udp Address using the ip address and port
+       * @param ip provided ip or any if non-specified (0.0.0.0)
+       * @param port provided port or any if non-specified (0)
+       */
+      explicit UdpAddress(const QString &ip = "0.0.0.0", int port = 0);
+
+      /**
+       * Destructor
+       */
+      virtual ~UdpAddress() {}
+
+      static const Address Create(const QUrl &url);
+      static const Address CreateAny();
+  };
+}
+}
+
+#endif
@@ -0,0 +1,56 @@
+#include <QDebug>
+#include "UdpEdge.hpp"
+#include "UdpEdgeListener.hpp"
+
+namespace Dissent {
+namespace Transports {
+  UdpEdge::UdpEdge(const Address &local, const Address &remote, bool outgoing,
+      UdpEdgeListener *listener, const QByteArray &peer, quint32 session_id) :
+    Edge(local, remote, outgoing),
+    _listener(listener),
+    _peer(peer),
+    _key(UdpEdgeListener::FlowKey(peer, session_id)),
+    _session(session_id, outgoing)
+  {
+  }
+
+  UdpEdge::~UdpEdge()
+  {
+    if(_listener) {
+      _listener->Detach(this);
+    }
+  }
+
+  void UdpEdge::Send(const QByteArray &data)
+  {
+    if(Stopped()) {
+      qWarning() << "Attempted to send on a closed edge:" << ToString();
+      return;
+    }
+
+    _session.Send(data);
+    if(_listener) {
+      _listener->Schedule(this);
+    }
+    Sent();
+  }
+
+  void UdpEdge::Deliver()
+  {
+    foreach(const QByteArray &msg, _session.TakeMessages()) {
+      if(Stopped()) {
+        return;
+      }
+      PushData(GetSharedPointer(), msg);
+    }
+  }
+
+  void UdpEdge::OnStop()
+  {
+    if(_listener) {
+      _listener->Detach(this);
+    }
+    Edge::OnStop();
+  }
+}
+}
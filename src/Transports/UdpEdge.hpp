@@ -0,0 +1,103 @@
+#ifndef DISSENT_TRANSPORTS_UDP_EDGE_H_GUARD
+#define DISSENT_TRANSPORTS_UDP_EDGE_H_GUARD
+
+#include <QPointer>
+
+#include "Edge.hpp"
+#include "UdpAddress.hpp"
+#include "UdpSession.hpp"
+
+namespace Dissent {
+namespace Transports {
+  class UdpEdgeListener;
+
+  /**
+   * A reliable, ordered edge over Udp.  All edges of a UdpEdgeListener
+   * share its socket, the edge keeps the flow's UdpSession.
+   */
+  class UdpEdge : public Edge {
+    Q_OBJECT
+
+    public:
+      /**
+       * Constructor
+       * @param local the local address of the edge
+       * @param remote the address of the remote point of the edge
+       * @param outgoing true if the local side requested the creation of this edge
+       * @param listener the listener owning the socket
+       * @param peer the remote socket address
+       * @param session_id identifies the flow between the two sockets
+       */
+      explicit UdpEdge(const Address &local, const Address &remote,
+          bool outgoing, UdpEdgeListener *listener, const QByteArray &peer,
+          quint32 session_id);
+
+      /**
+       * Destructor
+       */
+      virtual ~UdpEdge();
+
+      /**
+       * Queues data on the session, messages sent during the same event
+       * loop iteration are transmitted together
+       * @param data the message
+       */
+      virtual void Send(const QByteArray &data);
+
+      virtual inline void SetRemotePersistentAddress(const Address &addr)
+      {
+        const TcpAddress &new_ta = static_cast<const TcpAddress &>(addr);
+        const TcpAddress &old_ta = static_cast<const TcpAddress &>(GetRemoteAddress());
+
+        QHostAddress ha = old_ta.GetIP();
+
+        if(old_ta.GetIP() != new_ta.GetIP()) {
+          if(ha == QHostAddress::Null ||
+              ha == QHostAddress::LocalHost ||
+              ha == QHostAddress::LocalHostIPv6 ||
+              ha == QHostAddress::Broadcast ||
+              ha == QHostAddress::Any ||
+              ha == QHostAddress::AnyIPv6)
+          {
+            ha = new_ta.GetIP();
+          }
+        }
+        Edge::SetRemotePersistentAddress(UdpAddress(ha.toString(), new_ta.GetPort()));
+      }
+
+      /**
+       * Returns the flow's session
+       */
+      UdpSession &GetSession() { return _session; }
+
+      /**
+       * Returns the remote socket address
+       */
+      const QByteArray &GetPeer() const { return _peer; }
+
+      /**
+       * Returns the remote socket address and session identifier, which
+       * identify the flow at the listener
+       */
+      const QByteArray &GetKey() const { return _key; }
+
+      /**
+       * Pushes the messages completed by the session to the sink
+       */
+      void Deliver();
+
+    protected:
+      /**
+       * Called as a result of Stop has been called
+       */
+      virtual void OnStop();
+
+    private:
+      QPointer<UdpEdgeListener> _listener;
+      const QByteArray _peer;
+      QByteArray _key;
+      UdpSession _session;
+  };
+}
+}
+#endif
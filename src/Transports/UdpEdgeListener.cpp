@@ -0,0 +1,427 @@
+#include <QDebug>
+#include <QNetworkInterface>
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "Utils/Random.hpp"
+#include "Utils/Time.hpp"
+#include "Utils/Timer.hpp"
+
+#include "UdpEdgeListener.hpp"
+
+namespace Dissent {
+namespace Transports {
+  namespace {
+    const int SOCKET_BUFFER = 4 * 1024 * 1024;
+
+    QString ErrorString(int error)
+    {
+      return QString::fromLocal8Bit(strerror(error));
+    }
+
+    QByteArray ToPeer(const QHostAddress &ip, int port)
+    {
+      struct sockaddr_storage addr;
+      memset(&addr, 0, sizeof(addr));
+      if(ip.protocol() == QAbstractSocket::IPv6Protocol) {
+        struct sockaddr_in6 *addr6 = reinterpret_cast<struct sockaddr_in6 *>(&addr);
+        addr6->sin6_family = AF_INET6;
+        addr6->sin6_port = htons(port);
+        Q_IPV6ADDR bytes = ip.toIPv6Address();
+        memcpy(&addr6->sin6_addr, &bytes, sizeof(addr6->sin6_addr));
+        return QByteArray(reinterpret_cast<const char *>(&addr), sizeof(*addr6));
+      }
+
+      struct sockaddr_in *addr4 = reinterpret_cast<struct sockaddr_in *>(&addr);
+      addr4->sin_family = AF_INET;
+      addr4->sin_port = htons(port);
+      addr4->sin_addr.s_addr = htonl(ip.toIPv4Address());
+      return QByteArray(reinterpret_cast<const char *>(&addr), sizeof(*addr4));
+    }
+
+    UdpAddress FromPeer(const QByteArray &peer)
+    {
+      const struct sockaddr *addr = reinterpret_cast<const struct sockaddr *>(peer.constData());
+      int port = addr->sa_family == AF_INET6 ?
+        ntohs(reinterpret_cast<const struct sockaddr_in6 *>(addr)->sin6_port) :
+        ntohs(reinterpret_cast<const struct sockaddr_in *>(addr)->sin_port);
+      return UdpAddress(QHostAddress(addr).toString(), port);
+    }
+  }
+
+  const QString UdpEdgeListener::Scheme = "udp";
+
+  UdpEdgeListener::UdpEdgeListener(const UdpAddress &local_address) :
+    EdgeListener(local_address),
+    _fd(-1),
+    _flush_pending(false),
+    _recv_buffer(BATCH * (UdpSession::HEADER_SIZE + UdpSession::MAX_PAYLOAD), 0)
+  {
+  }
+
+  EdgeListener *UdpEdgeListener::Create(const Address &local_address)
+  {
+    const UdpAddress &ua = static_cast<const UdpAddress &>(local_address);
+    return new UdpEdgeListener(ua);
+  }
+
+  UdpEdgeListener::~UdpEdgeListener()
+  {
+    DestructorCheck();
+
+    // The edges cannot outlive the socket
+    foreach(UdpEdge *edge, _edges.values()) {
+      if(_connecting.contains(edge)) {
+        Forget(edge);
+      } else {
+        edge->Stop("EdgeListener destroyed");
+      }
+    }
+    _connecting.clear();
+    SendQueued();
+
+    _tick.Stop();
+    if(_notifier) {
+      _notifier->setEnabled(false);
+      _notifier.clear();
+    }
+    if(_fd >= 0) {
+      ::close(_fd);
+    }
+  }
+
+  QByteArray UdpEdgeListener::FlowKey(const QByteArray &peer, quint32 session_id)
+  {
+    QByteArray key = peer;
+    key.append(reinterpret_cast<const char *>(&session_id), sizeof(session_id));
+    return key;
+  }
+
+  void UdpEdgeListener::OnStart()
+  {
+    EdgeListener::OnStart();
+
+    const UdpAddress &addr = static_cast<const UdpAddress &>(GetAddress());
+    QByteArray local = ToPeer(addr.GetIP(), addr.GetPort());
+    struct sockaddr_storage saddr;
+    memcpy(&saddr, local.constData(), local.size());
+    socklen_t length = local.size();
+
+    _fd = ::socket(saddr.ss_family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(_fd < 0 ||
+        ::bind(_fd, reinterpret_cast<struct sockaddr *>(&saddr), length) ||
+        ::getsockname(_fd, reinterpret_cast<struct sockaddr *>(&saddr), &length))
+    {
+      qFatal("%s", QString("Unable to bind to " + addr.ToString() + ": " +
+            ErrorString(errno)).toUtf8().data());
+    }
+
+    // Many flows share these, the kernel caps them if not permitted
+    ::setsockopt(_fd, SOL_SOCKET, SO_RCVBUF, &SOCKET_BUFFER, sizeof(SOCKET_BUFFER));
+    ::setsockopt(_fd, SOL_SOCKET, SO_SNDBUF, &SOCKET_BUFFER, sizeof(SOCKET_BUFFER));
+
+    // deleteLater since the listener may be destroyed while reading
+    _notifier = QSharedPointer<QSocketNotifier>(
+        new QSocketNotifier(_fd, QSocketNotifier::Read), &QObject::deleteLater);
+    QObject::connect(_notifier.data(), SIGNAL(activated(int)), this, SLOT(Read()));
+
+    TimerCallback *cb = new TimerCallback(this, &UdpEdgeListener::Tick, 0);
+    _tick = Utils::Timer::GetInstance().QueueCallback(cb, TICK, TICK);
+
+    // XXX the following is a hack so I don't need to support multiple local addresses
+    QHostAddress ip(reinterpret_cast<struct sockaddr *>(&saddr));
+    if(ip == QHostAddress::Any || ip == QHostAddress::AnyIPv6) {
+      ip = QHostAddress::LocalHost;
+      foreach(const QHostAddress &local_ip, QNetworkInterface::allAddresses()) {
+        if(local_ip == QHostAddress::Null ||
+            local_ip == QHostAddress::LocalHost ||
+            local_ip == QHostAddress::LocalHostIPv6 ||
+            local_ip == QHostAddress::Broadcast ||
+            local_ip == QHostAddress::Any ||
+            local_ip == QHostAddress::AnyIPv6)
+        {
+            continue;
+        }
+        ip = local_ip;
+        break;
+      }
+    }
+
+    QByteArray bound(reinterpret_cast<const char *>(&saddr), length);
+    SetAddress(UdpAddress(ip.toString(), FromPeer(bound).GetPort()));
+  }
+
+  void UdpEdgeListener::OnStop()
+  {
+    EdgeListener::OnStop();
+
+    // Established edges keep using the socket until they stop
+    QHash<UdpEdge *, QSharedPointer<Edge> > connecting = _connecting;
+    _connecting.clear();
+    for(QHash<UdpEdge *, QSharedPointer<Edge> >::const_iterator it =
+        connecting.constBegin(); it != connecting.constEnd(); ++it)
+    {
+      Forget(it.key());
+      ProcessEdgeCreationFailure(it.key()->GetRemoteAddress(), "EdgeListner Stopped");
+    }
+  }
+
+  void UdpEdgeListener::CreateEdgeTo(const Address &to)
+  {
+    if(Stopped()) {
+      qWarning() << "Cannot CreateEdgeTo Stopped EL";
+      return;
+    }
+
+    if(!Started()) {
+      qWarning() << "Cannot CreateEdgeTo non-Started EL";
+      return;
+    }
+
+    qDebug() << "Connecting to" << to.ToString();
+    const UdpAddress &rem_ua = static_cast<const UdpAddress &>(to);
+    QByteArray peer = ToPeer(rem_ua.GetIP(), rem_ua.GetPort());
+
+    quint32 session_id;
+    do {
+      session_id = Utils::Random::GetInstance().GetInt();
+    } while(_edges.contains(FlowKey(peer, session_id)));
+
+    UdpEdge *edge = new UdpEdge(GetAddress(), rem_ua, true, this, peer, session_id);
+    QSharedPointer<Edge> shared(edge, &QObject::deleteLater);
+    SetSharedPointer(shared);
+
+    _edges[edge->GetKey()] = edge;
+    _connecting[edge] = shared;
+    Schedule(edge);
+  }
+
+  void UdpEdgeListener::Schedule(UdpEdge *edge)
+  {
+    _dirty.insert(edge);
+    ScheduleFlush();
+  }
+
+  void UdpEdgeListener::Detach(UdpEdge *edge)
+  {
+    if(_edges.value(edge->GetKey()) != edge) {
+      return;
+    }
+
+    // Transmit what the window allows and inform the remote side
+    UdpSession &session = edge->GetSession();
+    if(session.Connected() && !session.RemoteClosed() && !session.Failed()) {
+      qint64 now = Utils::Time::GetInstance().MSecsSinceEpoch();
+      foreach(const QByteArray &datagram, session.TakeDatagrams(now)) {
+        _outbox.append(qMakePair(edge->GetPeer(), datagram));
+      }
+      _outbox.append(qMakePair(edge->GetPeer(), session.CloseDatagram()));
+      ScheduleFlush();
+    }
+
+    Forget(edge);
+    _connecting.remove(edge);
+  }
+
+  void UdpEdgeListener::Forget(UdpEdge *edge)
+  {
+    _edges.remove(edge->GetKey());
+    _dirty.remove(edge);
+    _active.remove(edge);
+  }
+
+  void UdpEdgeListener::ScheduleFlush()
+  {
+    if(!_flush_pending) {
+      _flush_pending = true;
+      QMetaObject::invokeMethod(this, "Flush", Qt::QueuedConnection);
+    }
+  }
+
+  void UdpEdgeListener::Tick(const int &)
+  {
+    _dirty.unite(_active);
+    Flush();
+  }
+
+  void UdpEdgeListener::Read()
+  {
+    struct mmsghdr msgs[BATCH];
+    struct iovec iovs[BATCH];
+    struct sockaddr_storage addrs[BATCH];
+    const int size = UdpSession::HEADER_SIZE + UdpSession::MAX_PAYLOAD;
+    qint64 now = Utils::Time::GetInstance().MSecsSinceEpoch();
+
+    for(int round = 0; round < MAX_READ_BATCHES && _fd >= 0; round++) {
+      memset(msgs, 0, sizeof(msgs));
+      for(int idx = 0; idx < BATCH; idx++) {
+        iovs[idx].iov_base = _recv_buffer.data() + idx * size;
+        iovs[idx].iov_len = size;
+        msgs[idx].msg_hdr.msg_name = &addrs[idx];
+        msgs[idx].msg_hdr.msg_namelen = sizeof(addrs[idx]);
+        msgs[idx].msg_hdr.msg_iov = &iovs[idx];
+        msgs[idx].msg_hdr.msg_iovlen = 1;
+      }
+
+      int count = ::recvmmsg(_fd, msgs, BATCH, MSG_DONTWAIT, 0);
+      if(count < 0) {
+        if(errno == EINTR) {
+          continue;
+        } else if(errno != EAGAIN && errno != EWOULDBLOCK) {
+          qWarning() << "Error reading Udp socket:" << ErrorString(errno);
+        }
+        break;
+      }
+
+      for(int idx = 0; idx < count; idx++) {
+        if(msgs[idx].msg_hdr.msg_flags & MSG_TRUNC) {
+          continue;
+        }
+        QByteArray peer(reinterpret_cast<const char *>(&addrs[idx]),
+            msgs[idx].msg_hdr.msg_namelen);
+        QByteArray datagram(_recv_buffer.constData() + idx * size, msgs[idx].msg_len);
+        HandleDatagram(peer, datagram, now);
+      }
+
+      if(count < BATCH) {
+        break;
+      }
+    }
+  }
+
+  void UdpEdgeListener::HandleDatagram(const QByteArray &peer,
+      const QByteArray &datagram, qint64 now)
+  {
+    int type;
+    quint32 session_id;
+    if(!UdpSession::ParseHeader(datagram, type, session_id)) {
+      return;
+    }
+
+    UdpEdge *edge = _edges.value(FlowKey(peer, session_id));
+    if(edge == 0) {
+      if(type != UdpSession::Syn || !Started() || Stopped()) {
+        return;
+      }
+
+      UdpAddress remote = FromPeer(peer);
+      qDebug() << "Incoming connection from" << remote.ToString();
+      edge = new UdpEdge(GetAddress(), remote, false, this, peer, session_id);
+      QSharedPointer<Edge> shared(edge, &QObject::deleteLater);
+      SetSharedPointer(shared);
+      _edges[edge->GetKey()] = edge;
+      edge->GetSession().Receive(datagram, now);
+      Schedule(edge);
+      ProcessNewEdge(shared);
+      return;
+    }
+
+    UdpSession &session = edge->GetSession();
+    session.Receive(datagram, now);
+
+    if(_connecting.contains(edge) && session.Connected()) {
+      qDebug() << "Handling a successful connectTo from" <<
+        edge->GetRemoteAddress().ToString();
+      ProcessNewEdge(_connecting.take(edge));
+    }
+
+    edge->Deliver();
+    if(session.RemoteClosed()) {
+      edge->Stop("Disconnected");
+    } else if(_edges.value(edge->GetKey()) == edge) {
+      Schedule(edge);
+    }
+  }
+
+  void UdpEdgeListener::Flush()
+  {
+    _flush_pending = false;
+    qint64 now = Utils::Time::GetInstance().MSecsSinceEpoch();
+
+    QSet<UdpEdge *> dirty = _dirty;
+    _dirty.clear();
+    foreach(UdpEdge *edge, dirty) {
+      if(_edges.value(edge->GetKey()) == edge) {
+        Collect(edge, now);
+      }
+    }
+
+    SendQueued();
+  }
+
+  void UdpEdgeListener::Collect(UdpEdge *edge, qint64 now)
+  {
+    UdpSession &session = edge->GetSession();
+    foreach(const QByteArray &datagram, session.TakeDatagrams(now)) {
+      _outbox.append(qMakePair(edge->GetPeer(), datagram));
+    }
+
+    if(session.HasTimers()) {
+      _active.insert(edge);
+    } else {
+      _active.remove(edge);
+    }
+
+    if(!session.Failed()) {
+      return;
+    }
+
+    if(_connecting.contains(edge)) {
+      Address remote = edge->GetRemoteAddress();
+      QSharedPointer<Edge> shared = _connecting.take(edge);
+      Forget(edge);
+      qDebug() << "Unable to connect to host: " << remote.ToString() <<
+        session.GetFailReason();
+      ProcessEdgeCreationFailure(remote, session.GetFailReason());
+    } else {
+      edge->Stop(session.GetFailReason());
+    }
+  }
+
+  void UdpEdgeListener::SendQueued()
+  {
+    if(_fd < 0) {
+      _outbox.clear();
+      return;
+    }
+
+    struct mmsghdr msgs[BATCH];
+    struct iovec iovs[BATCH];
+
+    int offset = 0;
+    while(offset < _outbox.size()) {
+      int count = qMin(int(BATCH), _outbox.size() - offset);
+      memset(msgs, 0, sizeof(msgs));
+      for(int idx = 0; idx < count; idx++) {
+        const QPair<QByteArray, QByteArray> &entry = _outbox[offset + idx];
+        iovs[idx].iov_base = const_cast<char *>(entry.second.constData());
+        iovs[idx].iov_len = entry.second.size();
+        msgs[idx].msg_hdr.msg_name = const_cast<char *>(entry.first.constData());
+        msgs[idx].msg_hdr.msg_namelen = entry.first.size();
+        msgs[idx].msg_hdr.msg_iov = &iovs[idx];
+        msgs[idx].msg_hdr.msg_iovlen = 1;
+      }
+
+      int sent = ::sendmmsg(_fd, msgs, count, 0);
+      if(sent < 0) {
+        if(errno == EINTR) {
+          continue;
+        } else if(errno == EAGAIN || errno == EWOULDBLOCK) {
+          // The socket is full, the next tick tries again
+          break;
+        }
+        // Specific to the first datagram, the session recovers the loss
+        qDebug() << "Error writing Udp socket:" << ErrorString(errno);
+        sent = 1;
+      }
+      offset += sent;
+    }
+
+    _outbox.erase(_outbox.begin(), _outbox.begin() + offset);
+  }
+}
+}
@@ -0,0 +1,114 @@
+#ifndef DISSENT_TRANSPORTS_UDP_EDGE_LISTENER_H_GUARD
+#define DISSENT_TRANSPORTS_UDP_EDGE_LISTENER_H_GUARD
+
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QPair>
+#include <QSet>
+#include <QSharedPointer>
+#include <QSocketNotifier>
+
+#include "Utils/TimerCallback.hpp"
+#include "Utils/TimerEvent.hpp"
+
+#include "EdgeListener.hpp"
+#include "UdpAddress.hpp"
+#include "UdpEdge.hpp"
+
+namespace Dissent {
+namespace Transports {
+  /**
+   * Creates UdpEdges, all of which share a single socket.  Incoming
+   * datagrams are read in batches with recvmmsg and demultiplexed to their
+   * flow by remote socket address and session identifier, and the
+   * datagrams of all flows produced during an event loop iteration are
+   * written in batches with sendmmsg, so that a single thread serves many
+   * thousands of flows with few system calls.  Linux only.
+   */
+  class UdpEdgeListener : public EdgeListener {
+    Q_OBJECT
+
+    public:
+      const static QString Scheme;
+
+      /**
+       * The most datagrams passed to a single recvmmsg or sendmmsg
+       */
+      static const int BATCH = 64;
+
+      /**
+       * recvmmsg calls per readable notification, bounding the time spent
+       * before other events are handled
+       */
+      static const int MAX_READ_BATCHES = 16;
+
+      /**
+       * Interval in ms at which retransmission timers are checked
+       */
+      static const int TICK = 10;
+
+      explicit UdpEdgeListener(const UdpAddress &local_address);
+      static EdgeListener *Create(const Address &local_address);
+
+      /**
+       * Destructor
+       */
+      virtual ~UdpEdgeListener();
+
+      virtual void CreateEdgeTo(const Address &to);
+
+      /**
+       * Called by an edge with datagrams to transmit
+       * @param edge the edge
+       */
+      void Schedule(UdpEdge *edge);
+
+      /**
+       * Called by a closing edge, no further datagrams are handled for it
+       * @param edge the edge
+       */
+      void Detach(UdpEdge *edge);
+
+      /**
+       * Returns the key identifying a flow
+       * @param peer the remote socket address
+       * @param session_id the flow's session identifier
+       */
+      static QByteArray FlowKey(const QByteArray &peer, quint32 session_id);
+
+    protected:
+      virtual void OnStart();
+      virtual void OnStop();
+
+    private slots:
+      void Read();
+      void Flush();
+
+    private:
+      typedef Utils::TimerMethod<UdpEdgeListener, int> TimerCallback;
+
+      void Tick(const int &);
+      void HandleDatagram(const QByteArray &peer, const QByteArray &datagram,
+          qint64 now);
+      void Collect(UdpEdge *edge, qint64 now);
+      void ScheduleFlush();
+      void SendQueued();
+      void Forget(UdpEdge *edge);
+
+      int _fd;
+      QSharedPointer<QSocketNotifier> _notifier;
+      Utils::TimerEvent _tick;
+      bool _flush_pending;
+      QByteArray _recv_buffer;
+
+      QHash<QByteArray, UdpEdge *> _edges;
+      QHash<UdpEdge *, QSharedPointer<Edge> > _connecting;
+      QSet<UdpEdge *> _dirty;
+      QSet<UdpEdge *> _active;
+      QList<QPair<QByteArray, QByteArray> > _outbox;
+  };
+}
+}
+
+#endif
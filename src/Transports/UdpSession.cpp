@@ -0,0 +1,306 @@
+#include <cstring>
+
+#include "Utils/Serialization.hpp"
+#include "UdpSession.hpp"
+
+using Dissent::Utils::Serialization;
+
+namespace Dissent {
+namespace Transports {
+  namespace {
+    const int LAST_FRAGMENT = 0x01;
+    const int SACK_BITS = 32;
+    const int DUP_ACK_THRESHOLD = 3;
+  }
+
+  UdpSession::UdpSession(quint32 id, bool initiator) :
+    _id(id),
+    _initiator(initiator),
+    _connected(false),
+    _failed(false),
+    _remote_closed(false),
+    _syn_sent(-1),
+    _syn_retries(0),
+    _syn_ack_pending(false),
+    _ack_pending(false),
+    _send_base(0),
+    _in_flight(0),
+    _dup_acks(0),
+    _fast_retransmit(false),
+    _have_rtt(false),
+    _srtt(0),
+    _rttvar(0),
+    _rto(INITIAL_RTO),
+    _recv_next(0)
+  {
+  }
+
+  bool UdpSession::ParseHeader(const QByteArray &datagram, int &type, quint32 &id)
+  {
+    if(datagram.size() < HEADER_SIZE) {
+      return false;
+    }
+
+    type = static_cast<unsigned char>(datagram[0]);
+    id = Serialization::ReadInt(datagram, 4);
+    return type >= Syn && type <= Fin;
+  }
+
+  void UdpSession::Send(const QByteArray &msg)
+  {
+    int offset = 0;
+    do {
+      int length = qMin(int(MAX_PAYLOAD), msg.size() - offset);
+      quint32 seq = _send_base + _outgoing.size();
+      _outgoing.append(Fragment(seq, offset + length == msg.size(),
+            msg.mid(offset, length)));
+      offset += length;
+    } while(offset < msg.size());
+  }
+
+  void UdpSession::Receive(const QByteArray &datagram, qint64 now)
+  {
+    int type;
+    quint32 id;
+    if(!ParseHeader(datagram, type, id) || id != _id || _failed) {
+      return;
+    }
+
+    int flags = static_cast<unsigned char>(datagram[1]);
+    quint32 seq = Serialization::ReadInt(datagram, 8);
+    quint32 ack = Serialization::ReadInt(datagram, 12);
+    quint32 sack = Serialization::ReadInt(datagram, 16);
+
+    switch(type) {
+      case Syn:
+        if(!_initiator) {
+          _connected = true;
+          _syn_ack_pending = true;
+        }
+        break;
+      case SynAck:
+        if(_initiator && !_connected) {
+          _connected = true;
+          if(_syn_retries == 0) {
+            UpdateRtt(now - _syn_sent);
+          }
+        }
+        break;
+      case Data:
+        // Data implies the remote end saw our Syn, even if its SynAck was lost
+        _connected = true;
+        HandleAck(ack, sack, false, now);
+        HandleData(Fragment(seq, flags & LAST_FRAGMENT,
+              datagram.mid(HEADER_SIZE)));
+        break;
+      case Ack:
+        HandleAck(ack, sack, true, now);
+        break;
+      case Fin:
+        _remote_closed = true;
+        break;
+    }
+  }
+
+  QList<QByteArray> UdpSession::TakeDatagrams(qint64 now)
+  {
+    QList<QByteArray> datagrams;
+    if(_failed) {
+      return datagrams;
+    }
+
+    if(!_connected) {
+      if(_initiator && (_syn_sent < 0 || now - _syn_sent >= _rto)) {
+        if(_syn_sent >= 0) {
+          if(++_syn_retries > MAX_RETRIES) {
+            _failed = true;
+            _fail_reason = "Timed out";
+            return datagrams;
+          }
+          _rto = qMin(2 * _rto, int(MAX_RTO));
+        }
+        _syn_sent = now;
+        datagrams.append(Encode(Syn));
+      }
+      return datagrams;
+    }
+
+    if(_syn_ack_pending) {
+      _syn_ack_pending = false;
+      datagrams.append(Encode(SynAck));
+    }
+
+    if(_fast_retransmit && _in_flight > 0) {
+      Fragment &fragment = _outgoing[0];
+      fragment.retries++;
+      fragment.sent = now;
+      datagrams.append(Encode(Data, &fragment));
+    }
+    _fast_retransmit = false;
+
+    bool timed_out = false;
+    for(int idx = 0; idx < _in_flight; idx++) {
+      Fragment &fragment = _outgoing[idx];
+      if(fragment.sacked || now - fragment.sent < _rto) {
+        continue;
+      }
+
+      if(++fragment.retries > MAX_RETRIES) {
+        _failed = true;
+        _fail_reason = "Timed out";
+        return QList<QByteArray>();
+      }
+      fragment.sent = now;
+      datagrams.append(Encode(Data, &fragment));
+      timed_out = true;
+    }
+
+    if(timed_out) {
+      _rto = qMin(2 * _rto, int(MAX_RTO));
+    }
+
+    while(_in_flight < _outgoing.size() && _in_flight < WINDOW) {
+      Fragment &fragment = _outgoing[_in_flight++];
+      fragment.sent = now;
+      datagrams.append(Encode(Data, &fragment));
+    }
+
+    // Any of the above carries the acknowledgement
+    if(_ack_pending && datagrams.isEmpty()) {
+      datagrams.append(Encode(Ack));
+    }
+    _ack_pending = false;
+
+    return datagrams;
+  }
+
+  QList<QByteArray> UdpSession::TakeMessages()
+  {
+    QList<QByteArray> messages = _messages;
+    _messages.clear();
+    return messages;
+  }
+
+  QByteArray UdpSession::CloseDatagram() const
+  {
+    return Encode(Fin);
+  }
+
+  bool UdpSession::HasTimers() const
+  {
+    return !_failed && ((_initiator && !_connected) || _in_flight > 0);
+  }
+
+  QByteArray UdpSession::Encode(int type, const Fragment *fragment) const
+  {
+    int size = HEADER_SIZE + (fragment ? fragment->payload.size() : 0);
+    QByteArray datagram(size, 0);
+    datagram[0] = char(type);
+    datagram[1] = char(fragment && fragment->last ? LAST_FRAGMENT : 0);
+    Serialization::WriteInt(_id, datagram, 4);
+    Serialization::WriteInt(fragment ? fragment->seq : 0, datagram, 8);
+    Serialization::WriteInt(_recv_next, datagram, 12);
+
+    quint32 sack = 0;
+    if(!_early.isEmpty()) {
+      for(int bit = 0; bit < SACK_BITS; bit++) {
+        if(_early.contains(_recv_next + 1 + bit)) {
+          sack |= quint32(1) << bit;
+        }
+      }
+    }
+    Serialization::WriteInt(sack, datagram, 16);
+
+    if(fragment) {
+      memcpy(datagram.data() + HEADER_SIZE, fragment->payload.constData(),
+          fragment->payload.size());
+    }
+    return datagram;
+  }
+
+  void UdpSession::HandleAck(quint32 ack, quint32 sack, bool pure, qint64 now)
+  {
+    qint32 acked = qint32(ack - _send_base);
+    if(acked < 0 || acked > _in_flight) {
+      return;
+    }
+
+    if(acked == 0) {
+      if(pure && _in_flight > 0 && ++_dup_acks == DUP_ACK_THRESHOLD) {
+        _fast_retransmit = true;
+      }
+    } else {
+      _dup_acks = 0;
+      // Karn: only fragments sent once give an unambiguous sample
+      const Fragment &newest = _outgoing[acked - 1];
+      if(newest.retries == 0) {
+        UpdateRtt(now - newest.sent);
+      }
+
+      _outgoing.erase(_outgoing.begin(), _outgoing.begin() + acked);
+      _in_flight -= acked;
+      _send_base = ack;
+    }
+
+    // Bit i covers ack + 1 + i, ack itself is by definition missing
+    for(int bit = 0; bit < SACK_BITS && bit + 1 < _in_flight; bit++) {
+      if(sack & (quint32(1) << bit)) {
+        _outgoing[bit + 1].sacked = true;
+      }
+    }
+  }
+
+  void UdpSession::HandleData(const Fragment &fragment)
+  {
+    _ack_pending = true;
+
+    qint32 offset = qint32(fragment.seq - _recv_next);
+    if(offset < 0 || offset >= WINDOW) {
+      return;
+    } else if(offset > 0) {
+      _early.insert(fragment.seq, fragment);
+      return;
+    }
+
+    Fragment next = fragment;
+    while(true) {
+      if(_partial.size() + next.payload.size() > MAX_MESSAGE_SIZE) {
+        _failed = true;
+        _fail_reason = "Message too large";
+        _partial = QByteArray();
+        _early.clear();
+        return;
+      }
+
+      _partial.append(next.payload);
+      if(next.last) {
+        _messages.append(_partial);
+        _partial = QByteArray();
+      }
+
+      _recv_next++;
+      if(!_early.contains(_recv_next)) {
+        break;
+      }
+      next = _early.take(_recv_next);
+    }
+  }
+
+  void UdpSession::UpdateRtt(qint64 sample)
+  {
+    // RFC 6298
+    if(!_have_rtt) {
+      _srtt = sample;
+      _rttvar = sample / 2;
+      _have_rtt = true;
+    } else {
+      qint64 delta = _srtt > sample ? _srtt - sample : sample - _srtt;
+      _rttvar = (3 * _rttvar + delta) / 4;
+      _srtt = (7 * _srtt + sample) / 8;
+    }
+
+    _rto = int(qBound(qint64(MIN_RTO), _srtt + qMax(qint64(10), 4 * _rttvar),
+          qint64(MAX_RTO)));
+  }
+}
+}
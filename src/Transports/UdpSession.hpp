@@ -0,0 +1,187 @@
+#ifndef DISSENT_TRANSPORTS_UDP_SESSION_H_GUARD
+#define DISSENT_TRANSPORTS_UDP_SESSION_H_GUARD
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QString>
+
+#include "FrameReader.hpp"
+
+namespace Dissent {
+namespace Transports {
+  /**
+   * Reliable, ordered message delivery over datagrams for a single flow.
+   * Messages are split into fragments of at most MAX_PAYLOAD bytes, each
+   * carried in one datagram with a sequence number.  The receiver buffers
+   * out of order fragments and acknowledges cumulatively, along with a
+   * bitmap of the fragments it holds beyond the cumulative
+   * acknowledgement.  The sender keeps up to WINDOW fragments in flight
+   * and retransmits those neither acknowledged nor selectively
+   * acknowledged within the retransmission timeout, which is estimated
+   * from round trip times, or after three duplicate acknowledgements.
+   *
+   * The session performs no I/O and keeps no clock: datagrams are passed
+   * to Receive and taken from TakeDatagrams along with the current time.
+   *
+   * Datagram header, 20 bytes:
+   *   type (1), flags (1), reserved (2), session (4), seq (4), ack (4),
+   *   selective ack bitmap (4)
+   */
+  class UdpSession {
+    public:
+      enum DatagramType {
+        Syn = 1,
+        SynAck = 2,
+        Data = 3,
+        Ack = 4,
+        Fin = 5
+      };
+
+      static const int HEADER_SIZE = 20;
+
+      /**
+       * The largest fragment, sized to avoid IP fragmentation
+       */
+      static const int MAX_PAYLOAD = 1200;
+
+      /**
+       * The largest message reassembled from a peer's fragments, the session
+       * fails if a message grows beyond it
+       */
+      static const int MAX_MESSAGE_SIZE = FrameReader::MAX_FRAME_SIZE;
+
+      /**
+       * The most fragments in flight
+       */
+      static const int WINDOW = 512;
+
+      static const int INITIAL_RTO = 250;
+      static const int MIN_RTO = 50;
+      static const int MAX_RTO = 4000;
+
+      /**
+       * Retransmissions of a fragment or handshake before giving up
+       */
+      static const int MAX_RETRIES = 10;
+
+      /**
+       * Constructor
+       * @param id the session identifier shared by both ends
+       * @param initiator true if this end starts the handshake
+       */
+      explicit UdpSession(quint32 id, bool initiator);
+
+      /**
+       * Parses the type and session of a datagram, returns false if it is
+       * not a session datagram
+       * @param datagram the datagram
+       * @param type returns the type
+       * @param id returns the session identifier
+       */
+      static bool ParseHeader(const QByteArray &datagram, int &type, quint32 &id);
+
+      /**
+       * Queues a message
+       * @param msg the message
+       */
+      void Send(const QByteArray &msg);
+
+      /**
+       * Processes a datagram for this session
+       * @param datagram the datagram
+       * @param now the current time in ms
+       */
+      void Receive(const QByteArray &datagram, qint64 now);
+
+      /**
+       * Returns the datagrams that should be transmitted now: handshake,
+       * retransmissions, new fragments within the window, and
+       * acknowledgements
+       * @param now the current time in ms
+       */
+      QList<QByteArray> TakeDatagrams(qint64 now);
+
+      /**
+       * Removes and returns the messages received in order
+       */
+      QList<QByteArray> TakeMessages();
+
+      /**
+       * Returns a datagram informing the remote end that the session closed
+       */
+      QByteArray CloseDatagram() const;
+
+      /**
+       * Returns true if the session needs TakeDatagrams called as time
+       * passes, i.e., it is connecting or has fragments in flight
+       */
+      bool HasTimers() const;
+
+      quint32 GetId() const { return _id; }
+      bool Connected() const { return _connected; }
+      bool Failed() const { return _failed; }
+
+      /**
+       * Returns why the session failed
+       */
+      QString GetFailReason() const { return _fail_reason; }
+      bool RemoteClosed() const { return _remote_closed; }
+
+      /**
+       * Returns the current retransmission timeout
+       */
+      int GetRto() const { return _rto; }
+
+    private:
+      struct Fragment {
+        Fragment(quint32 seq = 0, bool last = false,
+            const QByteArray &payload = QByteArray()) :
+          seq(seq), last(last), payload(payload), sent(0), retries(0),
+          sacked(false)
+        {
+        }
+
+        quint32 seq;
+        bool last;
+        QByteArray payload;
+        qint64 sent;
+        int retries;
+        bool sacked;
+      };
+
+      QByteArray Encode(int type, const Fragment *fragment = 0) const;
+      void HandleAck(quint32 ack, quint32 sack, bool pure, qint64 now);
+      void HandleData(const Fragment &fragment);
+      void UpdateRtt(qint64 sample);
+
+      const quint32 _id;
+      const bool _initiator;
+      bool _connected;
+      bool _failed;
+      QString _fail_reason;
+      bool _remote_closed;
+      qint64 _syn_sent;
+      int _syn_retries;
+      bool _syn_ack_pending;
+      bool _ack_pending;
+
+      quint32 _send_base;
+      QList<Fragment> _outgoing;
+      int _in_flight;
+      int _dup_acks;
+      bool _fast_retransmit;
+      bool _have_rtt;
+      qint64 _srtt;
+      qint64 _rttvar;
+      int _rto;
+
+      quint32 _recv_next;
+      QHash<quint32, Fragment> _early;
+      QByteArray _partial;
+      QList<QByteArray> _messages;
+  };
+}
+}
+
+#endif
@@ -3,6 +3,7 @@
 #include <QTcpSocket>
 
 #include "Utils/Serialization.hpp"
+#include "Utils/Time.hpp"
 
 #include "EntryTunnel.hpp"
 #include "TunnelPacket.hpp"
@@ -10,13 +11,23 @@
 namespace Dissent {
 namespace Tunnel {
 
-  EntryTunnel::EntryTunnel(const QUrl &url) :
+  EntryTunnel::EntryTunnel(const QUrl &url, int key_pool_low,
+      int key_pool_high, int release_bytes) :
     _tcp_server(0),
     _host(url.host()),
     _port(url.port(8080)),
-    _running(false)
+    _running(false),
+    _key_pool(key_pool_low, key_pool_high),
+    _scheduler(Utils::TunnelScheduler::DEFAULT_QUANTUM,
+        Utils::TunnelScheduler::DEFAULT_FLOW_CAP, release_bytes),
+    _established(0),
+    _setup_time(0)
   {
     connect(&_tcp_server, SIGNAL(newConnection()), this, SLOT(NewConnection()));
+    connect(&_scheduler, SIGNAL(PacketReady(const QByteArray &)),
+        this, SIGNAL(OutgoingDataSignal(const QByteArray &)));
+    connect(&_scheduler, SIGNAL(FlowWritable(const QByteArray &)),
+        this, SLOT(ResumeFlow(const QByteArray &)));
   }
 
   EntryTunnel::~EntryTunnel()
@@ -32,6 +43,7 @@ namespace Tunnel {
 
     qDebug() << "Starting local tunnel on" << _host << ":" << _port;
     _running = true;
+    _scheduler.Start();
     _tcp_server.listen(_host, _port);
   }
 
@@ -45,8 +57,9 @@ namespace Tunnel {
 
     _tcp_server.close();
     _conn_map.clear();
+    _scheduler.Stop();
 
-    foreach(SocksConnection *sc, _pending_conns) {
+    foreach(SocksConnection *sc, _pending_conns.keys()) {
       sc->Close();
       sc->deleteLater();
     }
@@ -80,8 +93,8 @@ namespace Tunnel {
     QTcpSocket* socket = _tcp_server.nextPendingConnection();
     qDebug() << "New SOCKS connection from" << socket->peerAddress() << ":" << socket->peerPort();
 
-    SocksConnection* sp = new SocksConnection(socket);
-    _pending_conns.insert(sp);
+    SocksConnection* sp = new SocksConnection(socket, _key_pool.Take());
+    _pending_conns.insert(sp, Utils::Time::GetInstance().MSecsSinceEpoch());
 
     connect(sp, SIGNAL(ProxyConnected()), this, SLOT(SocksConnected()));
     connect(sp, SIGNAL(UpstreamPacketReady(const QByteArray &)),
@@ -101,7 +114,9 @@ namespace Tunnel {
     // Remove SocksConnection pointer from pending list and
     // add it to the connection map as a QSP
     QSharedPointer<SocksConnection> socks(sp, &QObject::deleteLater);
-    _pending_conns.remove(sp);
+    qint64 accepted = _pending_conns.take(sp);
+    _established++;
+    _setup_time += Utils::Time::GetInstance().MSecsSinceEpoch() - accepted;
 
     _conn_map[socks->GetConnectionId()] = socks;
     qDebug() << "MEM Pending:" << _pending_conns.count() << "Active:" << _conn_map.count();
@@ -119,6 +134,7 @@ namespace Tunnel {
       return;
     }
 
+    _scheduler.Forget(sp->GetConnectionId());
     if(_pending_conns.remove(sp)) {
       sp->deleteLater();
     } else if(!_conn_map.remove(sp->GetConnectionId())) {
@@ -129,7 +145,22 @@ namespace Tunnel {
 
   void EntryTunnel::OutgoingData(const QByteArray &data)
   {
-    emit OutgoingDataSignal(data);
+    SocksConnection* sp = qobject_cast<SocksConnection*>(sender());
+    if(!sp) {
+      qFatal("Illegal call to OutgoingData()");
+      return;
+    }
+
+    if(!_scheduler.Enqueue(sp->GetConnectionId(), data)) {
+      sp->SetReadPaused(true);
+    }
+  }
+
+  void EntryTunnel::ResumeFlow(const QByteArray &cid)
+  {
+    if(_conn_map.contains(cid)) {
+      _conn_map[cid]->SetReadPaused(false);
+    }
   }
 }
 }
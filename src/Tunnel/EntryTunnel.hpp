@@ -1,11 +1,14 @@
 #ifndef DISSENT_TUNNEL_ENTRY_TUNNEL_H_GUARD
 #define DISSENT_TUNNEL_ENTRY_TUNNEL_H_GUARD
 
-#include <QSet>
+#include <QHash>
 #include <QSharedPointer>
 #include <QTcpServer>
 #include <QUrl>
 
+#include "Crypto/KeyPool.hpp"
+#include "Utils/TunnelScheduler.hpp"
+
 #include "SocksConnection.hpp"
 
 namespace Dissent {
@@ -14,7 +17,10 @@ namespace Tunnel {
    * This is the "entry node" side of a TCP tunnel through 
    * dissent. It binds to a port on the local machine and
    * dumps incoming TCP traffic into the Dissent round
-   * in a special packet format.
+   * in a special packet format.  Packets pass through a
+   * TunnelScheduler, which shares the round fairly among
+   * connections, and a connection's socket is not read
+   * while its queue is full.
    */
   class EntryTunnel : public QObject {
     Q_OBJECT
@@ -23,8 +29,16 @@ namespace Tunnel {
       /**
        * Constructor
        * @param url TCP address to which to bind
+       * @param key_pool_low the KeyPool low watermark, the pool begins
+       * generating keys once the first connection takes one
+       * @param key_pool_high the KeyPool high watermark
+       * @param release_bytes bytes of packets released per
+       * Utils::TunnelScheduler::RELEASE_INTERVAL, unlimited if not positive
        */
-      explicit EntryTunnel(const QUrl &url);
+      explicit EntryTunnel(const QUrl &url,
+          int key_pool_low = Crypto::KeyPool::DEFAULT_LOW_WATERMARK,
+          int key_pool_high = Crypto::KeyPool::DEFAULT_HIGH_WATERMARK,
+          int release_bytes = Utils::TunnelScheduler::DEFAULT_RELEASE_BYTES);
 
       virtual ~EntryTunnel();
 
@@ -33,6 +47,28 @@ namespace Tunnel {
        */
       void Start();
 
+      /**
+       * Returns the pool supplying connection keys
+       */
+      const Crypto::KeyPool &GetKeyPool() const { return _key_pool; }
+
+      /**
+       * Returns the scheduler ordering outgoing packets, for setting
+       * connection weights and reading queue statistics
+       */
+      Utils::TunnelScheduler &GetScheduler() { return _scheduler; }
+
+      /**
+       * Returns the number of SOCKS connections that completed negotiation
+       */
+      qint64 GetConnectionsEstablished() const { return _established; }
+
+      /**
+       * Returns the total time in ms from accepting SOCKS connections to
+       * the completion of their negotiation
+       */
+      qint64 GetConnectionSetupTime() const { return _setup_time; }
+
     signals:
       void Stopped();
 
@@ -63,7 +99,15 @@ namespace Tunnel {
       const quint16 _port;
       bool _running;
 
-      QSet<SocksConnection*> _pending_conns;
+      Crypto::KeyPool _key_pool;
+      Utils::TunnelScheduler _scheduler;
+      qint64 _established;
+      qint64 _setup_time;
+
+      /**
+       * Pending connections and when they were accepted
+       */
+      QHash<SocksConnection*, qint64> _pending_conns;
       QHash<QByteArray, QSharedPointer<SocksConnection> > _conn_map;
 
     private slots:
@@ -87,6 +131,10 @@ namespace Tunnel {
        */
       void OutgoingData(const QByteArray &data);
 
+      /**
+       * Resumes reading from a connection whose queue has drained
+       */
+      void ResumeFlow(const QByteArray &cid);
   };
 }
 }
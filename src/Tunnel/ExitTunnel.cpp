@@ -3,21 +3,33 @@
 
 #include "Connections/Network.hpp"
 #include "Crypto/DsaPublicKey.hpp"
+#include "Utils/Logging.hpp"
 #include "Utils/Serialization.hpp"
 #include "Utils/Timer.hpp"
 #include "Utils/TimerCallback.hpp"
+#include "Utils/TraceRing.hpp"
 #include "ExitTunnel.hpp"
 
 namespace Dissent {
 namespace Tunnel {
 
-  ExitTunnel::ExitTunnel(const QUrl &exit_proxy_url) :
+  ExitTunnel::ExitTunnel(const QUrl &exit_proxy_url, int release_bytes) :
     _running(false),
     _exit_proxy(exit_proxy_url.isEmpty() ? QNetworkProxy::NoProxy :
         QNetworkProxy::Socks5Proxy,
         exit_proxy_url.host(),
-        exit_proxy_url.port())
+        exit_proxy_url.port()),
+    _scheduler(Utils::TunnelScheduler::DEFAULT_QUANTUM,
+        Utils::TunnelScheduler::DEFAULT_FLOW_CAP, release_bytes)
   {
+    connect(&_scheduler, SIGNAL(PacketReady(const QByteArray &)),
+        this, SLOT(SendPacket(const QByteArray &)));
+    connect(&_scheduler, SIGNAL(FlowWritable(const QByteArray &)),
+        this, SLOT(ResumeFlow(const QByteArray &)));
+    connect(&_dns_cache, SIGNAL(LookupFinished(int, const QString &,
+            const QList<QHostAddress> &)),
+        this, SLOT(DnsLookupFinished(int, const QString &,
+            const QList<QHostAddress> &)));
   }
 
   ExitTunnel::~ExitTunnel()
@@ -33,6 +45,7 @@ namespace Tunnel {
 
     qDebug() << "Proxy exit started";
     _running = true;
+    _scheduler.Start();
   }
 
   void ExitTunnel::Stop()
@@ -43,6 +56,7 @@ namespace Tunnel {
     qDebug() << "Stopping!";
 
     _stable.Clear();
+    _scheduler.Stop();
 
     /* kill the application */
     emit Stopped();
@@ -97,6 +111,13 @@ namespace Tunnel {
     QString cid;
     if(entry) {
       cid = entry->GetConnectionId().toBase64();
+
+      // Forward what remains even if the connection's queue is full
+      QTcpSocket *tcp_socket = qobject_cast<QTcpSocket *>(socket);
+      if(tcp_socket) {
+        TcpRead(tcp_socket, entry->GetConnectionId(), true);
+      }
+      _scheduler.Forget(entry->GetConnectionId());
     }
     qDebug() << "Socket closed:" << cid;
 
@@ -117,17 +138,47 @@ namespace Tunnel {
       return;
     }
 
-    QByteArray cid = _stable.GetSocksEntry(socket)->GetConnectionId();
+    QSharedPointer<SocksEntry> entry = _stable.GetSocksEntry(socket);
+    if(!entry) {
+      return;
+    }
+
+    TcpRead(socket, entry->GetConnectionId());
+    DISSENT_LOG(LOG_TRACE) << "MEM active" << _stable.Count();
+  }
 
-    do {
+  void ExitTunnel::TcpRead(QTcpSocket *socket, const QByteArray &cid, bool force)
+  {
+    // What is left unread fills the socket's read buffer, after which the
+    // kernel's receive window closes on the remote end
+    while(socket->bytesAvailable() && (force || !_scheduler.IsBlocked(cid))) {
       QByteArray data = socket->read(TunnelPacket::MAX_MESSAGE_SIZE);
-      qDebug() << "SOCKS Read" << data.count() << "bytes from proxy socket";
+      DISSENT_TRACE_EVENT(TUNNEL_READ, qint64(socket->socketDescriptor()),
+          data.count());
+      DISSENT_LOG(LOG_TRACE) << "SOCKS Read" << data.count() <<
+        "bytes from proxy socket";
 
       TunnelPacket packet = TunnelPacket::BuildTcpResponse(cid, data);
-      emit OutgoingDataSignal(packet);
-    } while(socket->bytesAvailable());
+      _scheduler.Enqueue(cid, packet.GetPacket());
+    }
+  }
 
-    qDebug() << "MEM active" << _stable.Count();
+  void ExitTunnel::SendPacket(const QByteArray &packet)
+  {
+    emit OutgoingDataSignal(TunnelPacket(packet));
+  }
+
+  void ExitTunnel::ResumeFlow(const QByteArray &cid)
+  {
+    QSharedPointer<SocksEntry> entry = _stable.GetSocksEntryId(cid);
+    if(!entry) {
+      return;
+    }
+
+    QSharedPointer<QTcpSocket> socket = entry->GetSocket().dynamicCast<QTcpSocket>();
+    if(socket) {
+      TcpRead(socket.data(), cid);
+    }
   }
 
   void ExitTunnel::UdpReadFromProxy()
@@ -162,21 +213,46 @@ namespace Tunnel {
       Q_ASSERT(static_cast<qint32>(bytes) == data.size());
       qDebug() << "SOCKS UDP read bytes:" << bytes;
 
+      // Datagrams cannot be held back, so they are dropped instead
+      if(_scheduler.IsBlocked(cid)) {
+        qDebug() << "SOCKS UDP queue full, dropping datagram";
+        continue;
+      }
+
       TunnelPacket packet = TunnelPacket::BuildUdpResponse(
           cid, address.toString(), port, data);
-      emit OutgoingDataSignal(packet);
+      _scheduler.Enqueue(cid, packet.GetPacket());
     }
 
     qDebug() << "MEM active" << _stable.Count();
   }
 
-  void ExitTunnel::DnsLookupFinished(const QHostInfo &host_info)
+  void ExitTunnel::DnsLookupFinished(int lookup_id, const QString &host,
+      const QList<QHostAddress> &addresses)
   {
-    QSharedPointer<SocksEntry> entry = _stable.GetSocksEntryDns(host_info.lookupId());
+    QSharedPointer<SocksEntry> entry = _stable.GetSocksEntryDns(lookup_id);
     if(!entry) {
       return;
     }
 
+    HostResolved(entry, host, addresses);
+  }
+
+  void ExitTunnel::ResolveHost(const QSharedPointer<SocksEntry> &entry,
+      const QString &host)
+  {
+    QList<QHostAddress> addresses;
+    int lookup_id = _dns_cache.Lookup(host, addresses);
+    if(lookup_id) {
+      _stable.AddLookUp(entry, lookup_id);
+    } else {
+      HostResolved(entry, host, addresses);
+    }
+  }
+
+  void ExitTunnel::HostResolved(const QSharedPointer<SocksEntry> &entry,
+      const QString &host, const QList<QHostAddress> &addresses)
+  {
     bool udp = entry->GetSocket()->socketType() == QAbstractSocket::UdpSocket;
 
     int port = entry->GetPort();
@@ -185,8 +261,8 @@ namespace Tunnel {
       entry->SetPort(0);
     }
 
-    if((host_info.error() != QHostInfo::NoError) || host_info.addresses().count() == 0) {
-      qDebug() << "Failed to resolve hostname:" << host_info.hostName() <<
+    if(addresses.count() == 0) {
+      qDebug() << "Failed to resolve hostname:" << host <<
         entry->GetConnectionId().toBase64();
       // If this is TCP, we're done...
       if(!udp) {
@@ -196,9 +272,9 @@ namespace Tunnel {
       return;
     }
 
-    QHostAddress addr = host_info.addresses()[0];
+    QHostAddress addr = addresses[0];
     
-    foreach(QHostAddress haddr, host_info.addresses()) {
+    foreach(QHostAddress haddr, addresses) {
       // Qt only binds to IPv4 so let's prefer IPv4 for now...
       if(haddr.protocol() == QAbstractSocket::IPv4Protocol) {
         addr = haddr;
@@ -206,7 +282,7 @@ namespace Tunnel {
       }
     }
 
-    qDebug() << "SOCKS hostname" << host_info.hostName() << addr;
+    qDebug() << "SOCKS hostname" << host << addr;
 
     QSharedPointer<QTcpSocket> socket = entry->GetSocket().dynamicCast<QTcpSocket>();
     if(socket) {
@@ -239,6 +315,7 @@ namespace Tunnel {
 
     entry->GetSocket()->close();
     _stable.RemoveSocksEntryId(conn_id);
+    _scheduler.Forget(conn_id);
   }
  
   void ExitTunnel::TcpCreateProxy(const TunnelPacket &packet)
@@ -246,6 +323,7 @@ namespace Tunnel {
     QSharedPointer<QTcpSocket> socket(new QTcpSocket(), &QObject::deleteLater);
     connect(socket.data(), SIGNAL(connected()), this, SLOT(TcpSocketConnected()));
     socket->setProxy(_exit_proxy);
+    socket->setReadBufferSize(TunnelPacket::MAX_MESSAGE_SIZE);
 
     // Check the verification key
     QHostAddress addr;
@@ -279,9 +357,7 @@ namespace Tunnel {
     } else {
       qDebug() << "SOCKS Hostname" << packet.GetHost() <<
         entry->GetPort();
-      int lookup_id = QHostInfo::lookupHost(packet.GetHost(),
-          this, SLOT(DnsLookupFinished(const QHostInfo &)));
-      _stable.AddLookUp(entry, lookup_id);
+      ResolveHost(entry, packet.GetHost());
     } 
   }
 
@@ -397,11 +473,9 @@ namespace Tunnel {
       qDebug() << "SOCKS UDP Hostname has outstanding request";
     } else {
       qDebug() << "SOCKS UDP Hostname" << packet.GetHost();
-      int lookup_id = QHostInfo::lookupHost(packet.GetHost(),
-          this, SLOT(DnsLookupFinished(const QHostInfo &)));
-      _stable.AddLookUp(entry, lookup_id);
       entry->GetBuffer().append(data);
       entry->SetPort(port);
+      ResolveHost(entry, packet.GetHost());
     }
 
     RestartTimer(entry);
@@ -13,6 +13,9 @@
 #include <QUrl>
 #include <QVariant>
 
+#include "Utils/DnsCache.hpp"
+#include "Utils/TunnelScheduler.hpp"
+
 #include "SocksTable.hpp"
 #include "TunnelPacket.hpp"
 
@@ -31,6 +34,9 @@ namespace Tunnel {
    *
    * It broadcasts replies from the network connection
    * *non-anonymously* to all members of the group.
+   * Replies pass through a TunnelScheduler, which shares
+   * the outgoing bandwidth fairly among connections, and a
+   * connection's socket is not read while its queue is full.
    */
   class ExitTunnel : public QObject {
     Q_OBJECT
@@ -46,8 +52,11 @@ namespace Tunnel {
       /**
        * Constructor
        * @param exit_proxy optional SOCKS5 proxy to relay messages through
+       * @param release_bytes bytes of replies released per
+       * Utils::TunnelScheduler::RELEASE_INTERVAL, unlimited if not positive
        */
-      explicit ExitTunnel(const QUrl &exit_proxy = QUrl());
+      explicit ExitTunnel(const QUrl &exit_proxy = QUrl(),
+          int release_bytes = Utils::TunnelScheduler::DEFAULT_RELEASE_BYTES);
 
       virtual ~ExitTunnel();
 
@@ -56,6 +65,17 @@ namespace Tunnel {
        */
       void Start();
 
+      /**
+       * Returns the scheduler ordering replies, for setting connection
+       * weights and reading queue statistics
+       */
+      Utils::TunnelScheduler &GetScheduler() { return _scheduler; }
+
+      /**
+       * Returns the cache resolving host names, for its statistics
+       */
+      const Utils::DnsCache &GetDnsCache() const { return _dns_cache; }
+
     signals:
       /**
        * Emitted when stopped
@@ -91,9 +111,12 @@ namespace Tunnel {
 
       /**
        * Slot called when a DNS lookup has finished
-       * @param host name information with resolved domain name
+       * @param lookup_id the id of the lookup
+       * @param host the host name
+       * @param addresses the resolved addresses, empty on failure
        */
-      void DnsLookupFinished(const QHostInfo& host_info);
+      void DnsLookupFinished(int lookup_id, const QString &host,
+          const QList<QHostAddress> &addresses);
 
       /**
        * Connection error handler
@@ -109,6 +132,12 @@ namespace Tunnel {
       void CloseSocket(QAbstractSocket *socket);
       void TcpWriteBuffer(QTcpSocket* socket);
 
+      /**
+       * Queues the data available on a socket, stopping once the
+       * connection's queue is full unless forced
+       */
+      void TcpRead(QTcpSocket *socket, const QByteArray &cid, bool force = false);
+
       void TcpCreateProxy(const TunnelPacket &packet);
       void UdpCreateProxy(const TunnelPacket &packet);
 
@@ -117,15 +146,39 @@ namespace Tunnel {
 
       void HandleFinish(const TunnelPacket &packet);
 
+      /**
+       * Resolves the host name for an entry, through the cache
+       */
+      void ResolveHost(const QSharedPointer<SocksEntry> &entry,
+          const QString &host);
+
+      /**
+       * Connects or sends the buffered datagram once resolved
+       */
+      void HostResolved(const QSharedPointer<SocksEntry> &entry,
+          const QString &host, const QList<QHostAddress> &addresses);
+
       void RestartTimer(const QSharedPointer<SocksEntry> &entry);
 
       SocksTable _stable;
       bool _running;
 
       QNetworkProxy _exit_proxy;
+      Utils::TunnelScheduler _scheduler;
+      Utils::DnsCache _dns_cache;
 
     private slots:
       void TcpSocketConnected();
+
+      /**
+       * Emits a packet released by the scheduler
+       */
+      void SendPacket(const QByteArray &packet);
+
+      /**
+       * Resumes reading from a connection whose queue has drained
+       */
+      void ResumeFlow(const QByteArray &cid);
   };
 
 }
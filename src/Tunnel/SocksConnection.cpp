@@ -1,4 +1,4 @@
-#include "Crypto/DsaPrivateKey.hpp"
+#include "Crypto/AsymmetricKey.hpp"
 #include "Crypto/Hash.hpp"
 #include "Utils/Utils.hpp"
 #include "Utils/Serialization.hpp"
@@ -12,13 +12,17 @@ using Utils::Serialization;
 
 namespace Tunnel {
 
-  SocksConnection::SocksConnection(QTcpSocket *socket) :
+  SocksConnection::SocksConnection(QTcpSocket *socket,
+      const QSharedPointer<AsymmetricKey> &signing_key) :
     _state(ConnState_WaitingForMethodHeader),
     _socket(socket),
     _socket_open(true),
-    _signing_key(new Crypto::DsaPrivateKey()),
+    _read_paused(false),
+    _signing_key(signing_key),
     _verif_key(_signing_key->GetPublicKey())
   {
+    // Bounds what is held while reading is paused
+    socket->setReadBufferSize(TunnelPacket::MAX_MESSAGE_SIZE);
     connect(socket, SIGNAL(readyRead()), this, SLOT(ReadFromSocket()));
     connect(socket, SIGNAL(disconnected()), this, SLOT(Close()));
     connect(socket, SIGNAL(error(QAbstractSocket::SocketError)), 
@@ -61,6 +65,12 @@ namespace Tunnel {
     }
     _socket_open = false;
 
+    // Forward what the client sent before it closed, even if paused
+    if(_state == ConnState_Connected && _command == SocksCommand_Connect) {
+      _read_paused = false;
+      HandleConnected();
+    }
+
     if(!_conn_id.isEmpty()) {
       qDebug() << "MEM Send finish";
 
@@ -104,6 +114,18 @@ namespace Tunnel {
     }
   }
 
+  void SocksConnection::SetReadPaused(bool paused)
+  {
+    if(_read_paused == paused) {
+      return;
+    }
+
+    _read_paused = paused;
+    if(!paused) {
+      ReadFromSocket();
+    }
+  }
+
   void SocksConnection::HandleError(QAbstractSocket::SocketError)
   {
     qWarning() << "SOCKS TCP Socket error: " << _socket->errorString();
@@ -288,7 +310,7 @@ namespace Tunnel {
       Close();
     }
 
-    while(_socket->bytesAvailable()) {
+    while(_socket->bytesAvailable() && !_read_paused) {
       // This seems rather large...
       QByteArray data = _socket->read(TunnelPacket::MAX_MESSAGE_SIZE);
       qDebug() << "SOCKS Read" << data.count() << "bytes from socket";
@@ -79,8 +79,10 @@ namespace Tunnel {
       /**
        * Constructor
        * @param TCP socket of the client making a request
+       * @param signing_key ephemeral key identifying the connection
        */
-      SocksConnection(QTcpSocket *socket);
+      SocksConnection(QTcpSocket *socket,
+          const QSharedPointer<AsymmetricKey> &signing_key);
 
       virtual ~SocksConnection();
 
@@ -95,6 +97,19 @@ namespace Tunnel {
        */
       inline QByteArray GetConnectionId() const { return _conn_id; }
 
+      /**
+       * Stops or resumes forwarding data from the TCP socket once
+       * connected, unread data is left to the socket so that the client
+       * is slowed by TCP flow control
+       * @param paused true to stop reading
+       */
+      void SetReadPaused(bool paused);
+
+      /**
+       * Returns true if reading from the TCP socket is paused
+       */
+      inline bool IsReadPaused() const { return _read_paused; }
+
     public slots:
 
       /**
@@ -205,6 +220,7 @@ namespace Tunnel {
 
       QTcpSocket *_socket;
       bool _socket_open;
+      bool _read_paused;
 
       /* For UDP connections */
       QSharedPointer<QUdpSocket> _udp_socket;
@@ -0,0 +1,146 @@
+#include "DnsCache.hpp"
+#include "Time.hpp"
+
+namespace Dissent {
+namespace Utils {
+  void SystemDnsResolver::Lookup(const QString &host)
+  {
+    int id = QHostInfo::lookupHost(host, this,
+        SLOT(LookupFinished(const QHostInfo &)));
+    _lookups[id] = host;
+  }
+
+  void SystemDnsResolver::LookupFinished(const QHostInfo &host_info)
+  {
+    QString host = _lookups.take(host_info.lookupId());
+    QList<QHostAddress> addresses;
+    if(host_info.error() == QHostInfo::NoError) {
+      addresses = host_info.addresses();
+    }
+    emit Resolved(host, addresses, -1);
+  }
+
+  DnsCache::DnsCache(DnsResolver *resolver, int capacity) :
+    _resolver(resolver ? resolver : new SystemDnsResolver()),
+    _capacity(qMax(1, capacity)),
+    _next_id(1),
+    _hits(0),
+    _negative_hits(0),
+    _misses(0),
+    _coalesced(0),
+    _resolutions(0),
+    _resolution_time(0),
+    _max_resolution_time(0),
+    _evictions(0)
+  {
+    _resolver->setParent(this);
+    connect(_resolver, SIGNAL(Resolved(const QString &,
+            const QList<QHostAddress> &, int)),
+        this, SLOT(HandleResolved(const QString &,
+            const QList<QHostAddress> &, int)));
+  }
+
+  DnsCache::~DnsCache()
+  {
+  }
+
+  int DnsCache::Lookup(const QString &host, QList<QHostAddress> &addresses)
+  {
+    QString key = host.toLower();
+    qint64 now = Time::GetInstance().MSecsSinceEpoch();
+
+    QHash<QString, Record>::iterator it = _cache.find(key);
+    if(it != _cache.end()) {
+      if(now < it.value().expires) {
+        _hits++;
+        if(it.value().addresses.isEmpty()) {
+          _negative_hits++;
+        }
+        addresses = it.value().addresses;
+        return 0;
+      }
+      _cache.erase(it);
+    }
+
+    _misses++;
+    int id = _next_id++;
+    if(_next_id <= 0) {
+      _next_id = 1;
+    }
+
+    if(_pending.contains(key)) {
+      _coalesced++;
+      _pending[key].ids.append(id);
+      return id;
+    }
+
+    Request request;
+    request.ids.append(id);
+    request.started = now;
+    _pending[key] = request;
+
+    _resolutions++;
+    _resolver->Lookup(key);
+    return id;
+  }
+
+  void DnsCache::HandleResolved(const QString &host,
+      const QList<QHostAddress> &addresses, int ttl)
+  {
+    QString key = host.toLower();
+    qint64 now = Time::GetInstance().MSecsSinceEpoch();
+
+    Request request;
+    if(_pending.contains(key)) {
+      request = _pending.take(key);
+      qint64 elapsed = now - request.started;
+      _resolution_time += elapsed;
+      _max_resolution_time = qMax(_max_resolution_time, elapsed);
+    }
+
+    int cache_ttl = NEGATIVE_TTL;
+    if(!addresses.isEmpty()) {
+      cache_ttl = ttl < 0 ? int(DEFAULT_TTL) : qMin(ttl, int(MAX_TTL));
+    }
+
+    // A TTL of 0 forbids caching
+    if(cache_ttl > 0) {
+      Record record;
+      record.addresses = addresses;
+      record.expires = now + cache_ttl * 1000;
+      Insert(key, record, now);
+    }
+
+    foreach(int id, request.ids) {
+      emit LookupFinished(id, host, addresses);
+    }
+  }
+
+  void DnsCache::Insert(const QString &key, const Record &record, qint64 now)
+  {
+    if(!_cache.contains(key) && _cache.count() >= _capacity) {
+      QHash<QString, Record>::iterator it = _cache.begin();
+      while(it != _cache.end()) {
+        if(it.value().expires <= now) {
+          it = _cache.erase(it);
+        } else {
+          ++it;
+        }
+      }
+
+      if(_cache.count() >= _capacity) {
+        QHash<QString, Record>::iterator oldest = _cache.begin();
+        for(it = _cache.begin(); it != _cache.end(); ++it) {
+          if(it.value().expires < oldest.value().expires) {
+            oldest = it;
+          }
+        }
+        _cache.erase(oldest);
+        _evictions++;
+      }
+    }
+
+    _cache[key] = record;
+  }
+}
+}
@@ -0,0 +1,217 @@
+#ifndef DISSENT_UTILS_DNS_CACHE_H_GUARD
+#define DISSENT_UTILS_DNS_CACHE_H_GUARD
+
+#include <QHash>
+#include <QHostAddress>
+#include <QHostInfo>
+#include <QList>
+#include <QObject>
+#include <QString>
+
+namespace Dissent {
+namespace Utils {
+  /**
+   * Resolves host names for a DnsCache
+   */
+  class DnsResolver : public QObject {
+    Q_OBJECT
+
+    public:
+      /**
+       * Destructor
+       */
+      virtual ~DnsResolver() {}
+
+      /**
+       * Begins resolving a host name, the result is announced by Resolved,
+       * which must not be emitted before this returns
+       * @param host the host name
+       */
+      virtual void Lookup(const QString &host) = 0;
+
+    signals:
+      /**
+       * Emitted when a lookup completes
+       * @param host the host name
+       * @param addresses the addresses, empty if the lookup failed
+       * @param ttl seconds the result may be cached, negative if unknown
+       */
+      void Resolved(const QString &host, const QList<QHostAddress> &addresses,
+          int ttl);
+  };
+
+  /**
+   * Resolves host names through QHostInfo, which does not report TTLs
+   */
+  class SystemDnsResolver : public DnsResolver {
+    Q_OBJECT
+
+    public:
+      virtual void Lookup(const QString &host);
+
+    private slots:
+      void LookupFinished(const QHostInfo &host_info);
+
+    private:
+      QHash<int, QString> _lookups;
+  };
+
+  /**
+   * Caches resolved host names, so that repeated lookups of popular hosts
+   * need not wait on the resolver.  Results are kept for their TTL, or
+   * DEFAULT_TTL if the resolver does not know it, and failures for
+   * NEGATIVE_TTL.  Lookups for a host already being resolved join the
+   * outstanding request.  When the cache is full, expired entries are
+   * dropped first, followed by those closest to expiring.
+   */
+  class DnsCache : public QObject {
+    Q_OBJECT
+
+    public:
+      static const int DEFAULT_CAPACITY = 4096;
+
+      /**
+       * Seconds to cache a result whose TTL is unknown
+       */
+      static const int DEFAULT_TTL = 60;
+
+      /**
+       * Upper bound in seconds on the time a result is cached
+       */
+      static const int MAX_TTL = 3600;
+
+      /**
+       * Seconds to cache a failed lookup
+       */
+      static const int NEGATIVE_TTL = 30;
+
+      /**
+       * Constructor
+       * @param resolver resolves host names, owned by the cache, the
+       * SystemDnsResolver if null
+       * @param capacity the most host names cached
+       */
+      explicit DnsCache(DnsResolver *resolver = 0,
+          int capacity = DEFAULT_CAPACITY);
+
+      /**
+       * Destructor
+       */
+      virtual ~DnsCache();
+
+      /**
+       * Resolves a host name.  If it is cached, returns 0 and sets the
+       * addresses, which are empty for a cached failure.  Otherwise,
+       * returns an id later passed to LookupFinished.
+       * @param host the host name
+       * @param addresses returns the cached addresses
+       */
+      int Lookup(const QString &host, QList<QHostAddress> &addresses);
+
+      /**
+       * Drops all cached results, outstanding lookups are unaffected
+       */
+      void Clear() { _cache.clear(); }
+
+      /**
+       * Returns the number of host names cached
+       */
+      int Count() const { return _cache.count(); }
+
+      /**
+       * Returns the number of host names being resolved
+       */
+      int Pending() const { return _pending.count(); }
+
+      /**
+       * Returns the number of lookups answered from the cache
+       */
+      qint64 GetHits() const { return _hits; }
+
+      /**
+       * Returns the number of lookups answered from cached failures, a
+       * subset of the hits
+       */
+      qint64 GetNegativeHits() const { return _negative_hits; }
+
+      /**
+       * Returns the number of lookups not answered from the cache
+       */
+      qint64 GetMisses() const { return _misses; }
+
+      /**
+       * Returns the number of misses that joined an outstanding request
+       */
+      qint64 GetCoalesced() const { return _coalesced; }
+
+      /**
+       * Returns the number of requests made to the resolver
+       */
+      qint64 GetResolutions() const { return _resolutions; }
+
+      /**
+       * Returns the total time in ms spent waiting on the resolver
+       */
+      qint64 GetResolutionTime() const { return _resolution_time; }
+
+      /**
+       * Returns the longest time in ms spent waiting on the resolver
+       */
+      qint64 GetMaxResolutionTime() const { return _max_resolution_time; }
+
+      /**
+       * Returns the number of unexpired results dropped for space
+       */
+      qint64 GetEvictions() const { return _evictions; }
+
+    signals:
+      /**
+       * Emitted when a lookup not answered from the cache completes
+       * @param id the id returned by Lookup
+       * @param host the host name
+       * @param addresses the addresses, empty if the lookup failed
+       */
+      void LookupFinished(int id, const QString &host,
+          const QList<QHostAddress> &addresses);
+
+    private slots:
+      void HandleResolved(const QString &host,
+          const QList<QHostAddress> &addresses, int ttl);
+
+    private:
+      struct Record {
+        Record() : expires(0) {}
+
+        QList<QHostAddress> addresses;
+        qint64 expires;
+      };
+
+      struct Request {
+        Request() : started(0) {}
+
+        QList<int> ids;
+        qint64 started;
+      };
+
+      void Insert(const QString &key, const Record &record, qint64 now);
+
+      DnsResolver *_resolver;
+      const int _capacity;
+      int _next_id;
+
+      QHash<QString, Record> _cache;
+      QHash<QString, Request> _pending;
+
+      qint64 _hits;
+      qint64 _negative_hits;
+      qint64 _misses;
+      qint64 _coalesced;
+      qint64 _resolutions;
+      qint64 _resolution_time;
+      qint64 _max_resolution_time;
+      qint64 _evictions;
+  };
+}
+}
+
+#endif
@@ -5,10 +5,32 @@
 namespace Dissent {
 namespace Utils {
   QString Logging::_filename;
+  Logging::LogLevel Logging::_level = Logging::LOG_DEBUG;
+
+  Logging::LogLevel Logging::ParseLevel(const QString &name, LogLevel def)
+  {
+    QString lower = name.toLower();
+    if(lower == "trace") {
+      return LOG_TRACE;
+    } else if(lower == "debug") {
+      return LOG_DEBUG;
+    } else if(lower == "off") {
+      return LOG_OFF;
+    }
+    return def;
+  }
+
+  void Logging::Reenable()
+  {
+    if(_level == LOG_OFF) {
+      _level = LOG_DEBUG;
+    }
+  }
 
   void Logging::UseFile(const QString &filename)
   {
     _filename = filename;
+    Reenable();
 #if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
     qInstallMsgHandler(File);
 #else
@@ -32,6 +54,7 @@ namespace Utils {
 
   void Logging::UseStdout()
   {
+    Reenable();
 #if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
     qInstallMsgHandler(Stdout);
 #else
@@ -52,6 +75,7 @@ namespace Utils {
 
   void Logging::UseStderr()
   {
+    Reenable();
 #if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
     qInstallMsgHandler(Stderr);
 #else
@@ -100,6 +124,7 @@ namespace Utils {
 
   void Logging::UseDefault()
   {
+    Reenable();
 #if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
     qInstallMsgHandler(0);
 #else
@@ -109,6 +134,7 @@ namespace Utils {
 
   void Logging::Disable()
   {
+    _level = LOG_OFF;
 #if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
     qInstallMsgHandler(Disabled);
 #else
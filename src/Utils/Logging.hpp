@@ -5,6 +5,22 @@
 #include <QString>
 #include <QTextStream>
 
+/**
+ * Log statements below this level are compiled out, see Logging::LogLevel
+ */
+#ifndef DISSENT_LOG_LEVEL
+#define DISSENT_LOG_LEVEL 0
+#endif
+
+/**
+ * Begins a qDebug stream that is only evaluated if the level is enabled,
+ * so that disabled statements format and encode nothing:
+ *   DISSENT_LOG(LOG_TRACE) << "sent" << id.ToString();
+ */
+#define DISSENT_LOG(level) \
+  if(!Dissent::Utils::Logging::Enabled(Dissent::Utils::Logging::level)) {} \
+  else qDebug()
+
 namespace Dissent {
 namespace Utils {
   /**
@@ -12,6 +28,44 @@ namespace Utils {
    */
   class Logging {
     public:
+      /**
+       * Log levels, messages on the hot path, per packet or per phase, are
+       * traced while the rest are debug output
+       */
+      enum LogLevel {
+        LOG_TRACE = 0,
+        LOG_DEBUG,
+        LOG_OFF
+      };
+
+      /**
+       * Returns true if messages at the level are output, checked before
+       * evaluating the message
+       * @param level the level of the message
+       */
+      static inline bool Enabled(LogLevel level)
+      {
+        return (int(level) >= DISSENT_LOG_LEVEL) && (level >= _level);
+      }
+
+      /**
+       * Sets the lowest level output
+       * @param level the level
+       */
+      static void SetLevel(LogLevel level) { _level = level; }
+
+      /**
+       * Returns the lowest level output
+       */
+      static LogLevel GetLevel() { return _level; }
+
+      /**
+       * Parses a level from its name: trace, debug, or off
+       * @param name the name of the level
+       * @param def returned for an unknown name
+       */
+      static LogLevel ParseLevel(const QString &name, LogLevel def = LOG_DEBUG);
+
       /**
        * Store all logs into the specified file
        * @param filename the file in which to store logs
@@ -34,12 +88,18 @@ namespace Utils {
       static void UseDefault();
 
       /**
-       * Disable logging
+       * Disable logging, messages below LOG_OFF are no longer evaluated
        */
       static void Disable();
 
     private:
       static QString _filename;
+      static LogLevel _level;
+
+      /**
+       * Output resumes at LOG_DEBUG after Disable
+       */
+      static void Reenable();
 
 #if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
       static void Disabled(QtMsgType type, const char *msg);
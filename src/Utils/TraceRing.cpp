@@ -0,0 +1,161 @@
+#include <atomic>
+#include <cstring>
+
+#include <QDebug>
+#include <QThread>
+
+#include "Time.hpp"
+#include "TraceRing.hpp"
+
+namespace Dissent {
+namespace Utils {
+  TraceRing *TraceRing::_active = 0;
+
+  TraceRing::TraceRing(const QString &filename, int capacity) :
+    _file(filename),
+    _map(0),
+    _records(0),
+    _capacity(qMax(1, capacity)),
+    _next(0)
+  {
+    qint64 size = sizeof(Header) + qint64(_capacity) * sizeof(Record);
+    if(!_file.open(QIODevice::ReadWrite | QIODevice::Truncate) ||
+        !_file.resize(size))
+    {
+      qWarning() << "Unable to create trace file" << filename;
+      return;
+    }
+
+    _map = _file.map(0, size);
+    if(!_map) {
+      qWarning() << "Unable to map trace file" << filename;
+      return;
+    }
+
+    memset(_map, 0, size);
+    Header *header = reinterpret_cast<Header *>(_map);
+    header->magic = MAGIC;
+    header->version = VERSION;
+    header->capacity = _capacity;
+    header->record_size = sizeof(Record);
+    header->start = Time::GetInstance().MSecsSinceEpoch();
+
+    _records = reinterpret_cast<Record *>(_map + sizeof(Header));
+    _timer.start();
+  }
+
+  TraceRing::~TraceRing()
+  {
+    if(_active == this) {
+      _active = 0;
+    }
+
+    if(_map) {
+      _file.unmap(_map);
+    }
+  }
+
+  void TraceRing::Append(Event event, qint64 a, qint64 b)
+  {
+    if(!_records) {
+      return;
+    }
+
+    quint32 sequence = quint32(_next.fetchAndAddOrdered(1));
+    Record &record = _records[sequence % _capacity];
+
+    // Readers ignore a record until its stamp matches its sequence
+    record.sequence = sequence + 1;
+    std::atomic_thread_fence(std::memory_order_release);
+    record.event = event;
+    record.time = _timer.nsecsElapsed();
+    record.a = a;
+    record.b = b;
+    record.thread = quint64(reinterpret_cast<quintptr>(
+          QThread::currentThreadId()));
+    std::atomic_thread_fence(std::memory_order_release);
+    record.stamp = sequence + 1;
+  }
+
+  QString TraceRing::EventName(int event)
+  {
+    switch(event) {
+      case STATE_COMPLETE:
+        return "StateComplete";
+      case CLIENT_CIPHERTEXT:
+        return "ClientCiphertext";
+      case SERVER_CIPHERTEXT:
+        return "ServerCiphertext";
+      case CLEARTEXT:
+        return "Cleartext";
+      case RPC_NOTIFICATION:
+        return "RpcNotification";
+      case RPC_REQUEST:
+        return "RpcRequest";
+      case RPC_HANDLE_REQUEST:
+        return "RpcHandleRequest";
+      case TUNNEL_READ:
+        return "TunnelRead";
+      default:
+        return "Unknown(" + QString::number(event) + ")";
+    }
+  }
+
+  namespace {
+    struct SequenceLessThan {
+      bool operator()(const TraceRing::Record &lhs,
+          const TraceRing::Record &rhs) const
+      {
+        return lhs.sequence < rhs.sequence;
+      }
+    };
+  }
+
+  bool TraceRing::Read(const QString &filename, Header &header,
+      QList<Record> &records)
+  {
+    QFile file(filename);
+    if(!file.open(QIODevice::ReadOnly) || file.size() < qint64(sizeof(Header))) {
+      return false;
+    }
+
+    // Maps the file so that records are read while writers may still append
+    uchar *map = file.map(0, file.size());
+    if(!map) {
+      return false;
+    }
+
+    memcpy(&header, map, sizeof(Header));
+    if(header.magic != MAGIC || header.version != VERSION ||
+        header.record_size != sizeof(Record) || file.size() <
+        qint64(sizeof(Header)) + qint64(header.capacity) * qint64(sizeof(Record)))
+    {
+      file.unmap(map);
+      return false;
+    }
+
+    const Record *ring = reinterpret_cast<const Record *>(map + sizeof(Header));
+    for(quint32 idx = 0; idx < header.capacity; idx++) {
+      const volatile Record *live = &ring[idx];
+      quint32 stamp = live->stamp;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      Record record;
+      memcpy(&record, &ring[idx], sizeof(Record));
+      std::atomic_thread_fence(std::memory_order_acquire);
+      quint32 sequence = live->sequence;
+
+      // Skips unwritten records and those a writer rewrote during the copy
+      if(stamp == 0 || stamp != sequence || record.sequence != sequence ||
+          record.stamp != sequence || (sequence - 1) % header.capacity != idx)
+      {
+        continue;
+      }
+      records.append(record);
+    }
+
+    file.unmap(map);
+    qSort(records.begin(), records.end(), SequenceLessThan());
+    return true;
+  }
+}
+}
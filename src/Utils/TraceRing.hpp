@@ -0,0 +1,148 @@
+#ifndef DISSENT_UTILS_TRACE_RING_H_GUARD
+#define DISSENT_UTILS_TRACE_RING_H_GUARD
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QList>
+#include <QString>
+
+/**
+ * Records an event into the active TraceRing, if there is one, the
+ * arguments are not evaluated otherwise
+ */
+#define DISSENT_TRACE_EVENT(event, a, b) \
+  do { \
+    Dissent::Utils::TraceRing *trace_ring = \
+      Dissent::Utils::TraceRing::GetActive(); \
+    if(trace_ring) { \
+      trace_ring->Append(Dissent::Utils::TraceRing::event, (a), (b)); \
+    } \
+  } while(0)
+
+namespace Dissent {
+namespace Utils {
+  /**
+   * A fixed number of binary trace records in a memory mapped file, for
+   * events too frequent to log as text.  Writers claim a record with an
+   * atomic increment and never block or allocate, once the ring is full the
+   * oldest records are overwritten.  The file survives the process and is
+   * read with trace_decode.  Records are in native byte order.
+   *
+   * File:    magic (4), version (4), capacity (4), record size (4),
+   *          start in ms since the epoch (8), capacity records
+   * Record:  sequence (4), event (4), ns since start (8), a (8), b (8),
+   *          thread (8), stamp (4), padding (4)
+   *
+   * A record's sequence is 1 + the order in which it was claimed, or 0 if
+   * the record was never written.  The sequence is written first and the
+   * stamp, a copy of it, last, so a reader that finds the same value in the
+   * stamp before copying a record and in the sequence afterwards has a
+   * record that was not being rewritten.
+   */
+  class TraceRing {
+    public:
+      enum Event {
+        STATE_COMPLETE = 1,   // a: state, b: phase
+        CLIENT_CIPHERTEXT,    // a: phase, b: bytes
+        SERVER_CIPHERTEXT,    // a: phase, b: bytes
+        CLEARTEXT,            // a: phase, b: bytes
+        RPC_NOTIFICATION,     // a: id, b: bytes
+        RPC_REQUEST,          // a: id, b: bytes
+        RPC_HANDLE_REQUEST,   // a: id, b: 0
+        TUNNEL_READ,          // a: socket, b: bytes
+      };
+
+      struct Header {
+        quint32 magic;
+        quint32 version;
+        quint32 capacity;
+        quint32 record_size;
+        qint64 start;
+      };
+
+      struct Record {
+        quint32 sequence;
+        quint32 event;
+        qint64 time;
+        qint64 a;
+        qint64 b;
+        quint64 thread;
+        quint32 stamp;
+      };
+
+      static const quint32 MAGIC = 0x44545243;
+      static const quint32 VERSION = 2;
+      static const int DEFAULT_CAPACITY = 1 << 16;
+
+      /**
+       * Constructor, check IsValid
+       * @param filename the file to map, truncated
+       * @param capacity the number of records
+       */
+      explicit TraceRing(const QString &filename,
+          int capacity = DEFAULT_CAPACITY);
+
+      /**
+       * Destructor, stops being the active ring
+       */
+      ~TraceRing();
+
+      /**
+       * Returns true if the file was mapped
+       */
+      bool IsValid() const { return _records != 0; }
+
+      /**
+       * Records an event, safe to call from any thread
+       * @param event the event
+       * @param a the first argument
+       * @param b the second argument
+       */
+      void Append(Event event, qint64 a, qint64 b);
+
+      /**
+       * Returns the number of records claimed, including those overwritten
+       */
+      int GetAppended() const { return _next.fetchAndAddOrdered(0); }
+
+      /**
+       * Makes a ring the target of DISSENT_TRACE_EVENT, or none if null
+       * @param ring the ring
+       */
+      static void SetActive(TraceRing *ring) { _active = ring; }
+
+      /**
+       * Returns the target of DISSENT_TRACE_EVENT
+       */
+      static TraceRing *GetActive() { return _active; }
+
+      /**
+       * Returns the name of an event
+       * @param event the event
+       */
+      static QString EventName(int event);
+
+      /**
+       * Reads the records in a trace file, oldest first
+       * @param filename the trace file
+       * @param header returns the file's header
+       * @param records returns the records
+       */
+      static bool Read(const QString &filename, Header &header,
+          QList<Record> &records);
+
+    private:
+      QFile _file;
+      uchar *_map;
+      Record *_records;
+      quint32 _capacity;
+      mutable QAtomicInt _next;
+      QElapsedTimer _timer;
+
+      static TraceRing *_active;
+  };
+}
+}
+
+#endif
@@ -0,0 +1,216 @@
+#include "Time.hpp"
+#include "Timer.hpp"
+#include "TunnelScheduler.hpp"
+
+namespace Dissent {
+namespace Utils {
+  TunnelScheduler::TunnelScheduler(int quantum, int flow_cap,
+      int release_bytes) :
+    _quantum(qMax(1, quantum)),
+    _flow_cap(qMax(1, flow_cap)),
+    _release_bytes(release_bytes),
+    _running(false),
+    _release_pending(false),
+    _credit(release_bytes),
+    _queued_bytes(0),
+    _queued_packets(0),
+    _max_queued_bytes(0),
+    _released(0),
+    _total_latency(0),
+    _max_latency(0),
+    _blocked_count(0)
+  {
+  }
+
+  TunnelScheduler::~TunnelScheduler()
+  {
+    _timer.Stop();
+  }
+
+  void TunnelScheduler::Start()
+  {
+    if(_running) {
+      return;
+    }
+    _running = true;
+    _credit = _release_bytes;
+
+    if(_release_bytes > 0) {
+      _timer = Timer::GetInstance().QueueCallback(
+          new TimerCallback(this, &TunnelScheduler::Tick, 0),
+          RELEASE_INTERVAL, RELEASE_INTERVAL);
+    }
+    ScheduleRelease();
+  }
+
+  void TunnelScheduler::Stop()
+  {
+    if(!_running) {
+      return;
+    }
+    _running = false;
+    _timer.Stop();
+    Clear();
+  }
+
+  bool TunnelScheduler::Enqueue(const QByteArray &flow_id, const QByteArray &packet)
+  {
+    // A connection is active exactly when it has packets queued
+    if(!_flows.contains(flow_id)) {
+      _active.append(flow_id);
+    }
+
+    Flow &flow = _flows[flow_id];
+    flow.queue.append(Entry(packet, Time::GetInstance().MSecsSinceEpoch()));
+    flow.bytes += packet.size();
+
+    _queued_bytes += packet.size();
+    _queued_packets++;
+    _max_queued_bytes = qMax(_max_queued_bytes, _queued_bytes);
+
+    if(!flow.blocked && flow.bytes >= _flow_cap) {
+      flow.blocked = true;
+      _blocked_count++;
+    }
+
+    ScheduleRelease();
+    return !flow.blocked;
+  }
+
+  QList<QByteArray> TunnelScheduler::Dequeue(int max_bytes)
+  {
+    QList<QByteArray> packets;
+    QList<QByteArray> writable;
+    qint64 now = Time::GetInstance().MSecsSinceEpoch();
+    int budget = max_bytes;
+
+    while(!_active.isEmpty()) {
+      const QByteArray flow_id = _active.first();
+      Flow &flow = _flows[flow_id];
+      if(!flow.visited) {
+        flow.deficit += _quantum * GetWeight(flow_id);
+        flow.visited = true;
+      }
+
+      bool exhausted = false;
+      while(!flow.queue.isEmpty()) {
+        int size = flow.queue.first().packet.size();
+        if(size > flow.deficit) {
+          break;
+        } else if(size > budget && !packets.isEmpty()) {
+          // Resume this visit, with its remaining credit, next time
+          exhausted = true;
+          break;
+        }
+
+        Entry entry = flow.queue.takeFirst();
+        flow.deficit -= size;
+        flow.bytes -= size;
+        budget -= size;
+        _queued_bytes -= size;
+        _queued_packets--;
+
+        qint64 latency = now - entry.queued;
+        _released++;
+        _total_latency += latency;
+        _max_latency = qMax(_max_latency, latency);
+        packets.append(entry.packet);
+      }
+
+      if(flow.blocked && flow.bytes <= _flow_cap / 2) {
+        flow.blocked = false;
+        writable.append(flow_id);
+      }
+
+      if(exhausted) {
+        break;
+      }
+
+      _active.removeFirst();
+      if(flow.queue.isEmpty()) {
+        // Idle connections do not bank credit
+        _flows.remove(flow_id);
+      } else {
+        flow.visited = false;
+        _active.append(flow_id);
+      }
+
+      if(budget <= 0) {
+        break;
+      }
+    }
+
+    foreach(const QByteArray &flow_id, writable) {
+      emit FlowWritable(flow_id);
+    }
+    return packets;
+  }
+
+  void TunnelScheduler::Tick(const int &)
+  {
+    // Unused budget does not accumulate, bursts stay within one interval
+    _credit = qMin(_credit + _release_bytes, _release_bytes);
+    ScheduleRelease();
+  }
+
+  void TunnelScheduler::ScheduleRelease()
+  {
+    // Packets queued during this event loop iteration are released
+    // together, so that the order across connections is decided by the
+    // scheduler rather than by the order of readyRead signals
+    if(!_running || _release_pending || _queued_packets == 0 ||
+        (_release_bytes > 0 && _credit <= 0))
+    {
+      return;
+    }
+
+    _release_pending = true;
+    QMetaObject::invokeMethod(this, "Release", Qt::QueuedConnection);
+  }
+
+  void TunnelScheduler::Release()
+  {
+    _release_pending = false;
+    if(!_running) {
+      return;
+    }
+
+    bool paced = _release_bytes > 0;
+    if(paced && _credit <= 0) {
+      return;
+    }
+
+    QList<QByteArray> packets = Dequeue(paced ? _credit : int(_queued_bytes));
+    foreach(const QByteArray &packet, packets) {
+      // An oversized packet overdraws the next interval
+      if(paced) {
+        _credit -= packet.size();
+      }
+      emit PacketReady(packet);
+    }
+  }
+
+  void TunnelScheduler::SetWeight(const QByteArray &flow, int weight)
+  {
+    if(weight <= 0 || weight == DEFAULT_WEIGHT) {
+      _weights.remove(flow);
+    } else {
+      _weights[flow] = weight;
+    }
+  }
+
+  void TunnelScheduler::Forget(const QByteArray &flow)
+  {
+    _weights.remove(flow);
+  }
+
+  void TunnelScheduler::Clear()
+  {
+    _flows.clear();
+    _active.clear();
+    _weights.clear();
+    _queued_bytes = 0;
+    _queued_packets = 0;
+  }
+}
+}
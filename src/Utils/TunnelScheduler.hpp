@@ -0,0 +1,247 @@
+#ifndef DISSENT_UTILS_TUNNEL_SCHEDULER_H_GUARD
+#define DISSENT_UTILS_TUNNEL_SCHEDULER_H_GUARD
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QObject>
+
+#include "TimerCallback.hpp"
+#include "TimerEvent.hpp"
+
+namespace Dissent {
+namespace Utils {
+  /**
+   * Queues tunnel packets per connection and releases them in deficit
+   * round robin order, so that a bulk transfer cannot monopolize the
+   * session at the expense of interactive connections.  Each visit to a
+   * connection grants it the quantum times its weight in bytes, which it
+   * may spend on its queued packets; unspent credit carries over while the
+   * connection has packets queued.
+   *
+   * Each connection's queue has a soft cap: once reached, Enqueue returns
+   * false and the producer should stop reading from its socket until
+   * FlowWritable is emitted, which happens once the queue has drained to
+   * half the cap.
+   *
+   * Once started, queued packets are released through PacketReady shortly
+   * after being queued, limited to a byte budget per RELEASE_INTERVAL, so
+   * that the session's send queue holds little more than the current
+   * interval's share and the order across connections is decided here.
+   */
+  class TunnelScheduler : public QObject {
+    Q_OBJECT
+
+    public:
+      static const int DEFAULT_QUANTUM = 4096;
+      static const int DEFAULT_FLOW_CAP = 256 * 1024;
+      static const int DEFAULT_WEIGHT = 1;
+      static const int DEFAULT_RELEASE_BYTES = 128 * 1024;
+
+      /**
+       * Interval in ms at which the release budget is renewed
+       */
+      static const int RELEASE_INTERVAL = 50;
+
+      /**
+       * Constructor
+       * @param quantum bytes granted to a connection of weight 1 per visit
+       * @param flow_cap bytes queued for a connection before it is blocked
+       * @param release_bytes bytes released per interval, or unlimited if
+       * not positive
+       */
+      explicit TunnelScheduler(int quantum = DEFAULT_QUANTUM,
+          int flow_cap = DEFAULT_FLOW_CAP,
+          int release_bytes = DEFAULT_RELEASE_BYTES);
+
+      /**
+       * Destructor
+       */
+      virtual ~TunnelScheduler();
+
+      /**
+       * Begins releasing queued packets through PacketReady
+       */
+      void Start();
+
+      /**
+       * Stops releasing packets and drops those queued
+       */
+      void Stop();
+
+      /**
+       * Queues a packet, returns false if the connection has reached its
+       * cap and should not produce more until FlowWritable
+       * @param flow the connection id
+       * @param packet the packet
+       */
+      bool Enqueue(const QByteArray &flow, const QByteArray &packet);
+
+      /**
+       * Removes and returns queued packets in deficit round robin order
+       * totalling at most max_bytes, though at least one packet is returned
+       * if any are queued
+       * @param max_bytes the byte budget
+       */
+      QList<QByteArray> Dequeue(int max_bytes);
+
+      /**
+       * Sets the share of a connection relative to others
+       * @param flow the connection id
+       * @param weight a positive weight
+       */
+      void SetWeight(const QByteArray &flow, int weight);
+
+      /**
+       * Returns the weight of a connection
+       * @param flow the connection id
+       */
+      int GetWeight(const QByteArray &flow) const
+      {
+        return _weights.value(flow, DEFAULT_WEIGHT);
+      }
+
+      /**
+       * Drops the weight of a connection that has closed, packets still
+       * queued for it are released as usual
+       * @param flow the connection id
+       */
+      void Forget(const QByteArray &flow);
+
+      /**
+       * Drops all queued packets
+       */
+      void Clear();
+
+      /**
+       * Returns true if the connection has reached its cap
+       * @param flow the connection id
+       */
+      bool IsBlocked(const QByteArray &flow) const
+      {
+        return _flows.contains(flow) && _flows[flow].blocked;
+      }
+
+      /**
+       * Returns the bytes queued for a connection
+       * @param flow the connection id
+       */
+      int QueuedBytes(const QByteArray &flow) const
+      {
+        return _flows.contains(flow) ? _flows[flow].bytes : 0;
+      }
+
+      /**
+       * Returns the bytes queued for all connections
+       */
+      qint64 QueuedBytes() const { return _queued_bytes; }
+
+      /**
+       * Returns the packets queued for all connections
+       */
+      int QueuedPackets() const { return _queued_packets; }
+
+      /**
+       * Returns the number of connections with packets queued
+       */
+      int ActiveFlows() const { return _active.size(); }
+
+      /**
+       * Returns the largest number of bytes that have been queued at once
+       */
+      qint64 GetMaxQueuedBytes() const { return _max_queued_bytes; }
+
+      /**
+       * Returns the number of packets released
+       */
+      qint64 GetPacketsReleased() const { return _released; }
+
+      /**
+       * Returns the total time in ms released packets spent queued
+       */
+      qint64 GetTotalLatency() const { return _total_latency; }
+
+      /**
+       * Returns the longest time in ms a released packet spent queued
+       */
+      qint64 GetMaxLatency() const { return _max_latency; }
+
+      /**
+       * Returns the number of times a connection reached its cap
+       */
+      qint64 GetBlockedCount() const { return _blocked_count; }
+
+      int GetQuantum() const { return _quantum; }
+      int GetFlowCap() const { return _flow_cap; }
+      int GetReleaseBytes() const { return _release_bytes; }
+
+    signals:
+      /**
+       * Emitted for each packet released while started
+       * @param packet the packet
+       */
+      void PacketReady(const QByteArray &packet);
+
+      /**
+       * Emitted when a blocked connection has drained to half its cap
+       * @param flow the connection id
+       */
+      void FlowWritable(const QByteArray &flow);
+
+    private slots:
+      void Release();
+
+    private:
+      typedef TimerMethod<TunnelScheduler, int> TimerCallback;
+
+      void Tick(const int &);
+      void ScheduleRelease();
+
+      struct Entry {
+        Entry(const QByteArray &packet = QByteArray(), qint64 queued = 0) :
+          packet(packet), queued(queued)
+        {
+        }
+
+        QByteArray packet;
+        qint64 queued;
+      };
+
+      struct Flow {
+        Flow() : bytes(0), deficit(0), visited(false), blocked(false) {}
+
+        QList<Entry> queue;
+        int bytes;
+        int deficit;
+        /* The quantum for the current visit has been granted */
+        bool visited;
+        bool blocked;
+      };
+
+      const int _quantum;
+      const int _flow_cap;
+      const int _release_bytes;
+
+      bool _running;
+      bool _release_pending;
+      /* Bytes that may still be released this interval */
+      int _credit;
+      TimerEvent _timer;
+
+      QHash<QByteArray, Flow> _flows;
+      /* Connections with packets queued, the head is being visited */
+      QList<QByteArray> _active;
+      QHash<QByteArray, int> _weights;
+
+      qint64 _queued_bytes;
+      int _queued_packets;
+      qint64 _max_queued_bytes;
+      qint64 _released;
+      qint64 _total_latency;
+      qint64 _max_latency;
+      qint64 _blocked_count;
+  };
+}
+}
+
+#endif
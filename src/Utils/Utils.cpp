@@ -1,3 +1,4 @@
+#include <cstring>
 #include <QDebug>
 #include "Utils.hpp"
 
@@ -129,5 +130,21 @@ namespace Utils {
     tmp.truncate(offset);
     return tmp;
   }
+
+  void Xor(char *dst, const char *src, int length)
+  {
+    int idx = 0;
+    for(; idx + int(sizeof(quint64)) <= length; idx += sizeof(quint64)) {
+      quint64 lhs, rhs;
+      memcpy(&lhs, dst + idx, sizeof(quint64));
+      memcpy(&rhs, src + idx, sizeof(quint64));
+      lhs ^= rhs;
+      memcpy(dst + idx, &lhs, sizeof(quint64));
+    }
+
+    for(; idx < length; idx++) {
+      dst[idx] ^= src[idx];
+    }
+  }
 }
 }
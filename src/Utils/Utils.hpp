@@ -27,6 +27,14 @@ namespace Utils {
    * @returns a base64 decoded byte array
    */
   QByteArray FromUrlSafeBase64(const QByteArray &base64);
+
+  /**
+   * XORs src into dst, a machine word at a time
+   * @param dst the destination and lhs of the xor operation
+   * @param src rhs of the xor operation
+   * @param length the number of bytes to xor
+   */
+  void Xor(char *dst, const char *src, int length);
 }
 }
 
@@ -43,6 +43,7 @@ HEADERS += ext/googletest/include/gtest/gtest-death-test.h \
            src/Tests/SessionTest.hpp
 
 SOURCES += ext/googletest/src/gtest-all.cc \
+           src/Tests/AbstractGroupTest.cpp \
            src/Tests/AddressTest.cpp \
            src/Tests/Base64.cpp \
            src/Tests/BlogDropProof.cpp \
@@ -50,15 +51,19 @@ SOURCES += ext/googletest/src/gtest-all.cc \
            src/Tests/BlogDropUtilsTest.cpp \
            src/Tests/ConnectionTest.cpp \
            src/Tests/Crypto.cpp \
+           src/Tests/DnsCacheTest.cpp \
            src/Tests/DsaCryptoTest.cpp \
            src/Tests/EdgeTest.cpp \
            src/Tests/HashTest.cpp \
            src/Tests/IdTest.cpp \
            src/Tests/IntegerTest.cpp \
+           src/Tests/KeyPoolTest.cpp \
            src/Tests/KeyShareTest.cpp \
+           src/Tests/LogTest.cpp \
            src/Tests/MainTest.cpp \
            src/Tests/OnionTest.cpp \
            src/Tests/OverlayTest.cpp \
+           src/Tests/PadTest.cpp \
            src/Tests/RandomTest.cpp \
            src/Tests/RoundTest.cpp \
            src/Tests/RpcTest.cpp \
@@ -66,4 +71,6 @@ SOURCES += ext/googletest/src/gtest-all.cc \
            src/Tests/SessionTest.cpp \
            src/Tests/SettingsTest.cpp \
            src/Tests/TimeTest.cpp \
-           src/Tests/TripleTest.cpp
+           src/Tests/TraceRingTest.cpp \
+           src/Tests/TripleTest.cpp \
+           src/Tests/TunnelSchedulerTest.cpp
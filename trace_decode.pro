@@ -0,0 +1,9 @@
+include(dissent.pro)
+TEMPLATE = app
+TARGET = trace_decode
+INCLUDEPATH += src 
+#DEFINES += QT_NO_DEBUG_OUTPUT
+#DEFINES += QT_NO_WARNING_OUTPUT
+
+# Input
+SOURCES += src/Applications/TraceDecode.cpp